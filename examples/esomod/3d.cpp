@@ -9,9 +9,11 @@
 #include <hadesmem/find_pattern.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
+#include <hadesmem/static_pattern.hpp>
 #include <hadesmem/write.hpp>
 
-void Toggle3D(hadesmem::Process const& process)
+void Toggle3D(hadesmem::Process const& process,
+              hadesmem::ModuleScanContext& scan_context)
 {
   std::cout << "\nPreparing to toggle 3D.\n";
 
@@ -22,9 +24,9 @@ void Toggle3D(hadesmem::Process const& process)
   // .text:00C7A51C                 fst     dword ptr [eax+0F0h]
   // .text:00C7A522                 mov     dword ptr [eax+0ECh], 5
   auto const anaglyph_flag_ref = static_cast<std::uint8_t*>(
-    hadesmem::Find(process,
-                   L"",
-                   L"D9 90 F0 00 00 00 C7 80 EC 00 00 00 05 00 00 00",
+    hadesmem::Find(scan_context,
+                   HADESMEM_PATTERN(
+                     L"D9 90 F0 00 00 00 C7 80 EC 00 00 00 05 00 00 00"),
                    hadesmem::PatternFlags::kThrowOnUnmatch,
                    0));
   std::cout << "Got 3D flag ref. [" << static_cast<void*>(anaglyph_flag_ref)
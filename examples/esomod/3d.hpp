@@ -3,7 +3,9 @@
 
 namespace hadesmem
 {
+class ModuleScanContext;
 class Process;
 }
 
-void Toggle3D(hadesmem::Process const& process);
+void Toggle3D(hadesmem::Process const& process,
+              hadesmem::ModuleScanContext& scan_context);
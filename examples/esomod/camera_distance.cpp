@@ -9,9 +9,12 @@
 #include <hadesmem/find_pattern.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
+#include <hadesmem/static_pattern.hpp>
 #include <hadesmem/write.hpp>
 
-void SetMaxCameraDistance(hadesmem::Process const& process, float value)
+void SetMaxCameraDistance(hadesmem::Process const& process,
+                          hadesmem::ModuleScanContext& scan_context,
+                          float value)
 {
   std::cout << "\nPreparing to set max camera distance.\n";
 
@@ -21,9 +24,8 @@ void SetMaxCameraDistance(hadesmem::Process const& process, float value)
   // .text:0038DFF9                   fstp    [ebp+var_4]
   // .text:0038DFFC                   call    sub_43C680
   auto const global_pointer_manager_ref = static_cast<std::uint8_t*>(
-    hadesmem::Find(process,
-                   L"",
-                   L"D9 E8 8B 0D ?? ?? ?? ?? D9 5D FC E8",
+    hadesmem::Find(scan_context,
+                   HADESMEM_PATTERN(L"D9 E8 8B 0D ?? ?? ?? ?? D9 5D FC E8"),
                    hadesmem::PatternFlags::kThrowOnUnmatch,
                    0));
   std::cout << "Got global pointer manager ref. ["
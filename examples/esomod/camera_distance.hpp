@@ -3,7 +3,10 @@
 
 namespace hadesmem
 {
+class ModuleScanContext;
 class Process;
 }
 
-void SetMaxCameraDistance(hadesmem::Process const& process, float value);
+void SetMaxCameraDistance(hadesmem::Process const& process,
+                          hadesmem::ModuleScanContext& scan_context,
+                          float value);
@@ -9,9 +9,11 @@
 #include <hadesmem/find_pattern.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
+#include <hadesmem/static_pattern.hpp>
 #include <hadesmem/write.hpp>
 
-void ToggleFader(hadesmem::Process const& process)
+void ToggleFader(hadesmem::Process const& process,
+                 hadesmem::ModuleScanContext& scan_context)
 {
   std::cout << "\nPreparing to toggle fader.\n";
 
@@ -21,9 +23,9 @@ void ToggleFader(hadesmem::Process const& process)
   // .text:011C3921                 fstp    dword ptr [ebx]
   // .text:011C3923                 cmp     ds:byte_21282AA, 0
   auto const fader_flag_ref = static_cast<std::uint8_t*>(
-    hadesmem::Find(process,
-                   L"",
-                   L"8D BE ?? ?? ?? ?? 8D 9E ?? ?? ?? ?? D9 1B 80 3D",
+    hadesmem::Find(scan_context,
+                   HADESMEM_PATTERN(
+                     L"8D BE ?? ?? ?? ?? 8D 9E ?? ?? ?? ?? D9 1B 80 3D"),
                    hadesmem::PatternFlags::kThrowOnUnmatch,
                    0));
   std::cout << "Got fader flag ref. [" << static_cast<void*>(fader_flag_ref)
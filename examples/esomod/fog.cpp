@@ -9,9 +9,11 @@
 #include <hadesmem/find_pattern.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
+#include <hadesmem/static_pattern.hpp>
 #include <hadesmem/write.hpp>
 
-void ToggleFog(hadesmem::Process const& process)
+void ToggleFog(hadesmem::Process const& process,
+               hadesmem::ModuleScanContext& scan_context)
 {
   std::cout << "\nPreparing to toggle fog.\n";
 
@@ -20,9 +22,8 @@ void ToggleFog(hadesmem::Process const& process)
   // .text:019122D5                 call    sub_1919430
   // .text:019122DA                 cmp     ds:byte_21282AB, bl
   auto const fog_flag_ref = static_cast<std::uint8_t*>(
-    hadesmem::Find(process,
-                   L"",
-                   L"8D 8D 40 FF FF FF E8 ?? ?? ?? ?? 38 1D",
+    hadesmem::Find(scan_context,
+                   HADESMEM_PATTERN(L"8D 8D 40 FF FF FF E8 ?? ?? ?? ?? 38 1D"),
                    hadesmem::PatternFlags::kThrowOnUnmatch,
                    0));
   std::cout << "Got fog flag ref. [" << static_cast<void*>(fog_flag_ref)
@@ -3,7 +3,9 @@
 
 namespace hadesmem
 {
+class ModuleScanContext;
 class Process;
 }
 
-void ToggleFog(hadesmem::Process const& process);
+void ToggleFog(hadesmem::Process const& process,
+               hadesmem::ModuleScanContext& scan_context);
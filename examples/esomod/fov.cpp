@@ -9,6 +9,7 @@
 #include <hadesmem/find_pattern.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
+#include <hadesmem/static_pattern.hpp>
 #include <hadesmem/write.hpp>
 
 namespace
@@ -21,7 +22,10 @@ float DegToRad(float f)
 }
 }
 
-void SetFov(hadesmem::Process const& process, float* third, float* first)
+void SetFov(hadesmem::Process const& process,
+            hadesmem::ModuleScanContext& scan_context,
+            float* third,
+            float* first)
 {
   std::cout << "\nPreparing to set FoV.\n";
 
@@ -29,9 +33,9 @@ void SetFov(hadesmem::Process const& process, float* third, float* first)
   // .text:00A58435                 jnz     loc_A58641
   // .text:00A5843B                 mov     edx, dword_1BCA930
   auto const camera_manager_ref = static_cast<std::uint8_t*>(
-    hadesmem::Find(process,
-                   L"",
-                   L"0F 85 ?? ?? ?? ?? 8B 15 ?? ?? ?? ?? 8B 4A 14",
+    hadesmem::Find(scan_context,
+                   HADESMEM_PATTERN(
+                     L"0F 85 ?? ?? ?? ?? 8B 15 ?? ?? ?? ?? 8B 4A 14"),
                    hadesmem::PatternFlags::kThrowOnUnmatch,
                    0));
   std::cout << "Got camera manager ref. ["
@@ -3,7 +3,11 @@
 
 namespace hadesmem
 {
+class ModuleScanContext;
 class Process;
 }
 
-void SetFov(hadesmem::Process const& process, float* third, float* first);
+void SetFov(hadesmem::Process const& process,
+            hadesmem::ModuleScanContext& scan_context,
+            float* third,
+            float* first);
@@ -9,9 +9,12 @@
 #include <hadesmem/find_pattern.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
+#include <hadesmem/static_pattern.hpp>
 #include <hadesmem/write.hpp>
 
-void SetTime(hadesmem::Process const& process, float time)
+void SetTime(hadesmem::Process const& process,
+             hadesmem::ModuleScanContext& scan_context,
+             float time)
 {
   std::cout << "\nPreparing to set time.\n";
 
@@ -19,9 +22,8 @@ void SetTime(hadesmem::Process const& process, float time)
   // .text:006A7E56                 fiadd   [ebp+var_8]
   // .text:006A7E59                 fstp    flt_133BDB0
   auto const time_ref = static_cast<std::uint8_t*>(
-    hadesmem::Find(process,
-                   L"",
-                   L"DA 45 F8 D9 1D",
+    hadesmem::Find(scan_context,
+                   HADESMEM_PATTERN(L"DA 45 F8 D9 1D"),
                    hadesmem::PatternFlags::kThrowOnUnmatch,
                    0));
   std::cout << "Got time ref. [" << static_cast<void*>(time_ref) << "].\n";
@@ -3,7 +3,10 @@
 
 namespace hadesmem
 {
+class ModuleScanContext;
 class Process;
 }
 
-void SetTime(hadesmem::Process const& process, float time);
+void SetTime(hadesmem::Process const& process,
+             hadesmem::ModuleScanContext& scan_context,
+             float time);
@@ -9,9 +9,12 @@
 #include <hadesmem/find_pattern.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
+#include <hadesmem/static_pattern.hpp>
 #include <hadesmem/write.hpp>
 
-void SetToneMappingType(hadesmem::Process const& process, std::uint32_t type)
+void SetToneMappingType(hadesmem::Process const& process,
+                        hadesmem::ModuleScanContext& scan_context,
+                        std::uint32_t type)
 {
   std::cout << "\nPreparing to set tone mapping type.\n";
 
@@ -20,12 +23,11 @@ void SetToneMappingType(hadesmem::Process const& process, std::uint32_t type)
   // .text:00C74BD0                 cmp     eax, ebx
   // .text:00C74BD2                 jz      short loc_C74BE0
   // .text:00C74BD4                 push    eax
-  auto tone_mapping_type_ref =
-    static_cast<std::uint8_t*>(hadesmem::Find(process,
-                                              L"",
-                                              L"A1 ?? ?? ?? ?? 3B C3 74 0C 50",
-                                              hadesmem::PatternFlags::kNone,
-                                              0));
+  auto tone_mapping_type_ref = static_cast<std::uint8_t*>(
+    hadesmem::Find(scan_context,
+                   HADESMEM_PATTERN(L"A1 ?? ?? ?? ?? 3B C3 74 0C 50"),
+                   hadesmem::PatternFlags::kNone,
+                   0));
   auto tone_mapping_type_ref_offset = 0x01;
   if (!tone_mapping_type_ref)
   {
@@ -42,9 +44,9 @@ void SetToneMappingType(hadesmem::Process const& process, std::uint32_t type)
     // .text:00E8A42C                 call    sub_1338A70
     // .text:00E8A431                 mov     ecx, ds:dword_1C0F7A8
     tone_mapping_type_ref = static_cast<std::uint8_t*>(
-      hadesmem::Find(process,
-                     L"",
-                     L"74 1D 8D 8D ?? ?? ?? ?? E8 ?? ?? ?? ?? 8B 0D",
+      hadesmem::Find(scan_context,
+                     HADESMEM_PATTERN(
+                       L"74 1D 8D 8D ?? ?? ?? ?? E8 ?? ?? ?? ?? 8B 0D"),
                      hadesmem::PatternFlags::kThrowOnUnmatch,
                      0));
     tone_mapping_type_ref_offset = 0x0F;
@@ -5,7 +5,10 @@
 
 namespace hadesmem
 {
+class ModuleScanContext;
 class Process;
 }
 
-void SetToneMappingType(hadesmem::Process const& process, std::uint32_t type);
+void SetToneMappingType(hadesmem::Process const& process,
+                        hadesmem::ModuleScanContext& scan_context,
+                        std::uint32_t type);
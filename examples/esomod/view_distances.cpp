@@ -9,9 +9,11 @@
 #include <hadesmem/find_pattern.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
+#include <hadesmem/static_pattern.hpp>
 #include <hadesmem/write.hpp>
 
 void SetViewDistances(hadesmem::Process const& process,
+                      hadesmem::ModuleScanContext& scan_context,
                       float* min,
                       float* max,
                       float* value)
@@ -24,9 +26,9 @@ void SetViewDistances(hadesmem::Process const& process,
   // .text:00CBCB22                 fld     ds:flt_1C0F76C
   // .text:00CBCB28                 fcom    st(1)
   auto const max_and_cur_view_distance_ref = static_cast<std::uint8_t*>(
-    hadesmem::Find(process,
-                   L"",
-                   L"74 ?? D9 05 ?? ?? ?? ?? D9 05 ?? ?? ?? ?? D8 D1",
+    hadesmem::Find(scan_context,
+                   HADESMEM_PATTERN(
+                     L"74 ?? D9 05 ?? ?? ?? ?? D9 05 ?? ?? ?? ?? D8 D1"),
                    hadesmem::PatternFlags::kThrowOnUnmatch,
                    0));
   std::cout << "Got tone mapping type ref. ["
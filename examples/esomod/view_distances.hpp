@@ -3,10 +3,12 @@
 
 namespace hadesmem
 {
+class ModuleScanContext;
 class Process;
 }
 
 void SetViewDistances(hadesmem::Process const& process,
+                      hadesmem::ModuleScanContext& scan_context,
                       float* min,
                       float* max,
                       float* value);
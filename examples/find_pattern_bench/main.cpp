@@ -0,0 +1,290 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <tclap/CmdLine.h>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/compiled_pattern.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/pattern_search.hpp>
+#include <hadesmem/detail/str_conv.hpp>
+#include <hadesmem/detail/to_upper_ordinal.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/pelib/section.hpp>
+#include <hadesmem/pelib/section_list.hpp>
+#include <hadesmem/process.hpp>
+
+// Compares the vectorized wildcard search used by FindPattern against the
+// naive std::search based implementation it replaced, over the code sections
+// of real PE files (by default everything in the system directory).
+
+namespace
+{
+std::wstring GetDefaultDir()
+{
+  std::vector<wchar_t> buffer(HADESMEM_DETAIL_MAX_PATH_UNICODE);
+  UINT const len =
+    ::GetSystemDirectoryW(buffer.data(), static_cast<UINT>(buffer.size()));
+  if (!len || len >= buffer.size())
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error{} << hadesmem::ErrorString{"GetSystemDirectoryW failed."}
+                        << hadesmem::ErrorCodeWinLast{last_error});
+  }
+
+  return buffer.data();
+}
+
+bool IsPeFileName(std::wstring const& name)
+{
+  auto const ext_pos = name.rfind(L'.');
+  if (ext_pos == std::wstring::npos)
+  {
+    return false;
+  }
+
+  auto const ext = hadesmem::detail::ToUpperOrdinal(name.substr(ext_pos));
+  return ext == L".DLL" || ext == L".EXE" || ext == L".SYS";
+}
+
+void AppendCodeSections(hadesmem::Process const& process,
+                        std::vector<char>& file,
+                        std::vector<std::uint8_t>& corpus)
+{
+  auto const base = file.data();
+  auto const size = static_cast<DWORD>(file.size());
+  hadesmem::PeFile const pe_file{
+    process, base, hadesmem::PeFileType::Data, size};
+  hadesmem::SectionList const sections{process, pe_file};
+  for (auto const& section : sections)
+  {
+    if (!(section.GetCharacteristics() & IMAGE_SCN_CNT_CODE))
+    {
+      continue;
+    }
+
+    DWORD const raw_ptr = section.GetPointerToRawData();
+    DWORD const raw_size = section.GetSizeOfRawData();
+    if (raw_ptr >= size || raw_size > size - raw_ptr)
+    {
+      continue;
+    }
+
+    auto const beg = reinterpret_cast<std::uint8_t*>(base) + raw_ptr;
+    corpus.insert(std::end(corpus), beg, beg + raw_size);
+  }
+}
+
+std::vector<std::uint8_t> LoadCorpus(hadesmem::Process const& process,
+                                     std::wstring const& dir,
+                                     std::size_t max_size)
+{
+  std::vector<std::uint8_t> corpus;
+  corpus.reserve(max_size);
+
+  auto const append_file = [&](std::wstring const& name)
+  {
+    if (!IsPeFileName(name))
+    {
+      return true;
+    }
+
+    auto const path = hadesmem::detail::CombinePath(dir, name);
+    if (hadesmem::detail::IsDirectory(path))
+    {
+      return true;
+    }
+
+    // Skip anything we can't read or parse, we only need a representative
+    // sample of code.
+    try
+    {
+      auto file = hadesmem::detail::PeFileToBuffer(path);
+      AppendCodeSections(process, file, corpus);
+    }
+    catch (std::exception const& /*e*/)
+    {
+    }
+
+    return corpus.size() < max_size;
+  };
+  hadesmem::detail::EnumDir(dir, append_file);
+
+  if (corpus.size() > max_size)
+  {
+    corpus.resize(max_size);
+  }
+
+  return corpus;
+}
+
+template <typename F>
+std::size_t CountMatches(std::vector<std::uint8_t> const& corpus,
+                         std::size_t needle_size,
+                         F const& search)
+{
+  std::size_t count = 0;
+  auto const end = corpus.data() + corpus.size();
+  auto cur = corpus.data();
+  while (static_cast<std::size_t>(end - cur) >= needle_size)
+  {
+    auto const match = search(cur, end);
+    if (!match)
+    {
+      break;
+    }
+
+    ++count;
+    cur = match + 1;
+  }
+
+  return count;
+}
+
+template <typename F>
+double TimeMs(F const& f)
+{
+  auto const beg = std::chrono::high_resolution_clock::now();
+  f();
+  auto const end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - beg).count();
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    std::cout << "HadesMem FindPattern Benchmark [" << HADESMEM_VERSION_STRING
+              << "]\n";
+
+    TCLAP::CmdLine cmd{"FindPattern benchmark", ' ', HADESMEM_VERSION_STRING};
+    TCLAP::ValueArg<std::string> dir_arg{
+      "", "dir", "Directory of PE files to scan", false, "", "string", cmd};
+    TCLAP::ValueArg<std::size_t> size_arg{
+      "", "size", "Corpus size (MB)", false, 256, "size_t", cmd};
+    TCLAP::ValueArg<int> iterations_arg{
+      "", "iterations", "Iterations per pattern", false, 3, "int", cmd};
+    cmd.parse(argc, argv);
+
+    auto const dir = dir_arg.isSet() ? hadesmem::detail::MultiByteToWideChar(
+                                         dir_arg.getValue())
+                                     : GetDefaultDir();
+    std::size_t const max_size = size_arg.getValue() * 1024 * 1024;
+    int const iterations = (std::max)(iterations_arg.getValue(), 1);
+
+    hadesmem::Process const process{::GetCurrentProcessId()};
+
+    std::wcout << "\nLoading code sections from \"" << dir << "\".\n";
+    auto const corpus = LoadCorpus(process, dir, max_size);
+    double const corpus_mb =
+      static_cast<double>(corpus.size()) / (1024.0 * 1024.0);
+    std::cout << "Corpus Size: " << corpus_mb << " MB.\n";
+    std::cout << "AVX2: "
+              << (hadesmem::detail::IsAvx2Supported() ? "Yes" : "No") << "\n";
+    if (corpus.empty())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        hadesmem::Error{} << hadesmem::ErrorString{"Empty corpus."});
+    }
+
+    std::vector<std::wstring> const patterns = {
+      L"48 8B 05 ?? ?? ?? ?? 48 85 C0 74",
+      L"E8 ?? ?? ?? ?? 84 C0 75",
+      L"40 53 48 83 EC 20 48 8B D9",
+      L"0F B6 ?? ?? 3C ?? 74",
+      L"FF 15 ?? ?? ?? ?? 8B F? 85 F6",
+      L"8B FF 55 8B EC",
+      L"11 22 33 ?? 44 55 66",
+      L"CC CC CC CC CC CC CC CC"};
+
+    bool mismatch = false;
+    for (auto const& pattern : patterns)
+    {
+      hadesmem::CompiledPattern const needle{pattern};
+      hadesmem::detail::PatternSearcher const searcher{needle};
+
+      auto const fast_search = [&](std::uint8_t const* beg,
+                                   std::uint8_t const* end)
+      {
+        return searcher.Search(beg, end);
+      };
+
+      auto const naive_search = [&](std::uint8_t const* beg,
+                                    std::uint8_t const* end)
+      {
+        auto const iter = std::search(
+          beg,
+          end,
+          needle.GetValues(),
+          needle.GetValues() + needle.GetSize(),
+          [&](std::uint8_t const& h, std::uint8_t const& v)
+          {
+            return (h & needle.GetMasks()[&v - needle.GetValues()]) == v;
+          });
+        return iter == end ? nullptr : iter;
+      };
+
+      std::size_t fast_count = 0;
+      std::size_t naive_count = 0;
+      double fast_ms = 0;
+      double naive_ms = 0;
+      for (int i = 0; i < iterations; ++i)
+      {
+        fast_ms += TimeMs([&]()
+                          {
+                            fast_count = CountMatches(
+                              corpus, needle.GetSize(), fast_search);
+                          });
+        naive_ms += TimeMs([&]()
+                           {
+                             naive_count = CountMatches(
+                               corpus, needle.GetSize(), naive_search);
+                           });
+      }
+
+      fast_ms /= iterations;
+      naive_ms /= iterations;
+
+      std::wcout << L"\nPattern: \"" << pattern << L"\"\n";
+      std::cout << "Matches: " << fast_count << " (Reference: " << naive_count
+                << ").\n";
+      std::cout << "Vectorized: " << fast_ms << " ms ("
+                << corpus_mb / (fast_ms / 1000.0) << " MB/s).\n";
+      std::cout << "Reference: " << naive_ms << " ms ("
+                << corpus_mb / (naive_ms / 1000.0) << " MB/s).\n";
+
+      if (fast_count != naive_count)
+      {
+        std::cerr << "Error! Match count mismatch.\n";
+        mismatch = true;
+      }
+    }
+
+    std::cout << "\nDone.\n";
+
+    return mismatch ? 1 : 0;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n";
+    std::cerr << boost::current_exception_diagnostic_information() << '\n';
+
+    return 1;
+  }
+}
@@ -0,0 +1,67 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <tclap/CmdLine.h>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/str_conv.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/pattern_db.hpp>
+
+// Converts a FindPattern XML file to a precompiled pattern database, which can
+// then be loaded with hadesmem::PatternDb without any parsing at runtime.
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    std::cout << "HadesMem Pattern Database Compiler ["
+              << HADESMEM_VERSION_STRING << "]\n";
+
+    TCLAP::CmdLine cmd{
+      "Pattern database compiler", ' ', HADESMEM_VERSION_STRING};
+    TCLAP::ValueArg<std::string> input_arg{
+      "", "input", "Pattern file (XML)", true, "", "string", cmd};
+    TCLAP::ValueArg<std::string> output_arg{
+      "", "output", "Pattern database", true, "", "string", cmd};
+    cmd.parse(argc, argv);
+
+    auto const input =
+      hadesmem::detail::MultiByteToWideChar(input_arg.getValue());
+    auto const output =
+      hadesmem::detail::MultiByteToWideChar(output_arg.getValue());
+
+    std::vector<std::uint8_t> const db =
+      hadesmem::CompilePatternDb(input, false);
+
+    // Make sure what we're about to write can actually be loaded.
+    hadesmem::PatternDb const pattern_db{db.data(), db.size()};
+
+    hadesmem::detail::BufferToFile(
+      output, db.data(), static_cast<std::streamsize>(db.size()));
+
+    std::wcout << "\nWrote " << pattern_db.GetNumModules()
+               << " module(s) to \"" << output << "\" (" << db.size()
+               << " bytes).\n";
+
+    return 0;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n";
+    std::cerr << boost::current_exception_diagnostic_information() << '\n';
+
+    return 1;
+  }
+}
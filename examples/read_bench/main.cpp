@@ -0,0 +1,214 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <tclap/CmdLine.h>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/alloc.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/region_cache.hpp>
+#include <hadesmem/detail/scope_warden.hpp>
+#include <hadesmem/detail/self_path.hpp>
+#include <hadesmem/detail/smart_handle.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+#include <hadesmem/write.hpp>
+
+// Measures the cost of following pointer chains (the typical access pattern
+// when walking game or application data structures) with and without the
+// Process region cache. Without the cache every Read is a VirtualQueryEx call
+// followed by a ReadProcessMemory call. With it, only reads of regions which
+// haven't been seen before need to query the region first.
+
+// The chain is built in a suspended child process (another instance of this
+// executable), because reads of our own process are done with a guarded
+// memcpy rather than ReadProcessMemory, and so wouldn't measure anything.
+
+namespace
+{
+struct Node
+{
+  Node* next;
+  std::uint32_t value;
+};
+
+// Nodes are spread out across several allocations, like heap allocated data
+// structures would be.
+enum : std::size_t
+{
+  kBlockSize = 64 * 1024,
+  kNodeStride = 256,
+  kNodesPerBlock = kBlockSize / kNodeStride
+};
+
+struct ChildProcess
+{
+  hadesmem::detail::SmartHandle process;
+  hadesmem::detail::SmartHandle thread;
+  DWORD id;
+};
+
+ChildProcess CreateSuspendedChild()
+{
+  auto const command_line = L"\"" + hadesmem::detail::GetSelfPath() + L"\"";
+  std::vector<wchar_t> command_line_buf(std::begin(command_line),
+                                        std::end(command_line));
+  command_line_buf.push_back(L'\0');
+
+  STARTUPINFO start_info{};
+  PROCESS_INFORMATION proc_info{};
+  if (!::CreateProcessW(nullptr,
+                        command_line_buf.data(),
+                        nullptr,
+                        nullptr,
+                        FALSE,
+                        CREATE_SUSPENDED | CREATE_NO_WINDOW,
+                        nullptr,
+                        nullptr,
+                        &start_info,
+                        &proc_info))
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error{} << hadesmem::ErrorString{"CreateProcessW failed."}
+                        << hadesmem::ErrorCodeWinLast{last_error});
+  }
+
+  return ChildProcess{hadesmem::detail::SmartHandle{proc_info.hProcess},
+                      hadesmem::detail::SmartHandle{proc_info.hThread},
+                      proc_info.dwProcessId};
+}
+
+// Returns the head of the chain.
+Node* BuildChain(hadesmem::Process const& process, std::size_t length)
+{
+  std::vector<Node*> addresses;
+  while (addresses.size() < length)
+  {
+    auto const block =
+      static_cast<std::uint8_t*>(hadesmem::Alloc(process, kBlockSize));
+    for (std::size_t j = 0; j < kNodesPerBlock; ++j)
+    {
+      addresses.emplace_back(reinterpret_cast<Node*>(block + j * kNodeStride));
+    }
+  }
+
+  for (std::size_t i = 0; i < length; ++i)
+  {
+    Node const node{i + 1 < length ? addresses[i + 1] : nullptr,
+                    static_cast<std::uint32_t>(i)};
+    hadesmem::Write(process, addresses[i], node);
+  }
+
+  return length ? addresses.front() : nullptr;
+}
+
+template <typename F> double TimeMs(F const& f)
+{
+  auto const beg = std::chrono::high_resolution_clock::now();
+  f();
+  auto const end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - beg).count();
+}
+
+std::uint64_t WalkChain(hadesmem::Process const& process,
+                        Node* head,
+                        std::size_t iterations)
+{
+  std::uint64_t sum = 0;
+  for (std::size_t i = 0; i < iterations; ++i)
+  {
+    for (auto cur = head; cur;)
+    {
+      auto const node = hadesmem::Read<Node>(process, cur);
+      sum += node.value;
+      cur = node.next;
+    }
+  }
+
+  return sum;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    std::cout << "HadesMem Read Benchmark [" << HADESMEM_VERSION_STRING
+              << "]\n";
+
+    TCLAP::CmdLine cmd{"Read benchmark", ' ', HADESMEM_VERSION_STRING};
+    TCLAP::ValueArg<std::size_t> length_arg{
+      "", "length", "Pointer chain length", false, 1000, "size_t", cmd};
+    TCLAP::ValueArg<std::size_t> iterations_arg{
+      "", "iterations", "Chain walks per run", false, 100, "size_t", cmd};
+    cmd.parse(argc, argv);
+
+    std::size_t const length = length_arg.getValue();
+    std::size_t const iterations = iterations_arg.getValue();
+    std::size_t const num_reads = length * iterations;
+
+    auto const child = CreateSuspendedChild();
+    auto terminate_child = [&]()
+    {
+      ::TerminateProcess(child.process.GetHandle(), 0);
+    };
+    auto ensure_terminate_child =
+      hadesmem::detail::MakeScopeWarden(terminate_child);
+
+    hadesmem::Process process{child.id};
+    Node* const head = BuildChain(process, length);
+
+    std::uint64_t sum_uncached = 0;
+    double const uncached_ms = TimeMs([&]()
+                                      {
+                                        sum_uncached =
+                                          WalkChain(process, head, iterations);
+                                      });
+
+    process.SetRegionCacheEnabled(true);
+    std::uint64_t sum_cached = 0;
+    double const cached_ms = TimeMs([&]()
+                                    {
+                                      sum_cached =
+                                        WalkChain(process, head, iterations);
+                                    });
+    auto const region_cache = process.GetRegionCache();
+
+    // Only counters which are actually measured are reported. Misses are the
+    // only cached reads which need to query the region.
+    std::cout << "\nReads: " << num_reads << "\n";
+    std::cout << "Uncached: " << uncached_ms << " ms.\n";
+    std::cout << "Cached: " << cached_ms << " ms ("
+              << region_cache->GetNumHits() << " hits, "
+              << region_cache->GetNumMisses() << " misses, "
+              << region_cache->GetNumRegions() << " regions).\n";
+
+    if (sum_uncached != sum_cached)
+    {
+      std::cerr << "Error! Result mismatch.\n";
+      return 1;
+    }
+
+    return 0;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n";
+    std::cerr << boost::current_exception_diagnostic_information() << '\n';
+
+    return 1;
+  }
+}
@@ -55,6 +55,8 @@ inline void Free(Process const& process, LPVOID address)
                                     << ErrorString{"VirtualFreeEx failed."}
                                     << ErrorCodeWinLast{last_error});
   }
+
+  process.InvalidateRegionCache();
 }
 
 class Allocator
@@ -0,0 +1,369 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/read_impl.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/detail/type_traits.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+
+namespace hadesmem
+{
+// Read-through cache of the memory of a process, for workloads which read the
+// same pages over and over (e.g. chasing pointers or walking PE structures).
+// Memory is cached in 4 KiB pages, with the least recently used pages evicted
+// once the cache exceeds its budget.
+// The cache has no way of knowing when the memory of the target changes, so it
+// is up to the caller to call Invalidate when cached data may be stale.
+// Invalidate simply bumps the epoch, so it is cheap enough to call between
+// every 'frame' of work, and pages from old epochs are lazily refreshed.
+// Not safe to use from multiple threads.
+class CachedProcessReader
+{
+public:
+  enum : std::size_t
+  {
+    kPageSize = 0x1000,
+    kDefaultBudget = 0x400000
+  };
+
+  explicit CachedProcessReader(Process const& process,
+                               std::size_t budget = kDefaultBudget)
+    : process_{&process}, budget_{(std::max)(budget, std::size_t{kPageSize})}
+  {
+  }
+
+  explicit CachedProcessReader(Process const&& process,
+                               std::size_t budget = kDefaultBudget) = delete;
+
+  CachedProcessReader(CachedProcessReader const& other) = delete;
+
+  CachedProcessReader& operator=(CachedProcessReader const& other) = delete;
+
+  CachedProcessReader(CachedProcessReader&& other) = default;
+
+  CachedProcessReader& operator=(CachedProcessReader&& other) = default;
+
+  Process const& GetProcess() const noexcept
+  {
+    return *process_;
+  }
+
+  // Throws if any part of the range can't be read, with the same error that
+  // an uncached read of the range would have thrown.
+  void Read(void* address, void* data, std::size_t len)
+  {
+    HADESMEM_DETAIL_ASSERT(len ? address != nullptr : true);
+    HADESMEM_DETAIL_ASSERT(data != nullptr);
+
+    auto cur = reinterpret_cast<std::uintptr_t>(address);
+    auto out = static_cast<std::uint8_t*>(data);
+    while (len)
+    {
+      std::uintptr_t const page_base = cur & ~(kPageSize - 1);
+      std::size_t const offset = static_cast<std::size_t>(cur - page_base);
+      std::size_t const n = (std::min)(len, kPageSize - offset);
+      std::uint8_t const* const page = GetPage(page_base);
+      if (!page)
+      {
+        detail::ReadImpl(*process_, reinterpret_cast<void*>(cur), out, n);
+      }
+      else
+      {
+        std::memcpy(out, page + offset, n);
+      }
+
+      cur += n;
+      out += n;
+      len -= n;
+    }
+  }
+
+  // Returns a pointer to the cached copy of the page containing 'address',
+  // or nullptr if the page can't be read. Only valid until the next call to
+  // any other (non-const) member function.
+  std::uint8_t const* GetPage(void* address)
+  {
+    return GetPage(reinterpret_cast<std::uintptr_t>(address) &
+                   ~(kPageSize - 1));
+  }
+
+  void Invalidate() noexcept
+  {
+    ++epoch_;
+  }
+
+  void Invalidate(void* address, std::size_t len) noexcept
+  {
+    auto const beg = reinterpret_cast<std::uintptr_t>(address);
+    for (std::uintptr_t page_base = beg & ~(kPageSize - 1);
+         page_base < beg + len;
+         page_base += kPageSize)
+    {
+      auto const iter = index_.find(page_base);
+      if (iter != std::end(index_))
+      {
+        pages_.erase(iter->second);
+        index_.erase(iter);
+      }
+    }
+  }
+
+  std::uint64_t GetEpoch() const noexcept
+  {
+    return epoch_;
+  }
+
+  std::size_t GetBudget() const noexcept
+  {
+    return budget_;
+  }
+
+  void SetBudget(std::size_t budget)
+  {
+    budget_ = (std::max)(budget, std::size_t{kPageSize});
+    Trim();
+  }
+
+  std::size_t GetNumPages() const noexcept
+  {
+    return pages_.size();
+  }
+
+  std::size_t GetNumHits() const noexcept
+  {
+    return num_hits_;
+  }
+
+  std::size_t GetNumMisses() const noexcept
+  {
+    return num_misses_;
+  }
+
+  void ResetCounters() noexcept
+  {
+    num_hits_ = 0;
+    num_misses_ = 0;
+  }
+
+private:
+  struct Page
+  {
+    std::uintptr_t base;
+    std::uint64_t epoch;
+    std::array<std::uint8_t, kPageSize> data;
+  };
+
+  std::uint8_t const* GetPage(std::uintptr_t page_base)
+  {
+    auto const iter = index_.find(page_base);
+    if (iter != std::end(index_) && iter->second->epoch == epoch_)
+    {
+      ++num_hits_;
+      pages_.splice(std::begin(pages_), pages_, iter->second);
+      return iter->second->data.data();
+    }
+
+    ++num_misses_;
+
+    // Read into the spare node first, so that a failed read doesn't evict
+    // anything.
+    if (spare_.empty())
+    {
+      spare_.emplace_back();
+    }
+
+    Page& page = spare_.front();
+    try
+    {
+      detail::ReadImpl(*process_,
+                       reinterpret_cast<void*>(page_base),
+                       page.data.data(),
+                       page.data.size());
+    }
+    catch (Error const& /*e*/)
+    {
+      // The caller falls back to an uncached read of only the bytes it
+      // actually needs, which will either succeed or throw the right error.
+      return nullptr;
+    }
+
+    page.base = page_base;
+    page.epoch = epoch_;
+    pages_.splice(std::begin(pages_), spare_);
+
+    // The stale copy of this page, or the least recently used page if we're
+    // over our budget, becomes the spare node for the next miss rather than
+    // being freed.
+    if (iter != std::end(index_))
+    {
+      spare_.splice(std::begin(spare_), pages_, iter->second);
+    }
+    else if (pages_.size() * kPageSize > budget_)
+    {
+      spare_.splice(std::begin(spare_), pages_, std::prev(std::end(pages_)));
+      index_.erase(spare_.front().base);
+    }
+
+    index_[page_base] = std::begin(pages_);
+    return pages_.front().data.data();
+  }
+
+  void Trim()
+  {
+    spare_.clear();
+
+    while (pages_.size() * kPageSize > budget_)
+    {
+      index_.erase(pages_.back().base);
+      pages_.pop_back();
+    }
+  }
+
+  Process const* process_;
+  std::size_t budget_;
+  std::uint64_t epoch_{};
+  // Most recently used page first.
+  std::list<Page> pages_;
+  std::unordered_map<std::uintptr_t, std::list<Page>::iterator> index_;
+  // At most one page, which is read into before anything is evicted.
+  std::list<Page> spare_;
+  std::size_t num_hits_{};
+  std::size_t num_misses_{};
+};
+
+template <typename T>
+inline T Read(CachedProcessReader& reader, PVOID address)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(detail::IsTriviallyCopyable<T>::value);
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_default_constructible<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  T data;
+  reader.Read(address, std::addressof(data), sizeof(data));
+  return data;
+}
+
+template <typename T, std::size_t N>
+inline std::array<T, N> Read(CachedProcessReader& reader, PVOID address)
+{
+  return Read<std::array<T, N>>(reader, address);
+}
+
+template <typename T, typename Alloc = std::allocator<T>>
+inline std::vector<T, Alloc>
+  ReadVector(CachedProcessReader& reader, PVOID address, std::size_t count)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(detail::IsTriviallyCopyable<T>::value);
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_default_constructible<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(count ? address != nullptr : true);
+
+  if (!count)
+  {
+    return {};
+  }
+
+  std::vector<T, Alloc> data(count);
+  reader.Read(address, data.data(), sizeof(T) * count);
+  return data;
+}
+
+template <typename T, typename OutputIterator>
+void ReadStringBounded(CachedProcessReader& reader,
+                       PVOID address,
+                       OutputIterator data,
+                       void* upper_bound)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(detail::IsCharType<T>::value);
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_base_of<
+    std::output_iterator_tag,
+    typename std::iterator_traits<OutputIterator>::iterator_category>::value);
+
+  auto cur = reinterpret_cast<std::uintptr_t>(address);
+  auto const end = upper_bound ? reinterpret_cast<std::uintptr_t>(upper_bound)
+                               : ~static_cast<std::uintptr_t>(0);
+  while (cur + sizeof(T) <= end)
+  {
+    std::uintptr_t const page_base =
+      cur & ~(CachedProcessReader::kPageSize - 1);
+    std::uintptr_t const page_end = page_base + CachedProcessReader::kPageSize;
+    std::uint8_t const* const page =
+      reader.GetPage(reinterpret_cast<void*>(cur));
+    if (!page || cur + sizeof(T) > page_end)
+    {
+      // Unreadable page (so this throws) or a misaligned character which
+      // straddles two pages.
+      T const c = Read<T>(reader, reinterpret_cast<void*>(cur));
+      if (c == T())
+      {
+        return;
+      }
+
+      *data = c;
+      ++data;
+      cur += sizeof(T);
+      continue;
+    }
+
+    std::size_t const len =
+      static_cast<std::size_t>(((std::min)(page_end, end) - cur) / sizeof(T));
+    T const* const beg = reinterpret_cast<T const*>(page + (cur - page_base));
+    T const* const iter = std::find(beg, beg + len, T());
+    data = std::copy(beg, iter, data);
+    if (iter != beg + len)
+    {
+      return;
+    }
+
+    cur += len * sizeof(T);
+  }
+}
+
+template <typename T,
+          typename Traits = std::char_traits<T>,
+          typename Alloc = std::allocator<T>>
+std::basic_string<T, Traits, Alloc> ReadStringBounded(
+  CachedProcessReader& reader, PVOID address, void* upper_bound)
+{
+  std::basic_string<T, Traits, Alloc> data;
+  ReadStringBounded<T>(reader, address, std::back_inserter(data), upper_bound);
+  return data;
+}
+
+template <typename T, typename OutputIterator>
+void ReadString(CachedProcessReader& reader, PVOID address, OutputIterator data)
+{
+  return ReadStringBounded<T>(reader, address, data, nullptr);
+}
+
+template <typename T,
+          typename Traits = std::char_traits<T>,
+          typename Alloc = std::allocator<T>>
+std::basic_string<T, Traits, Alloc> ReadString(CachedProcessReader& reader,
+                                               PVOID address)
+{
+  return ReadStringBounded<T, Traits, Alloc>(reader, address, nullptr);
+}
+}
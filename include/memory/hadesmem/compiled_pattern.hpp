@@ -0,0 +1,339 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/error.hpp>
+
+namespace hadesmem
+{
+// Pattern stored as contiguous value and mask arrays, where a byte matches if
+// (byte & mask) == value. A mask of 0x00 is a wildcard, 0xFF is a fixed byte,
+// and 0xF0/0x0F are nibble wildcards.
+//
+// Text patterns are a whitespace separated list of hex bytes, where '??' is
+// a full wildcard and a single '?' nibble (e.g. 'D?' or '?D') is a nibble
+// wildcard. e.g. "48 8B 05 ?? ?? ?? ?? FF D?".
+//
+// Parsing is only done once, so a compiled pattern should be kept around and
+// reused if the same pattern is scanned for more than once.
+//
+// A pattern either owns its data, or is a view (see View) of arrays owned by
+// something else. Copies of a view are also views.
+class CompiledPattern
+{
+public:
+  CompiledPattern() = default;
+
+  explicit CompiledPattern(std::wstring const& data)
+  {
+    Parse(data.c_str(), data.c_str() + data.size());
+    Rebind();
+  }
+
+  explicit CompiledPattern(std::string const& data)
+  {
+    Parse(data.c_str(), data.c_str() + data.size());
+    Rebind();
+  }
+
+  explicit CompiledPattern(std::vector<std::uint8_t> values,
+                           std::vector<std::uint8_t> masks)
+    : values_(std::move(values)), masks_(std::move(masks))
+  {
+    if (values_.empty() || values_.size() != masks_.size())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Invalid pattern data."});
+    }
+
+    for (std::size_t i = 0; i < values_.size(); ++i)
+    {
+      values_[i] &= masks_[i];
+    }
+
+    Rebind();
+  }
+
+  CompiledPattern(CompiledPattern const& other)
+    : values_(other.values_),
+      masks_(other.masks_),
+      values_ptr_(other.values_ptr_),
+      masks_ptr_(other.masks_ptr_),
+      size_(other.size_)
+  {
+    Rebind();
+  }
+
+  CompiledPattern(CompiledPattern&& other) noexcept
+    : values_(std::move(other.values_)),
+      masks_(std::move(other.masks_)),
+      values_ptr_(other.values_ptr_),
+      masks_ptr_(other.masks_ptr_),
+      size_(other.size_)
+  {
+    Rebind();
+    other.Clear();
+  }
+
+  CompiledPattern& operator=(CompiledPattern const& other)
+  {
+    CompiledPattern tmp{other};
+    return *this = std::move(tmp);
+  }
+
+  CompiledPattern& operator=(CompiledPattern&& other) noexcept
+  {
+    values_ = std::move(other.values_);
+    masks_ = std::move(other.masks_);
+    values_ptr_ = other.values_ptr_;
+    masks_ptr_ = other.masks_ptr_;
+    size_ = other.size_;
+    Rebind();
+    other.Clear();
+    return *this;
+  }
+
+  // Refers to the given arrays instead of copying them, so they must outlive
+  // the pattern and every copy of it. Used to scan for patterns straight out
+  // of a mapped PatternDb. The values must already be masked.
+  static CompiledPattern View(std::uint8_t const* values,
+                              std::uint8_t const* masks,
+                              std::size_t size) noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(values && masks && size);
+
+    CompiledPattern pattern;
+    pattern.values_ptr_ = values;
+    pattern.masks_ptr_ = masks;
+    pattern.size_ = size;
+    return pattern;
+  }
+
+  std::size_t GetSize() const noexcept
+  {
+    return size_;
+  }
+
+  bool IsEmpty() const noexcept
+  {
+    return !size_;
+  }
+
+  std::uint8_t const* GetValues() const noexcept
+  {
+    return values_ptr_;
+  }
+
+  std::uint8_t const* GetMasks() const noexcept
+  {
+    return masks_ptr_;
+  }
+
+  bool IsWildcard(std::size_t i) const noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(i < size_);
+    return !masks_ptr_[i];
+  }
+
+  bool IsFixed(std::size_t i) const noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(i < size_);
+    return masks_ptr_[i] == 0xFF;
+  }
+
+  // Caller is responsible for ensuring there are at least GetSize() bytes
+  // available.
+  bool Matches(std::uint8_t const* data) const noexcept
+  {
+    for (std::size_t i = 0; i < size_; ++i)
+    {
+      if ((data[i] & masks_ptr_[i]) != values_ptr_[i])
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+private:
+  // Points the accessors at our own data, unless we're a view.
+  void Rebind() noexcept
+  {
+    if (!values_.empty())
+    {
+      values_ptr_ = values_.data();
+      masks_ptr_ = masks_.data();
+      size_ = values_.size();
+    }
+  }
+
+  void Clear() noexcept
+  {
+    values_.clear();
+    masks_.clear();
+    values_ptr_ = nullptr;
+    masks_ptr_ = nullptr;
+    size_ = 0;
+  }
+
+  template <typename CharT> static bool IsSpace(CharT c) noexcept
+  {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  }
+
+  template <typename CharT> static int HexDigitToInt(CharT c) noexcept
+  {
+    if (c >= '0' && c <= '9')
+    {
+      return c - '0';
+    }
+
+    if (c >= 'a' && c <= 'f')
+    {
+      return c - 'a' + 10;
+    }
+
+    if (c >= 'A' && c <= 'F')
+    {
+      return c - 'A' + 10;
+    }
+
+    return -1;
+  }
+
+  template <typename CharT> void Parse(CharT const* beg, CharT const* end)
+  {
+    values_.reserve(static_cast<std::size_t>(end - beg) / 3 + 1);
+    masks_.reserve(static_cast<std::size_t>(end - beg) / 3 + 1);
+
+    for (CharT const* cur = beg;;)
+    {
+      while (cur != end && IsSpace(*cur))
+      {
+        ++cur;
+      }
+
+      if (cur == end)
+      {
+        break;
+      }
+
+      CharT const* const token_beg = cur;
+      while (cur != end && !IsSpace(*cur))
+      {
+        ++cur;
+      }
+
+      ParseToken(token_beg, cur);
+    }
+
+    if (values_.empty())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Data parsing failed."});
+    }
+  }
+
+  template <typename CharT>
+  void ParseToken(CharT const* beg, CharT const* end)
+  {
+    std::size_t const len = static_cast<std::size_t>(end - beg);
+
+    // Wildcards are only supported in the short form, with exactly one
+    // character per nibble.
+    if (len == 2 && (beg[0] == '?' || beg[1] == '?'))
+    {
+      int const hi = beg[0] == '?' ? 0 : HexDigitToInt(beg[0]);
+      int const lo = beg[1] == '?' ? 0 : HexDigitToInt(beg[1]);
+      if (hi < 0 || lo < 0)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Data conversion failed."});
+      }
+
+      std::uint8_t const mask = static_cast<std::uint8_t>(
+        (beg[0] == '?' ? 0x00 : 0xF0) | (beg[1] == '?' ? 0x00 : 0x0F));
+      values_.emplace_back(static_cast<std::uint8_t>((hi << 4) | lo));
+      masks_.emplace_back(mask);
+      return;
+    }
+
+    // Accept an optional '0x' prefix and leading zeros for compatibility with
+    // the old stream based parser.
+    CharT const* cur = beg;
+    if (len > 2 && cur[0] == '0' && (cur[1] == 'x' || cur[1] == 'X'))
+    {
+      cur += 2;
+    }
+
+    if (cur == end)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Data conversion failed."});
+    }
+
+    std::uint32_t value = 0;
+    for (; cur != end; ++cur)
+    {
+      int const digit = HexDigitToInt(*cur);
+      if (digit < 0)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Data conversion failed."});
+      }
+
+      value = (value << 4) | static_cast<std::uint32_t>(digit);
+      if (value > 0xFF)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                        << ErrorString{"Invalid data."});
+      }
+    }
+
+    values_.emplace_back(static_cast<std::uint8_t>(value));
+    masks_.emplace_back(static_cast<std::uint8_t>(0xFF));
+  }
+
+  std::vector<std::uint8_t> values_;
+  std::vector<std::uint8_t> masks_;
+  std::uint8_t const* values_ptr_{};
+  std::uint8_t const* masks_ptr_{};
+  std::size_t size_{};
+};
+
+inline bool operator==(CompiledPattern const& lhs,
+                       CompiledPattern const& rhs) noexcept
+{
+  if (lhs.GetSize() != rhs.GetSize())
+  {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < lhs.GetSize(); ++i)
+  {
+    if (lhs.GetValues()[i] != rhs.GetValues()[i] ||
+        lhs.GetMasks()[i] != rhs.GetMasks()[i])
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+inline bool operator!=(CompiledPattern const& lhs,
+                       CompiledPattern const& rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+}
@@ -9,6 +9,7 @@
 #include <limits>
 
 #include <hadesmem/config.hpp>
+#include <hadesmem/detail/scratch_buffer.hpp>
 #include <hadesmem/detail/str_conv.hpp>
 #include <hadesmem/module.hpp>
 #include <hadesmem/module_list.hpp>
@@ -23,6 +24,7 @@
 #include <hadesmem/pelib/section_list.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/process_helpers.hpp>
+#include <hadesmem/read.hpp>
 
 namespace hadesmem
 {
@@ -114,23 +116,32 @@ inline void DumpAllModules(hadesmem::Process const& process)
 
     HADESMEM_DETAIL_TRACE_A("Reading memory.");
 
-    auto raw = hadesmem::ReadVectorEx<std::uint8_t>(
-      process,
-      module.GetHandle(),
-      module.GetSize(),
-      hadesmem::ReadFlags::kZeroFillReserved);
-    hadesmem::Process const local_process(::GetCurrentProcessId());
+    // Only needed until the rebuilt copy has been written out, so reuse the
+    // scratch buffer rather than allocating (and zeroing) a new one for every
+    // module.
+    std::size_t const raw_size = module.GetSize();
+    ScopedScratch scratch{GetScanScratch()};
+    std::uint8_t* const raw = scratch.Get(raw_size);
+    hadesmem::ReadSpan(process,
+                       module.GetHandle(),
+                       raw,
+                       raw_size,
+                       hadesmem::ReadFlags::kZeroFillReserved);
+    // Only ever used to parse our own copies of the module, so there's no
+    // need to query (or reprotect) each region we touch.
+    hadesmem::Process local_process(::GetCurrentProcessId());
+    local_process.SetTrustedBufferMode(true);
     hadesmem::PeFile const pe_file(local_process,
-                                   raw.data(),
+                                   raw,
                                    hadesmem::PeFileType::Image,
-                                   static_cast<DWORD>(raw.size()));
+                                   static_cast<DWORD>(raw_size));
     hadesmem::NtHeaders nt_headers(local_process, pe_file);
 
     HADESMEM_DETAIL_TRACE_A("Copying headers.");
 
     std::vector<std::uint8_t> raw_new;
-    std::copy(std::begin(raw),
-              std::begin(raw) + nt_headers.GetSizeOfHeaders(),
+    std::copy(raw,
+              raw + nt_headers.GetSizeOfHeaders(),
               std::back_inserter(raw_new));
 
     HADESMEM_DETAIL_TRACE_A("Copying section data.");
@@ -153,7 +164,7 @@ inline void DumpAllModules(hadesmem::Process const& process)
         raw_new.resize(ptr_raw_data_new);
       }
 
-      auto const raw_data = raw.data() + section.GetVirtualAddress();
+      auto const raw_data = raw + section.GetVirtualAddress();
       auto const raw_data_end = raw_data + section_size;
       raw_new.reserve(raw_new.size() + section_size);
       std::copy(raw_data, raw_data_end, std::back_inserter(raw_new));
@@ -187,8 +198,15 @@ inline void DumpAllModules(hadesmem::Process const& process)
 
     HADESMEM_DETAIL_TRACE_A("Fixing imports.");
 
+    // PeFile caches the headers, so it has to be recreated to see the new
+    // section layout.
+    hadesmem::PeFile const pe_file_fixed(local_process,
+                                         raw_new.data(),
+                                         hadesmem::PeFileType::Data,
+                                         static_cast<DWORD>(raw_new.size()));
     hadesmem::ImportDirList const import_dirs(local_process, pe_file);
-    hadesmem::ImportDirList const import_dirs_new(local_process, pe_file_new);
+    hadesmem::ImportDirList const import_dirs_new(local_process,
+                                                  pe_file_fixed);
     auto i = std::begin(import_dirs), j = std::begin(import_dirs_new);
     bool thunk_mismatch = false;
     for (; i != std::end(import_dirs) && j != std::end(import_dirs_new);
@@ -197,7 +215,7 @@ inline void DumpAllModules(hadesmem::Process const& process)
       hadesmem::ImportThunkList const import_thunks(
         local_process, pe_file, i->GetOriginalFirstThunk());
       hadesmem::ImportThunkList import_thunks_new(
-        local_process, pe_file_new, j->GetFirstThunk());
+        local_process, pe_file_fixed, j->GetFirstThunk());
       auto a = std::begin(import_thunks);
       auto b = std::begin(import_thunks_new);
       for (; a != std::end(import_thunks) && b != std::end(import_thunks_new);
@@ -240,10 +258,11 @@ inline void DumpMemoryRegionRaw(hadesmem::Process const& process,
 {
   HADESMEM_DETAIL_TRACE_A("Reading memory.");
 
-  auto raw = hadesmem::ReadVector<std::uint8_t>(process, base, size);
+  ScopedScratch scratch{GetScanScratch()};
+  std::uint8_t* const raw = scratch.Get(size);
+  hadesmem::ReadSpan(process, base, raw, size);
 
-  WriteDumpFile(
-    process, PtrToHexString(base), raw.data(), raw.size(), L"raw_dumps");
+  WriteDumpFile(process, PtrToHexString(base), raw, size, L"raw_dumps");
 }
 
 inline void DumpMemory(
@@ -3,18 +3,22 @@
 
 #pragma once
 
-#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <memory>
 #include <string>
 
 #include <windows.h>
 
-#include <hadesmem/pelib/export_list.hpp>
 #include <hadesmem/detail/alias_cast.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/query_region.hpp>
 #include <hadesmem/detail/static_assert.hpp>
 #include <hadesmem/detail/str_conv.hpp>
+#include <hadesmem/detail/symbol_cache.hpp>
 #include <hadesmem/error.hpp>
 #include <hadesmem/module.hpp>
-#include <hadesmem/pelib/export.hpp>
+#include <hadesmem/pelib/export_index.hpp>
 #include <hadesmem/pelib/pe_file.hpp>
 #include <hadesmem/process.hpp>
 
@@ -22,69 +26,217 @@ namespace hadesmem
 {
 namespace detail
 {
-inline FARPROC GetProcAddressFromExport(Process const& process,
-                                        Export const& e);
+inline FARPROC GetProcAddressFromTarget(Process const& process,
+                                        ExportTarget const& target);
 
-template <typename Pred>
-inline FARPROC GetProcAddressInternalFromPred(Process const& process,
-                                              HMODULE module,
-                                              Pred pred)
+// Nothing tells us when a remote process loads or unloads a module, so a
+// cache hit is only used if the module is still mapped as an image at the same
+// base, and the address found (if any, which may be in a forwarder module) is
+// still inside an image. Otherwise the whole cache is invalidated, as the set
+// of loaded modules has changed. A different module loaded at the same base
+// isn't caught, so InvalidateSymbolCache is still needed if that can happen.
+// Loads and unloads in the current process invalidate the cache as they
+// happen, and snapshots never change, so neither is checked.
+inline bool CheckCachedImage(Process const& process,
+                             SymbolCache& symbol_cache,
+                             HMODULE module,
+                             void const* address = nullptr)
+{
+  if (process.IsSelf() || process.GetSnapshot())
+  {
+    return true;
+  }
+
+  MEMORY_BASIC_INFORMATION const module_mbi = Query(process, module);
+  bool valid = module_mbi.Type == MEM_IMAGE &&
+               module_mbi.AllocationBase == static_cast<void*>(module);
+  if (valid && address)
+  {
+    valid = Query(process, address).Type == MEM_IMAGE;
+  }
+
+  if (!valid)
+  {
+    symbol_cache.Invalidate();
+  }
+
+  return valid;
+}
+
+// 'find' looks the export up on a cache miss. Only successful lookups are
+// cached.
+template <typename KeyT, typename FindFn>
+inline FARPROC GetProcAddressCached(Process const& process,
+                                    HMODULE module,
+                                    KeyT const& key,
+                                    FindFn find)
 {
   HADESMEM_DETAIL_STATIC_ASSERT(sizeof(FARPROC) == sizeof(void*));
 
-  PeFile const pe_file{process, module, PeFileType::Image, 0};
+  SymbolCache* const symbol_cache = process.GetSymbolCache();
+  FARPROC proc = nullptr;
+  if (symbol_cache && symbol_cache->FindProcedure(module, key, proc) &&
+      CheckCachedImage(process, *symbol_cache, module, AliasCast<void*>(proc)))
+  {
+    return proc;
+  }
+
+  std::uint32_t const generation =
+    symbol_cache ? symbol_cache->GetGeneration() : 0;
 
-  ExportList const exports{process, pe_file};
-  auto const iter = std::find_if(std::begin(exports), std::end(exports), pred);
-  if (iter != std::end(exports))
+  ExportTarget target;
+  if (!find(target))
   {
-    return GetProcAddressFromExport(process, *iter);
+    return nullptr;
   }
 
-  return nullptr;
+  // Forwarders are resolved through GetProcAddressInternal, so every link in
+  // the chain is cached too.
+  proc = GetProcAddressFromTarget(process, target);
+  if (symbol_cache && proc)
+  {
+    symbol_cache->InsertProcedure(generation, module, key, proc);
+  }
+
+  return proc;
+}
+
+// Null if the export directory is malformed, which is treated as empty (as it
+// is by ExportList). Any other error (e.g. a failed read) is thrown. The index
+// is kept in the symbol cache, so it is only built once per module.
+inline std::shared_ptr<ExportIndex const>
+  GetExportIndex(Process const& process, HMODULE module)
+{
+  SymbolCache* const symbol_cache = process.GetSymbolCache();
+  std::shared_ptr<ExportIndex const> exports;
+  if (symbol_cache && symbol_cache->FindExportIndex(module, exports) &&
+      CheckCachedImage(process, *symbol_cache, module))
+  {
+    return exports;
+  }
+
+  std::uint32_t const generation =
+    symbol_cache ? symbol_cache->GetGeneration() : 0;
+
+  try
+  {
+    PeFile const pe_file{process, module, PeFileType::Image, 0};
+    exports = std::make_shared<ExportIndex const>(process, pe_file);
+  }
+  catch (Error const& e)
+  {
+    if (!IsInvalidExportDirError(e))
+    {
+      throw;
+    }
+
+    return nullptr;
+  }
+
+  if (symbol_cache)
+  {
+    symbol_cache->InsertExportIndex(generation, module, exports);
+  }
+
+  return exports;
 }
 
 inline FARPROC GetProcAddressInternal(Process const& process,
                                       HMODULE module,
                                       std::string const& name)
 {
-  auto const pred = [&](Export const& e)
-  {
-    return e.ByName() && e.GetName() == name;
-  };
-  return GetProcAddressInternalFromPred(process, module, pred);
+  return GetProcAddressCached(
+    process,
+    module,
+    name,
+    [&](ExportTarget& target)
+    {
+      auto const exports = GetExportIndex(process, module);
+      return exports && exports->FindByName(name, target);
+    });
 }
 
 inline FARPROC
   GetProcAddressInternal(Process const& process, HMODULE module, WORD ordinal)
 {
-  auto const pred = [&](Export const& e)
+  return GetProcAddressCached(
+    process,
+    module,
+    ordinal,
+    [&](ExportTarget& target)
+    {
+      auto const exports = GetExportIndex(process, module);
+      return exports && exports->FindByProcedureNumber(ordinal, target);
+    });
+}
+
+// Looking a module up by name needs a module snapshot, so the handle is
+// cached.
+inline HMODULE GetForwarderModule(Process const& process,
+                                  std::string const& name)
+{
+  std::wstring const name_wide = MultiByteToWideChar(name);
+
+  SymbolCache* const symbol_cache = process.GetSymbolCache();
+  HMODULE module = nullptr;
+  if (symbol_cache && symbol_cache->FindModule(name_wide, module) &&
+      CheckCachedImage(process, *symbol_cache, module))
   {
-    return e.ByOrdinal() && e.GetProcedureNumber() == ordinal;
-  };
-  return GetProcAddressInternalFromPred(process, module, pred);
+    return module;
+  }
+
+  std::uint32_t const generation =
+    symbol_cache ? symbol_cache->GetGeneration() : 0;
+  module = Module{process, name_wide}.GetHandle();
+  if (symbol_cache)
+  {
+    symbol_cache->InsertModule(generation, name_wide, module);
+  }
+
+  return module;
+}
+
+inline bool IsForwardedByOrdinal(ExportTarget const& target)
+{
+  return !target.forwarder_function.empty() &&
+         target.forwarder_function[0] == '#';
+}
+
+inline WORD GetForwarderOrdinal(ExportTarget const& target)
+{
+  HADESMEM_DETAIL_ASSERT(IsForwardedByOrdinal(target));
+
+  try
+  {
+    return StrToNum<WORD>(target.forwarder_function.substr(1));
+  }
+  catch (std::exception const& /*e*/)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Invalid forwarder ordinal detected."});
+  }
 }
 
-inline FARPROC GetProcAddressFromExport(Process const& process, Export const& e)
+inline FARPROC GetProcAddressFromTarget(Process const& process,
+                                        ExportTarget const& target)
 {
-  if (e.IsForwarded())
+  if (target.forwarded)
   {
-    std::string const forwarder_module_name{e.GetForwarderModule()};
-    Module const forwarder_module{process,
-                                  MultiByteToWideChar(forwarder_module_name)};
-    if (e.IsForwardedByOrdinal())
+    HMODULE const forwarder_module =
+      GetForwarderModule(process, target.forwarder_module);
+    if (IsForwardedByOrdinal(target))
     {
       return GetProcAddressInternal(
-        process, forwarder_module.GetHandle(), e.GetForwarderOrdinal());
+        process, forwarder_module, GetForwarderOrdinal(target));
     }
     else
     {
       return GetProcAddressInternal(
-        process, forwarder_module.GetHandle(), e.GetForwarderFunction());
+        process, forwarder_module, target.forwarder_function);
     }
   }
 
-  return AliasCast<FARPROC>(e.GetVa());
+  return AliasCast<FARPROC>(target.va);
 }
 }
 }
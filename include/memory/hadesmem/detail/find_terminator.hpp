@@ -0,0 +1,74 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <emmintrin.h>
+#include <intrin.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+template <typename T>
+inline T const* FindTerminatorImpl(T const* beg,
+                                   T const* end,
+                                   std::integral_constant<std::size_t, 1>)
+{
+  // The CRT's memchr is already vectorized.
+  auto const iter = std::memchr(beg, 0, static_cast<std::size_t>(end - beg));
+  return iter ? static_cast<T const*>(iter) : end;
+}
+
+template <typename T>
+inline T const* FindTerminatorImpl(T const* beg,
+                                   T const* end,
+                                   std::integral_constant<std::size_t, 2>)
+{
+  __m128i const zero = _mm_setzero_si128();
+  T const* cur = beg;
+  for (; end - cur >= 8; cur += 8)
+  {
+    __m128i const chars =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(cur));
+    auto const bits = static_cast<unsigned long>(
+      _mm_movemask_epi8(_mm_cmpeq_epi16(chars, zero)));
+    if (bits)
+    {
+      unsigned long index = 0;
+      _BitScanForward(&index, bits);
+      return cur + index / 2;
+    }
+  }
+
+  return std::find(cur, end, T());
+}
+
+template <typename T, std::size_t N>
+inline T const* FindTerminatorImpl(T const* beg,
+                                   T const* end,
+                                   std::integral_constant<std::size_t, N>)
+{
+  return std::find(beg, end, T());
+}
+
+// Equivalent to std::find(beg, end, T()), but vectorized for narrow and wide
+// characters.
+template <typename T> inline T const* FindTerminator(T const* beg, T const* end)
+{
+  HADESMEM_DETAIL_ASSERT(beg <= end);
+
+  return FindTerminatorImpl(
+    beg, end, std::integral_constant<std::size_t, sizeof(T)>{});
+}
+}
+}
@@ -0,0 +1,46 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+inline int GuardedCopyFilter(DWORD code) noexcept
+{
+  return (code == EXCEPTION_ACCESS_VIOLATION ||
+          code == EXCEPTION_IN_PAGE_ERROR ||
+          code == STATUS_GUARD_PAGE_VIOLATION)
+           ? EXCEPTION_EXECUTE_HANDLER
+           : EXCEPTION_CONTINUE_SEARCH;
+}
+
+// memcpy within the current process which fails (setting the last error to
+// ERROR_NOACCESS) rather than crashing if either buffer is inaccessible, e.g.
+// because it was freed or reprotected by another thread since it was checked.
+// Must not contain any objects with destructors, as it uses SEH.
+// WARNING: Touching a guard page consumes it, the same as any other access.
+inline bool GuardedCopy(void* dst, void const* src, std::size_t len) noexcept
+{
+  __try
+  {
+    std::memcpy(dst, src, len);
+  }
+  __except (GuardedCopyFilter(GetExceptionCode()))
+  {
+    ::SetLastError(ERROR_NOACCESS);
+    return false;
+  }
+
+  return true;
+}
+}
+}
@@ -0,0 +1,157 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else // #if defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // #if defined(_WIN32)
+
+#include <hadesmem/error.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+// Read-only view of an entire file, e.g. for parsing with PeView.
+class MappedFile
+{
+public:
+#if defined(_WIN32)
+  using PathT = std::wstring;
+#else // #if defined(_WIN32)
+  using PathT = std::string;
+#endif // #if defined(_WIN32)
+
+  explicit MappedFile(PathT const& path)
+  {
+    Map(path);
+  }
+
+  MappedFile(MappedFile const&) = delete;
+
+  MappedFile& operator=(MappedFile const&) = delete;
+
+  ~MappedFile()
+  {
+    Unmap();
+  }
+
+  void const* GetData() const noexcept
+  {
+    return data_;
+  }
+
+  std::size_t GetSize() const noexcept
+  {
+    return size_;
+  }
+
+private:
+#if defined(_WIN32)
+  void Map(PathT const& path)
+  {
+    HANDLE const file = ::CreateFileW(path.c_str(),
+                                      GENERIC_READ,
+                                      FILE_SHARE_READ,
+                                      nullptr,
+                                      OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL,
+                                      nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"CreateFileW failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    LARGE_INTEGER size{};
+    HANDLE mapping = nullptr;
+    if (::GetFileSizeEx(file, &size) && size.QuadPart)
+    {
+      mapping =
+        ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    DWORD const last_error = ::GetLastError();
+    ::CloseHandle(file);
+    if (!mapping)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"CreateFileMappingW failed."}
+                << ErrorCodeWinLast{size.QuadPart ? last_error
+                                                  : ERROR_FILE_INVALID});
+    }
+
+    data_ = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    DWORD const map_last_error = ::GetLastError();
+    ::CloseHandle(mapping);
+    if (!data_)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"MapViewOfFile failed."}
+                                      << ErrorCodeWinLast{map_last_error});
+    }
+
+    size_ = static_cast<std::size_t>(size.QuadPart);
+  }
+
+  void Unmap() noexcept
+  {
+    ::UnmapViewOfFile(data_);
+  }
+#else // #if defined(_WIN32)
+  void Map(PathT const& path)
+  {
+    int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+      int const last_error = errno;
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{} << ErrorString{"open failed."}
+                                              << ErrorCodeErrno{last_error});
+    }
+
+    struct stat st = {};
+    void* data = MAP_FAILED;
+    if (!::fstat(fd, &st) && st.st_size)
+    {
+      data = ::mmap(nullptr,
+                    static_cast<std::size_t>(st.st_size),
+                    PROT_READ,
+                    MAP_PRIVATE,
+                    fd,
+                    0);
+    }
+    int const last_error = st.st_size ? errno : EINVAL;
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{} << ErrorString{"mmap failed."}
+                                              << ErrorCodeErrno{last_error});
+    }
+
+    data_ = data;
+    size_ = static_cast<std::size_t>(st.st_size);
+  }
+
+  void Unmap() noexcept
+  {
+    ::munmap(data_, size_);
+  }
+#endif // #if defined(_WIN32)
+
+  void* data_{};
+  std::size_t size_{};
+};
+}
+}
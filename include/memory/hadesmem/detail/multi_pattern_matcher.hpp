@@ -0,0 +1,279 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <hadesmem/compiled_pattern.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/error.hpp>
+
+// TODO: Compress the transition table using byte equivalence classes if the
+// memory usage ever becomes a problem for very large pattern files.
+
+namespace hadesmem
+{
+namespace detail
+{
+// Aho-Corasick automaton built over a fixed-length literal 'anchor' taken from
+// each pattern. Every anchor hit is a candidate which is then verified against
+// the full masked pattern, so a single pass over a buffer is
+// enough to resolve the first match of every pattern.
+class MultiPatternMatcher
+{
+public:
+  // Longer anchors reduce the number of candidates which need verifying, but
+  // increase the number of states (and so the size of the transition table).
+  static std::size_t const kMaxAnchorLen = 8;
+
+  std::size_t Add(CompiledPattern const& pattern)
+  {
+    HADESMEM_DETAIL_ASSERT(!compiled_);
+
+    if (pattern.IsEmpty())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Empty pattern."});
+    }
+
+    // Use the longest run of fixed bytes as the anchor, because it's the most
+    // selective literal we can feed to the automaton. Nibble wildcards are
+    // treated the same as full wildcards here and only checked on verify.
+    std::size_t anchor_beg = 0;
+    std::size_t anchor_len = 0;
+    for (std::size_t i = 0; i < pattern.GetSize();)
+    {
+      if (!pattern.IsFixed(i))
+      {
+        ++i;
+        continue;
+      }
+
+      std::size_t j = i;
+      while (j < pattern.GetSize() && pattern.IsFixed(j))
+      {
+        ++j;
+      }
+
+      if (j - i > anchor_len)
+      {
+        anchor_beg = i;
+        anchor_len = j - i;
+      }
+
+      i = j;
+    }
+
+    if (anchor_len > kMaxAnchorLen)
+    {
+      anchor_len = kMaxAnchorLen;
+    }
+
+    patterns_.emplace_back(PatternInfo{pattern, anchor_beg, anchor_len});
+    return patterns_.size() - 1;
+  }
+
+  void Compile()
+  {
+    HADESMEM_DETAIL_ASSERT(!compiled_);
+
+    transitions_.assign(kAlphabetSize, kNoState);
+    outputs_.assign(1, std::vector<std::size_t>());
+
+    for (std::size_t id = 0; id < patterns_.size(); ++id)
+    {
+      auto const& p = patterns_[id];
+      max_pattern_len_ = (std::max)(max_pattern_len_, p.data.GetSize());
+
+      if (!p.anchor_len)
+      {
+        unanchored_.emplace_back(id);
+        continue;
+      }
+
+      std::size_t state = 0;
+      for (std::size_t i = 0; i < p.anchor_len; ++i)
+      {
+        std::uint8_t const c = p.data.GetValues()[p.anchor_beg + i];
+        std::size_t const idx = state * kAlphabetSize + c;
+        if (transitions_[idx] == kNoState)
+        {
+          transitions_[idx] = static_cast<std::uint32_t>(outputs_.size());
+          outputs_.emplace_back();
+          transitions_.resize(transitions_.size() + kAlphabetSize, kNoState);
+        }
+
+        state = transitions_[idx];
+      }
+
+      outputs_[state].emplace_back(id);
+    }
+
+    // Turn the trie into a DFA by folding the failure links into the
+    // transition table. States are visited in BFS order so the failure
+    // state's transitions (and outputs) are always complete before use.
+    std::vector<std::uint32_t> fail(outputs_.size(), 0);
+    std::deque<std::uint32_t> queue;
+    for (std::size_t c = 0; c < kAlphabetSize; ++c)
+    {
+      std::uint32_t& next = transitions_[c];
+      if (next == kNoState)
+      {
+        next = 0;
+      }
+      else
+      {
+        fail[next] = 0;
+        queue.emplace_back(next);
+      }
+    }
+
+    while (!queue.empty())
+    {
+      std::uint32_t const state = queue.front();
+      queue.pop_front();
+
+      auto const& fail_outputs = outputs_[fail[state]];
+      outputs_[state].insert(std::end(outputs_[state]),
+                             std::begin(fail_outputs),
+                             std::end(fail_outputs));
+
+      for (std::size_t c = 0; c < kAlphabetSize; ++c)
+      {
+        std::uint32_t& next = transitions_[state * kAlphabetSize + c];
+        std::uint32_t const fail_next =
+          transitions_[fail[state] * kAlphabetSize + c];
+        if (next == kNoState)
+        {
+          next = fail_next;
+        }
+        else
+        {
+          fail[next] = fail_next;
+          queue.emplace_back(next);
+        }
+      }
+    }
+
+    compiled_ = true;
+  }
+
+  std::size_t GetNumPatterns() const noexcept
+  {
+    return patterns_.size();
+  }
+
+  std::size_t GetMaxPatternLength() const noexcept
+  {
+    return max_pattern_len_;
+  }
+
+  // Finds the first match of every pattern which is not yet marked as matched
+  // in [beg, end). The callback is invoked with the pattern ID and the address
+  // of the match in the buffer. Returns the number of patterns which remain
+  // unmatched, so callers can stop early when scanning multiple buffers.
+  template <typename Callback>
+  std::size_t FindFirst(std::uint8_t const* beg,
+                        std::uint8_t const* end,
+                        std::vector<bool>& matched,
+                        Callback callback) const
+  {
+    HADESMEM_DETAIL_ASSERT(compiled_);
+    HADESMEM_DETAIL_ASSERT(beg <= end);
+    HADESMEM_DETAIL_ASSERT(matched.size() == patterns_.size());
+
+    std::size_t remaining = static_cast<std::size_t>(
+      std::count(std::begin(matched), std::end(matched), false));
+    std::size_t const size = static_cast<std::size_t>(end - beg);
+
+    // Patterns without a single fixed byte can't be fed to the automaton, so
+    // fall back to a naive search. For patterns which are entirely wildcards
+    // this always matches at the start of the buffer.
+    for (auto const id : unanchored_)
+    {
+      auto const& p = patterns_[id];
+      if (matched[id] || p.data.GetSize() > size)
+      {
+        continue;
+      }
+
+      for (std::size_t i = 0; i <= size - p.data.GetSize(); ++i)
+      {
+        if (p.data.Matches(beg + i))
+        {
+          matched[id] = true;
+          --remaining;
+          callback(id, beg + i);
+          break;
+        }
+      }
+    }
+
+    std::uint32_t state = 0;
+    for (std::uint8_t const* cur = beg; cur != end && remaining; ++cur)
+    {
+      state = transitions_[state * kAlphabetSize + *cur];
+
+      for (auto const id : outputs_[state])
+      {
+        if (matched[id])
+        {
+          continue;
+        }
+
+        // Anchor hits for a given pattern are found in increasing order, so
+        // the first verified candidate is also the lowest match.
+        auto const& p = patterns_[id];
+        std::size_t const anchor_end =
+          static_cast<std::size_t>(cur - beg) + 1;
+        if (anchor_end < p.anchor_beg + p.anchor_len)
+        {
+          continue;
+        }
+
+        std::size_t const match_beg = anchor_end - p.anchor_len - p.anchor_beg;
+        if (p.data.GetSize() > size - match_beg)
+        {
+          continue;
+        }
+
+        if (p.data.Matches(beg + match_beg))
+        {
+          matched[id] = true;
+          --remaining;
+          callback(id, beg + match_beg);
+        }
+      }
+    }
+
+    return remaining;
+  }
+
+private:
+  static std::size_t const kAlphabetSize = 256;
+  enum : std::uint32_t
+  {
+    kNoState = static_cast<std::uint32_t>(-1)
+  };
+
+  struct PatternInfo
+  {
+    CompiledPattern data;
+    std::size_t anchor_beg;
+    std::size_t anchor_len;
+  };
+
+  std::vector<PatternInfo> patterns_;
+  std::vector<std::size_t> unanchored_;
+  std::vector<std::uint32_t> transitions_;
+  std::vector<std::vector<std::size_t>> outputs_;
+  std::size_t max_pattern_len_{};
+  bool compiled_{};
+};
+}
+}
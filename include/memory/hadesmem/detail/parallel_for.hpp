@@ -0,0 +1,103 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+inline std::size_t GetDefaultParallelism() noexcept
+{
+  std::size_t const num_threads = std::thread::hardware_concurrency();
+  return num_threads ? num_threads : 1;
+}
+
+// Calls func(i) for every i in [0, count), using up to num_threads threads
+// (including the calling thread). Indexes are handed out one at a time from a
+// shared counter, so a thread which finishes its work early immediately picks
+// up the next unclaimed item instead of waiting on a statically assigned
+// partition. Items are claimed in increasing order.
+//
+// Creating a thread costs far more than a small item of work, so no more
+// threads are used than would each get 'min_items_per_thread' items. Small
+// jobs therefore run entirely on the calling thread.
+//
+// Blocks until every item has been processed. If any calls throw, the
+// exception from the lowest index is rethrown (so the error reported is the
+// same regardless of scheduling).
+template <typename Func>
+void ParallelFor(std::size_t count,
+                 Func const& func,
+                 std::size_t num_threads = GetDefaultParallelism(),
+                 std::size_t min_items_per_thread = 1)
+{
+  if (!count)
+  {
+    return;
+  }
+
+  std::size_t const max_threads =
+    count / (std::max)(min_items_per_thread, std::size_t{1});
+  num_threads =
+    (std::max)((std::min)(num_threads, max_threads), std::size_t{1});
+
+  std::atomic<std::size_t> next{0};
+  std::vector<std::exception_ptr> errors(count);
+  auto const worker = [&]()
+  {
+    for (std::size_t i = next++; i < count; i = next++)
+    {
+      try
+      {
+        func(i);
+      }
+      catch (...)
+      {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  try
+  {
+    for (std::size_t i = 1; i < num_threads; ++i)
+    {
+      threads.emplace_back(worker);
+    }
+  }
+  catch (...)
+  {
+    // Couldn't create as many threads as we wanted. The ones we did create
+    // (and the calling thread) will still get through all the work.
+    HADESMEM_DETAIL_ASSERT(false);
+  }
+
+  worker();
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  for (auto const& e : errors)
+  {
+    if (e)
+    {
+      std::rethrow_exception(e);
+    }
+  }
+}
+}
+}
@@ -0,0 +1,274 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <intrin.h>
+
+#include <hadesmem/compiled_pattern.hpp>
+#include <hadesmem/detail/assert.hpp>
+
+// TODO: AVX-512 kernel.
+
+// TODO: Vectorize verification for long patterns.
+
+namespace hadesmem
+{
+namespace detail
+{
+// Rank of how common each byte value is in x86/x64 code sections, where 0 is
+// the rarest and 255 the most common. Generated from a few hundred MB of code
+// sections, with 0xCC bumped up to account for MSVC's int3 padding. Only the
+// relative order matters, as it is used to pick the most selective anchor
+// bytes for the vectorized search.
+inline std::uint8_t GetByteFrequencyRank(std::uint8_t b) noexcept
+{
+  static std::uint8_t const kRanks[256] = {
+    255, 246, 228, 224, 234, 219, 179, 198, 238, 184, 118, 106, 191, 137, 93,
+    249, 235, 203, 111, 79,  171, 96,  75,  70,  220, 59,  55,  60,  126, 71,
+    53,  216, 226, 120, 40,  43,  251, 177, 32,  33,  221, 187, 36,  76,  119,
+    47,  176, 46,  208, 225, 41,  73,  115, 127, 39,  42,  199, 227, 56,  183,
+    151, 117, 61,  77,  223, 244, 100, 189, 242, 218, 129, 158, 253, 239, 87,
+    102, 247, 212, 82,  85,  207, 57,  38,  168, 202, 167, 138, 164, 154, 27,
+    16,  162, 181, 163, 142, 133, 172, 44,  31,  99,  186, 48,  237, 26,  145,
+    51,  29,  50,  155, 67,  72,  157, 178, 35,  122, 121, 236, 217, 86,  116,
+    161, 52,  23,  91,  206, 110, 101, 144, 211, 185, 68,  240, 241, 233, 64,
+    94,  156, 252, 69,  250, 143, 243, 37,  30,  182, 17,  25,  20,  165, 45,
+    13,  18,  104, 7,   0,   5,   92,  11,  10,  14,  131, 1,   2,   28,  58,
+    8,   3,   6,   114, 22,  62,  19,  103, 9,   4,   54,  132, 15,  12,  21,
+    139, 24,  152, 123, 190, 150, 169, 65,  194, 74,  159, 97,  232, 231, 180,
+    213, 196, 205, 204, 229, 192, 188, 109, 63,  254, 78,  98,  83,  174, 147,
+    173, 107, 49,  80,  95,  84,  166, 108, 105, 136, 34,  81,  124, 195, 201,
+    141, 140, 89,  88,  90,  135, 149, 245, 222, 130, 215, 128, 153, 160, 193,
+    200, 113, 134, 146, 66,  112, 210, 197, 209, 175, 170, 148, 125, 214, 230,
+    248};
+  return kRanks[b];
+}
+
+inline bool IsAvx2Supported() noexcept
+{
+  static bool const supported = []() -> bool
+  {
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+      return false;
+    }
+
+    // The OS must also have enabled saving of the YMM state.
+    __cpuid(info, 1);
+    bool const osxsave = !!(info[2] & (1 << 27));
+    bool const avx = !!(info[2] & (1 << 28));
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+    {
+      return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return !!(info[1] & (1 << 5));
+  }();
+
+  return supported;
+}
+
+// Vectorized wildcard search. Candidates are filtered by comparing the two
+// rarest fixed bytes of the needle at every position in a block using SSE2
+// (or AVX2 when supported at runtime), and only the positions where both
+// match are verified against the full masked needle. The needle is not
+// copied, so it must outlive the searcher.
+class PatternSearcher
+{
+public:
+  explicit PatternSearcher(CompiledPattern const& needle)
+    : needle_{&needle},
+      value_{needle.GetValues()},
+      mask_{needle.GetMasks()},
+      size_{needle.GetSize()}
+  {
+    SelectAnchors();
+  }
+
+  explicit PatternSearcher(CompiledPattern const&& needle) = delete;
+
+  std::size_t GetSize() const noexcept
+  {
+    return size_;
+  }
+
+  // Returns a pointer to the first match in [h_beg, h_end), or nullptr.
+  std::uint8_t const* Search(std::uint8_t const* h_beg,
+                             std::uint8_t const* h_end) const
+  {
+    HADESMEM_DETAIL_ASSERT(h_beg <= h_end);
+
+    std::size_t const size = static_cast<std::size_t>(h_end - h_beg);
+    std::size_t const len = size_;
+    if (!len || size < len)
+    {
+      return nullptr;
+    }
+
+    if (!has_anchor_)
+    {
+      return h_beg;
+    }
+
+    std::size_t const num_starts = size - len + 1;
+    std::size_t pos = 0;
+    if (IsAvx2Supported())
+    {
+      if (auto const match = SearchAvx2(h_beg, num_starts, pos))
+      {
+        return match;
+      }
+    }
+
+    if (auto const match = SearchSse2(h_beg, num_starts, pos))
+    {
+      return match;
+    }
+
+    return SearchScalar(h_beg, num_starts, pos);
+  }
+
+private:
+  void SelectAnchors()
+  {
+    // Fully fixed bytes are always preferred over partially masked ones, and
+    // among those the rarest byte values filter out the most candidates.
+    auto const score = [&](std::size_t i) -> std::uint32_t
+    {
+      return mask_[i] == 0xFF ? GetByteFrequencyRank(value_[i]) : 0x100U;
+    };
+
+    for (std::size_t i = 0; i < size_; ++i)
+    {
+      if (!mask_[i])
+      {
+        continue;
+      }
+
+      if (!has_anchor_ || score(i) < score(anchor1_))
+      {
+        anchor2_ = has_anchor_ ? anchor1_ : i;
+        anchor1_ = i;
+        has_anchor_ = true;
+      }
+      else if (anchor2_ == anchor1_ || score(i) < score(anchor2_))
+      {
+        anchor2_ = i;
+      }
+    }
+  }
+
+  bool Verify(std::uint8_t const* h) const noexcept
+  {
+    return needle_->Matches(h);
+  }
+
+  std::uint8_t const* SearchSse2(std::uint8_t const* h_beg,
+                                 std::size_t num_starts,
+                                 std::size_t& pos) const
+  {
+    __m128i const v1 = _mm_set1_epi8(static_cast<char>(value_[anchor1_]));
+    __m128i const m1 = _mm_set1_epi8(static_cast<char>(mask_[anchor1_]));
+    __m128i const v2 = _mm_set1_epi8(static_cast<char>(value_[anchor2_]));
+    __m128i const m2 = _mm_set1_epi8(static_cast<char>(mask_[anchor2_]));
+
+    for (; pos + 16 <= num_starts; pos += 16)
+    {
+      __m128i const h1 = _mm_loadu_si128(
+        reinterpret_cast<__m128i const*>(h_beg + pos + anchor1_));
+      __m128i const h2 = _mm_loadu_si128(
+        reinterpret_cast<__m128i const*>(h_beg + pos + anchor2_));
+      __m128i const eq =
+        _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(h1, m1), v1),
+                      _mm_cmpeq_epi8(_mm_and_si128(h2, m2), v2));
+      auto bits = static_cast<unsigned long>(_mm_movemask_epi8(eq));
+      while (bits)
+      {
+        unsigned long idx = 0;
+        _BitScanForward(&idx, bits);
+        if (Verify(h_beg + pos + idx))
+        {
+          return h_beg + pos + idx;
+        }
+
+        bits &= bits - 1;
+      }
+    }
+
+    return nullptr;
+  }
+
+  std::uint8_t const* SearchAvx2(std::uint8_t const* h_beg,
+                                 std::size_t num_starts,
+                                 std::size_t& pos) const
+  {
+    __m256i const v1 = _mm256_set1_epi8(static_cast<char>(value_[anchor1_]));
+    __m256i const m1 = _mm256_set1_epi8(static_cast<char>(mask_[anchor1_]));
+    __m256i const v2 = _mm256_set1_epi8(static_cast<char>(value_[anchor2_]));
+    __m256i const m2 = _mm256_set1_epi8(static_cast<char>(mask_[anchor2_]));
+
+    for (; pos + 32 <= num_starts; pos += 32)
+    {
+      __m256i const h1 = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const*>(h_beg + pos + anchor1_));
+      __m256i const h2 = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const*>(h_beg + pos + anchor2_));
+      __m256i const eq =
+        _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(h1, m1), v1),
+                         _mm256_cmpeq_epi8(_mm256_and_si256(h2, m2), v2));
+      auto bits = static_cast<unsigned long>(
+        static_cast<std::uint32_t>(_mm256_movemask_epi8(eq)));
+      while (bits)
+      {
+        unsigned long idx = 0;
+        _BitScanForward(&idx, bits);
+        if (Verify(h_beg + pos + idx))
+        {
+          _mm256_zeroupper();
+          return h_beg + pos + idx;
+        }
+
+        bits &= bits - 1;
+      }
+    }
+
+    _mm256_zeroupper();
+    return nullptr;
+  }
+
+  std::uint8_t const* SearchScalar(std::uint8_t const* h_beg,
+                                   std::size_t num_starts,
+                                   std::size_t pos) const
+  {
+    std::uint8_t const v1 = value_[anchor1_];
+    std::uint8_t const m1 = mask_[anchor1_];
+    for (; pos < num_starts; ++pos)
+    {
+      if ((h_beg[pos + anchor1_] & m1) == v1 && Verify(h_beg + pos))
+      {
+        return h_beg + pos;
+      }
+    }
+
+    return nullptr;
+  }
+
+  CompiledPattern const* needle_;
+  std::uint8_t const* value_;
+  std::uint8_t const* mask_;
+  std::size_t size_;
+  std::size_t anchor1_{};
+  std::size_t anchor2_{};
+  bool has_anchor_{};
+};
+}
+}
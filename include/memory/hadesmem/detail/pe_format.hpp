@@ -0,0 +1,188 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstdint>
+
+#include <hadesmem/detail/static_assert.hpp>
+
+// Layout compatible copies of the winnt.h PE structures, so that PE files can
+// be parsed without windows.h (see pelib/pe_view.hpp). Only the structures and
+// constants needed by the parser are defined.
+
+namespace hadesmem
+{
+namespace detail
+{
+enum : std::uint32_t
+{
+  kPeDosSignature = 0x5A4D,
+  kPeNtSignature = 0x00004550,
+  kPeMachineAmd64 = 0x8664,
+  kPeNumDataDirs = 16,
+  kPeSectionNameLen = 8
+};
+
+struct PeDosHeader
+{
+  std::uint16_t e_magic;
+  std::uint16_t e_cblp;
+  std::uint16_t e_cp;
+  std::uint16_t e_crlc;
+  std::uint16_t e_cparhdr;
+  std::uint16_t e_minalloc;
+  std::uint16_t e_maxalloc;
+  std::uint16_t e_ss;
+  std::uint16_t e_sp;
+  std::uint16_t e_csum;
+  std::uint16_t e_ip;
+  std::uint16_t e_cs;
+  std::uint16_t e_lfarlc;
+  std::uint16_t e_ovno;
+  std::uint16_t e_res[4];
+  std::uint16_t e_oemid;
+  std::uint16_t e_oeminfo;
+  std::uint16_t e_res2[10];
+  std::int32_t e_lfanew;
+};
+
+struct PeFileHeader
+{
+  std::uint16_t Machine;
+  std::uint16_t NumberOfSections;
+  std::uint32_t TimeDateStamp;
+  std::uint32_t PointerToSymbolTable;
+  std::uint32_t NumberOfSymbols;
+  std::uint16_t SizeOfOptionalHeader;
+  std::uint16_t Characteristics;
+};
+
+struct PeDataDirectory
+{
+  std::uint32_t VirtualAddress;
+  std::uint32_t Size;
+};
+
+struct PeOptionalHeader32
+{
+  std::uint16_t Magic;
+  std::uint8_t MajorLinkerVersion;
+  std::uint8_t MinorLinkerVersion;
+  std::uint32_t SizeOfCode;
+  std::uint32_t SizeOfInitializedData;
+  std::uint32_t SizeOfUninitializedData;
+  std::uint32_t AddressOfEntryPoint;
+  std::uint32_t BaseOfCode;
+  std::uint32_t BaseOfData;
+  std::uint32_t ImageBase;
+  std::uint32_t SectionAlignment;
+  std::uint32_t FileAlignment;
+  std::uint16_t MajorOperatingSystemVersion;
+  std::uint16_t MinorOperatingSystemVersion;
+  std::uint16_t MajorImageVersion;
+  std::uint16_t MinorImageVersion;
+  std::uint16_t MajorSubsystemVersion;
+  std::uint16_t MinorSubsystemVersion;
+  std::uint32_t Win32VersionValue;
+  std::uint32_t SizeOfImage;
+  std::uint32_t SizeOfHeaders;
+  std::uint32_t CheckSum;
+  std::uint16_t Subsystem;
+  std::uint16_t DllCharacteristics;
+  std::uint32_t SizeOfStackReserve;
+  std::uint32_t SizeOfStackCommit;
+  std::uint32_t SizeOfHeapReserve;
+  std::uint32_t SizeOfHeapCommit;
+  std::uint32_t LoaderFlags;
+  std::uint32_t NumberOfRvaAndSizes;
+  PeDataDirectory DataDirectory[kPeNumDataDirs];
+};
+
+struct PeOptionalHeader64
+{
+  std::uint16_t Magic;
+  std::uint8_t MajorLinkerVersion;
+  std::uint8_t MinorLinkerVersion;
+  std::uint32_t SizeOfCode;
+  std::uint32_t SizeOfInitializedData;
+  std::uint32_t SizeOfUninitializedData;
+  std::uint32_t AddressOfEntryPoint;
+  std::uint32_t BaseOfCode;
+  std::uint64_t ImageBase;
+  std::uint32_t SectionAlignment;
+  std::uint32_t FileAlignment;
+  std::uint16_t MajorOperatingSystemVersion;
+  std::uint16_t MinorOperatingSystemVersion;
+  std::uint16_t MajorImageVersion;
+  std::uint16_t MinorImageVersion;
+  std::uint16_t MajorSubsystemVersion;
+  std::uint16_t MinorSubsystemVersion;
+  std::uint32_t Win32VersionValue;
+  std::uint32_t SizeOfImage;
+  std::uint32_t SizeOfHeaders;
+  std::uint32_t CheckSum;
+  std::uint16_t Subsystem;
+  std::uint16_t DllCharacteristics;
+  std::uint64_t SizeOfStackReserve;
+  std::uint64_t SizeOfStackCommit;
+  std::uint64_t SizeOfHeapReserve;
+  std::uint64_t SizeOfHeapCommit;
+  std::uint32_t LoaderFlags;
+  std::uint32_t NumberOfRvaAndSizes;
+  PeDataDirectory DataDirectory[kPeNumDataDirs];
+};
+
+struct PeSectionHeader
+{
+  std::uint8_t Name[kPeSectionNameLen];
+  std::uint32_t VirtualSize;
+  std::uint32_t VirtualAddress;
+  std::uint32_t SizeOfRawData;
+  std::uint32_t PointerToRawData;
+  std::uint32_t PointerToRelocations;
+  std::uint32_t PointerToLinenumbers;
+  std::uint16_t NumberOfRelocations;
+  std::uint16_t NumberOfLinenumbers;
+  std::uint32_t Characteristics;
+};
+
+struct PeExportDirectory
+{
+  std::uint32_t Characteristics;
+  std::uint32_t TimeDateStamp;
+  std::uint16_t MajorVersion;
+  std::uint16_t MinorVersion;
+  std::uint32_t Name;
+  std::uint32_t Base;
+  std::uint32_t NumberOfFunctions;
+  std::uint32_t NumberOfNames;
+  std::uint32_t AddressOfFunctions;
+  std::uint32_t AddressOfNames;
+  std::uint32_t AddressOfNameOrdinals;
+};
+
+struct PeImportDescriptor
+{
+  std::uint32_t OriginalFirstThunk;
+  std::uint32_t TimeDateStamp;
+  std::uint32_t ForwarderChain;
+  std::uint32_t Name;
+  std::uint32_t FirstThunk;
+};
+
+// Offset of the optional header from the start of the NT headers.
+enum : std::uint32_t
+{
+  kPeOptionalHeaderOffset = sizeof(std::uint32_t) + sizeof(PeFileHeader)
+};
+
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeDosHeader) == 64);
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeFileHeader) == 20);
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeOptionalHeader32) == 224);
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeOptionalHeader64) == 240);
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeSectionHeader) == 40);
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeExportDirectory) == 40);
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeImportDescriptor) == 20);
+}
+}
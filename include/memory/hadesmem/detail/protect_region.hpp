@@ -6,6 +6,7 @@
 #include <windows.h>
 
 #include <hadesmem/config.hpp>
+#include <hadesmem/detail/region_cache.hpp>
 #include <hadesmem/error.hpp>
 #include <hadesmem/process.hpp>
 
@@ -17,6 +18,12 @@ inline DWORD Protect(Process const& process,
                      MEMORY_BASIC_INFORMATION const& mbi,
                      DWORD protect)
 {
+  if (process.GetSnapshot())
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Process snapshots are read-only."});
+  }
+
   DWORD old_protect = 0;
   if (!::VirtualProtectEx(process.GetHandle(),
                           mbi.BaseAddress,
@@ -30,6 +37,11 @@ inline DWORD Protect(Process const& process,
                                     << ErrorCodeWinLast{last_error});
   }
 
+  if (RegionCache* const region_cache = process.GetRegionCache())
+  {
+    region_cache->Invalidate(mbi.BaseAddress, mbi.RegionSize);
+  }
+
   return old_protect;
 }
 }
@@ -16,6 +16,19 @@ namespace detail
 inline MEMORY_BASIC_INFORMATION Query(Process const& process, LPCVOID address)
 {
   MEMORY_BASIC_INFORMATION mbi{};
+  if (SnapshotView const* const snapshot = process.GetSnapshot())
+  {
+    if (!snapshot->Query(address, mbi))
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Snapshot query failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    return mbi;
+  }
+
   if (::VirtualQueryEx(process.GetHandle(), address, &mbi, sizeof(mbi)) !=
       sizeof(mbi))
   {
@@ -10,8 +10,10 @@
 #include <windows.h>
 
 #include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/guarded_copy.hpp>
 #include <hadesmem/detail/protect_guard.hpp>
 #include <hadesmem/detail/query_region.hpp>
+#include <hadesmem/detail/region_cache.hpp>
 #include <hadesmem/detail/type_traits.hpp>
 #include <hadesmem/error.hpp>
 #include <hadesmem/process.hpp>
@@ -30,6 +32,27 @@ struct ReadFlags
 
 namespace detail
 {
+inline bool TryReadUnchecked(Process const& process,
+                             void* address,
+                             void* data,
+                             std::size_t len) noexcept
+{
+  if (SnapshotView const* const snapshot = process.GetSnapshot())
+  {
+    return snapshot->TryRead(address, data, len);
+  }
+
+  if (process.IsSelf())
+  {
+    return GuardedCopy(data, address, len);
+  }
+
+  SIZE_T bytes_read = 0;
+  return ::ReadProcessMemory(
+           process.GetHandle(), address, data, len, &bytes_read) &&
+         bytes_read == len;
+}
+
 inline void ReadUnchecked(Process const& process,
                           void* address,
                           void* data,
@@ -44,15 +67,16 @@ inline void ReadUnchecked(Process const& process,
     return;
   }
 
-  SIZE_T bytes_read = 0;
-  if (!::ReadProcessMemory(
-        process.GetHandle(), address, data, len, &bytes_read) ||
-      bytes_read != len)
+  if (!TryReadUnchecked(process, address, data, len))
   {
     DWORD const last_error = ::GetLastError();
-    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                    << ErrorString{"ReadProcessMemory failed."}
-                                    << ErrorCodeWinLast{last_error});
+    char const* const error =
+      process.GetSnapshot()
+        ? "Snapshot read failed."
+        : process.IsSelf() ? "Guarded memory copy failed."
+                           : "ReadProcessMemory failed.";
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{} << ErrorString{error}
+                                            << ErrorCodeWinLast{last_error});
   }
 }
 
@@ -70,10 +94,52 @@ inline void ReadImpl(Process const& process,
     return;
   }
 
+  // Snapshots can't be reprotected (and have nothing to reprotect anyway, as
+  // only readable memory is captured), so skip the region checks.
+  if (SnapshotView const* const snapshot = process.GetSnapshot())
+  {
+    if (!snapshot->TryRead(
+          address, data, len, !!(flags & ReadFlags::kZeroFillReserved)))
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Snapshot read failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    return;
+  }
+
+  // ReadFlags::kZeroFillReserved is not supported in trusted buffer mode, as
+  // we never find out that the memory is reserved.
+  if (process.IsTrustedBufferMode())
+  {
+    ReadUnchecked(process, address, data, len, flags);
+    return;
+  }
+
+  RegionCache* const region_cache = process.GetRegionCache();
+  if (region_cache && region_cache->IsReadable(address, len))
+  {
+    if (TryReadUnchecked(process, address, data, len))
+    {
+      return;
+    }
+
+    // The cached region map is out of date (e.g. the memory was freed or
+    // reprotected), so throw it away and query the regions again.
+    region_cache->Invalidate();
+  }
+
   for (;;)
   {
     MEMORY_BASIC_INFORMATION const mbi = detail::Query(process, address);
 
+    if (region_cache && CanRead(mbi) && !IsBadProtect(mbi))
+    {
+      region_cache->Insert(mbi.BaseAddress, mbi.RegionSize);
+    }
+
     void* const address_end = static_cast<std::uint8_t*>(address) + len;
     void* const region_next =
       static_cast<std::uint8_t*>(mbi.BaseAddress) + mbi.RegionSize;
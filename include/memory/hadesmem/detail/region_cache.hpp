@@ -0,0 +1,122 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/srw_lock.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+// Sorted map of the regions in a process which are known to be directly
+// readable (committed, readable, and without a 'bad' protection mask), so that
+// reads which land entirely inside them can skip querying the region. Regions
+// are added lazily as they are queried, and are only removed when invalidated.
+// Safe to use from multiple threads.
+class RegionCache
+{
+public:
+  RegionCache() noexcept
+  {
+  }
+
+  RegionCache(RegionCache const& other) = delete;
+
+  RegionCache& operator=(RegionCache const& other) = delete;
+
+  // Returns true if every byte in the range is in a cached region (which may
+  // span multiple adjacent regions).
+  bool IsReadable(void const* address, std::size_t len) noexcept
+  {
+    auto cur = reinterpret_cast<std::uintptr_t>(address);
+    auto const end = cur + len;
+
+    AcquireSRWLock const lock{&lock_, SRWLockType::Shared};
+    while (cur < end)
+    {
+      // Regions are keyed by their end address, so this is the only region
+      // which could contain 'cur'.
+      auto const iter = regions_.upper_bound(cur);
+      if (iter == std::end(regions_) || iter->second > cur)
+      {
+        ++num_misses_;
+        return false;
+      }
+
+      cur = iter->first;
+    }
+
+    ++num_hits_;
+    return true;
+  }
+
+  // Replaces any cached regions which overlap the new one.
+  void Insert(void const* base, std::size_t size)
+  {
+    auto const beg = reinterpret_cast<std::uintptr_t>(base);
+    auto const end = beg + size;
+
+    AcquireSRWLock const lock{&lock_, SRWLockType::Exclusive};
+    EraseOverlapping(beg, end);
+    regions_.emplace(end, beg);
+  }
+
+  void Invalidate(void const* base, std::size_t size) noexcept
+  {
+    auto const beg = reinterpret_cast<std::uintptr_t>(base);
+
+    AcquireSRWLock const lock{&lock_, SRWLockType::Exclusive};
+    EraseOverlapping(beg, beg + size);
+  }
+
+  void Invalidate() noexcept
+  {
+    AcquireSRWLock const lock{&lock_, SRWLockType::Exclusive};
+    regions_.clear();
+  }
+
+  std::size_t GetNumRegions() noexcept
+  {
+    AcquireSRWLock const lock{&lock_, SRWLockType::Shared};
+    return regions_.size();
+  }
+
+  std::size_t GetNumHits() const noexcept
+  {
+    return num_hits_;
+  }
+
+  std::size_t GetNumMisses() const noexcept
+  {
+    return num_misses_;
+  }
+
+private:
+  void EraseOverlapping(std::uintptr_t beg, std::uintptr_t end) noexcept
+  {
+    for (auto iter = regions_.upper_bound(beg);
+         iter != std::end(regions_) && iter->second < end;)
+    {
+      iter = regions_.erase(iter);
+    }
+  }
+
+  SRWLOCK lock_ = SRWLOCK_INIT;
+  // End address to base address.
+  std::map<std::uintptr_t, std::uintptr_t> regions_;
+  std::atomic<std::size_t> num_hits_{};
+  std::atomic<std::size_t> num_misses_{};
+};
+}
+}
@@ -0,0 +1,119 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <hadesmem/config.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+// Scratch buffers bigger than this are freed once they're no longer in use
+// (see ScopedScratch). Comfortably above the chunk sizes used for region
+// scans and string reads, so those never reallocate, but a one-off read of a
+// whole module isn't kept around for the life of the thread.
+enum : std::size_t
+{
+  kScratchBufferMaxRetainedSize = 4 * 1024 * 1024
+};
+
+// Growable block of uninitialized memory, for temporary buffers which are
+// immediately overwritten (e.g. by a read) and so don't need to be zeroed like
+// a std::vector would be. Memory is only ever reallocated to grow, so a buffer
+// which is reused across calls stops allocating once it's big enough.
+class ScratchBuffer
+{
+public:
+  ScratchBuffer() noexcept
+  {
+  }
+
+  ScratchBuffer(ScratchBuffer const& other) = delete;
+
+  ScratchBuffer& operator=(ScratchBuffer const& other) = delete;
+
+  // Contents are not preserved if the buffer grows. The pointer is valid until
+  // the next call to Get or Release.
+  std::uint8_t* Get(std::size_t size)
+  {
+    if (size > size_)
+    {
+      data_.reset();
+      size_ = 0;
+      data_.reset(new std::uint8_t[size]);
+      size_ = size;
+    }
+
+    return data_.get();
+  }
+
+  // Frees the memory, e.g. after an unusually large scan.
+  void Release() noexcept
+  {
+    data_.reset();
+    size_ = 0;
+  }
+
+  // Frees the memory if it has grown past kScratchBufferMaxRetainedSize.
+  void Trim() noexcept
+  {
+    if (size_ > kScratchBufferMaxRetainedSize)
+    {
+      Release();
+    }
+  }
+
+  std::size_t GetSize() const noexcept
+  {
+    return size_;
+  }
+
+private:
+  std::unique_ptr<std::uint8_t[]> data_;
+  std::size_t size_{};
+};
+
+// Uses a (typically thread_local) scratch buffer for the current scope, then
+// trims it on the way out so the thread doesn't hold on to the largest buffer
+// it has ever needed.
+class ScopedScratch
+{
+public:
+  explicit ScopedScratch(ScratchBuffer& scratch) noexcept : scratch_(&scratch)
+  {
+  }
+
+  ScopedScratch(ScopedScratch const& other) = delete;
+
+  ScopedScratch& operator=(ScopedScratch const& other) = delete;
+
+  ~ScopedScratch()
+  {
+    scratch_->Trim();
+  }
+
+  // See ScratchBuffer::Get.
+  std::uint8_t* Get(std::size_t size)
+  {
+    return scratch_->Get(size);
+  }
+
+private:
+  ScratchBuffer* scratch_;
+};
+
+// Per-thread scratch buffer for reading memory which is scanned and then
+// discarded (e.g. FindRaw and Dump). Must not be held across calls which may
+// use it themselves. Use it through ScopedScratch.
+inline ScratchBuffer& GetScanScratch()
+{
+  thread_local ScratchBuffer scratch;
+  return scratch;
+}
+}
+}
@@ -0,0 +1,104 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstdint>
+
+#include <hadesmem/detail/static_assert.hpp>
+
+// Process snapshot file format. Holds the region map, module list and the
+// contents of every readable region of a process, as captured by
+// CreateProcessSnapshot (in process_snapshot.hpp, or linux/process_snapshot.hpp
+// for Linux processes). The file is sparse, with pages which were entirely zero
+// left as holes.
+//
+// Layout:
+//   SnapshotHeader
+//   SnapshotRegion[num_regions] (sorted by base address, free regions omitted)
+//   SnapshotModule[num_modules]
+//   Region data, each region starting on a page boundary.
+//
+// This header has no platform dependencies, so that snapshots can be written
+// (and read) on any platform. Region states, types and protections are always
+// stored as their Win32 values.
+
+namespace hadesmem
+{
+namespace detail
+{
+enum : std::uint32_t
+{
+  // 'HMSS'
+  kSnapshotMagic = 0x53534D48,
+  kSnapshotVersion = 1,
+  kSnapshotDataAlignment = 0x1000,
+  // MAX_MODULE_NAME32 + 1 and MAX_PATH.
+  kSnapshotModuleNameLen = 256,
+  kSnapshotModulePathLen = 260
+};
+
+enum : std::uint32_t
+{
+  kSnapshotMemCommit = 0x1000,
+  kSnapshotMemReserve = 0x2000,
+  kSnapshotMemPrivate = 0x20000,
+  kSnapshotMemMapped = 0x40000,
+  kSnapshotMemImage = 0x1000000
+};
+
+enum : std::uint32_t
+{
+  kSnapshotPageNoAccess = 0x01,
+  kSnapshotPageReadOnly = 0x02,
+  kSnapshotPageReadWrite = 0x04,
+  kSnapshotPageExecute = 0x10,
+  kSnapshotPageExecuteRead = 0x20,
+  kSnapshotPageExecuteReadWrite = 0x40
+};
+
+struct SnapshotHeader
+{
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t pointer_size;
+  std::uint32_t process_id;
+  std::uint32_t num_regions;
+  std::uint32_t num_modules;
+  // Highest address which can be queried (lpMaximumApplicationAddress of the
+  // machine the snapshot was taken on).
+  std::uint64_t max_address;
+  std::uint64_t size;
+};
+
+struct SnapshotRegion
+{
+  std::uint64_t base;
+  std::uint64_t alloc_base;
+  std::uint64_t size;
+  // Zero if the contents of the region were not captured (e.g. reserved or
+  // PAGE_NOACCESS memory).
+  std::uint64_t data_offset;
+  std::uint32_t alloc_protect;
+  std::uint32_t state;
+  std::uint32_t protect;
+  std::uint32_t type;
+};
+
+// Names and paths are null terminated UTF-16.
+struct SnapshotModule
+{
+  std::uint64_t base;
+  std::uint32_t size;
+  std::uint32_t reserved;
+  std::uint16_t name[kSnapshotModuleNameLen];
+  std::uint16_t path[kSnapshotModulePathLen];
+};
+
+// Every structure is a multiple of 8 bytes, so the 64-bit fields are always
+// naturally aligned, and the layout is identical for x86 and x64.
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(SnapshotHeader) == 40);
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(SnapshotRegion) == 48);
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(SnapshotModule) == 1048);
+}
+}
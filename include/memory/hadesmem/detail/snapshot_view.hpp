@@ -0,0 +1,329 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+#include <tlhelp32.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/guarded_copy.hpp>
+#include <hadesmem/detail/smart_handle.hpp>
+#include <hadesmem/detail/snapshot_format.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/error.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotModuleNameLen == MAX_MODULE_NAME32 + 1);
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotModulePathLen == MAX_PATH);
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotMemCommit == MEM_COMMIT);
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotMemReserve == MEM_RESERVE);
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotMemPrivate == MEM_PRIVATE);
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotMemMapped == MEM_MAPPED);
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotMemImage == MEM_IMAGE);
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotPageNoAccess == PAGE_NOACCESS);
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotPageReadOnly == PAGE_READONLY);
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotPageReadWrite == PAGE_READWRITE);
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotPageExecute == PAGE_EXECUTE);
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotPageExecuteRead == PAGE_EXECUTE_READ);
+HADESMEM_DETAIL_STATIC_ASSERT(kSnapshotPageExecuteReadWrite ==
+                              PAGE_EXECUTE_READWRITE);
+
+// Read-only view of a snapshot file. The file is mapped rather than read, so
+// memory usage is bounded by the working set of whatever is reading it
+// rather than the size of the snapshot. The header and tables are validated
+// once on construction.
+// WARNING: The entire file is mapped with a single view, so in an x86 process
+// snapshots are limited by the available address space.
+class SnapshotView
+{
+public:
+  explicit SnapshotView(std::wstring const& path)
+  {
+    file_ = SmartFileHandle{::CreateFileW(path.c_str(),
+                                          GENERIC_READ,
+                                          FILE_SHARE_READ,
+                                          nullptr,
+                                          OPEN_EXISTING,
+                                          0,
+                                          nullptr)};
+    if (!file_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"CreateFileW failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    LARGE_INTEGER file_size{};
+    if (!::GetFileSizeEx(file_.GetHandle(), &file_size))
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"GetFileSizeEx failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    if (file_size.QuadPart < static_cast<LONGLONG>(sizeof(SnapshotHeader)) ||
+        static_cast<std::uint64_t>(file_size.QuadPart) >
+          (std::numeric_limits<std::size_t>::max)())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid snapshot size."});
+    }
+
+    mapping_ = SmartHandle{::CreateFileMappingW(
+      file_.GetHandle(), nullptr, PAGE_READONLY, 0, 0, nullptr)};
+    if (!mapping_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"CreateFileMappingW failed."}
+                << ErrorCodeWinLast{last_error});
+    }
+
+    view_ = SmartMappedFileHandle{
+      ::MapViewOfFile(mapping_.GetHandle(), FILE_MAP_READ, 0, 0, 0)};
+    if (!view_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"MapViewOfFile failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    Initialize(static_cast<std::uint8_t const*>(view_.GetHandle()),
+               static_cast<std::size_t>(file_size.QuadPart));
+  }
+
+  SnapshotView(SnapshotView const& other) = delete;
+
+  SnapshotView& operator=(SnapshotView const& other) = delete;
+
+  DWORD GetProcessId() const noexcept
+  {
+    return process_id_;
+  }
+
+  std::vector<MODULEENTRY32W> const& GetModules() const noexcept
+  {
+    return modules_;
+  }
+
+  // Same semantics as VirtualQueryEx, including failing with
+  // ERROR_INVALID_PARAMETER for addresses above the maximum application
+  // address. Gaps between the captured regions are reported as free.
+  bool Query(void const* address, MEMORY_BASIC_INFORMATION& mbi) const
+    noexcept
+  {
+    auto const cur = reinterpret_cast<std::uintptr_t>(address);
+    if (cur > max_address_)
+    {
+      ::SetLastError(ERROR_INVALID_PARAMETER);
+      return false;
+    }
+
+    auto const iter = FindRegion(cur);
+    if (iter != std::end(regions_) && cur >= iter->base)
+    {
+      mbi = iter->mbi;
+      return true;
+    }
+
+    std::uintptr_t const free_beg =
+      iter == std::begin(regions_) ? 0 : std::prev(iter)->end;
+    std::uintptr_t const free_end =
+      iter == std::end(regions_) ? max_address_ + 1 : iter->base;
+    mbi = MEMORY_BASIC_INFORMATION{};
+    mbi.BaseAddress = reinterpret_cast<void*>(free_beg);
+    mbi.RegionSize = static_cast<SIZE_T>(free_end - free_beg);
+    mbi.State = MEM_FREE;
+    mbi.Protect = PAGE_NOACCESS;
+    return true;
+  }
+
+  // Fails (with ERROR_PARTIAL_COPY) if any part of the range was not
+  // captured, unless it is reserved memory and 'zero_fill_reserved' is set.
+  bool TryRead(void const* address,
+               void* data,
+               std::size_t len,
+               bool zero_fill_reserved = false) const noexcept
+  {
+    auto cur = reinterpret_cast<std::uintptr_t>(address);
+    auto out = static_cast<std::uint8_t*>(data);
+    while (len)
+    {
+      auto const iter = FindRegion(cur);
+      if (iter == std::end(regions_) || cur < iter->base)
+      {
+        ::SetLastError(ERROR_PARTIAL_COPY);
+        return false;
+      }
+
+      std::size_t const n = static_cast<std::size_t>(
+        (std::min)(iter->end - cur, static_cast<std::uintptr_t>(len)));
+      if (iter->data)
+      {
+        // The file could be truncated or on a network share which has gone
+        // away, in which case touching the view raises an in-page error.
+        if (!GuardedCopy(out, iter->data + (cur - iter->base), n))
+        {
+          return false;
+        }
+      }
+      else if (zero_fill_reserved && iter->mbi.State == MEM_RESERVE)
+      {
+        std::fill(out, out + n, std::uint8_t{0});
+      }
+      else
+      {
+        ::SetLastError(ERROR_PARTIAL_COPY);
+        return false;
+      }
+
+      cur += n;
+      out += n;
+      len -= n;
+    }
+
+    return true;
+  }
+
+private:
+  struct Region
+  {
+    std::uintptr_t base;
+    std::uintptr_t end;
+    MEMORY_BASIC_INFORMATION mbi;
+    std::uint8_t const* data;
+  };
+
+  void Initialize(std::uint8_t const* base, std::size_t size)
+  {
+    SnapshotHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (header.magic != kSnapshotMagic)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid snapshot signature."});
+    }
+
+    if (header.version != kSnapshotVersion)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Unsupported snapshot version."});
+    }
+
+    if (header.pointer_size != sizeof(void*))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Cross-architecture snapshots are currently "
+                               "unsupported."});
+    }
+
+    std::uint64_t const tables_size =
+      sizeof(SnapshotHeader) +
+      std::uint64_t{header.num_regions} * sizeof(SnapshotRegion) +
+      std::uint64_t{header.num_modules} * sizeof(SnapshotModule);
+    if (header.size != size || tables_size > size)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid snapshot size."});
+    }
+
+    process_id_ = header.process_id;
+    max_address_ = static_cast<std::uintptr_t>(header.max_address);
+
+    auto const file_regions =
+      reinterpret_cast<SnapshotRegion const*>(base + sizeof(SnapshotHeader));
+    regions_.reserve(header.num_regions);
+    for (std::uint32_t i = 0; i < header.num_regions; ++i)
+    {
+      SnapshotRegion const& r = file_regions[i];
+      if (!r.size || r.base > header.max_address ||
+          r.size > header.max_address - r.base + 1 ||
+          (!regions_.empty() && r.base < regions_.back().end) ||
+          (r.data_offset &&
+           (r.data_offset < tables_size || r.data_offset > size ||
+            r.size > size - r.data_offset)))
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Invalid snapshot region."});
+      }
+
+      Region region{};
+      region.base = static_cast<std::uintptr_t>(r.base);
+      region.end = static_cast<std::uintptr_t>(r.base + r.size);
+      region.mbi.BaseAddress = reinterpret_cast<void*>(region.base);
+      region.mbi.AllocationBase =
+        reinterpret_cast<void*>(static_cast<std::uintptr_t>(r.alloc_base));
+      region.mbi.AllocationProtect = r.alloc_protect;
+      region.mbi.RegionSize = static_cast<SIZE_T>(r.size);
+      region.mbi.State = r.state;
+      region.mbi.Protect = r.protect;
+      region.mbi.Type = r.type;
+      region.data = r.data_offset
+                      ? base + static_cast<std::size_t>(r.data_offset)
+                      : nullptr;
+      regions_.emplace_back(region);
+    }
+
+    auto const file_modules = reinterpret_cast<SnapshotModule const*>(
+      file_regions + header.num_regions);
+    modules_.reserve(header.num_modules);
+    for (std::uint32_t i = 0; i < header.num_modules; ++i)
+    {
+      SnapshotModule const& m = file_modules[i];
+      MODULEENTRY32W entry{};
+      entry.dwSize = sizeof(entry);
+      entry.th32ProcessID = header.process_id;
+      entry.modBaseAddr =
+        reinterpret_cast<BYTE*>(static_cast<std::uintptr_t>(m.base));
+      entry.modBaseSize = m.size;
+      entry.hModule = reinterpret_cast<HMODULE>(entry.modBaseAddr);
+      std::copy(
+        std::begin(m.name), std::end(m.name), std::begin(entry.szModule));
+      std::copy(
+        std::begin(m.path), std::end(m.path), std::begin(entry.szExePath));
+      entry.szModule[MAX_MODULE_NAME32] = L'\0';
+      entry.szExePath[MAX_PATH - 1] = L'\0';
+      modules_.emplace_back(entry);
+    }
+  }
+
+  // Returns the region containing the address, or the first region above it.
+  std::vector<Region>::const_iterator FindRegion(std::uintptr_t address) const
+    noexcept
+  {
+    return std::upper_bound(std::begin(regions_),
+                            std::end(regions_),
+                            address,
+                            [](std::uintptr_t a, Region const& r)
+                            {
+                              return a < r.end;
+                            });
+  }
+
+  SmartFileHandle file_;
+  SmartHandle mapping_;
+  SmartMappedFileHandle view_;
+  DWORD process_id_{};
+  std::uintptr_t max_address_{};
+  std::vector<Region> regions_;
+  std::vector<MODULEENTRY32W> modules_;
+};
+}
+}
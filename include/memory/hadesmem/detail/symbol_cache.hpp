@@ -0,0 +1,269 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <windows.h>
+#include <winternl.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/srw_lock.hpp>
+#include <hadesmem/detail/trace.hpp>
+
+namespace hadesmem
+{
+class ExportIndex;
+
+namespace detail
+{
+// Procedure addresses (with any forwarder chain already followed), module
+// handles and export indexes used by FindProcedure. Invalidating the cache
+// only starts a new 'generation' (entries from an older one are never
+// returned, and are thrown away on the next insert), so it is safe to do from
+// anywhere, including a loader notification. Safe to use from multiple
+// threads.
+class SymbolCache
+{
+public:
+  SymbolCache() noexcept
+  {
+  }
+
+  SymbolCache(SymbolCache const& other) = delete;
+
+  SymbolCache& operator=(SymbolCache const& other) = delete;
+
+  ~SymbolCache()
+  {
+    UnregisterDllNotification();
+  }
+
+  // Results must be inserted with the generation from before they were
+  // resolved, so that they are dropped if the cache is invalidated meanwhile.
+  std::uint32_t GetGeneration() const noexcept
+  {
+    return generation_;
+  }
+
+  void Invalidate() noexcept
+  {
+    ++generation_;
+  }
+
+  // Like Invalidate, but the old entries are thrown away immediately rather
+  // than on the next insert.
+  void Clear() noexcept
+  {
+    AcquireSRWLock const lock{&lock_, SRWLockType::Exclusive};
+    ++generation_;
+    modules_.clear();
+    procs_by_name_.clear();
+    procs_by_ordinal_.clear();
+    exports_.clear();
+    map_generation_ = generation_;
+  }
+
+  bool FindModule(std::wstring const& name, HMODULE& module)
+  {
+    return Find(modules_, name, module);
+  }
+
+  bool FindProcedure(HMODULE module, std::string const& name, FARPROC& proc)
+  {
+    return Find(procs_by_name_, std::make_pair(module, name), proc);
+  }
+
+  bool FindProcedure(HMODULE module, WORD ordinal, FARPROC& proc)
+  {
+    return Find(procs_by_ordinal_, std::make_pair(module, ordinal), proc);
+  }
+
+  bool FindExportIndex(HMODULE module,
+                       std::shared_ptr<ExportIndex const>& exports)
+  {
+    return Find(exports_, module, exports);
+  }
+
+  void InsertModule(std::uint32_t generation,
+                    std::wstring const& name,
+                    HMODULE module)
+  {
+    Insert(generation, modules_, name, module);
+  }
+
+  void InsertProcedure(std::uint32_t generation,
+                       HMODULE module,
+                       std::string const& name,
+                       FARPROC proc)
+  {
+    Insert(generation, procs_by_name_, std::make_pair(module, name), proc);
+  }
+
+  void InsertProcedure(std::uint32_t generation,
+                       HMODULE module,
+                       WORD ordinal,
+                       FARPROC proc)
+  {
+    Insert(
+      generation, procs_by_ordinal_, std::make_pair(module, ordinal), proc);
+  }
+
+  void InsertExportIndex(std::uint32_t generation,
+                         HMODULE module,
+                         std::shared_ptr<ExportIndex const> exports)
+  {
+    Insert(generation, exports_, module, std::move(exports));
+  }
+
+  // Invalidates the cache whenever a module is loaded or unloaded in the
+  // current process. If the notification can't be registered (e.g. the loader
+  // doesn't support notifications prior to Vista) nothing is ever inserted, as
+  // entries could otherwise outlive the module they came from.
+  void RegisterDllNotification()
+  {
+    HADESMEM_DETAIL_ASSERT(!dll_notification_cookie_);
+
+    using FnLdrRegisterDllNotification =
+      NTSTATUS(NTAPI*)(ULONG flags,
+                       FnLdrDllNotification notification_function,
+                       PVOID context,
+                       PVOID* cookie);
+    auto const ldr_register_dll_notification =
+      reinterpret_cast<FnLdrRegisterDllNotification>(::GetProcAddress(
+        ::GetModuleHandleW(L"ntdll.dll"), "LdrRegisterDllNotification"));
+    if (!ldr_register_dll_notification)
+    {
+      HADESMEM_DETAIL_TRACE_A(
+        "LdrRegisterDllNotification not found. Disabling symbol cache.");
+      disabled_ = true;
+      return;
+    }
+
+    PVOID cookie = nullptr;
+    NTSTATUS const status =
+      ldr_register_dll_notification(0, &OnDllNotification, this, &cookie);
+    if (!NT_SUCCESS(status))
+    {
+      HADESMEM_DETAIL_TRACE_FORMAT_A(
+        "LdrRegisterDllNotification failed with status 0x%08lX. Disabling "
+        "symbol cache.",
+        static_cast<unsigned long>(status));
+      disabled_ = true;
+      return;
+    }
+
+    dll_notification_cookie_ = cookie;
+  }
+
+  // Whether inserts are ignored because invalidation can't be relied upon.
+  bool IsDisabled() const noexcept
+  {
+    return disabled_;
+  }
+
+  std::size_t GetNumHits() const noexcept
+  {
+    return num_hits_;
+  }
+
+  std::size_t GetNumMisses() const noexcept
+  {
+    return num_misses_;
+  }
+
+private:
+  using FnLdrDllNotification = VOID(CALLBACK*)(ULONG reason,
+                                               void const* data,
+                                               PVOID context);
+
+  static VOID CALLBACK
+    OnDllNotification(ULONG /*reason*/, void const* /*data*/, PVOID context)
+  {
+    static_cast<SymbolCache*>(context)->Invalidate();
+  }
+
+  void UnregisterDllNotification() noexcept
+  {
+    if (!dll_notification_cookie_)
+    {
+      return;
+    }
+
+    using FnLdrUnregisterDllNotification = NTSTATUS(NTAPI*)(PVOID cookie);
+    auto const ldr_unregister_dll_notification =
+      reinterpret_cast<FnLdrUnregisterDllNotification>(::GetProcAddress(
+        ::GetModuleHandleW(L"ntdll.dll"), "LdrUnregisterDllNotification"));
+    HADESMEM_DETAIL_ASSERT(ldr_unregister_dll_notification);
+    ldr_unregister_dll_notification(dll_notification_cookie_);
+    dll_notification_cookie_ = nullptr;
+  }
+
+  template <typename MapT, typename KeyT, typename ValueT>
+  bool Find(MapT const& map, KeyT const& key, ValueT& value) noexcept
+  {
+    AcquireSRWLock const lock{&lock_, SRWLockType::Shared};
+    if (map_generation_ == generation_)
+    {
+      auto const iter = map.find(key);
+      if (iter != std::end(map))
+      {
+        value = iter->second;
+        ++num_hits_;
+        return true;
+      }
+    }
+
+    ++num_misses_;
+    return false;
+  }
+
+  template <typename MapT, typename KeyT, typename ValueT>
+  void Insert(std::uint32_t generation,
+              MapT& map,
+              KeyT const& key,
+              ValueT value)
+  {
+    AcquireSRWLock const lock{&lock_, SRWLockType::Exclusive};
+    if (disabled_ || generation != generation_)
+    {
+      return;
+    }
+
+    if (map_generation_ != generation)
+    {
+      modules_.clear();
+      procs_by_name_.clear();
+      procs_by_ordinal_.clear();
+      exports_.clear();
+      map_generation_ = generation;
+    }
+
+    map[key] = std::move(value);
+  }
+
+  SRWLOCK lock_ = SRWLOCK_INIT;
+  std::atomic<std::uint32_t> generation_{};
+  // Generation of the entries currently in the maps.
+  std::uint32_t map_generation_{};
+  std::map<std::wstring, HMODULE> modules_;
+  std::map<std::pair<HMODULE, std::string>, FARPROC> procs_by_name_;
+  std::map<std::pair<HMODULE, WORD>, FARPROC> procs_by_ordinal_;
+  std::map<HMODULE, std::shared_ptr<ExportIndex const>> exports_;
+  PVOID dll_notification_cookie_{};
+  // Only set by RegisterDllNotification, which is called before the cache is
+  // used.
+  bool disabled_{};
+  std::atomic<std::size_t> num_hits_{};
+  std::atomic<std::size_t> num_misses_{};
+};
+}
+}
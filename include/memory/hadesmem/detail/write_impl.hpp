@@ -8,6 +8,7 @@
 #include <windows.h>
 
 #include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/guarded_copy.hpp>
 #include <hadesmem/detail/protect_guard.hpp>
 #include <hadesmem/detail/query_region.hpp>
 #include <hadesmem/detail/type_traits.hpp>
@@ -28,6 +29,25 @@ inline void WriteUnchecked(Process const& process,
   HADESMEM_DETAIL_ASSERT(data != nullptr);
   HADESMEM_DETAIL_ASSERT(len != 0);
 
+  if (process.GetSnapshot())
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Process snapshots are read-only."});
+  }
+
+  if (process.IsSelf())
+  {
+    if (!GuardedCopy(address, data, len))
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Guarded memory copy failed."}
+                << ErrorCodeWinLast{last_error});
+    }
+
+    return;
+  }
+
   SIZE_T bytes_written = 0;
   if (!::WriteProcessMemory(
         process.GetHandle(), address, data, len, &bytes_written) ||
@@ -49,6 +69,12 @@ inline void WriteImpl(Process const& process,
   HADESMEM_DETAIL_ASSERT(data != nullptr);
   HADESMEM_DETAIL_ASSERT(len != 0);
 
+  if (process.IsTrustedBufferMode())
+  {
+    WriteUnchecked(process, address, data, len);
+    return;
+  }
+
   for (;;)
   {
     ProtectGuard protect_guard{process, address, ProtectGuardType::kWrite};
@@ -5,15 +5,19 @@
 
 #include <exception>
 
+#if defined(_WIN32)
 #include <windows.h>
 #include <winnt.h>
 #include <winternl.h>
+#endif // #if defined(_WIN32)
 
 #include <hadesmem/detail/warning_disable_prefix.hpp>
 #include <boost/exception/all.hpp>
 #include <hadesmem/detail/warning_disable_suffix.hpp>
 
+#if defined(_WIN32)
 #include <hadesmem/config.hpp>
+#endif // #if defined(_WIN32)
 
 // TODO: Remove Boost.Exception dependency.
 
@@ -57,6 +61,12 @@ class Error : public virtual std::exception, public virtual boost::exception
 };
 
 using ErrorString = boost::error_info<struct TagErrorString, std::string>;
+using ErrorStringOther =
+  boost::error_info<struct TagErrorStringOther, std::string>;
+
+// The error code types below are Win32 specific, so the Linux backend (see
+// hadesmem/linux) reports errno instead.
+#if defined(_WIN32)
 using ErrorCodeWinRet = boost::error_info<struct TagErrorCodeWinRet, DWORD_PTR>;
 using ErrorCodeWinLast = boost::error_info<struct TagErrorCodeWinLast, DWORD>;
 using ErrorCodeWinOther =
@@ -65,8 +75,9 @@ using ErrorCodeOther = boost::error_info<struct TagErrorCodeOther, DWORD_PTR>;
 using ErrorCodeWinHr = boost::error_info<struct TagErrorCodWinHr, HRESULT>;
 using ErrorCodeWinStatus =
   boost::error_info<struct TagErrorCodeWinStatus, NTSTATUS>;
-using ErrorStringOther =
-  boost::error_info<struct TagErrorStringOther, std::string>;
+#else // #if defined(_WIN32)
+using ErrorCodeErrno = boost::error_info<struct TagErrorCodeErrno, int>;
+#endif // #if defined(_WIN32)
 }
 
 #define HADESMEM_DETAIL_THROW_EXCEPTION(x) BOOST_THROW_EXCEPTION(x)
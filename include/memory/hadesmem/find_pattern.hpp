@@ -4,12 +4,14 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <exception>
 #include <iterator>
 #include <limits>
-#include <locale>
 #include <map>
-#include <sstream>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -21,9 +23,16 @@
 #include <pugixml.cpp>
 #include <hadesmem/detail/warning_disable_suffix.hpp>
 
+#include <hadesmem/compiled_pattern.hpp>
 #include <hadesmem/config.hpp>
 #include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/crypto.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/multi_pattern_matcher.hpp>
+#include <hadesmem/detail/parallel_for.hpp>
+#include <hadesmem/detail/pattern_search.hpp>
 #include <hadesmem/detail/pugixml_helpers.hpp>
+#include <hadesmem/detail/scratch_buffer.hpp>
 #include <hadesmem/detail/smart_handle.hpp>
 #include <hadesmem/detail/static_assert.hpp>
 #include <hadesmem/detail/str_conv.hpp>
@@ -32,6 +41,8 @@
 #include <hadesmem/find_procedure.hpp>
 #include <hadesmem/module.hpp>
 #include <hadesmem/module_list.hpp>
+#include <hadesmem/pattern_cache.hpp>
+#include <hadesmem/pattern_db.hpp>
 #include <hadesmem/pelib/dos_header.hpp>
 #include <hadesmem/pelib/nt_headers.hpp>
 #include <hadesmem/pelib/pe_file.hpp>
@@ -39,12 +50,11 @@
 #include <hadesmem/pelib/section_list.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
+#include <hadesmem/static_pattern.hpp>
 
 // TODO: Standalone app/example for FindPattern. For dumping results,
 // experimenting with patterns, automatically generating new patterns, etc.
 
-// TODO: Support nibble wildcards. (e.g. FF D? EB)
-
 // TODO: Handle the case where after resolving a pattern, the result lives
 // outside the module (the heap, a different module, etc) and we want to use
 // that result as the starting address for a different pattern. Example: Using a
@@ -63,7 +73,8 @@ struct PatternFlags
     kThrowOnUnmatch = 1 << 0,
     kRelativeAddress = 1 << 1,
     kScanData = 1 << 2,
-    kInvalidFlagMaxValue = 1 << 3
+    kParallel = 1 << 3,
+    kInvalidFlagMaxValue = 1 << 4
   };
 };
 
@@ -147,90 +158,195 @@ inline void* Rel(Process const& process,
   }
 }
 
-struct PatternDataByte
+inline std::uint8_t const* SearchBuffer(std::uint8_t const* h_beg,
+                                        std::uint8_t const* h_end,
+                                        CompiledPattern const& needle)
+{
+  PatternSearcher const searcher{needle};
+  return searcher.Search(h_beg, h_end);
+}
+
+inline void* FindRaw(Process const& process,
+                     std::uint8_t* s_beg,
+                     std::uint8_t* s_end,
+                     CompiledPattern const& needle)
+{
+  HADESMEM_DETAIL_ASSERT(s_beg < s_end);
+
+  auto const mem_size = static_cast<std::size_t>(s_end - s_beg);
+  ScopedScratch scratch{GetScanScratch()};
+  auto const h_beg = scratch.Get(mem_size);
+  ReadSpan(process, s_beg, h_beg, mem_size);
+
+  auto const h_end = h_beg + mem_size;
+  if (auto const iter = SearchBuffer(h_beg, h_end, needle))
+  {
+    return s_beg + (iter - h_beg);
+  }
+
+  return nullptr;
+}
+
+// Large buffers are split into chunks of this size when scanning in parallel.
+// Big enough that the per-chunk overhead is negligible, but small enough that
+// a typical code section still gives every thread some work.
+enum : std::size_t
 {
-  std::uint8_t data;
-  bool wildcard;
+  kParallelScanChunkSize = 1024 * 1024
 };
 
-inline std::vector<PatternDataByte> ConvertData(std::wstring const& data)
+// Threads are only used if each gets at least this many chunks, so a small
+// module is scanned on the calling thread.
+enum : std::size_t
 {
-  HADESMEM_DETAIL_ASSERT(!data.empty());
+  kParallelScanMinChunksPerThread = 4
+};
 
-  std::wstring const data_trimmed{
-    data.substr(0, data.find_last_not_of(L" \n\r\t") + 1)};
+using SearchRange = std::pair<std::uint8_t const*, std::uint8_t const*>;
 
-  HADESMEM_DETAIL_ASSERT(!data_trimmed.empty());
+struct SearchChunk
+{
+  std::size_t range;
+  std::uint8_t const* beg;
+  std::uint8_t const* end;
+};
 
-  std::wistringstream data_str{data_trimmed};
-  data_str.imbue(std::locale::classic());
-  std::vector<PatternDataByte> data_real;
-  do
+// Splits each range into chunks, in address order. Every chunk is extended
+// into the next one by 'overlap' bytes (the needle length minus one) so that
+// a match which starts in the chunk but crosses the boundary is still found.
+inline std::vector<SearchChunk>
+  GetSearchChunks(std::vector<SearchRange> const& ranges, std::size_t overlap)
+{
+  std::vector<SearchChunk> chunks;
+  for (std::size_t i = 0; i < ranges.size(); ++i)
   {
-    std::wstring data_cur_str;
-    if (!(data_str >> data_cur_str))
+    auto const end = ranges[i].second;
+    for (auto cur = ranges[i].first; cur < end;)
     {
-      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                      << ErrorString{"Data parsing failed."});
+      auto const chunk_end =
+        cur + (std::min)(static_cast<std::size_t>(end - cur),
+                         static_cast<std::size_t>(kParallelScanChunkSize));
+      auto const search_end =
+        chunk_end +
+        (std::min)(static_cast<std::size_t>(end - chunk_end), overlap);
+      chunks.emplace_back(SearchChunk{i, cur, search_end});
+      cur = chunk_end;
     }
+  }
 
-    bool const is_wildcard = (data_cur_str == L"??");
-    std::uint32_t current = 0U;
-    if (!is_wildcard)
-    {
-      std::wistringstream conv{data_cur_str};
-      conv.imbue(std::locale::classic());
-      if (!(conv >> std::hex >> current))
-      {
-        HADESMEM_DETAIL_THROW_EXCEPTION(
-          Error{} << ErrorString{"Data conversion failed."});
-      }
+  return chunks;
+}
+
+// Parallel equivalent of calling SearchBuffer on each range in turn and
+// stopping at the first match. Returns the index of the range containing the
+// match (or ranges.size() if there isn't one). The match is always the first
+// one in range order, regardless of which chunk finishes first.
+inline std::size_t SearchBuffersParallel(std::vector<SearchRange> const& ranges,
+                                         CompiledPattern const& needle,
+                                         std::uint8_t const*& match)
+{
+  HADESMEM_DETAIL_ASSERT(!needle.IsEmpty());
+
+  auto const chunks = GetSearchChunks(ranges, needle.GetSize() - 1);
+  PatternSearcher const searcher{needle};
+  std::vector<std::uint8_t const*> results(chunks.size());
+  // Chunks after the lowest one known to contain a match can't change the
+  // result, so they're skipped.
+  std::atomic<std::size_t> first_match{chunks.size()};
+  ParallelFor(chunks.size(),
+              [&](std::size_t i)
+              {
+                if (i > first_match)
+                {
+                  return;
+                }
+
+                results[i] = searcher.Search(chunks[i].beg, chunks[i].end);
+                if (results[i])
+                {
+                  std::size_t cur = first_match;
+                  while (i < cur && !first_match.compare_exchange_weak(cur, i))
+                  {
+                  }
+                }
+              },
+              GetDefaultParallelism(),
+              kParallelScanMinChunksPerThread);
+
+  std::size_t const i = first_match;
+  if (i == chunks.size())
+  {
+    match = nullptr;
+    return ranges.size();
+  }
+
+  match = results[i];
+  return chunks[i].range;
+}
 
-      if (current > static_cast<std::uint8_t>(-1))
+// Parallel equivalent of calling MultiPatternMatcher::FindFirst on each range
+// in turn. Every chunk is scanned for every pattern, and then the results are
+// merged by taking the match from the lowest chunk. The callback is invoked
+// (on the calling thread) with the pattern ID, the index of the range and the
+// address of the match.
+template <typename Callback>
+void FindFirstParallel(MultiPatternMatcher const& matcher,
+                       std::vector<SearchRange> const& ranges,
+                       Callback callback)
+{
+  HADESMEM_DETAIL_ASSERT(matcher.GetNumPatterns());
+
+  auto const chunks =
+    GetSearchChunks(ranges, matcher.GetMaxPatternLength() - 1);
+  std::size_t const num_patterns = matcher.GetNumPatterns();
+  std::vector<std::uint8_t const*> results(chunks.size() * num_patterns);
+  ParallelFor(chunks.size(),
+              [&](std::size_t i)
+              {
+                std::vector<bool> matched(num_patterns);
+                auto const chunk_results = results.data() + i * num_patterns;
+                matcher.FindFirst(
+                  chunks[i].beg,
+                  chunks[i].end,
+                  matched,
+                  [&](std::size_t id, std::uint8_t const* match)
+                  {
+                    chunk_results[id] = match;
+                  });
+              },
+              GetDefaultParallelism(),
+              kParallelScanMinChunksPerThread);
+
+  for (std::size_t id = 0; id < num_patterns; ++id)
+  {
+    for (std::size_t i = 0; i < chunks.size(); ++i)
+    {
+      if (auto const match = results[i * num_patterns + id])
       {
-        HADESMEM_DETAIL_THROW_EXCEPTION(Error()
-                                        << ErrorString("Invalid data."));
+        callback(id, chunks[i].range, match);
+        break;
       }
     }
-
-    data_real.emplace_back(
-      PatternDataByte{static_cast<std::uint8_t>(current), is_wildcard});
-  } while (!data_str.eof());
-
-  return data_real;
+  }
 }
 
-template <typename NeedleIterator>
-void* FindRaw(Process const& process,
-              std::uint8_t* s_beg,
-              std::uint8_t* s_end,
-              NeedleIterator n_beg,
-              NeedleIterator n_end)
+inline void* FindRawParallel(Process const& process,
+                             std::uint8_t* s_beg,
+                             std::uint8_t* s_end,
+                             CompiledPattern const& needle)
 {
   HADESMEM_DETAIL_ASSERT(s_beg < s_end);
 
-  std::ptrdiff_t const mem_size = s_end - s_beg;
-  std::vector<std::uint8_t> const haystack{ReadVector<std::uint8_t>(
-    process, s_beg, static_cast<std::size_t>(mem_size))};
-
-  auto const h_beg = std::begin(haystack);
-  auto const h_end = std::end(haystack);
-  auto const iter =
-    std::search(h_beg,
-                h_end,
-                n_beg,
-                n_end,
-                [](std::uint8_t h_cur, detail::PatternDataByte const& n_cur)
-                {
-                  return n_cur.wildcard || h_cur == n_cur.data;
-                });
-
-  if (iter != h_end)
-  {
-    return s_beg + std::distance(h_beg, iter);
-  }
+  auto const mem_size = static_cast<std::size_t>(s_end - s_beg);
+  ScopedScratch scratch{GetScanScratch()};
+  auto const h_beg = scratch.Get(mem_size);
+  ReadSpan(process, s_beg, h_beg, mem_size);
 
-  return nullptr;
+  std::uint8_t const* match = nullptr;
+  SearchBuffersParallel({SearchRange{h_beg, h_beg + mem_size}},
+                        needle,
+                        match);
+  return match ? s_beg + (match - h_beg) : nullptr;
 }
 
 struct ModuleRegionInfo
@@ -302,14 +418,13 @@ inline ModuleRegionInfo GetModuleInfo(Process const& process,
   return mod_info;
 }
 
-template <typename NeedleIterator>
-void* Find(Process const& process,
-           ModuleRegionInfo::ScanRegion const& region,
-           void* start,
-           NeedleIterator n_beg,
-           NeedleIterator n_end)
+// Returns false if the region should be skipped because the custom start
+// address lies outside of it.
+inline bool GetScanStart(ModuleRegionInfo::ScanRegion const& region,
+                         void* start,
+                         std::uint8_t*& s_beg)
 {
-  std::uint8_t* s_beg = region.first;
+  s_beg = region.first;
   std::uint8_t* const s_end = region.second;
 
   // Support custom scan start address.
@@ -330,37 +445,24 @@ void* Find(Process const& process,
     // Skip if we're not in the target region.
     else
     {
-      return nullptr;
+      return false;
     }
   }
 
-  return FindRaw(process, s_beg, s_end, n_beg, n_end);
+  return true;
 }
 
-template <typename NeedleIterator>
-void* Find(Process const& process,
-           ModuleRegionInfo const& mod_info,
-           NeedleIterator n_beg,
-           NeedleIterator n_end,
-           std::uint32_t flags,
-           void* start,
-           std::wstring const* name)
+inline void* HandleFindResult(void* address,
+                              void* base,
+                              std::uint32_t flags,
+                              std::wstring const* name)
 {
-  HADESMEM_DETAIL_ASSERT(n_beg != n_end);
-
-  bool const scan_data_secs = !!(flags & PatternFlags::kScanData);
-  auto const& scan_regions =
-    scan_data_secs ? mod_info.data_regions : mod_info.code_regions;
-  for (auto const& region : scan_regions)
+  if (address)
   {
-    if (void* const address = Find(process, region, start, n_beg, n_end))
-    {
-      return !!(flags & PatternFlags::kRelativeAddress)
-               ? static_cast<std::uint8_t*>(address) -
-                   reinterpret_cast<std::uintptr_t>(
-                     mod_info.module->GetHandle())
-               : address;
-    }
+    return !!(flags & PatternFlags::kRelativeAddress)
+             ? static_cast<std::uint8_t*>(address) -
+                 reinterpret_cast<std::uintptr_t>(base)
+             : address;
   }
 
   if (!!(flags & PatternFlags::kThrowOnUnmatch))
@@ -374,40 +476,302 @@ void* Find(Process const& process,
   return nullptr;
 }
 
-template <typename NeedleIterator>
-void* Find(Process const& process,
-           std::pair<std::uint8_t*, std::uint8_t*> const& region,
-           NeedleIterator n_beg,
-           NeedleIterator n_end,
-           std::uint32_t flags,
-           void* start,
-           std::wstring const* name)
+inline void* Find(Process const& process,
+                  ModuleRegionInfo::ScanRegion const& region,
+                  void* start,
+                  CompiledPattern const& needle,
+                  bool parallel = false)
+{
+  std::uint8_t* s_beg = nullptr;
+  if (!GetScanStart(region, start, s_beg))
+  {
+    return nullptr;
+  }
+
+  return parallel ? FindRawParallel(process, s_beg, region.second, needle)
+                  : FindRaw(process, s_beg, region.second, needle);
+}
+
+inline void* Find(Process const& process,
+                  std::pair<std::uint8_t*, std::uint8_t*> const& region,
+                  CompiledPattern const& needle,
+                  std::uint32_t flags,
+                  void* start,
+                  std::wstring const* name)
+{
+  HADESMEM_DETAIL_ASSERT(!needle.IsEmpty());
+
+  bool const parallel = !!(flags & PatternFlags::kParallel);
+  void* const address = Find(process, region, start, needle, parallel);
+  return HandleFindResult(address, region.first, flags, name);
+}
+
+// Module scan using section data which has already been read, so that multiple
+// patterns can be resolved without reading the module again.
+inline void* Find(ModuleRegionInfo const& mod_info,
+                  std::vector<std::vector<std::uint8_t>> const& buffers,
+                  CompiledPattern const& needle,
+                  std::uint32_t flags,
+                  void* start,
+                  std::wstring const* name)
 {
-  HADESMEM_DETAIL_ASSERT(n_beg != n_end);
+  HADESMEM_DETAIL_ASSERT(!needle.IsEmpty());
+
+  bool const scan_data_secs = !!(flags & PatternFlags::kScanData);
+  auto const& scan_regions =
+    scan_data_secs ? mod_info.data_regions : mod_info.code_regions;
+  HADESMEM_DETAIL_ASSERT(scan_regions.size() == buffers.size());
+  void* address = nullptr;
 
-  if (void* const address = Find(process, region, start, n_beg, n_end))
+  if (!!(flags & PatternFlags::kParallel))
   {
-    return !!(flags & PatternFlags::kRelativeAddress)
-             ? static_cast<std::uint8_t*>(address) -
-                 reinterpret_cast<std::uintptr_t>(region.first)
-             : address;
+    // Regions which are skipped because of the start address are left empty
+    // so the range indexes still line up with the regions.
+    std::vector<SearchRange> ranges;
+    ranges.reserve(scan_regions.size());
+    for (std::size_t i = 0; i < scan_regions.size(); ++i)
+    {
+      auto const h_base = buffers[i].data();
+      auto const h_end = h_base + buffers[i].size();
+      std::uint8_t* s_beg = nullptr;
+      auto const h_beg = GetScanStart(scan_regions[i], start, s_beg)
+                           ? h_base + (s_beg - scan_regions[i].first)
+                           : h_end;
+      ranges.emplace_back(h_beg, h_end);
+    }
+
+    std::uint8_t const* match = nullptr;
+    std::size_t const i = SearchBuffersParallel(ranges, needle, match);
+    if (match)
+    {
+      address = scan_regions[i].first + (match - buffers[i].data());
+    }
+
+    return HandleFindResult(
+      address, mod_info.module->GetHandle(), flags, name);
   }
 
-  if (!!(flags & PatternFlags::kThrowOnUnmatch))
+  for (std::size_t i = 0; i < scan_regions.size() && !address; ++i)
   {
-    auto const name_narrow = name ? WideCharToMultiByte(*name) : std::string();
-    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                    << ErrorString{"Could not match pattern."}
-                                    << ErrorStringOther{name_narrow});
+    std::uint8_t* s_beg = nullptr;
+    if (!GetScanStart(scan_regions[i], start, s_beg))
+    {
+      continue;
+    }
+
+    auto const h_base = buffers[i].data();
+    auto const h_beg = h_base + (s_beg - scan_regions[i].first);
+    auto const h_end = h_base + buffers[i].size();
+    if (auto const iter = SearchBuffer(h_beg, h_end, needle))
+    {
+      address = scan_regions[i].first + (iter - h_base);
+    }
   }
 
-  return nullptr;
+  return HandleFindResult(address, mod_info.module->GetHandle(), flags, name);
+}
+
+inline std::vector<std::vector<std::uint8_t>>
+  ReadRegions(Process const& process,
+              std::vector<ModuleRegionInfo::ScanRegion> const& regions)
+{
+  std::vector<std::vector<std::uint8_t>> buffers;
+  buffers.reserve(regions.size());
+  for (auto const& region : regions)
+  {
+    buffers.emplace_back(ReadVector<std::uint8_t>(
+      process,
+      region.first,
+      static_cast<std::size_t>(region.second - region.first)));
+  }
+
+  return buffers;
+}
+
+inline void* Find(Process const& process,
+                  ModuleRegionInfo const& mod_info,
+                  CompiledPattern const& needle,
+                  std::uint32_t flags,
+                  void* start,
+                  std::wstring const* name)
+{
+  HADESMEM_DETAIL_ASSERT(!needle.IsEmpty());
+
+  bool const scan_data_secs = !!(flags & PatternFlags::kScanData);
+  auto const& scan_regions =
+    scan_data_secs ? mod_info.data_regions : mod_info.code_regions;
+
+  // Chunks from every section are scanned together, so all of them need to be
+  // read up front rather than stopping at the first section with a match.
+  if (!!(flags & PatternFlags::kParallel))
+  {
+    return Find(mod_info,
+                ReadRegions(process, scan_regions),
+                needle,
+                flags,
+                start,
+                name);
+  }
+
+  void* address = nullptr;
+  for (auto const& region : scan_regions)
+  {
+    if ((address = Find(process, region, start, needle)) != nullptr)
+    {
+      break;
+    }
+  }
+
+  return HandleFindResult(address, mod_info.module->GetHandle(), flags, name);
+}
+
+inline DWORD GetModuleTimeDateStamp(Process const& process, void* base)
+{
+  auto const dos_header = Read<IMAGE_DOS_HEADER>(process, base);
+  auto const nt_headers_offset =
+    static_cast<std::uintptr_t>(dos_header.e_lfanew) +
+    offsetof(IMAGE_NT_HEADERS, FileHeader.TimeDateStamp);
+  return Read<DWORD>(process,
+                     static_cast<std::uint8_t*>(base) + nt_headers_offset);
 }
 }
 
+// Caches the section layout of a module, and a copy of its section data (which
+// is read lazily the first time each class of section is scanned), so repeated
+// scans of the same module don't have to enumerate modules, parse headers and
+// read the target process every time. The cache is rebuilt automatically if
+// the module has been reloaded (i.e. its base or TimeDateStamp has changed).
+// Cached section data is a snapshot, so call Invalidate if the target may have
+// modified it (e.g. when scanning writable data sections).
+class ModuleScanContext
+{
+public:
+  explicit ModuleScanContext(Process const& process, std::wstring const& module)
+    : process_{&process}, module_name_{detail::ToUpperOrdinal(module)}
+  {
+    Initialize();
+  }
+
+  explicit ModuleScanContext(Process const&& process,
+                             std::wstring const& module) = delete;
+
+  Process const& GetProcess() const noexcept
+  {
+    return *process_;
+  }
+
+  // Upper case name the context was created with (empty for the main module).
+  std::wstring const& GetModuleName() const noexcept
+  {
+    return module_name_;
+  }
+
+  Module const& GetModule() const noexcept
+  {
+    return *mod_info_.module;
+  }
+
+  void* GetBase() const noexcept
+  {
+    return mod_info_.module->GetHandle();
+  }
+
+  DWORD GetTimeDateStamp() const noexcept
+  {
+    return time_date_stamp_;
+  }
+
+  detail::ModuleRegionInfo const& GetRegionInfo() const noexcept
+  {
+    return mod_info_;
+  }
+
+  // Returns true if the module was reloaded and the context was rebuilt. Only
+  // requires reading the headers at the cached base, so it's cheap to call
+  // before every scan.
+  bool Refresh()
+  {
+    try
+    {
+      if (detail::GetModuleTimeDateStamp(*process_, GetBase()) ==
+          time_date_stamp_)
+      {
+        return false;
+      }
+    }
+    catch (std::exception const& /*e*/)
+    {
+      // Module has probably been unloaded, so look it up again by name.
+    }
+
+    Initialize();
+
+    return true;
+  }
+
+  void Invalidate() noexcept
+  {
+    code_buffers_.reset();
+    data_buffers_.reset();
+  }
+
+  // Cached data for the code or data sections (depending on
+  // PatternFlags::kScanData), in the same order as the corresponding regions.
+  // The reference is only valid until the context is refreshed or
+  // invalidated.
+  std::vector<std::vector<std::uint8_t>> const&
+    GetSectionBuffers(std::uint32_t flags)
+  {
+    return *GetSharedSectionBuffers(flags);
+  }
+
+  // Same as GetSectionBuffers, but the data is kept alive by the returned
+  // pointer even after the context has been refreshed or invalidated (in
+  // which case it is simply no longer cached by the context).
+  std::shared_ptr<std::vector<std::vector<std::uint8_t>> const>
+    GetSharedSectionBuffers(std::uint32_t flags)
+  {
+    if (!!(flags & PatternFlags::kScanData))
+    {
+      if (!data_buffers_)
+      {
+        data_buffers_ =
+          std::make_shared<std::vector<std::vector<std::uint8_t>> const>(
+            detail::ReadRegions(*process_, mod_info_.data_regions));
+      }
+
+      return data_buffers_;
+    }
+
+    if (!code_buffers_)
+    {
+      code_buffers_ =
+        std::make_shared<std::vector<std::vector<std::uint8_t>> const>(
+          detail::ReadRegions(*process_, mod_info_.code_regions));
+    }
+
+    return code_buffers_;
+  }
+
+private:
+  void Initialize()
+  {
+    Invalidate();
+    mod_info_ = detail::GetModuleInfo(*process_, module_name_);
+    time_date_stamp_ = detail::GetModuleTimeDateStamp(*process_, GetBase());
+  }
+
+  Process const* process_;
+  std::wstring module_name_;
+  detail::ModuleRegionInfo mod_info_;
+  DWORD time_date_stamp_{};
+  std::shared_ptr<std::vector<std::vector<std::uint8_t>> const> code_buffers_;
+  std::shared_ptr<std::vector<std::vector<std::uint8_t>> const> data_buffers_;
+};
+
 inline void* Find(Process const& process,
                   std::wstring const& module,
-                  std::wstring const& data,
+                  CompiledPattern const& data,
                   std::uint32_t flags,
                   std::uintptr_t start,
                   std::wstring const* name = nullptr)
@@ -416,24 +780,57 @@ inline void* Find(Process const& process,
     !(flags & ~(PatternFlags::kInvalidFlagMaxValue - 1UL)));
 
   auto const mod_info = detail::GetModuleInfo(process, module);
-  auto const needle = detail::ConvertData(data);
   void* const start_abs =
     start
       ? reinterpret_cast<std::uint8_t*>(mod_info.module->GetHandle()) + start
       : nullptr;
-  return detail::Find(process,
-                      mod_info,
-                      std::begin(needle),
-                      std::end(needle),
+  return detail::Find(process, mod_info, data, flags, start_abs, name);
+}
+
+inline void* Find(Process const& process,
+                  std::wstring const& module,
+                  std::wstring const& data,
+                  std::uint32_t flags,
+                  std::uintptr_t start,
+                  std::wstring const* name = nullptr)
+{
+  return Find(process, module, CompiledPattern{data}, flags, start, name);
+}
+
+inline void* Find(ModuleScanContext& context,
+                  CompiledPattern const& data,
+                  std::uint32_t flags,
+                  std::uintptr_t start,
+                  std::wstring const* name = nullptr)
+{
+  HADESMEM_DETAIL_ASSERT(
+    !(flags & ~(PatternFlags::kInvalidFlagMaxValue - 1UL)));
+
+  context.Refresh();
+
+  void* const start_abs =
+    start ? static_cast<std::uint8_t*>(context.GetBase()) + start : nullptr;
+  return detail::Find(context.GetRegionInfo(),
+                      context.GetSectionBuffers(flags),
+                      data,
                       flags,
                       start_abs,
                       name);
 }
 
+inline void* Find(ModuleScanContext& context,
+                  std::wstring const& data,
+                  std::uint32_t flags,
+                  std::uintptr_t start,
+                  std::wstring const* name = nullptr)
+{
+  return Find(context, CompiledPattern{data}, flags, start, name);
+}
+
 inline void* Find(Process const& process,
                   void* base,
                   std::size_t size,
-                  std::wstring const& data,
+                  CompiledPattern const& data,
                   std::uint32_t flags,
                   std::uintptr_t start,
                   std::wstring const* name = nullptr)
@@ -443,20 +840,24 @@ inline void* Find(Process const& process,
 
   auto const region = std::make_pair(static_cast<std::uint8_t*>(base),
                                      static_cast<std::uint8_t*>(base) + size);
-  auto const needle = detail::ConvertData(data);
   void* const start_abs = start ? region.first + start : nullptr;
-  return detail::Find(process,
-                      region,
-                      std::begin(needle),
-                      std::end(needle),
-                      flags,
-                      start_abs,
-                      name);
+  return detail::Find(process, region, data, flags, start_abs, name);
+}
+
+inline void* Find(Process const& process,
+                  void* base,
+                  std::size_t size,
+                  std::wstring const& data,
+                  std::uint32_t flags,
+                  std::uintptr_t start,
+                  std::wstring const* name = nullptr)
+{
+  return Find(process, base, size, CompiledPattern{data}, flags, start, name);
 }
 
 inline void* FindInFile(Process const& process,
                         std::wstring const& path,
-                        std::wstring const& data,
+                        CompiledPattern const& data,
                         std::uint32_t flags,
                         std::uintptr_t start,
                         std::wstring const* name = nullptr)
@@ -504,6 +905,16 @@ inline void* FindInFile(Process const& process,
   return Find(process, base, size, data, flags, start, name);
 }
 
+inline void* FindInFile(Process const& process,
+                        std::wstring const& path,
+                        std::wstring const& data,
+                        std::uint32_t flags,
+                        std::uintptr_t start,
+                        std::wstring const* name = nullptr)
+{
+  return FindInFile(process, path, CompiledPattern{data}, flags, start, name);
+}
+
 class Pattern
 {
 public:
@@ -709,335 +1120,453 @@ private:
   std::map<std::wstring, PatternMap> map_;
 };
 
-class FindPattern
+namespace detail
 {
-public:
-  explicit FindPattern(Process const& process,
-                       std::wstring const& pattern_file,
-                       bool in_memory_file)
-    : process_{&process}, find_pattern_datas_{}
+// Pattern definitions for a single module, as read from a pattern file. These
+// are only used to build a PatternDb (see CompilePatternDb), which is what
+// FindPattern actually resolves patterns from.
+struct PatternInfo
+{
+  std::wstring name;
+  CompiledPattern data;
+  std::wstring start;
+  bool has_start_rva;
+  std::uintptr_t start_rva;
+  std::wstring start_export;
+  std::uint32_t flags;
+};
+
+struct ManipInfo
+{
+  enum class Manipulator
   {
-    if (in_memory_file)
-    {
-      LoadPatternFileMemory(pattern_file);
-    }
-    else
-    {
-      LoadPatternFile(pattern_file);
-    }
-  }
+    kAdd,
+    kSub,
+    kRel,
+    kLea,
+    kAnd
+  };
 
-  explicit FindPattern(Process const&& process,
-                       std::wstring const& pattern,
-                       bool in_memory_file) = delete;
+  Manipulator type;
+  bool has_operand1;
+  std::uintptr_t operand1;
+  bool has_operand2;
+  std::uintptr_t operand2;
+};
 
-  ModuleMap const& GetModuleMap() const noexcept
-  {
-    return find_pattern_datas_;
-  }
+HADESMEM_DETAIL_STATIC_ASSERT(PatternFlags::kInvalidFlagMaxValue - 1 ==
+                              kPatternDbFlagsMask);
+HADESMEM_DETAIL_STATIC_ASSERT(
+  static_cast<std::uint32_t>(ManipInfo::Manipulator::kAnd) ==
+  kPatternDbMaxManipulatorType);
 
-  PatternMap const& GetPatternMap(std::wstring const& module) const
+struct PatternInfoFull
+{
+  PatternInfo pattern;
+  std::vector<ManipInfo> manipulators;
+};
+
+struct FindPatternInfo
+{
+  std::uint32_t flags;
+  std::vector<PatternInfoFull> patterns;
+};
+
+inline std::uint32_t ReadPatternFlags(pugi::xml_node const& node)
+{
+  std::uint32_t flags = PatternFlags::kNone;
+  for (auto const& flag : node.children(L"Flag"))
   {
-    try
+    auto const flag_name = pugixml::GetAttributeValue(flag, L"Name");
+
+    if (flag_name == L"None")
     {
-      return find_pattern_datas_.at(detail::ToUpperOrdinal(module));
+      flags |= PatternFlags::kNone;
     }
-    catch (std::out_of_range const&)
+    else if (flag_name == L"ThrowOnUnmatch")
     {
-      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                      << ErrorString{"Invalid module name."});
+      flags |= PatternFlags::kThrowOnUnmatch;
+    }
+    else if (flag_name == L"RelativeAddress")
+    {
+      flags |= PatternFlags::kRelativeAddress;
+    }
+    else if (flag_name == L"ScanData")
+    {
+      flags |= PatternFlags::kScanData;
+    }
+    else if (flag_name == L"Parallel")
+    {
+      flags |= PatternFlags::kParallel;
+    }
+    else
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Unknown 'Flag' value."});
     }
   }
 
-  void* Lookup(std::wstring const& module, std::wstring const& name) const
-  {
-    return LookupEx(module, name).GetAddress();
-  }
+  return flags;
+}
 
-  friend bool operator==(FindPattern const& lhs, FindPattern const& rhs)
+inline std::map<std::wstring, FindPatternInfo>
+  ReadPatternsFromXml(pugi::xml_document const& doc)
+{
+  auto const hadesmem_root = doc.child(L"HadesMem");
+  if (!hadesmem_root)
   {
-    return lhs.process_ == rhs.process_ &&
-           lhs.find_pattern_datas_ == rhs.find_pattern_datas_;
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Failed to find 'HadesMem' root node."});
   }
 
-  friend bool operator!=(FindPattern const& lhs, FindPattern const& rhs)
+  std::map<std::wstring, FindPatternInfo> pattern_infos_full;
+  for (auto const& find_pattern_node : hadesmem_root.children(L"FindPattern"))
   {
-    return !(lhs == rhs);
-  }
+    auto const module_name = ToUpperOrdinal(
+      pugixml::GetOptionalAttributeValue(find_pattern_node, L"Module"));
 
-private:
-  void LoadPatternFile(std::wstring const& path)
-  {
-    pugi::xml_document doc;
-    auto const load_result = doc.load_file(path.c_str());
-    if (!load_result)
-    {
-      HADESMEM_DETAIL_THROW_EXCEPTION(
-        Error{} << ErrorString{"Loading XML file failed."}
-                << ErrorCodeOther{static_cast<DWORD_PTR>(load_result.status)}
-                << ErrorStringOther{load_result.description()});
-    }
+    std::uint32_t const flags = ReadPatternFlags(find_pattern_node);
 
-    LoadPatternFileImpl(doc);
-  }
+    std::vector<PatternInfoFull> pattern_infos;
 
-  void LoadPatternFileMemory(std::wstring const& data)
-  {
-    pugi::xml_document doc;
-    auto const load_result = doc.load(data.c_str());
-    if (!load_result)
+    for (auto const& pattern : find_pattern_node.children(L"Pattern"))
     {
-      HADESMEM_DETAIL_THROW_EXCEPTION(
-        Error{} << ErrorString{"Loading XML file failed."}
-                << ErrorCodeOther{static_cast<DWORD_PTR>(load_result.status)}
-                << ErrorStringOther{load_result.description()});
+      auto const pattern_name = pugixml::GetAttributeValue(pattern, L"Name");
+
+      auto const pattern_data = pugixml::GetAttributeValue(pattern, L"Data");
+
+      auto const pattern_start =
+        pugixml::GetOptionalAttributeValue(pattern, L"Start");
+
+      auto const pattern_start_rva =
+        pugixml::GetOptionalAttributeValue(pattern, L"StartRVA");
+
+      auto const pattern_start_export =
+        pugixml::GetOptionalAttributeValue(pattern, L"StartExport");
+
+      std::uint32_t const pattern_flags = ReadPatternFlags(pattern);
+
+      PatternInfo pattern_info{
+        pattern_name,
+        CompiledPattern{pattern_data},
+        pattern_start,
+        !pattern_start_rva.empty(),
+        pattern_start_rva.empty() ? 0U : HexStrToPtr(pattern_start_rva),
+        pattern_start_export,
+        pattern_flags};
+
+      std::vector<ManipInfo> pattern_manips;
+
+      for (auto const& manipulator : pattern.children(L"Manipulator"))
+      {
+        auto const manipulator_name =
+          pugixml::GetAttributeValue(manipulator, L"Name");
+
+        ManipInfo::Manipulator type = ManipInfo::Manipulator::kAdd;
+        if (manipulator_name == L"Add")
+        {
+          type = ManipInfo::Manipulator::kAdd;
+        }
+        else if (manipulator_name == L"Sub")
+        {
+          type = ManipInfo::Manipulator::kSub;
+        }
+        else if (manipulator_name == L"Rel")
+        {
+          type = ManipInfo::Manipulator::kRel;
+        }
+        else if (manipulator_name == L"Lea")
+        {
+          type = ManipInfo::Manipulator::kLea;
+        }
+        else if (manipulator_name == L"And")
+        {
+          type = ManipInfo::Manipulator::kAnd;
+        }
+        else
+        {
+          HADESMEM_DETAIL_THROW_EXCEPTION(
+            Error{} << ErrorString{"Unknown value for 'Name' attribute for "
+                                   "'Manipulator' node."});
+        }
+
+        auto const manipulator_operand1 = manipulator.attribute(L"Operand1");
+        bool const has_operand1 = !!manipulator_operand1;
+        std::uintptr_t const operand1 =
+          has_operand1 ? HexStrToPtr(manipulator_operand1.value()) : 0U;
+
+        auto const manipulator_operand2 = manipulator.attribute(L"Operand2");
+        bool const has_operand2 = !!manipulator_operand2;
+        std::uintptr_t const operand2 =
+          has_operand2 ? HexStrToPtr(manipulator_operand2.value()) : 0U;
+
+        pattern_manips.emplace_back(
+          ManipInfo{type, has_operand1, operand1, has_operand2, operand2});
+      }
+
+      pattern_infos.emplace_back(PatternInfoFull{pattern_info, pattern_manips});
     }
 
-    LoadPatternFileImpl(doc);
+    HADESMEM_DETAIL_ASSERT(pattern_infos_full.find(module_name) ==
+                           std::end(pattern_infos_full));
+    pattern_infos_full[module_name] = {flags, pattern_infos};
   }
 
-  Pattern LookupEx(std::wstring const& module, std::wstring const& name) const
+  return pattern_infos_full;
+}
+
+inline std::map<std::wstring, FindPatternInfo>
+  ReadPatternFile(std::wstring const& pattern_file, bool in_memory_file)
+{
+  pugi::xml_document doc;
+  auto const load_result = in_memory_file
+                             ? doc.load(pattern_file.c_str())
+                             : doc.load_file(pattern_file.c_str());
+  if (!load_result)
   {
-    auto const& pattern_map = GetPatternMap(module);
-    try
-    {
-      return pattern_map.at(name);
-    }
-    catch (std::out_of_range const&)
-    {
-      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                      << ErrorString{"Invalid pattern name."});
-    }
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Loading XML file failed."}
+              << ErrorCodeOther{static_cast<DWORD_PTR>(load_result.status)}
+              << ErrorStringOther{load_result.description()});
   }
 
-  struct PatternInfo
-  {
-    std::wstring name;
-    std::wstring data;
-    std::wstring start;
-    std::wstring start_rva;
-    std::wstring start_export;
-    std::uint32_t flags;
-  };
+  return ReadPatternsFromXml(doc);
+}
+}
+
+// Converts a pattern file to a precompiled pattern database (see PatternDb).
+// The result can be written to disk and later loaded by FindPattern without
+// any XML or pattern string parsing.
+inline std::vector<std::uint8_t>
+  CompilePatternDb(std::wstring const& pattern_file, bool in_memory_file)
+{
+  auto const patterns_info_full_list =
+    detail::ReadPatternFile(pattern_file, in_memory_file);
 
-  struct ManipInfo
+  detail::PatternDbWriter writer;
+  for (auto const& patterns_info_full : patterns_info_full_list)
   {
-    enum class Manipulator
+    writer.AddModule(patterns_info_full.first, patterns_info_full.second.flags);
+    for (auto const& p : patterns_info_full.second.patterns)
     {
-      kAdd,
-      kSub,
-      kRel,
-      kLea,
-      kAnd
-    };
+      writer.AddPattern(p.pattern.name,
+                        p.pattern.data.GetValues(),
+                        p.pattern.data.GetMasks(),
+                        p.pattern.data.GetSize(),
+                        p.pattern.start,
+                        p.pattern.has_start_rva,
+                        p.pattern.start_rva,
+                        p.pattern.start_export,
+                        p.pattern.flags);
+      for (auto const& m : p.manipulators)
+      {
+        writer.AddManipulator(static_cast<std::uint32_t>(m.type),
+                              m.has_operand1,
+                              m.operand1,
+                              m.has_operand2,
+                              m.operand2);
+      }
+    }
+  }
 
-    Manipulator type;
-    bool has_operand1;
-    std::uintptr_t operand1;
-    bool has_operand2;
-    std::uintptr_t operand2;
-  };
+  return writer.Finish();
+}
 
-  struct PatternInfoFull
+class FindPattern
+{
+public:
+  explicit FindPattern(Process const& process,
+                       std::wstring const& pattern_file,
+                       bool in_memory_file)
+    : FindPattern{process,
+                  pattern_file,
+                  in_memory_file,
+                  std::vector<ModuleScanContext*>{}}
   {
-    PatternInfo pattern;
-    std::vector<ManipInfo> manipulators;
-  };
+  }
 
-  struct FindPatternInfo
+  // Modules which have a matching scan context (by name, as passed to the
+  // ModuleScanContext constructor) are scanned using that context instead of
+  // building a temporary one.
+  explicit FindPattern(Process const& process,
+                       std::wstring const& pattern_file,
+                       bool in_memory_file,
+                       std::vector<ModuleScanContext*> const& contexts)
+    : FindPattern{process, pattern_file, in_memory_file, contexts, nullptr}
   {
-    std::uint32_t flags;
-    std::vector<PatternInfoFull> patterns;
-  };
+  }
 
-  std::uint32_t ReadFlags(pugi::xml_node const& node) const
+  // If a cache is provided, modules which have a valid cache entry are not
+  // scanned at all. Modules which are scanned have their results added to the
+  // cache, and the cache is saved if anything changed.
+  explicit FindPattern(Process const& process,
+                       std::wstring const& pattern_file,
+                       bool in_memory_file,
+                       std::vector<ModuleScanContext*> const& contexts,
+                       PatternCache* cache)
+    : process_{&process}, find_pattern_datas_{}
   {
-    std::uint32_t flags = PatternFlags::kNone;
-    for (auto const& flag : node.children(L"Flag"))
-    {
-      auto const flag_name = detail::pugixml::GetAttributeValue(flag, L"Name");
+    auto const db_data = CompilePatternDb(pattern_file, in_memory_file);
+    LoadPatternDbImpl(
+      PatternDb{db_data.data(), db_data.size()}, contexts, cache);
 
-      if (flag_name == L"None")
-      {
-        flags |= PatternFlags::kNone;
-      }
-      else if (flag_name == L"ThrowOnUnmatch")
-      {
-        flags |= PatternFlags::kThrowOnUnmatch;
-      }
-      else if (flag_name == L"RelativeAddress")
-      {
-        flags |= PatternFlags::kRelativeAddress;
-      }
-      else if (flag_name == L"ScanData")
-      {
-        flags |= PatternFlags::kScanData;
-      }
-      else
-      {
-        HADESMEM_DETAIL_THROW_EXCEPTION(
-          Error{} << ErrorString{"Unknown 'Flag' value."});
-      }
+    if (cache && cache->IsDirty())
+    {
+      cache->Save();
     }
+  }
 
-    return flags;
+  explicit FindPattern(Process const& process, PatternDb const& db)
+    : FindPattern{process, db, std::vector<ModuleScanContext*>{}, nullptr}
+  {
   }
 
-  std::map<std::wstring, FindPatternInfo>
-    ReadPatternsFromXml(pugi::xml_document const& doc) const
+  explicit FindPattern(Process const& process,
+                       PatternDb const& db,
+                       std::vector<ModuleScanContext*> const& contexts,
+                       PatternCache* cache)
+    : process_{&process}, find_pattern_datas_{}
   {
-    auto const hadesmem_root = doc.child(L"HadesMem");
-    if (!hadesmem_root)
-    {
-      HADESMEM_DETAIL_THROW_EXCEPTION(
-        Error{} << ErrorString{"Failed to find 'HadesMem' root node."});
-    }
+    LoadPatternDbImpl(db, contexts, cache);
 
-    std::map<std::wstring, FindPatternInfo> pattern_infos_full;
-    for (auto const& find_pattern_node : hadesmem_root.children(L"FindPattern"))
+    if (cache && cache->IsDirty())
     {
-      auto const module_name =
-        detail::ToUpperOrdinal(detail::pugixml::GetOptionalAttributeValue(
-          find_pattern_node, L"Module"));
-
-      std::uint32_t const flags = ReadFlags(find_pattern_node);
-
-      std::vector<PatternInfoFull> pattern_infos;
-
-      for (auto const& pattern : find_pattern_node.children(L"Pattern"))
-      {
-        auto const pattern_name =
-          detail::pugixml::GetAttributeValue(pattern, L"Name");
-
-        auto const pattern_data =
-          detail::pugixml::GetAttributeValue(pattern, L"Data");
-
-        auto const pattern_start =
-          detail::pugixml::GetOptionalAttributeValue(pattern, L"Start");
-
-        auto const pattern_start_rva =
-          detail::pugixml::GetOptionalAttributeValue(pattern, L"StartRVA");
+      cache->Save();
+    }
+  }
 
-        auto const pattern_start_export =
-          detail::pugixml::GetOptionalAttributeValue(pattern, L"StartExport");
+  explicit FindPattern(Process const&& process,
+                       std::wstring const& pattern,
+                       bool in_memory_file) = delete;
 
-        std::uint32_t const pattern_flags = ReadFlags(pattern);
+  explicit FindPattern(
+    Process const&& process,
+    std::wstring const& pattern,
+    bool in_memory_file,
+    std::vector<ModuleScanContext*> const& contexts) = delete;
 
-        PatternInfo pattern_info{pattern_name,
-                                 pattern_data,
-                                 pattern_start,
-                                 pattern_start_rva,
-                                 pattern_start_export,
-                                 pattern_flags};
+  explicit FindPattern(Process const&& process,
+                       std::wstring const& pattern,
+                       bool in_memory_file,
+                       std::vector<ModuleScanContext*> const& contexts,
+                       PatternCache* cache) = delete;
 
-        std::vector<ManipInfo> pattern_manips;
+  explicit FindPattern(Process const&& process, PatternDb const& db) = delete;
 
-        for (auto const& manipulator : pattern.children(L"Manipulator"))
-        {
-          auto const manipulator_name =
-            detail::pugixml::GetAttributeValue(manipulator, L"Name");
+  explicit FindPattern(Process const&& process,
+                       PatternDb const& db,
+                       std::vector<ModuleScanContext*> const& contexts,
+                       PatternCache* cache) = delete;
 
-          ManipInfo::Manipulator type = ManipInfo::Manipulator::kAdd;
-          if (manipulator_name == L"Add")
-          {
-            type = ManipInfo::Manipulator::kAdd;
-          }
-          else if (manipulator_name == L"Sub")
-          {
-            type = ManipInfo::Manipulator::kSub;
-          }
-          else if (manipulator_name == L"Rel")
-          {
-            type = ManipInfo::Manipulator::kRel;
-          }
-          else if (manipulator_name == L"Lea")
-          {
-            type = ManipInfo::Manipulator::kLea;
-          }
-          else if (manipulator_name == L"And")
-          {
-            type = ManipInfo::Manipulator::kAnd;
-          }
-          else
-          {
-            HADESMEM_DETAIL_THROW_EXCEPTION(
-              Error{} << ErrorString{"Unknown value for 'Name' attribute for "
-                                     "'Manipulator' node."});
-          }
+  ModuleMap const& GetModuleMap() const noexcept
+  {
+    return find_pattern_datas_;
+  }
 
-          auto const manipulator_operand1 = manipulator.attribute(L"Operand1");
-          bool const has_operand1 = !!manipulator_operand1;
-          std::uintptr_t const operand1 =
-            has_operand1 ? detail::HexStrToPtr(manipulator_operand1.value())
-                         : 0U;
+  PatternMap const& GetPatternMap(std::wstring const& module) const
+  {
+    try
+    {
+      return find_pattern_datas_.at(detail::ToUpperOrdinal(module));
+    }
+    catch (std::out_of_range const&)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Invalid module name."});
+    }
+  }
 
-          auto const manipulator_operand2 = manipulator.attribute(L"Operand2");
-          bool const has_operand2 = !!manipulator_operand2;
-          std::uintptr_t const operand2 =
-            has_operand2 ? detail::HexStrToPtr(manipulator_operand2.value())
-                         : 0U;
+  void* Lookup(std::wstring const& module, std::wstring const& name) const
+  {
+    return LookupEx(module, name).GetAddress();
+  }
 
-          pattern_manips.emplace_back(
-            ManipInfo{type, has_operand1, operand1, has_operand2, operand2});
-        }
+  friend bool operator==(FindPattern const& lhs, FindPattern const& rhs)
+  {
+    return lhs.process_ == rhs.process_ &&
+           lhs.find_pattern_datas_ == rhs.find_pattern_datas_;
+  }
 
-        pattern_infos.emplace_back(
-          PatternInfoFull{pattern_info, pattern_manips});
-      }
+  friend bool operator!=(FindPattern const& lhs, FindPattern const& rhs)
+  {
+    return !(lhs == rhs);
+  }
 
-      HADESMEM_DETAIL_ASSERT(pattern_infos_full.find(module_name) ==
-                             std::end(pattern_infos_full));
-      pattern_infos_full[module_name] = {flags, pattern_infos};
+private:
+  Pattern LookupEx(std::wstring const& module, std::wstring const& name) const
+  {
+    auto const& pattern_map = GetPatternMap(module);
+    try
+    {
+      return pattern_map.at(name);
+    }
+    catch (std::out_of_range const&)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Invalid pattern name."});
     }
-
-    return pattern_infos_full;
   }
 
+  using ManipInfo = detail::ManipInfo;
+  using PatternDbModule = detail::PatternDbModule;
+  using PatternDbPattern = detail::PatternDbPattern;
+  using PatternDbManipulator = detail::PatternDbManipulator;
+
+  // Manipulator types and operand bits are validated when the database is
+  // opened, but which operands each manipulator requires is checked here.
   void* ApplyManipulators(void* address,
                           std::uint32_t flags,
                           std::uintptr_t base,
-                          std::vector<ManipInfo> const& manip_list) const
+                          PatternDb const& db,
+                          PatternDbPattern const& pattern) const
   {
-    for (auto const& m : manip_list)
+    for (std::uint32_t i = 0; i < pattern.num_manipulators; ++i)
     {
-      switch (m.type)
+      auto const& m = db.GetManipulator(pattern.first_manipulator + i);
+      bool const has_operand1 =
+        !!(m.operands & PatternDbManipulator::kHasOperand1);
+      bool const has_operand2 =
+        !!(m.operands & PatternDbManipulator::kHasOperand2);
+      auto const operand1 = static_cast<std::uintptr_t>(m.operand1);
+      auto const operand2 = static_cast<std::uintptr_t>(m.operand2);
+      switch (static_cast<ManipInfo::Manipulator>(m.type))
       {
       case ManipInfo::Manipulator::kAdd:
-        if (!m.has_operand1 || m.has_operand2)
+        if (!has_operand1 || has_operand2)
         {
           HADESMEM_DETAIL_THROW_EXCEPTION(
             Error{} << ErrorString{"Invalid manipulator operands for 'Add'."});
         }
 
-        address = detail::Add(*process_, base, address, flags, m.operand1);
+        address = detail::Add(*process_, base, address, flags, operand1);
 
         break;
 
       case ManipInfo::Manipulator::kSub:
-        if (!m.has_operand1 || m.has_operand2)
+        if (!has_operand1 || has_operand2)
         {
           HADESMEM_DETAIL_THROW_EXCEPTION(
             Error{} << ErrorString{"Invalid manipulator operands for 'Sub'."});
         }
 
-        address = detail::Sub(*process_, base, address, flags, m.operand1);
+        address = detail::Sub(*process_, base, address, flags, operand1);
 
         break;
 
       case ManipInfo::Manipulator::kRel:
-        if (!m.has_operand1 || !m.has_operand2)
+        if (!has_operand1 || !has_operand2)
         {
           HADESMEM_DETAIL_THROW_EXCEPTION(
             Error{} << ErrorString{"Invalid manipulator operands for 'Rel'."});
         }
 
         address =
-          detail::Rel(*process_, base, address, flags, m.operand1, m.operand2);
+          detail::Rel(*process_, base, address, flags, operand1, operand2);
 
         break;
 
       case ManipInfo::Manipulator::kLea:
-        if (m.has_operand1 || m.has_operand2)
+        if (has_operand1 || has_operand2)
         {
           HADESMEM_DETAIL_THROW_EXCEPTION(
             Error{} << ErrorString{"Invalid manipulator operands for 'Lea'."});
@@ -1048,19 +1577,18 @@ private:
         break;
 
       case ManipInfo::Manipulator::kAnd:
-        if (!m.has_operand1 || m.has_operand2)
+        if (!has_operand1 || has_operand2)
         {
           HADESMEM_DETAIL_THROW_EXCEPTION(
             Error{} << ErrorString{"Invalid manipulator operands for 'And'."});
         }
 
-        address = detail::And(*process_, base, address, flags, m.operand1);
+        address = detail::And(*process_, base, address, flags, operand1);
 
         break;
 
       default:
-        HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                        << ErrorString{"Unknown manipulator."});
+        HADESMEM_DETAIL_ASSERT(false);
 
         break;
       }
@@ -1111,55 +1639,499 @@ private:
     return start_rva;
   }
 
-  void LoadPatternFileImpl(pugi::xml_document const& doc)
+  ModuleScanContext*
+    GetScanContext(std::wstring const& module,
+                   std::vector<ModuleScanContext*> const& contexts) const
   {
-    auto const patterns_info_full_list = ReadPatternsFromXml(doc);
-    for (auto const& patterns_info_full_pair : patterns_info_full_list)
+    for (auto const context : contexts)
     {
-      HADESMEM_DETAIL_ASSERT(
-        find_pattern_datas_.find(patterns_info_full_pair.first) ==
-        std::end(find_pattern_datas_));
-
-      auto const mod_info =
-        detail::GetModuleInfo(*process_, patterns_info_full_pair.first);
-      auto const base =
-        reinterpret_cast<std::uintptr_t>(mod_info.module->GetHandle());
-      auto const& module = patterns_info_full_pair.first;
-      auto const& patterns_info_full = patterns_info_full_pair.second;
-      auto const& pattern_infos = patterns_info_full.patterns;
-      for (auto const& p : pattern_infos)
+      HADESMEM_DETAIL_ASSERT(context);
+      HADESMEM_DETAIL_ASSERT(&context->GetProcess() == process_);
+      if (context->GetModuleName() == module)
       {
-        std::uint32_t const flags = patterns_info_full.flags | p.pattern.flags;
+        return context;
+      }
+    }
+
+    return nullptr;
+  }
+
+  // Patterns are resolved straight from the database records. Only the module
+  // and pattern names (which are needed for the results anyway) and the
+  // occasional start pattern or export name are copied out of it.
+  void LoadPatternDbImpl(PatternDb const& db,
+                         std::vector<ModuleScanContext*> const& contexts,
+                         PatternCache* cache)
+  {
+    for (std::uint32_t i = 0; i < db.GetNumModules(); ++i)
+    {
+      auto const& module_info = db.GetModule(i);
+      auto const module = db.GetString(module_info.name);
+      HADESMEM_DETAIL_ASSERT(find_pattern_datas_.find(module) ==
+                             std::end(find_pattern_datas_));
+
+      // Use the caller's scan context for the module if there is one. Either
+      // way each section is only read once per module, regardless of how many
+      // patterns we need to resolve.
+      std::unique_ptr<ModuleScanContext> local_context;
+      ModuleScanContext* context = GetScanContext(module, contexts);
+      if (context)
+      {
+        context->Refresh();
+      }
+      else
+      {
+        local_context = std::make_unique<ModuleScanContext>(*process_, module);
+        context = local_context.get();
+      }
+
+      auto const base = reinterpret_cast<std::uintptr_t>(context->GetBase());
+
+      PatternCacheKey cache_key{};
+      if (cache)
+      {
+        cache_key = GetPatternCacheKey(*cache, *context, db, module_info);
+        auto const cached = cache->Lookup(module, cache_key);
+        if (cached &&
+            LoadFromCache(*cache, *context, module, db, module_info, *cached))
+        {
+          continue;
+        }
+      }
+
+      std::vector<PatternCacheEntry> cache_entries;
+      cache_entries.reserve(module_info.num_patterns);
+
+      auto const batch_results = FindBatched(*context, db, module_info);
+
+      auto const independent_results =
+        FindIndependent(*context, module, db, module_info);
+
+      for (std::uint32_t j = 0; j < module_info.num_patterns; ++j)
+      {
+        auto const& p = db.GetPattern(module_info.first_pattern + j);
+        auto const name = db.GetString(p.name);
+        std::uint32_t const flags = module_info.flags | p.flags;
         void* address = nullptr;
-        std::uintptr_t const start_rva = [&]() -> std::uintptr_t
+        if (IsBatchable(p))
         {
-          if (!p.pattern.start_rva.empty())
-          {
-            return detail::HexStrToPtr(p.pattern.start_rva);
-          }
-          else if (!p.pattern.start_export.empty())
+          address = detail::HandleFindResult(
+            batch_results[j], context->GetBase(), flags, &name);
+        }
+        else if (!independent_results.empty() && IsIndependent(p))
+        {
+          // Errors are deferred until now so they're reported for the same
+          // pattern as they would be when resolving serially.
+          if (independent_results[j].error)
           {
-            return GetStartRvaFromExport(*mod_info.module,
-                                         p.pattern.start_export);
+            std::rethrow_exception(independent_results[j].error);
           }
-          else
+
+          address = independent_results[j].address;
+        }
+        else
+        {
+          address = FindUnbatched(*context,
+                                  context->GetSectionBuffers(flags),
+                                  module,
+                                  db,
+                                  p,
+                                  name,
+                                  flags);
+        }
+
+        bool const is_relative = !!(flags & PatternFlags::kRelativeAddress);
+        auto const rva =
+          reinterpret_cast<std::uintptr_t>(address) - (is_relative ? 0 : base);
+        cache_entries.emplace_back(
+          PatternCacheEntry{name, !!address, address ? rva : 0U});
+
+        AddPattern(module, db, p, name, flags, base, address);
+      }
+
+      if (cache)
+      {
+        cache->Update(module, cache_key, std::move(cache_entries));
+      }
+    }
+  }
+
+  void AddPattern(std::wstring const& module,
+                  PatternDb const& db,
+                  PatternDbPattern const& p,
+                  std::wstring const& name,
+                  std::uint32_t flags,
+                  std::uintptr_t base,
+                  void* address)
+  {
+    if (address)
+    {
+      address = ApplyManipulators(address, flags, base, db, p);
+    }
+
+    find_pattern_datas_[module][name] = Pattern{address, flags};
+  }
+
+  // Hash of everything which affects how the module's patterns are resolved,
+  // so that editing one module's patterns doesn't invalidate the cache for
+  // every other module in the same file.
+  static std::wstring GetPatternsHash(PatternDb const& db,
+                                      PatternDbModule const& module_info)
+  {
+    std::wstring data;
+    auto const append = [&](detail::PatternDbString const& str)
+    {
+      data.append(db.GetStringData(str), str.length);
+      data += L'\0';
+    };
+    auto const append_num = [&](std::uintptr_t num)
+    {
+      data += detail::NumToStr<wchar_t>(num, true);
+      data += L'\0';
+    };
+
+    append_num(module_info.flags);
+    for (std::uint32_t i = 0; i < module_info.num_patterns; ++i)
+    {
+      auto const& p = db.GetPattern(module_info.first_pattern + i);
+      append(p.name);
+      auto const values = db.GetPatternValues(p);
+      auto const masks = db.GetPatternMasks(p);
+      for (std::uint32_t j = 0; j < p.data_size; ++j)
+      {
+        append_num(values[j]);
+        append_num(masks[j]);
+      }
+      append(p.start);
+      append_num(p.has_start_rva ? static_cast<std::uintptr_t>(p.start_rva)
+                                 : ~std::uintptr_t{0});
+      append(p.start_export);
+      append_num(p.flags);
+      for (std::uint32_t j = 0; j < p.num_manipulators; ++j)
+      {
+        auto const& m = db.GetManipulator(p.first_manipulator + j);
+        append_num(m.type);
+        append_num((m.operands & PatternDbManipulator::kHasOperand1)
+                     ? static_cast<std::uintptr_t>(m.operand1)
+                     : ~std::uintptr_t{0});
+        append_num((m.operands & PatternDbManipulator::kHasOperand2)
+                     ? static_cast<std::uintptr_t>(m.operand2)
+                     : ~std::uintptr_t{0});
+      }
+    }
+
+    return detail::ByteArrayToString(detail::GetSha1Hash(
+      &data[0], static_cast<std::uint32_t>(data.size() * sizeof(wchar_t))));
+  }
+
+  PatternCacheKey GetPatternCacheKey(PatternCache const& cache,
+                                     ModuleScanContext const& context,
+                                     PatternDb const& db,
+                                     PatternDbModule const& module_info) const
+  {
+    PeFile const pe_file{
+      *process_, context.GetBase(), hadesmem::PeFileType::Image, 0};
+    NtHeaders const nt_headers{*process_, pe_file};
+
+    PatternCacheKey key{};
+    key.time_date_stamp = nt_headers.GetTimeDateStamp();
+    key.size_of_image = nt_headers.GetSizeOfImage();
+    key.checksum = nt_headers.GetCheckSum();
+    if (!!(cache.GetFlags() & PatternCacheFlags::kHashModule))
+    {
+      auto file = detail::FileToBuffer(context.GetModule().GetPath());
+      key.module_sha1 = detail::ByteArrayToString(detail::GetSha1Hash(
+        file.data(), static_cast<std::uint32_t>(file.size())));
+    }
+    key.patterns_sha1 = GetPatternsHash(db, module_info);
+
+    return key;
+  }
+
+  // Returns false (without adding any patterns) if the cache can't be used,
+  // in which case the module should be scanned as normal.
+  bool LoadFromCache(PatternCache const& cache,
+                     ModuleScanContext const& context,
+                     std::wstring const& module,
+                     PatternDb const& db,
+                     PatternDbModule const& module_info,
+                     std::vector<PatternCacheEntry> const& cache_entries)
+  {
+    if (cache_entries.size() != module_info.num_patterns)
+    {
+      return false;
+    }
+
+    auto const base = static_cast<std::uint8_t*>(context.GetBase());
+    bool const verify = !!(cache.GetFlags() & PatternCacheFlags::kVerify);
+    for (std::uint32_t i = 0; i < module_info.num_patterns; ++i)
+    {
+      auto const& p = db.GetPattern(module_info.first_pattern + i);
+      auto const& entry = cache_entries[i];
+      if (!db.StringEquals(p.name, entry.name))
+      {
+        return false;
+      }
+
+      if (verify && entry.matched)
+      {
+        try
+        {
+          auto const needle = db.GetPatternData(p);
+          auto const data = ReadVector<std::uint8_t>(
+            *process_, base + entry.rva, needle.GetSize());
+          if (!needle.Matches(data.data()))
           {
-            return GetStartRvaFromPattern(module, base, p.pattern.start);
+            return false;
           }
-        }();
+        }
+        catch (std::exception const& /*e*/)
+        {
+          return false;
+        }
+      }
+    }
 
-        address = ::hadesmem::Find(
-          *process_, module, p.pattern.data, flags, start_rva, &p.pattern.name);
+    for (std::uint32_t i = 0; i < module_info.num_patterns; ++i)
+    {
+      auto const& p = db.GetPattern(module_info.first_pattern + i);
+      auto const& entry = cache_entries[i];
+      std::uint32_t const flags = module_info.flags | p.flags;
+      void* const address = detail::HandleFindResult(
+        entry.matched ? base + entry.rva : nullptr, base, flags, &entry.name);
+      AddPattern(module,
+                 db,
+                 p,
+                 entry.name,
+                 flags,
+                 reinterpret_cast<std::uintptr_t>(base),
+                 address);
+    }
 
-        if (address)
+    return true;
+  }
+
+  static bool IsBatchable(PatternDbPattern const& pattern) noexcept
+  {
+    return !pattern.start.length && !pattern.has_start_rva &&
+           !pattern.start_export.length;
+  }
+
+  // Patterns which have a custom start address that doesn't come from another
+  // pattern.
+  static bool IsIndependent(PatternDbPattern const& pattern) noexcept
+  {
+    return !IsBatchable(pattern) && !pattern.start.length;
+  }
+
+  void* FindUnbatched(ModuleScanContext const& context,
+                      std::vector<std::vector<std::uint8_t>> const& buffers,
+                      std::wstring const& module,
+                      PatternDb const& db,
+                      PatternDbPattern const& pattern,
+                      std::wstring const& name,
+                      std::uint32_t flags) const
+  {
+    auto const base = reinterpret_cast<std::uintptr_t>(context.GetBase());
+    std::uintptr_t const start_rva = [&]() -> std::uintptr_t
+    {
+      if (pattern.has_start_rva)
+      {
+        return static_cast<std::uintptr_t>(pattern.start_rva);
+      }
+      else if (pattern.start_export.length)
+      {
+        return GetStartRvaFromExport(context.GetModule(),
+                                     db.GetString(pattern.start_export));
+      }
+      else
+      {
+        return GetStartRvaFromPattern(
+          module, base, db.GetString(pattern.start));
+      }
+    }();
+
+    void* const start_abs =
+      start_rva ? reinterpret_cast<std::uint8_t*>(base) + start_rva : nullptr;
+    return detail::Find(context.GetRegionInfo(),
+                        buffers,
+                        db.GetPatternData(pattern),
+                        flags,
+                        start_abs,
+                        &name);
+  }
+
+  struct IndependentResult
+  {
+    void* address;
+    std::exception_ptr error;
+  };
+
+  // When PatternFlags::kParallel is set for the module, patterns which have a
+  // custom start address but don't depend on another pattern are resolved
+  // concurrently (one pattern per task, each scanned serially). Returns an
+  // empty list if the module isn't being scanned in parallel, otherwise the
+  // result for each independent pattern indexed the same as the pattern list.
+  std::vector<IndependentResult>
+    FindIndependent(ModuleScanContext& context,
+                    std::wstring const& module,
+                    PatternDb const& db,
+                    PatternDbModule const& module_info) const
+  {
+    if (!(module_info.flags & PatternFlags::kParallel))
+    {
+      return {};
+    }
+
+    std::vector<std::uint32_t> pattern_indexes;
+    for (std::uint32_t i = 0; i < module_info.num_patterns; ++i)
+    {
+      if (IsIndependent(db.GetPattern(module_info.first_pattern + i)))
+      {
+        pattern_indexes.emplace_back(i);
+      }
+    }
+
+    // Section data is read lazily by the context, so make sure everything the
+    // tasks need is available before they start.
+    std::vector<std::vector<std::uint8_t>> const* buffers[2] = {};
+    for (auto const i : pattern_indexes)
+    {
+      std::uint32_t const flags =
+        module_info.flags | db.GetPattern(module_info.first_pattern + i).flags;
+      bool const scan_data = !!(flags & PatternFlags::kScanData);
+      if (!buffers[scan_data])
+      {
+        buffers[scan_data] = &context.GetSectionBuffers(flags);
+      }
+    }
+
+    // Each pattern scans (at most) the whole of its sections, so only use as
+    // many threads as would each get a worthwhile amount of data.
+    std::size_t scan_size = 1;
+    for (auto const b : buffers)
+    {
+      std::size_t size = 0;
+      for (std::size_t n = 0; b && n < b->size(); ++n)
+      {
+        size += (*b)[n].size();
+      }
+      scan_size = (std::max)(scan_size, size);
+    }
+    std::size_t const min_patterns_per_thread =
+      detail::kParallelScanMinChunksPerThread *
+      detail::kParallelScanChunkSize / scan_size;
+
+    std::vector<IndependentResult> results(module_info.num_patterns);
+    detail::ParallelFor(
+      pattern_indexes.size(),
+      [&](std::size_t n)
+      {
+        auto const i = pattern_indexes[n];
+        auto const& p = db.GetPattern(module_info.first_pattern + i);
+        // Patterns are already being resolved concurrently, so don't split
+        // each individual scan up as well.
+        std::uint32_t const flags =
+          (module_info.flags | p.flags) & ~PatternFlags::kParallel;
+        try
+        {
+          results[i].address =
+            FindUnbatched(context,
+                          *buffers[!!(flags & PatternFlags::kScanData)],
+                          module,
+                          db,
+                          p,
+                          db.GetString(p.name),
+                          flags);
+        }
+        catch (...)
+        {
+          results[i].error = std::current_exception();
+        }
+      },
+      detail::GetDefaultParallelism(),
+      min_patterns_per_thread);
+
+    return results;
+  }
+
+  // Patterns without a custom start address don't depend on each other, so
+  // all of them which target the same class of section (code or data) are
+  // resolved together in a single pass over each section. Returns the absolute
+  // address of each match (or nullptr), indexed the same as the pattern list.
+  std::vector<void*> FindBatched(ModuleScanContext& context,
+                                 PatternDb const& db,
+                                 PatternDbModule const& module_info) const
+  {
+    std::vector<void*> results(module_info.num_patterns);
+
+    for (auto const scan_data : {false, true})
+    {
+      detail::MultiPatternMatcher matcher;
+      std::vector<std::uint32_t> pattern_indexes;
+      for (std::uint32_t i = 0; i < module_info.num_patterns; ++i)
+      {
+        auto const& p = db.GetPattern(module_info.first_pattern + i);
+        std::uint32_t const flags = module_info.flags | p.flags;
+        if (IsBatchable(p) &&
+            !!(flags & PatternFlags::kScanData) == scan_data)
         {
-          address = ApplyManipulators(address, flags, base, p.manipulators);
+          matcher.Add(db.GetPatternData(p));
+          pattern_indexes.emplace_back(i);
         }
+      }
 
-        find_pattern_datas_[patterns_info_full_pair.first][p.pattern.name] =
-          Pattern{address, flags};
+      if (pattern_indexes.empty())
+      {
+        continue;
+      }
+
+      matcher.Compile();
+
+      auto const& mod_info = context.GetRegionInfo();
+      auto const& regions =
+        scan_data ? mod_info.data_regions : mod_info.code_regions;
+      auto const& buffers = context.GetSectionBuffers(
+        scan_data ? PatternFlags::kScanData : PatternFlags::kNone);
+      HADESMEM_DETAIL_ASSERT(regions.size() == buffers.size());
+
+      if (!!(module_info.flags & PatternFlags::kParallel))
+      {
+        std::vector<detail::SearchRange> ranges;
+        ranges.reserve(buffers.size());
+        for (auto const& buffer : buffers)
+        {
+          ranges.emplace_back(buffer.data(), buffer.data() + buffer.size());
+        }
+
+        detail::FindFirstParallel(
+          matcher,
+          ranges,
+          [&](std::size_t id, std::size_t i, std::uint8_t const* match)
+          {
+            results[pattern_indexes[id]] =
+              regions[i].first + (match - buffers[i].data());
+          });
+        continue;
+      }
+
+      std::vector<bool> matched(pattern_indexes.size());
+      for (std::size_t i = 0; i < regions.size(); ++i)
+      {
+        auto const h_beg = buffers[i].data();
+        auto const h_end = h_beg + buffers[i].size();
+        auto const on_match = [&](std::size_t id, std::uint8_t const* match)
+        {
+          results[pattern_indexes[id]] = regions[i].first + (match - h_beg);
+        };
+        if (!matcher.FindFirst(h_beg, h_end, matched, on_match))
+        {
+          break;
+        }
       }
     }
+
+    return results;
   }
 
   Process const* process_;
@@ -3,12 +3,20 @@
 
 #pragma once
 
+#include <cstddef>
+#include <exception>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <windows.h>
 
+#include <hadesmem/detail/assert.hpp>
 #include <hadesmem/detail/find_procedure.hpp>
+#include <hadesmem/error.hpp>
 #include <hadesmem/module.hpp>
+#include <hadesmem/pelib/export_index.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
 #include <hadesmem/process.hpp>
 
 namespace hadesmem
@@ -41,4 +49,113 @@ inline FARPROC
 
   return remote_func;
 }
+
+// An empty name means the procedure is looked up by ordinal.
+struct ResolveRequest
+{
+  std::string name;
+  WORD ordinal;
+  FARPROC address;
+  std::exception_ptr error;
+};
+
+// Resolves many procedures in the same module, parsing its export directory
+// at most once (and not at all if every request, or the module's export index,
+// is in the symbol cache).
+// Failures are reported per request rather than thrown, and the return value
+// is the number of requests which failed.
+inline std::size_t ResolveMany(Process const& process,
+                               Module const& module,
+                               ResolveRequest* requests,
+                               std::size_t count)
+{
+  HADESMEM_DETAIL_ASSERT(count ? requests != nullptr : true);
+
+  HMODULE const handle = module.GetHandle();
+  std::shared_ptr<ExportIndex const> exports;
+  bool exports_loaded = false;
+  // Reported for every request which needs the index.
+  std::exception_ptr exports_error;
+  auto const get_exports = [&]() -> ExportIndex const*
+  {
+    if (!exports_loaded)
+    {
+      exports_loaded = true;
+      try
+      {
+        exports = detail::GetExportIndex(process, handle);
+      }
+      catch (...)
+      {
+        exports_error = std::current_exception();
+      }
+    }
+
+    if (exports_error)
+    {
+      std::rethrow_exception(exports_error);
+    }
+
+    return exports.get();
+  };
+
+  std::size_t num_failed = 0;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    ResolveRequest& request = requests[i];
+    try
+    {
+      FARPROC proc = nullptr;
+      if (request.name.empty())
+      {
+        proc = detail::GetProcAddressCached(
+          process,
+          handle,
+          request.ordinal,
+          [&](ExportTarget& target)
+          {
+            ExportIndex const* const index = get_exports();
+            return index &&
+                   index->FindByProcedureNumber(request.ordinal, target);
+          });
+      }
+      else
+      {
+        proc = detail::GetProcAddressCached(
+          process,
+          handle,
+          request.name,
+          [&](ExportTarget& target)
+          {
+            ExportIndex const* const index = get_exports();
+            return index && index->FindByName(request.name, target);
+          });
+      }
+
+      if (!proc)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"GetProcAddressInternal failed."});
+      }
+
+      request.address = proc;
+      request.error = nullptr;
+    }
+    catch (...)
+    {
+      request.address = nullptr;
+      request.error = std::current_exception();
+      ++num_failed;
+    }
+  }
+
+  return num_failed;
+}
+
+inline std::size_t ResolveMany(Process const& process,
+                               Module const& module,
+                               std::vector<ResolveRequest>& requests)
+{
+  return ResolveMany(process, module, requests.data(), requests.size());
+}
 }
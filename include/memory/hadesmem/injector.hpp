@@ -178,6 +178,8 @@ inline HMODULE InjectDll(Process const& process,
          static_cast<LPCWSTR>(lib_file_remote.GetBase()),
          nullptr,
          add_path ? LOAD_WITH_ALTERED_SEARCH_PATH : 0UL);
+  // Even a failed load can leave dependencies loaded.
+  process.InvalidateSymbolCache();
   if (!load_library_ret.GetReturnValue())
   {
     HADESMEM_DETAIL_THROW_EXCEPTION(
@@ -198,6 +200,7 @@ inline void FreeDll(Process const& process, HMODULE module)
          reinterpret_cast<decltype(&FreeLibrary)>(free_library),
          CallConv::kStdCall,
          module);
+  process.InvalidateSymbolCache();
   if (!free_library_ret.GetReturnValue())
   {
     HADESMEM_DETAIL_THROW_EXCEPTION(
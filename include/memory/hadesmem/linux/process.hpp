@@ -0,0 +1,112 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <fstream>
+#include <locale>
+#include <ostream>
+#include <string>
+
+#include <elf.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/error.hpp>
+
+// Linux backend. Provides the subset of the API needed to read, write, scan
+// and snapshot a Linux process (e.g. a game running under Wine), with the same
+// names and semantics as the Windows API wherever possible. Memory is accessed
+// with process_vm_readv and process_vm_writev, and regions are enumerated from
+// /proc/<pid>/maps. Reading or writing another process requires ptrace access
+// to it (see ptrace(2) and the Yama ptrace_scope setting).
+// Snapshots (see linux/process_snapshot.hpp) of Linux processes can be opened
+// on Windows with OpenProcessSnapshot, to run the rest of the library (Find,
+// PeLib, etc.) against them.
+
+namespace hadesmem
+{
+class Process
+{
+public:
+  explicit Process(pid_t id) : id_{id}
+  {
+    if (id <= 0 || (::kill(id, 0) == -1 && errno == ESRCH))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Invalid process ID."}
+                                      << ErrorCodeErrno{ESRCH});
+    }
+
+    CheckArch();
+  }
+
+  pid_t GetId() const noexcept
+  {
+    return id_;
+  }
+
+  bool IsSelf() const noexcept
+  {
+    return id_ == ::getpid();
+  }
+
+  std::string GetProcPath(std::string const& name) const
+  {
+    return "/proc/" + std::to_string(id_) + "/" + name;
+  }
+
+private:
+  void CheckArch() const
+  {
+    // We may not have access to the executable (e.g. a process owned by
+    // another user), in which case reads will fail later on anyway.
+    std::ifstream exe{GetProcPath("exe"), std::ios::binary};
+    unsigned char ident[EI_NIDENT] = {};
+    if (!exe.read(reinterpret_cast<char*>(ident), sizeof(ident)))
+    {
+      return;
+    }
+
+    unsigned char const elf_class =
+      sizeof(void*) == 8 ? ELFCLASS64 : ELFCLASS32;
+    if (ident[EI_CLASS] != elf_class)
+    {
+      // TODO: Lift this restriction. Reads and writes would work as is, but
+      // the snapshot format and PeLib assume pointers are the size of our own.
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Cross-architecture process manipulation is "
+                               "currently unsupported."});
+    }
+  }
+
+  pid_t id_;
+};
+
+inline bool operator==(Process const& lhs, Process const& rhs) noexcept
+{
+  return lhs.GetId() == rhs.GetId();
+}
+
+inline bool operator!=(Process const& lhs, Process const& rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+
+inline bool operator<(Process const& lhs, Process const& rhs) noexcept
+{
+  return lhs.GetId() < rhs.GetId();
+}
+
+inline std::ostream& operator<<(std::ostream& lhs, Process const& rhs)
+{
+  std::locale const old = lhs.imbue(std::locale::classic());
+  lhs << rhs.GetId();
+  lhs.imbue(old);
+  return lhs;
+}
+}
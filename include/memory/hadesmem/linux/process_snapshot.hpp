@@ -0,0 +1,448 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/snapshot_format.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/linux/process.hpp>
+#include <hadesmem/linux/read.hpp>
+#include <hadesmem/linux/region_list.hpp>
+
+// Captures a Linux process to the snapshot format used by process_snapshot.hpp.
+// Snapshots are opened with OpenProcessSnapshot on Windows, where the rest of
+// the library (Find, FindInRegions, PeLib, etc.) runs against them unchanged.
+
+namespace hadesmem
+{
+struct ProcessSnapshotFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    // Stop the process (with SIGSTOP) while it is being captured, so that the
+    // snapshot is consistent.
+    kSuspend = 1 << 0,
+    kInvalidFlagMaxValue = 1 << 1
+  };
+};
+
+namespace detail
+{
+// Regions are read in batches of up to this many bytes (and IOV_MAX pieces),
+// so small regions share a system call and memory usage is bounded regardless
+// of the size of the largest region.
+enum : std::size_t
+{
+  kSnapshotChunkSize = 0x100000
+};
+
+class SnapshotFile
+{
+public:
+  explicit SnapshotFile(std::string const& path)
+    : fd_{::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)}
+  {
+    if (fd_ == -1)
+    {
+      int const last_error = errno;
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{} << ErrorString{"open failed."}
+                                              << ErrorCodeErrno{last_error});
+    }
+  }
+
+  SnapshotFile(SnapshotFile const&) = delete;
+
+  SnapshotFile& operator=(SnapshotFile const&) = delete;
+
+  ~SnapshotFile()
+  {
+    ::close(fd_);
+  }
+
+  void Write(std::uint64_t offset, void const* data, std::size_t len)
+  {
+    auto const bytes = static_cast<std::uint8_t const*>(data);
+    for (std::size_t done = 0; done < len;)
+    {
+      ssize_t const written = ::pwrite(
+        fd_, bytes + done, len - done, static_cast<off_t>(offset + done));
+      if (written == -1 && errno == EINTR)
+      {
+        continue;
+      }
+
+      if (written <= 0)
+      {
+        int const last_error = written ? errno : EIO;
+        HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                        << ErrorString{"pwrite failed."}
+                                        << ErrorCodeErrno{last_error});
+      }
+
+      done += static_cast<std::size_t>(written);
+    }
+  }
+
+  // Writes each run of pages which are not entirely zero. Zero pages are
+  // skipped and left as holes in the file.
+  void
+    WritePages(std::uint64_t offset, std::uint8_t const* data, std::size_t len)
+  {
+    HADESMEM_DETAIL_ASSERT(len % kSnapshotDataAlignment == 0);
+
+    std::size_t run_beg = 0;
+    for (std::size_t i = 0; i <= len; i += kSnapshotDataAlignment)
+    {
+      bool const is_zero =
+        i == len ||
+        std::find_if(data + i,
+                     data + i + kSnapshotDataAlignment,
+                     [](std::uint8_t b)
+                     {
+                       return b != 0;
+                     }) == data + i + kSnapshotDataAlignment;
+      if (is_zero)
+      {
+        if (run_beg != i)
+        {
+          Write(offset + run_beg, data + run_beg, i - run_beg);
+        }
+
+        run_beg = i + kSnapshotDataAlignment;
+      }
+    }
+  }
+
+  void Truncate(std::uint64_t len)
+  {
+    if (::ftruncate(fd_, static_cast<off_t>(len)) == -1)
+    {
+      int const last_error = errno;
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"ftruncate failed."}
+                                      << ErrorCodeErrno{last_error});
+    }
+  }
+
+private:
+  int fd_;
+};
+
+class StoppedProcess
+{
+public:
+  explicit StoppedProcess(Process const& process) : id_{process.GetId()}
+  {
+    if (process.IsSelf())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Can't stop the current process."});
+    }
+
+    if (::kill(id_, SIGSTOP) == -1)
+    {
+      int const last_error = errno;
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{} << ErrorString{"kill failed."}
+                                              << ErrorCodeErrno{last_error});
+    }
+
+    // The signal is delivered asynchronously, so wait (briefly) for every
+    // thread to actually stop.
+    for (int i = 0; i < 1000 && !IsStopped(process); ++i)
+    {
+      timespec const delay{0, 1000000};
+      ::nanosleep(&delay, nullptr);
+    }
+  }
+
+  StoppedProcess(StoppedProcess const&) = delete;
+
+  StoppedProcess& operator=(StoppedProcess const&) = delete;
+
+  ~StoppedProcess()
+  {
+    ::kill(id_, SIGCONT);
+  }
+
+private:
+  static bool IsStopped(Process const& process)
+  {
+    // The state follows the command name, which is in parentheses and may
+    // itself contain spaces or parentheses.
+    std::ifstream stat_file{process.GetProcPath("stat")};
+    std::string stat;
+    std::getline(stat_file, stat);
+    auto const name_end = stat.rfind(')');
+    return name_end != std::string::npos && name_end + 2 < stat.size() &&
+           stat[name_end + 2] == 'T';
+  }
+
+  pid_t id_;
+};
+
+// Paths are arbitrary bytes, but almost always UTF-8. Invalid sequences are
+// replaced with U+FFFD.
+template <std::size_t N>
+inline void CopySnapshotString(std::string const& src, std::uint16_t (&dst)[N])
+{
+  std::size_t len = 0;
+  for (std::size_t i = 0; i < src.size() && len < N - 1;)
+  {
+    auto const lead = static_cast<std::uint8_t>(src[i++]);
+    // Number of continuation bytes, or 4 for an invalid lead byte.
+    std::size_t trail = 4;
+    if (lead < 0x80)
+    {
+      trail = 0;
+    }
+    else if (lead >= 0xC2 && lead < 0xE0)
+    {
+      trail = 1;
+    }
+    else if (lead >= 0xE0 && lead < 0xF0)
+    {
+      trail = 2;
+    }
+    else if (lead >= 0xF0 && lead < 0xF5)
+    {
+      trail = 3;
+    }
+
+    std::uint32_t c = trail == 0 ? lead : lead & (0x3F >> trail);
+    std::size_t j = 0;
+    for (; trail < 4 && j < trail && i + j < src.size() &&
+           (static_cast<std::uint8_t>(src[i + j]) & 0xC0) == 0x80;
+         ++j)
+    {
+      c = (c << 6) | (static_cast<std::uint8_t>(src[i + j]) & 0x3F);
+    }
+
+    std::uint32_t const min[] = {0, 0x80, 0x800, 0x10000};
+    if (trail == 4 || j != trail || c < min[trail] || c > 0x10FFFF ||
+        (c >= 0xD800 && c <= 0xDFFF))
+    {
+      c = 0xFFFD;
+    }
+    i += j;
+
+    if (c < 0x10000)
+    {
+      dst[len++] = static_cast<std::uint16_t>(c);
+    }
+    else if (len + 2 <= N - 1)
+    {
+      c -= 0x10000;
+      dst[len++] = static_cast<std::uint16_t>(0xD800 + (c >> 10));
+      dst[len++] = static_cast<std::uint16_t>(0xDC00 + (c & 0x3FF));
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  dst[len] = 0;
+}
+}
+
+// Only the contents of readable regions are captured, but the metadata of
+// every region is recorded. Modules are the file mappings (both PE images and
+// ELF shared objects), with one module per group of adjacent mappings of the
+// same file. Thread state and file descriptors are not captured.
+inline void CreateProcessSnapshot(Process const& process,
+                                  std::string const& path,
+                                  std::uint32_t flags =
+                                    ProcessSnapshotFlags::kNone)
+{
+  HADESMEM_DETAIL_ASSERT(flags < ProcessSnapshotFlags::kInvalidFlagMaxValue);
+
+  std::unique_ptr<detail::StoppedProcess> stopped_process;
+  if (!!(flags & ProcessSnapshotFlags::kSuspend))
+  {
+    stopped_process.reset(new detail::StoppedProcess{process});
+  }
+
+  std::vector<detail::SnapshotRegion> regions;
+  std::vector<detail::SnapshotModule> modules;
+  std::uint64_t max_address = 0;
+  for (auto const& region : RegionList{process})
+  {
+    // The vsyscall page is above the user address space (and can't be read
+    // with process_vm_readv anyway).
+    if (region.GetPath() == "[vsyscall]")
+    {
+      continue;
+    }
+
+    auto const base = reinterpret_cast<std::uintptr_t>(region.GetBase());
+    auto const alloc_base =
+      reinterpret_cast<std::uintptr_t>(region.GetAllocBase());
+    regions.emplace_back(detail::SnapshotRegion{base,
+                                                alloc_base,
+                                                region.GetSize(),
+                                                0,
+                                                region.GetAllocProtect(),
+                                                region.GetState(),
+                                                region.GetProtect(),
+                                                region.GetType()});
+    max_address = base + region.GetSize() - 1;
+
+    if (!region.IsFile())
+    {
+      continue;
+    }
+
+    if (base == alloc_base)
+    {
+      detail::SnapshotModule module{};
+      module.base = base;
+      auto const name_beg = region.GetPath().rfind('/') + 1;
+      detail::CopySnapshotString(region.GetPath().substr(name_beg),
+                                 module.name);
+      detail::CopySnapshotString(region.GetPath(), module.path);
+      modules.emplace_back(module);
+    }
+
+    modules.back().size = static_cast<std::uint32_t>((std::min)(
+      std::uint64_t{base + region.GetSize() - modules.back().base},
+      std::uint64_t{(std::numeric_limits<std::uint32_t>::max)()}));
+  }
+
+  detail::SnapshotFile file{path};
+
+  std::uint64_t const tables_size =
+    sizeof(detail::SnapshotHeader) +
+    regions.size() * sizeof(detail::SnapshotRegion) +
+    modules.size() * sizeof(detail::SnapshotModule);
+  std::uint64_t offset = (tables_size + detail::kSnapshotDataAlignment - 1) &
+                         ~std::uint64_t{detail::kSnapshotDataAlignment - 1};
+
+  // Every readable region is given its space up front and read in pieces,
+  // batched across regions. The target may still be running, so regions can
+  // be unmapped or reprotected after they have been enumerated, which is not
+  // an error. Such regions are simply not captured, and their space is never
+  // referenced.
+  std::vector<std::uint8_t> buffer(detail::kSnapshotChunkSize);
+  std::vector<ReadRequest> requests;
+  std::vector<std::size_t> owners;
+  std::vector<bool> failed(regions.size());
+  std::size_t buffer_used = 0;
+  auto const flush = [&]()
+  {
+    ReadBatch(process, requests);
+    for (std::size_t i = 0; i < requests.size(); ++i)
+    {
+      detail::SnapshotRegion const& region = regions[owners[i]];
+      if (requests[i].error)
+      {
+        failed[owners[i]] = true;
+      }
+      else if (!failed[owners[i]])
+      {
+        file.WritePages(region.data_offset +
+                          (reinterpret_cast<std::uintptr_t>(
+                             requests[i].address) -
+                           region.base),
+                        static_cast<std::uint8_t const*>(requests[i].data),
+                        requests[i].size);
+      }
+    }
+
+    requests.clear();
+    owners.clear();
+    buffer_used = 0;
+  };
+
+  for (std::size_t i = 0; i < regions.size(); ++i)
+  {
+    detail::SnapshotRegion& region = regions[i];
+    bool const readable =
+      region.state == detail::kSnapshotMemCommit &&
+      region.protect != detail::kSnapshotPageExecute;
+    if (!readable)
+    {
+      continue;
+    }
+
+    region.data_offset = offset;
+    offset += region.size;
+    for (std::uint64_t done = 0; done < region.size;)
+    {
+      if (buffer_used == buffer.size() ||
+          requests.size() == detail::kMaxIovecs)
+      {
+        flush();
+      }
+
+      std::size_t const len = static_cast<std::size_t>((std::min)(
+        region.size - done, std::uint64_t{buffer.size() - buffer_used}));
+      requests.emplace_back(
+        ReadRequest{reinterpret_cast<void*>(region.base + done),
+                    len,
+                    buffer.data() + buffer_used,
+                    nullptr});
+      owners.emplace_back(i);
+      buffer_used += len;
+      done += len;
+    }
+  }
+  flush();
+
+  for (std::size_t i = 0; i < regions.size(); ++i)
+  {
+    if (failed[i])
+    {
+      regions[i].data_offset = 0;
+    }
+  }
+
+  detail::SnapshotHeader const header{
+    detail::kSnapshotMagic,
+    detail::kSnapshotVersion,
+    static_cast<std::uint32_t>(sizeof(void*)),
+    static_cast<std::uint32_t>(process.GetId()),
+    static_cast<std::uint32_t>(regions.size()),
+    static_cast<std::uint32_t>(modules.size()),
+    max_address,
+    offset};
+  std::vector<std::uint8_t> tables(static_cast<std::size_t>(tables_size));
+  auto cur = tables.data();
+  std::memcpy(cur, &header, sizeof(header));
+  cur += sizeof(header);
+  if (!regions.empty())
+  {
+    std::memcpy(
+      cur, regions.data(), regions.size() * sizeof(detail::SnapshotRegion));
+    cur += regions.size() * sizeof(detail::SnapshotRegion);
+  }
+  if (!modules.empty())
+  {
+    std::memcpy(
+      cur, modules.data(), modules.size() * sizeof(detail::SnapshotModule));
+  }
+  file.Write(0, tables.data(), tables.size());
+
+  // Trailing zero pages were never written, so the file may be too short.
+  file.Truncate(offset);
+}
+}
@@ -0,0 +1,290 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/linux/process.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+// process_vm_readv and process_vm_writev accept at most IOV_MAX iovecs per
+// call.
+enum : std::size_t
+{
+  kMaxIovecs = IOV_MAX,
+  kPageSize = 0x1000
+};
+
+// Fails with EFAULT if only part of the range could be transferred (e.g. it
+// crosses into an unmapped or unreadable page).
+template <typename Fn>
+inline bool TryTransferUnchecked(Fn fn,
+                                 Process const& process,
+                                 void* address,
+                                 void* data,
+                                 std::size_t len) noexcept
+{
+  iovec const local{data, len};
+  iovec const remote{address, len};
+  ssize_t const transferred = fn(process.GetId(), &local, 1, &remote, 1, 0);
+  if (transferred < 0)
+  {
+    return false;
+  }
+
+  if (static_cast<std::size_t>(transferred) != len)
+  {
+    errno = EFAULT;
+    return false;
+  }
+
+  return true;
+}
+
+inline bool TryReadUnchecked(Process const& process,
+                             void* address,
+                             void* data,
+                             std::size_t len) noexcept
+{
+  return TryTransferUnchecked(&::process_vm_readv, process, address, data, len);
+}
+
+// Unlike ReadProcessMemory, process_vm_readv never needs to reprotect anything
+// (PROT_NONE pages are simply unreadable), so there is no region walk here.
+inline void ReadImpl(Process const& process,
+                     void* address,
+                     void* data,
+                     std::size_t len)
+{
+  HADESMEM_DETAIL_ASSERT(len ? address != nullptr : true);
+  HADESMEM_DETAIL_ASSERT(data != nullptr);
+
+  if (!len)
+  {
+    return;
+  }
+
+  if (!TryReadUnchecked(process, address, data, len))
+  {
+    int const last_error = errno;
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"process_vm_readv failed."}
+                                    << ErrorCodeErrno{last_error});
+  }
+}
+
+template <typename T> T ReadImpl(Process const& process, void* address)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_trivially_copyable<T>::value);
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_default_constructible<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  T data;
+  ReadImpl(process, address, std::addressof(data), sizeof(data));
+  return data;
+}
+}
+
+template <typename T> inline T Read(Process const& process, void* address)
+{
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  return detail::ReadImpl<T>(process, address);
+}
+
+template <typename T, std::size_t N>
+inline std::array<T, N> Read(Process const& process, void* address)
+{
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  return detail::ReadImpl<std::array<T, N>>(process, address);
+}
+
+template <typename T, typename Alloc = std::allocator<T>>
+inline std::vector<T, Alloc>
+  ReadVector(Process const& process, void* address, std::size_t count)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_trivially_copyable<T>::value);
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_default_constructible<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(count ? address != nullptr : true);
+
+  std::vector<T, Alloc> data(count);
+  detail::ReadImpl(process, address, data.data(), sizeof(T) * count);
+  return data;
+}
+
+// Reads up to the end of each page at a time, so a string which ends just
+// before an unreadable page can still be read.
+template <typename T,
+          typename Traits = std::char_traits<T>,
+          typename Alloc = std::allocator<T>>
+std::basic_string<T, Traits, Alloc> ReadString(Process const& process,
+                                               void* address)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_trivially_copyable<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  std::basic_string<T, Traits, Alloc> data;
+  std::vector<T> buffer(detail::kPageSize / sizeof(T));
+  auto cur = reinterpret_cast<std::uintptr_t>(address);
+  for (;;)
+  {
+    std::size_t const page_left = detail::kPageSize - cur % detail::kPageSize;
+    std::size_t const count = (std::max)(page_left / sizeof(T), std::size_t{1});
+    detail::ReadImpl(
+      process, reinterpret_cast<void*>(cur), buffer.data(), count * sizeof(T));
+
+    auto const term = std::find(buffer.data(), buffer.data() + count, T{});
+    data.append(buffer.data(), term);
+    if (term != buffer.data() + count)
+    {
+      return data;
+    }
+
+    cur += count * sizeof(T);
+  }
+}
+
+// Single read in a batch. 'error' is set by ReadBatch (null on success).
+struct ReadRequest
+{
+  void* address;
+  std::size_t size;
+  void* data;
+  std::exception_ptr error;
+};
+
+namespace detail
+{
+// Services up to IOV_MAX requests per system call. The kernel stops at the
+// first remote iovec which can't be fully transferred, so on a short transfer
+// the requests before it have succeeded, the one it stopped on is retried on
+// its own (to find out whether, and why, it failed) and the batch carries on
+// from the next one. Returns the number of requests which failed.
+template <typename Request, typename Transfer, typename Single>
+inline std::size_t TransferBatch(Transfer transfer,
+                                 Single single,
+                                 Process const& process,
+                                 Request* requests,
+                                 std::size_t count)
+{
+  HADESMEM_DETAIL_ASSERT(count ? requests != nullptr : true);
+
+  std::size_t failed = 0;
+  std::vector<iovec> local;
+  std::vector<iovec> remote;
+  std::vector<std::size_t> index;
+  local.reserve((std::min)(count, std::size_t{kMaxIovecs}));
+  remote.reserve(local.capacity());
+  index.reserve(local.capacity());
+  for (std::size_t beg = 0; beg < count;)
+  {
+    local.clear();
+    remote.clear();
+    index.clear();
+    std::size_t end = beg;
+    for (; end < count && local.size() < kMaxIovecs; ++end)
+    {
+      Request& request = requests[end];
+      HADESMEM_DETAIL_ASSERT(request.size ? request.data != nullptr : true);
+
+      request.error = nullptr;
+      if (request.size)
+      {
+        local.push_back(iovec{const_cast<void*>(static_cast<void const*>(
+                                request.data)),
+                              request.size});
+        remote.push_back(iovec{request.address, request.size});
+        index.push_back(end);
+      }
+    }
+
+    ssize_t const transferred =
+      local.empty() ? 0 : transfer(process.GetId(),
+                                   local.data(),
+                                   local.size(),
+                                   remote.data(),
+                                   remote.size(),
+                                   0);
+    std::size_t left =
+      transferred < 0 ? 0 : static_cast<std::size_t>(transferred);
+    std::size_t done = 0;
+    for (; done < local.size() && left >= local[done].iov_len; ++done)
+    {
+      left -= local[done].iov_len;
+    }
+
+    if (done == local.size())
+    {
+      beg = end;
+      continue;
+    }
+
+    Request& request = requests[index[done]];
+    try
+    {
+      single(process, request.address, request.data, request.size);
+    }
+    catch (...)
+    {
+      request.error = std::current_exception();
+      ++failed;
+    }
+
+    beg = index[done] + 1;
+  }
+
+  return failed;
+}
+}
+
+// Reads many (typically small and scattered) ranges with as few system calls
+// as possible. Unlike the Windows implementation no merging is necessary, as
+// process_vm_readv takes a list of remote ranges. Failures are reported per
+// request rather than thrown, and the return value is the number of requests
+// which failed.
+inline std::size_t
+  ReadBatch(Process const& process, ReadRequest* requests, std::size_t count)
+{
+  return detail::TransferBatch(
+    &::process_vm_readv,
+    [](Process const& p, void* address, void* data, std::size_t len)
+    {
+      detail::ReadImpl(p, address, data, len);
+    },
+    process,
+    requests,
+    count);
+}
+
+inline std::size_t ReadBatch(Process const& process,
+                             std::vector<ReadRequest>& requests)
+{
+  return ReadBatch(process, requests.data(), requests.size());
+}
+}
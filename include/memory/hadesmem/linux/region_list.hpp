@@ -0,0 +1,256 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <locale>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/detail/snapshot_format.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/linux/process.hpp>
+#include <hadesmem/linux/read.hpp>
+
+namespace hadesmem
+{
+// A single line of /proc/<pid>/maps. State, protection and type use the same
+// (Win32) values as on Windows, so that code which filters regions (and the
+// snapshot format) doesn't care which backend the region came from.
+class Region
+{
+public:
+  void* GetBase() const noexcept
+  {
+    return base_;
+  }
+
+  // Start of the first of the adjacent mappings of the same file, or the base
+  // for anonymous mappings.
+  void* GetAllocBase() const noexcept
+  {
+    return alloc_base_;
+  }
+
+  std::uint32_t GetAllocProtect() const noexcept
+  {
+    return alloc_protect_;
+  }
+
+  std::size_t GetSize() const noexcept
+  {
+    return size_;
+  }
+
+  std::uint32_t GetState() const noexcept
+  {
+    return state_;
+  }
+
+  std::uint32_t GetProtect() const noexcept
+  {
+    return protect_;
+  }
+
+  std::uint32_t GetType() const noexcept
+  {
+    return type_;
+  }
+
+  // Empty for anonymous mappings, or a pseudo path such as "[heap]".
+  std::string const& GetPath() const noexcept
+  {
+    return path_;
+  }
+
+  std::uint64_t GetOffset() const noexcept
+  {
+    return offset_;
+  }
+
+  bool IsFile() const noexcept
+  {
+    return !path_.empty() && path_[0] == '/';
+  }
+
+private:
+  friend class RegionList;
+
+  void* base_{};
+  void* alloc_base_{};
+  std::size_t size_{};
+  std::uint64_t offset_{};
+  std::uint32_t alloc_protect_{};
+  std::uint32_t state_{};
+  std::uint32_t protect_{};
+  std::uint32_t type_{};
+  std::string path_;
+};
+
+inline bool operator==(Region const& lhs, Region const& rhs) noexcept
+{
+  return lhs.GetBase() == rhs.GetBase();
+}
+
+inline bool operator!=(Region const& lhs, Region const& rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+
+inline bool operator<(Region const& lhs, Region const& rhs) noexcept
+{
+  return lhs.GetBase() < rhs.GetBase();
+}
+
+inline std::ostream& operator<<(std::ostream& lhs, Region const& rhs)
+{
+  std::locale const old = lhs.imbue(std::locale::classic());
+  lhs << rhs.GetBase();
+  lhs.imbue(old);
+  return lhs;
+}
+
+namespace detail
+{
+inline std::uint32_t ProtFromPerms(char const* perms) noexcept
+{
+  bool const read = perms[0] == 'r';
+  bool const write = perms[1] == 'w';
+  bool const exec = perms[2] == 'x';
+  if (exec)
+  {
+    return write ? kSnapshotPageExecuteReadWrite
+                 : read ? kSnapshotPageExecuteRead : kSnapshotPageExecute;
+  }
+
+  // There is no write-only protection on Windows either.
+  return write ? kSnapshotPageReadWrite
+               : read ? kSnapshotPageReadOnly : kSnapshotPageNoAccess;
+}
+}
+
+// Unlike the Windows RegionList, which queries one region at a time, the maps
+// file is parsed up front, as it can't be read incrementally in a consistent
+// way anyway. Regions are sorted by base address and free space is omitted.
+class RegionList
+{
+public:
+  using value_type = Region;
+  using iterator = std::vector<Region>::const_iterator;
+  using const_iterator = iterator;
+
+  explicit RegionList(Process const& process)
+  {
+    std::ifstream maps{process.GetProcPath("maps")};
+    if (!maps)
+    {
+      int const last_error = errno;
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Failed to open maps file."}
+                << ErrorCodeErrno{last_error});
+    }
+
+    for (std::string line; std::getline(maps, line);)
+    {
+      std::uintptr_t beg = 0;
+      std::uintptr_t end = 0;
+      char perms[5] = {};
+      std::uint64_t offset = 0;
+      int path_pos = 0;
+      if (std::sscanf(line.c_str(),
+                      "%" SCNxPTR "-%" SCNxPTR " %4s %" SCNx64 " %*s %*s %n",
+                      &beg,
+                      &end,
+                      perms,
+                      &offset,
+                      &path_pos) < 4 ||
+          end <= beg)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Invalid maps file entry."});
+      }
+
+      Region region;
+      region.base_ = reinterpret_cast<void*>(beg);
+      region.size_ = end - beg;
+      region.offset_ = offset;
+      region.path_ = path_pos ? line.substr(path_pos) : std::string{};
+      region.protect_ = detail::ProtFromPerms(perms);
+      // PROT_NONE mappings are how address space is reserved on Linux (e.g.
+      // thread stack guards, or the gaps between the segments of a library).
+      if (region.protect_ == detail::kSnapshotPageNoAccess)
+      {
+        region.state_ = detail::kSnapshotMemReserve;
+        region.protect_ = 0;
+      }
+      else
+      {
+        region.state_ = detail::kSnapshotMemCommit;
+      }
+
+      Region const* const prev = regions_.empty() ? nullptr : &regions_.back();
+      if (region.IsFile() && prev && prev->path_ == region.path_ &&
+          static_cast<std::uint8_t*>(prev->base_) + prev->size_ ==
+            region.base_)
+      {
+        region.alloc_base_ = prev->alloc_base_;
+        region.alloc_protect_ = prev->alloc_protect_;
+        region.type_ = prev->type_;
+      }
+      else
+      {
+        region.alloc_base_ = region.base_;
+        region.alloc_protect_ = region.protect_;
+        region.type_ = region.IsFile() ? GetFileType(process, region)
+                                       : detail::kSnapshotMemPrivate;
+      }
+
+      regions_.emplace_back(std::move(region));
+    }
+  }
+
+  iterator begin() const noexcept
+  {
+    return regions_.begin();
+  }
+
+  iterator end() const noexcept
+  {
+    return regions_.end();
+  }
+
+  std::size_t size() const noexcept
+  {
+    return regions_.size();
+  }
+
+private:
+  // PE images (e.g. the executable and DLLs of a program running under Wine)
+  // are reported as MEM_IMAGE, and everything else as MEM_MAPPED.
+  static std::uint32_t GetFileType(Process const& process,
+                                   Region const& region) noexcept
+  {
+    char magic[2] = {};
+    if (region.offset_ == 0 &&
+        region.state_ == detail::kSnapshotMemCommit &&
+        detail::TryReadUnchecked(process, region.base_, magic, sizeof(magic)) &&
+        magic[0] == 'M' && magic[1] == 'Z')
+    {
+      return detail::kSnapshotMemImage;
+    }
+
+    return detail::kSnapshotMemMapped;
+  }
+
+  std::vector<Region> regions_;
+};
+}
@@ -0,0 +1,189 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/linux/process.hpp>
+#include <hadesmem/linux/read.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+inline bool TryWriteUnchecked(Process const& process,
+                              void* address,
+                              void const* data,
+                              std::size_t len) noexcept
+{
+  return TryTransferUnchecked(&::process_vm_writev,
+                              process,
+                              address,
+                              const_cast<void*>(data),
+                              len);
+}
+
+// Writes through /proc/<pid>/mem ignore page protections (in the same way as
+// WriteProcessMemory under a ProtectGuard), so code and other read-only memory
+// can still be patched.
+inline bool TryWriteProcMem(Process const& process,
+                            void* address,
+                            void const* data,
+                            std::size_t len) noexcept
+{
+  int const fd =
+    ::open(process.GetProcPath("mem").c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd == -1)
+  {
+    return false;
+  }
+
+  auto const bytes = static_cast<std::uint8_t const*>(data);
+  auto const offset = reinterpret_cast<std::uintptr_t>(address);
+  std::size_t done = 0;
+  while (done < len)
+  {
+    ssize_t const written = ::pwrite(
+      fd, bytes + done, len - done, static_cast<off_t>(offset + done));
+    if (written <= 0)
+    {
+      if (written == -1 && errno == EINTR)
+      {
+        continue;
+      }
+
+      if (!written)
+      {
+        errno = EFAULT;
+      }
+
+      break;
+    }
+
+    done += static_cast<std::size_t>(written);
+  }
+
+  int const last_error = errno;
+  ::close(fd);
+  errno = last_error;
+  return done == len;
+}
+
+inline void WriteImpl(Process const& process,
+                      void* address,
+                      void const* data,
+                      std::size_t len)
+{
+  HADESMEM_DETAIL_ASSERT(len ? address != nullptr : true);
+  HADESMEM_DETAIL_ASSERT(data != nullptr);
+
+  if (!len)
+  {
+    return;
+  }
+
+  // process_vm_writev honours page protections, so fall back to the (slower)
+  // proc file for read-only memory.
+  if (TryWriteUnchecked(process, address, data, len))
+  {
+    return;
+  }
+
+  if (errno != EFAULT || !TryWriteProcMem(process, address, data, len))
+  {
+    int const last_error = errno;
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"process_vm_writev failed."}
+                                    << ErrorCodeErrno{last_error});
+  }
+}
+}
+
+template <typename T>
+inline void Write(Process const& process, void* address, T const& data)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_trivially_copyable<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  detail::WriteImpl(process, address, std::addressof(data), sizeof(data));
+}
+
+template <typename T, typename Alloc>
+inline void WriteVector(Process const& process,
+                        void* address,
+                        std::vector<T, Alloc> const& data)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_trivially_copyable<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(data.empty() ? true : address != nullptr);
+
+  detail::WriteImpl(process, address, data.data(), sizeof(T) * data.size());
+}
+
+// Writes the terminator too.
+template <typename T, typename Traits, typename Alloc>
+inline void WriteString(Process const& process,
+                        void* address,
+                        std::basic_string<T, Traits, Alloc> const& data)
+{
+  HADESMEM_DETAIL_ASSERT(address != nullptr);
+
+  detail::WriteImpl(
+    process, address, data.c_str(), sizeof(T) * (data.size() + 1));
+}
+
+template <typename T>
+inline void WriteString(Process const& process, void* address, T const* data)
+{
+  WriteString(process, address, std::basic_string<T>(data));
+}
+
+// Single write in a batch. 'error' is set by WriteBatch (null on success).
+struct WriteRequest
+{
+  void* address;
+  std::size_t size;
+  void const* data;
+  std::exception_ptr error;
+};
+
+// Batched counterpart to ReadBatch. Requests are written in order with as few
+// system calls as possible, and only the requests which hit read-only memory
+// fall back to individual writes.
+inline std::size_t
+  WriteBatch(Process const& process, WriteRequest* requests, std::size_t count)
+{
+  return detail::TransferBatch(
+    &::process_vm_writev,
+    [](Process const& p, void* address, void const* data, std::size_t len)
+    {
+      detail::WriteImpl(p, address, data, len);
+    },
+    process,
+    requests,
+    count);
+}
+
+inline std::size_t WriteBatch(Process const& process,
+                              std::vector<WriteRequest>& requests)
+{
+  return WriteBatch(process, requests.data(), requests.size());
+}
+}
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <climits>
 #include <cstdint>
@@ -221,8 +222,8 @@ public:
         trampoline_->GetBase());
     }
 
-    auto const buffer =
-      ReadVector<std::uint8_t>(*process_, target_, kTrampSize);
+    std::array<std::uint8_t, kTrampSize> buffer;
+    ReadSpan(*process_, target_, buffer.data(), buffer.size());
 
     // TODO: Port to use Capstone instead.
     // TODO: Add a disassembler module to abstract away the actual disassembly
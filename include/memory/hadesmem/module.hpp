@@ -103,6 +103,21 @@ private:
 
   void InitializeIf(EntryCallback const& check_func)
   {
+    if (detail::SnapshotView const* const snapshot = process_->GetSnapshot())
+    {
+      for (auto const& entry : snapshot->GetModules())
+      {
+        if (check_func(entry))
+        {
+          Initialize(entry);
+          return;
+        }
+      }
+
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Could not find module."});
+    }
+
     detail::SmartSnapHandle const snap{
       detail::CreateToolhelp32Snapshot(TH32CS_SNAPMODULE, process_->GetId())};
 
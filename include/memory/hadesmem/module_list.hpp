@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <iterator>
 #include <memory>
 #include <utility>
@@ -45,6 +46,18 @@ public:
 
     impl_->process_ = &process;
 
+    if (detail::SnapshotView const* const snapshot = process.GetSnapshot())
+    {
+      if (snapshot->GetModules().empty())
+      {
+        impl_.reset();
+        return;
+      }
+
+      impl_->module_ = Module{process, snapshot->GetModules().front()};
+      return;
+    }
+
     // CreateToolhelp32Snapshot can fail with ERROR_PARTIAL_COPY for 'zombie'
     // processes.
     try
@@ -87,6 +100,21 @@ public:
   {
     HADESMEM_DETAIL_ASSERT(impl_.get());
 
+    if (detail::SnapshotView const* const snapshot =
+          impl_->process_->GetSnapshot())
+    {
+      auto const& modules = snapshot->GetModules();
+      if (++impl_->snapshot_index_ >= modules.size())
+      {
+        impl_.reset();
+        return *this;
+      }
+
+      impl_->module_ =
+        Module{*impl_->process_, modules[impl_->snapshot_index_]};
+      return *this;
+    }
+
     hadesmem::detail::Optional<MODULEENTRY32> const entry =
       detail::Module32Next(impl_->snap_.GetHandle());
     if (!entry)
@@ -122,6 +150,8 @@ private:
   {
     Process const* process_{nullptr};
     detail::SmartSnapHandle snap_{};
+    // Index of the current module when enumerating a process snapshot.
+    std::size_t snapshot_index_{};
     hadesmem::detail::Optional<Module> module_{};
   };
 
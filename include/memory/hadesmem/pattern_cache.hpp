@@ -0,0 +1,298 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <pugixml.hpp>
+#include <pugixml.cpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/pugixml_helpers.hpp>
+#include <hadesmem/detail/str_conv.hpp>
+#include <hadesmem/detail/trace.hpp>
+#include <hadesmem/error.hpp>
+
+namespace hadesmem
+{
+struct PatternCacheFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    // Include a SHA-1 of the module file on disk in the module identity, for
+    // when the PE header fields alone can't be trusted to change between
+    // builds. Requires reading (and hashing) the entire file on every load.
+    kHashModule = 1 << 0,
+    // Check that each cached match still matches its pattern before using it,
+    // and fall back to a full scan if any don't. Only requires reading the
+    // matched bytes, rather than the entire module.
+    kVerify = 1 << 1,
+    kInvalidFlagMaxValue = 1 << 2
+  };
+};
+
+// Identity of a module and the pattern definitions which were resolved against
+// it. A cache entry is only used if every field is identical.
+struct PatternCacheKey
+{
+  DWORD time_date_stamp;
+  DWORD size_of_image;
+  DWORD checksum;
+  // Empty unless PatternCacheFlags::kHashModule is set.
+  std::wstring module_sha1;
+  std::wstring patterns_sha1;
+};
+
+inline bool operator==(PatternCacheKey const& lhs,
+                       PatternCacheKey const& rhs) noexcept
+{
+  return lhs.time_date_stamp == rhs.time_date_stamp &&
+         lhs.size_of_image == rhs.size_of_image &&
+         lhs.checksum == rhs.checksum && lhs.module_sha1 == rhs.module_sha1 &&
+         lhs.patterns_sha1 == rhs.patterns_sha1;
+}
+
+inline bool operator!=(PatternCacheKey const& lhs,
+                       PatternCacheKey const& rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+
+// Raw match for a single pattern, before any manipulators are applied (so the
+// cache is unaffected by ASLR, and manipulators which read memory at runtime
+// are still evaluated every time).
+struct PatternCacheEntry
+{
+  std::wstring name;
+  bool matched;
+  std::uintptr_t rva;
+};
+
+// On-disk cache of FindPattern results, keyed by module identity. A missing,
+// corrupt or out of date cache file is not an error, it just results in a
+// cache miss (and the file being rewritten once the patterns are resolved).
+class PatternCache
+{
+public:
+  explicit PatternCache(std::wstring const& path,
+                        std::uint32_t flags = PatternCacheFlags::kNone)
+    : path_{path}, flags_{flags}
+  {
+    HADESMEM_DETAIL_ASSERT(
+      !(flags & ~(PatternCacheFlags::kInvalidFlagMaxValue - 1UL)));
+
+    Load();
+  }
+
+  std::wstring const& GetPath() const noexcept
+  {
+    return path_;
+  }
+
+  std::uint32_t GetFlags() const noexcept
+  {
+    return flags_;
+  }
+
+  // Returns nullptr if there is no entry for the module, or if it was created
+  // for a different module identity or set of patterns.
+  std::vector<PatternCacheEntry> const*
+    Lookup(std::wstring const& module, PatternCacheKey const& key)
+  {
+    auto const iter = modules_.find(module);
+    if (iter == std::end(modules_) || iter->second.key != key)
+    {
+      ++num_misses_;
+      return nullptr;
+    }
+
+    ++num_hits_;
+    return &iter->second.entries;
+  }
+
+  // Lookup statistics since the cache was constructed.
+  std::size_t GetNumHits() const noexcept
+  {
+    return num_hits_;
+  }
+
+  std::size_t GetNumMisses() const noexcept
+  {
+    return num_misses_;
+  }
+
+  void Update(std::wstring const& module,
+              PatternCacheKey const& key,
+              std::vector<PatternCacheEntry> entries)
+  {
+    modules_[module] = ModuleEntry{key, std::move(entries)};
+    dirty_ = true;
+  }
+
+  void Remove(std::wstring const& module)
+  {
+    if (modules_.erase(module))
+    {
+      dirty_ = true;
+    }
+  }
+
+  void Clear()
+  {
+    if (!modules_.empty())
+    {
+      modules_.clear();
+      dirty_ = true;
+    }
+  }
+
+  // Whether there are changes which have not been saved yet.
+  bool IsDirty() const noexcept
+  {
+    return dirty_;
+  }
+
+  void Save()
+  {
+    auto const set_attribute = [](pugi::xml_node& node,
+                                  wchar_t const* name,
+                                  std::wstring const& value)
+    {
+      node.append_attribute(name).set_value(value.c_str());
+    };
+
+    pugi::xml_document doc;
+    auto cache_node =
+      doc.append_child(L"HadesMem").append_child(L"PatternCache");
+    for (auto const& module : modules_)
+    {
+      auto const& key = module.second.key;
+      auto module_node = cache_node.append_child(L"Module");
+      set_attribute(module_node, L"Name", module.first);
+      set_attribute(module_node,
+                    L"TimeDateStamp",
+                    detail::NumToStr<wchar_t>(key.time_date_stamp, true));
+      set_attribute(module_node,
+                    L"SizeOfImage",
+                    detail::NumToStr<wchar_t>(key.size_of_image, true));
+      set_attribute(module_node,
+                    L"CheckSum",
+                    detail::NumToStr<wchar_t>(key.checksum, true));
+      if (!key.module_sha1.empty())
+      {
+        set_attribute(module_node, L"Sha1", key.module_sha1);
+      }
+      set_attribute(module_node, L"PatternsSha1", key.patterns_sha1);
+
+      for (auto const& entry : module.second.entries)
+      {
+        auto pattern_node = module_node.append_child(L"Pattern");
+        set_attribute(pattern_node, L"Name", entry.name);
+        if (entry.matched)
+        {
+          set_attribute(
+            pattern_node, L"Rva", detail::NumToStr<wchar_t>(entry.rva, true));
+        }
+      }
+    }
+
+    if (!doc.save_file(path_.c_str()))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Saving XML file failed."});
+    }
+
+    dirty_ = false;
+  }
+
+private:
+  struct ModuleEntry
+  {
+    PatternCacheKey key;
+    std::vector<PatternCacheEntry> entries;
+  };
+
+  void Load()
+  {
+    if (!detail::DoesFileExist(path_))
+    {
+      return;
+    }
+
+    try
+    {
+      pugi::xml_document doc;
+      auto const load_result = doc.load_file(path_.c_str());
+      if (!load_result)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Loading XML file failed."}
+                  << ErrorCodeOther{static_cast<DWORD_PTR>(load_result.status)}
+                  << ErrorStringOther{load_result.description()});
+      }
+
+      auto const cache_node = doc.child(L"HadesMem").child(L"PatternCache");
+      for (auto const& module_node : cache_node.children(L"Module"))
+      {
+        // Main module is stored with an empty name, so this can't use the
+        // usual helper (which treats empty values as an error).
+        std::wstring const name = module_node.attribute(L"Name").value();
+
+        ModuleEntry module;
+        module.key.time_date_stamp = detail::StrToNum<DWORD>(
+          detail::pugixml::GetAttributeValue(module_node, L"TimeDateStamp"),
+          true);
+        module.key.size_of_image = detail::StrToNum<DWORD>(
+          detail::pugixml::GetAttributeValue(module_node, L"SizeOfImage"),
+          true);
+        module.key.checksum = detail::StrToNum<DWORD>(
+          detail::pugixml::GetAttributeValue(module_node, L"CheckSum"), true);
+        module.key.module_sha1 =
+          detail::pugixml::GetOptionalAttributeValue(module_node, L"Sha1");
+        module.key.patterns_sha1 =
+          detail::pugixml::GetAttributeValue(module_node, L"PatternsSha1");
+
+        for (auto const& pattern_node : module_node.children(L"Pattern"))
+        {
+          auto const rva =
+            detail::pugixml::GetOptionalAttributeValue(pattern_node, L"Rva");
+          module.entries.emplace_back(PatternCacheEntry{
+            detail::pugixml::GetAttributeValue(pattern_node, L"Name"),
+            !rva.empty(),
+            rva.empty() ? 0U : detail::StrToNum<std::uintptr_t>(rva, true)});
+        }
+
+        modules_[name] = std::move(module);
+      }
+    }
+    catch (std::exception const& /*e*/)
+    {
+      // Treat anything we can't parse as an empty cache. It will be
+      // overwritten the next time it's saved.
+      HADESMEM_DETAIL_TRACE_A(
+        boost::current_exception_diagnostic_information().c_str());
+      modules_.clear();
+    }
+  }
+
+  std::wstring path_;
+  std::uint32_t flags_;
+  std::map<std::wstring, ModuleEntry> modules_;
+  std::size_t num_hits_{};
+  std::size_t num_misses_{};
+  bool dirty_{};
+};
+}
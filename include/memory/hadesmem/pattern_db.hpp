@@ -0,0 +1,546 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/compiled_pattern.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/smart_handle.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/error.hpp>
+
+// Precompiled pattern database. Holds the same information as a FindPattern
+// XML file, but with the patterns already converted to value/mask bytes, the
+// manipulators encoded as fixed size instructions, and all numbers stored in
+// binary. A database can be used directly from a mapped file without any text
+// parsing. Use CompilePatternDb (in find_pattern.hpp) to convert an existing
+// pattern file.
+//
+// Layout (all offsets are implied by the counts in the header):
+//   PatternDbHeader
+//   PatternDbModule[num_modules]
+//   PatternDbPattern[num_patterns]
+//   PatternDbManipulator[num_manipulators]
+//   wchar_t[strings_size] (string pool, not null terminated)
+//   std::uint8_t[bytes_size] (pattern values followed by masks)
+
+namespace hadesmem
+{
+namespace detail
+{
+enum : std::uint32_t
+{
+  // 'HMPD'
+  kPatternDbMagic = 0x44504D48,
+  kPatternDbVersion = 1,
+  // Every valid PatternFlags bit, and the last valid manipulator type. These
+  // are checked against FindPattern's definitions in find_pattern.hpp.
+  kPatternDbFlagsMask = 0xF,
+  kPatternDbMaxManipulatorType = 4
+};
+
+struct PatternDbString
+{
+  // In characters, relative to the start of the string pool.
+  std::uint32_t offset;
+  std::uint32_t length;
+};
+
+struct PatternDbHeader
+{
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t size;
+  std::uint32_t num_modules;
+  std::uint32_t num_patterns;
+  std::uint32_t num_manipulators;
+  std::uint32_t strings_size;
+  std::uint32_t bytes_size;
+};
+
+// Patterns for each module are stored contiguously, in file order.
+struct PatternDbModule
+{
+  PatternDbString name;
+  std::uint32_t flags;
+  std::uint32_t first_pattern;
+  std::uint32_t num_patterns;
+  std::uint32_t reserved;
+};
+
+struct PatternDbPattern
+{
+  std::uint64_t start_rva;
+  PatternDbString name;
+  PatternDbString start;
+  PatternDbString start_export;
+  std::uint32_t flags;
+  std::uint32_t has_start_rva;
+  // Relative to the start of the byte pool. The data_size pattern values are
+  // immediately followed by data_size masks.
+  std::uint32_t data_offset;
+  std::uint32_t data_size;
+  std::uint32_t first_manipulator;
+  std::uint32_t num_manipulators;
+};
+
+struct PatternDbManipulator
+{
+  enum : std::uint32_t
+  {
+    kHasOperand1 = 1 << 0,
+    kHasOperand2 = 1 << 1
+  };
+
+  std::uint64_t operand1;
+  std::uint64_t operand2;
+  std::uint32_t type;
+  std::uint32_t operands;
+};
+
+// Every structure is a multiple of 8 bytes, so the 64-bit fields are always
+// naturally aligned, and the layout is identical for x86 and x64.
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PatternDbHeader) == 32);
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PatternDbModule) == 24);
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PatternDbPattern) == 56);
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PatternDbManipulator) == 24);
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(wchar_t) == 2);
+
+inline std::uint64_t GetPatternDbSize(PatternDbHeader const& header) noexcept
+{
+  return sizeof(PatternDbHeader) +
+         std::uint64_t{header.num_modules} * sizeof(PatternDbModule) +
+         std::uint64_t{header.num_patterns} * sizeof(PatternDbPattern) +
+         std::uint64_t{header.num_manipulators} *
+           sizeof(PatternDbManipulator) +
+         std::uint64_t{header.strings_size} * sizeof(wchar_t) +
+         header.bytes_size;
+}
+
+// Builds a database in memory. Modules, patterns and manipulators must be
+// added in order (i.e. each pattern belongs to the most recently added module,
+// and each manipulator to the most recently added pattern).
+class PatternDbWriter
+{
+public:
+  void AddModule(std::wstring const& name, std::uint32_t flags)
+  {
+    modules_.emplace_back(PatternDbModule{AddString(name),
+                                          flags,
+                                          static_cast<std::uint32_t>(
+                                            patterns_.size()),
+                                          0,
+                                          0});
+  }
+
+  void AddPattern(std::wstring const& name,
+                  std::uint8_t const* values,
+                  std::uint8_t const* masks,
+                  std::size_t size,
+                  std::wstring const& start,
+                  bool has_start_rva,
+                  std::uintptr_t start_rva,
+                  std::wstring const& start_export,
+                  std::uint32_t flags)
+  {
+    HADESMEM_DETAIL_ASSERT(!modules_.empty());
+
+    PatternDbPattern pattern{};
+    pattern.start_rva = start_rva;
+    pattern.name = AddString(name);
+    pattern.start = AddString(start);
+    pattern.start_export = AddString(start_export);
+    pattern.flags = flags;
+    pattern.has_start_rva = has_start_rva;
+    pattern.data_offset = static_cast<std::uint32_t>(bytes_.size());
+    pattern.data_size = static_cast<std::uint32_t>(size);
+    pattern.first_manipulator =
+      static_cast<std::uint32_t>(manipulators_.size());
+    bytes_.insert(std::end(bytes_), values, values + size);
+    bytes_.insert(std::end(bytes_), masks, masks + size);
+    patterns_.emplace_back(pattern);
+    ++modules_.back().num_patterns;
+  }
+
+  void AddManipulator(std::uint32_t type,
+                      bool has_operand1,
+                      std::uintptr_t operand1,
+                      bool has_operand2,
+                      std::uintptr_t operand2)
+  {
+    HADESMEM_DETAIL_ASSERT(!patterns_.empty());
+
+    std::uint32_t const operands =
+      (has_operand1 ? PatternDbManipulator::kHasOperand1 : 0U) |
+      (has_operand2 ? PatternDbManipulator::kHasOperand2 : 0U);
+    manipulators_.emplace_back(
+      PatternDbManipulator{operand1, operand2, type, operands});
+    ++patterns_.back().num_manipulators;
+  }
+
+  std::vector<std::uint8_t> Finish() const
+  {
+    PatternDbHeader header{};
+    header.magic = kPatternDbMagic;
+    header.version = kPatternDbVersion;
+    header.num_modules = static_cast<std::uint32_t>(modules_.size());
+    header.num_patterns = static_cast<std::uint32_t>(patterns_.size());
+    header.num_manipulators = static_cast<std::uint32_t>(manipulators_.size());
+    header.strings_size = static_cast<std::uint32_t>(strings_.size());
+    header.bytes_size = static_cast<std::uint32_t>(bytes_.size());
+    std::uint64_t const size = GetPatternDbSize(header);
+    if (size > (std::numeric_limits<std::uint32_t>::max)())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Pattern database too large."});
+    }
+    header.size = static_cast<std::uint32_t>(size);
+
+    std::vector<std::uint8_t> buffer;
+    buffer.reserve(static_cast<std::size_t>(size));
+    Append(buffer, &header, sizeof(header));
+    Append(buffer, modules_.data(), modules_.size() * sizeof(modules_[0]));
+    Append(buffer, patterns_.data(), patterns_.size() * sizeof(patterns_[0]));
+    Append(buffer,
+           manipulators_.data(),
+           manipulators_.size() * sizeof(manipulators_[0]));
+    Append(buffer, strings_.data(), strings_.size() * sizeof(strings_[0]));
+    Append(buffer, bytes_.data(), bytes_.size());
+    HADESMEM_DETAIL_ASSERT(buffer.size() == size);
+
+    return buffer;
+  }
+
+private:
+  PatternDbString AddString(std::wstring const& str)
+  {
+    PatternDbString const result{static_cast<std::uint32_t>(strings_.size()),
+                                 static_cast<std::uint32_t>(str.size())};
+    strings_.insert(std::end(strings_), std::begin(str), std::end(str));
+    return result;
+  }
+
+  static void
+    Append(std::vector<std::uint8_t>& buffer, void const* data, std::size_t len)
+  {
+    auto const beg = static_cast<std::uint8_t const*>(data);
+    buffer.insert(std::end(buffer), beg, beg + len);
+  }
+
+  std::vector<PatternDbModule> modules_;
+  std::vector<PatternDbPattern> patterns_;
+  std::vector<PatternDbManipulator> manipulators_;
+  std::vector<wchar_t> strings_;
+  std::vector<std::uint8_t> bytes_;
+};
+}
+
+// Read-only view of a precompiled pattern database. The header and every
+// offset in the tables are bounds checked once on construction, after which
+// all accessors are simple pointer arithmetic into the original buffer.
+class PatternDb
+{
+public:
+  // Maps the file into memory. It is not read until it is used.
+  explicit PatternDb(std::wstring const& path)
+  {
+    file_ = detail::SmartFileHandle{::CreateFileW(path.c_str(),
+                                                  GENERIC_READ,
+                                                  FILE_SHARE_READ,
+                                                  nullptr,
+                                                  OPEN_EXISTING,
+                                                  0,
+                                                  nullptr)};
+    if (!file_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"CreateFileW failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    LARGE_INTEGER file_size{};
+    if (!::GetFileSizeEx(file_.GetHandle(), &file_size))
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"GetFileSizeEx failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    if (file_size.QuadPart < static_cast<LONGLONG>(
+                               sizeof(detail::PatternDbHeader)) ||
+        file_size.QuadPart > (std::numeric_limits<std::uint32_t>::max)())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid pattern database size."});
+    }
+
+    mapping_ = detail::SmartHandle{::CreateFileMappingW(
+      file_.GetHandle(), nullptr, PAGE_READONLY, 0, 0, nullptr)};
+    if (!mapping_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"CreateFileMappingW failed."}
+                << ErrorCodeWinLast{last_error});
+    }
+
+    view_ = detail::SmartMappedFileHandle{
+      ::MapViewOfFile(mapping_.GetHandle(), FILE_MAP_READ, 0, 0, 0)};
+    if (!view_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"MapViewOfFile failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    Initialize(view_.GetHandle(), static_cast<std::size_t>(file_size.QuadPart));
+  }
+
+  // Uses a database which is already in memory (e.g. embedded as a resource).
+  // The data is not copied, so it must outlive this object.
+  explicit PatternDb(void const* data, std::size_t size)
+  {
+    Initialize(data, size);
+  }
+
+  std::uint32_t GetNumModules() const noexcept
+  {
+    return header_->num_modules;
+  }
+
+  detail::PatternDbModule const& GetModule(std::uint32_t index) const noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(index < header_->num_modules);
+    return modules_[index];
+  }
+
+  detail::PatternDbPattern const& GetPattern(std::uint32_t index) const
+    noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(index < header_->num_patterns);
+    return patterns_[index];
+  }
+
+  detail::PatternDbManipulator const&
+    GetManipulator(std::uint32_t index) const noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(index < header_->num_manipulators);
+    return manipulators_[index];
+  }
+
+  std::wstring GetString(detail::PatternDbString const& str) const
+  {
+    return std::wstring(strings_ + str.offset, str.length);
+  }
+
+  // Not null terminated. See PatternDbString::length.
+  wchar_t const* GetStringData(detail::PatternDbString const& str) const
+    noexcept
+  {
+    return strings_ + str.offset;
+  }
+
+  bool StringEquals(detail::PatternDbString const& str,
+                    std::wstring const& other) const noexcept
+  {
+    return str.length == other.size() &&
+           std::equal(std::begin(other), std::end(other), GetStringData(str));
+  }
+
+  // Refers to the pattern bytes in place, so it must not outlive the database.
+  CompiledPattern GetPatternData(detail::PatternDbPattern const& pattern) const
+    noexcept
+  {
+    return CompiledPattern::View(
+      GetPatternValues(pattern), GetPatternMasks(pattern), pattern.data_size);
+  }
+
+  std::uint8_t const* GetPatternValues(
+    detail::PatternDbPattern const& pattern) const noexcept
+  {
+    return bytes_ + pattern.data_offset;
+  }
+
+  std::uint8_t const* GetPatternMasks(
+    detail::PatternDbPattern const& pattern) const noexcept
+  {
+    return bytes_ + pattern.data_offset + pattern.data_size;
+  }
+
+private:
+  void Initialize(void const* data, std::size_t size)
+  {
+    auto const beg = static_cast<std::uint8_t const*>(data);
+    if (size < sizeof(detail::PatternDbHeader))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid pattern database size."});
+    }
+
+    header_ = reinterpret_cast<detail::PatternDbHeader const*>(beg);
+    if (header_->magic != detail::kPatternDbMagic)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid pattern database signature."});
+    }
+
+    if (header_->version != detail::kPatternDbVersion)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Unsupported pattern database version."});
+    }
+
+    if (detail::GetPatternDbSize(*header_) != header_->size ||
+        header_->size > size)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid pattern database size."});
+    }
+
+    auto cur = beg + sizeof(detail::PatternDbHeader);
+    modules_ = reinterpret_cast<detail::PatternDbModule const*>(cur);
+    cur += header_->num_modules * sizeof(detail::PatternDbModule);
+    patterns_ = reinterpret_cast<detail::PatternDbPattern const*>(cur);
+    cur += header_->num_patterns * sizeof(detail::PatternDbPattern);
+    manipulators_ = reinterpret_cast<detail::PatternDbManipulator const*>(cur);
+    cur += header_->num_manipulators * sizeof(detail::PatternDbManipulator);
+    strings_ = reinterpret_cast<wchar_t const*>(cur);
+    cur += header_->strings_size * sizeof(wchar_t);
+    bytes_ = cur;
+
+    Validate();
+  }
+
+  bool IsValidRange(std::uint64_t offset,
+                    std::uint64_t len,
+                    std::uint64_t size) const noexcept
+  {
+    return offset <= size && len <= size - offset;
+  }
+
+  bool IsValidString(detail::PatternDbString const& str) const noexcept
+  {
+    return IsValidRange(str.offset, str.length, header_->strings_size);
+  }
+
+  bool IsDuplicateModule(std::uint32_t index) const noexcept
+  {
+    auto const& name = modules_[index].name;
+    for (std::uint32_t i = 0; i < index; ++i)
+    {
+      auto const& other = modules_[i].name;
+      if (other.length == name.length &&
+          std::equal(GetStringData(name),
+                     GetStringData(name) + name.length,
+                     GetStringData(other)))
+      {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  bool IsMasked(detail::PatternDbPattern const& pattern) const noexcept
+  {
+    auto const values = GetPatternValues(pattern);
+    auto const masks = GetPatternMasks(pattern);
+    for (std::uint32_t i = 0; i < pattern.data_size; ++i)
+    {
+      if (values[i] & ~masks[i])
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Everything FindPattern relies on is checked here, so the records can be
+  // used in place without any further validation.
+  void Validate() const
+  {
+    auto const fail = []()
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid pattern database."});
+    };
+
+    for (std::uint32_t i = 0; i < header_->num_modules; ++i)
+    {
+      auto const& module = modules_[i];
+      if (!IsValidString(module.name) ||
+          !IsValidRange(
+            module.first_pattern, module.num_patterns, header_->num_patterns) ||
+          (module.flags & ~std::uint32_t{detail::kPatternDbFlagsMask}))
+      {
+        fail();
+      }
+
+      if (IsDuplicateModule(i))
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Duplicate module in pattern database."});
+      }
+    }
+
+    for (std::uint32_t i = 0; i < header_->num_patterns; ++i)
+    {
+      auto const& pattern = patterns_[i];
+      if (!IsValidString(pattern.name) || !IsValidString(pattern.start) ||
+          !IsValidString(pattern.start_export) || !pattern.data_size ||
+          !IsValidRange(pattern.data_offset,
+                        std::uint64_t{pattern.data_size} * 2,
+                        header_->bytes_size) ||
+          !IsValidRange(pattern.first_manipulator,
+                        pattern.num_manipulators,
+                        header_->num_manipulators) ||
+          (pattern.flags & ~std::uint32_t{detail::kPatternDbFlagsMask}) ||
+          pattern.has_start_rva > 1 ||
+          pattern.start_rva > (std::numeric_limits<std::uintptr_t>::max)() ||
+          !IsMasked(pattern))
+      {
+        fail();
+      }
+    }
+
+    for (std::uint32_t i = 0; i < header_->num_manipulators; ++i)
+    {
+      auto const& manipulator = manipulators_[i];
+      std::uint32_t const operands_mask =
+        detail::PatternDbManipulator::kHasOperand1 |
+        detail::PatternDbManipulator::kHasOperand2;
+      if (manipulator.type > detail::kPatternDbMaxManipulatorType ||
+          (manipulator.operands & ~operands_mask) ||
+          manipulator.operand1 > (std::numeric_limits<std::uintptr_t>::max)() ||
+          manipulator.operand2 > (std::numeric_limits<std::uintptr_t>::max)())
+      {
+        fail();
+      }
+    }
+  }
+
+  detail::SmartFileHandle file_;
+  detail::SmartHandle mapping_;
+  detail::SmartMappedFileHandle view_;
+  detail::PatternDbHeader const* header_{};
+  detail::PatternDbModule const* modules_{};
+  detail::PatternDbPattern const* patterns_{};
+  detail::PatternDbManipulator const* manipulators_{};
+  wchar_t const* strings_{};
+  std::uint8_t const* bytes_{};
+};
+}
@@ -0,0 +1,560 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/compiled_pattern.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/guarded_copy.hpp>
+#include <hadesmem/detail/pattern_search.hpp>
+#include <hadesmem/detail/read_impl.hpp>
+#include <hadesmem/detail/smart_handle.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/process.hpp>
+
+// Streaming equivalent of Find, for when every match is wanted rather than
+// just the first one. Calling Find repeatedly with an updated start address
+// re-reads the remainder of the region every time, whereas FindAll reads each
+// byte of the target exactly once (in bounded chunks, and only as far as the
+// caller actually iterates).
+
+// Matches may overlap (i.e. the search for the next match starts one byte after
+// the previous match), to be consistent with passing the previous match as the
+// start address to Find.
+
+// Of the PatternFlags, only kScanData and kRelativeAddress have any effect.
+// Running out of matches is not an error, and the search is inherently
+// sequential.
+
+namespace hadesmem
+{
+namespace detail
+{
+// Remote regions are read in chunks of this size, so memory usage is bounded
+// regardless of the size of the region being scanned.
+enum : std::size_t
+{
+  kFindAllChunkSize = 1024 * 1024
+};
+
+struct PatternMatchRegion
+{
+  std::uint8_t* beg;
+  std::uint8_t* end;
+  // Non-null if the region data is already in our address space (e.g. a mapped
+  // file, or section data cached by a ModuleScanContext), in which case it is
+  // searched in place instead of being read.
+  std::uint8_t const* local;
+};
+
+// Everything needed to restart a search from the beginning. Shared by the list
+// and every iterator created from it, so a mapped file (or a scan context's
+// section data) stays alive for as long as anything could still refer to it.
+struct PatternMatchSource
+{
+  Process const* process{};
+  std::vector<PatternMatchRegion> regions;
+  CompiledPattern pattern;
+  std::uint8_t* base{};
+  std::uint32_t flags{};
+  SmartFileHandle file;
+  SmartHandle mapping;
+  SmartMappedFileHandle view;
+  std::shared_ptr<std::vector<std::vector<std::uint8_t>> const> buffers;
+};
+
+// Local region data may be a mapped file, which can fault with an in-page
+// error if the file is truncated or its volume goes away while we're searching
+// it. Returns false instead of crashing in that case. Must not contain any
+// objects with destructors, as it uses SEH.
+inline bool GuardedSearch(PatternSearcher const& searcher,
+                          std::uint8_t const* h_beg,
+                          std::uint8_t const* h_end,
+                          std::uint8_t const** match) noexcept
+{
+  __try
+  {
+    *match = searcher.Search(h_beg, h_end);
+  }
+  __except (GuardedCopyFilter(GetExceptionCode()))
+  {
+    return false;
+  }
+
+  return true;
+}
+
+class PatternMatchStream
+{
+public:
+  explicit PatternMatchStream(
+    std::shared_ptr<PatternMatchSource const> const& source)
+    : source_{source}, searcher_{source->pattern}
+  {
+    HADESMEM_DETAIL_ASSERT(!source->pattern.IsEmpty());
+
+    SetRegion(0);
+  }
+
+  // Returns the address of the next match in the target (ignoring
+  // PatternFlags::kRelativeAddress), or nullptr once every region has been
+  // searched.
+  std::uint8_t* Next()
+  {
+    auto const& regions = source_->regions;
+    while (region_ < regions.size())
+    {
+      auto const& region = regions[region_];
+
+      if (region.local)
+      {
+        auto const h_end = region.local + (region.end - region.beg);
+        std::uint8_t const* match = nullptr;
+        if (!GuardedSearch(searcher_, region.local + pos_, h_end, &match))
+        {
+          HADESMEM_DETAIL_THROW_EXCEPTION(
+            Error{} << ErrorString{"Reading region data failed."}
+                    << ErrorCodeWinLast{ERROR_NOACCESS});
+        }
+
+        if (match)
+        {
+          pos_ = static_cast<std::size_t>(match - region.local) + 1;
+          return region.beg + (match - region.local);
+        }
+
+        SetRegion(region_ + 1);
+        continue;
+      }
+
+      auto const h_beg = buffer_.data();
+      auto const h_end = h_beg + buffer_.size();
+      if (auto const match = searcher_.Search(h_beg + pos_, h_end))
+      {
+        pos_ = static_cast<std::size_t>(match - h_beg) + 1;
+        return buffer_addr_ + (match - h_beg);
+      }
+
+      if (read_ == region.end)
+      {
+        SetRegion(region_ + 1);
+        continue;
+      }
+
+      // Nothing matched starting before the last (size - 1) bytes of the
+      // buffer, so that's all that needs to be kept to find matches which
+      // cross into the next chunk.
+      std::size_t const overlap =
+        (std::min)(buffer_.size(), searcher_.GetSize() - 1);
+      std::size_t const keep_from = (std::max)(pos_, buffer_.size() - overlap);
+      buffer_.erase(std::begin(buffer_),
+                    std::begin(buffer_) +
+                      static_cast<std::ptrdiff_t>(keep_from));
+      buffer_addr_ += keep_from;
+      pos_ = 0;
+
+      std::size_t const len =
+        (std::min)(static_cast<std::size_t>(region.end - read_),
+                   static_cast<std::size_t>(kFindAllChunkSize));
+      std::size_t const old_size = buffer_.size();
+      buffer_.resize(old_size + len);
+      ReadImpl(*source_->process, read_, buffer_.data() + old_size, len);
+      read_ += len;
+    }
+
+    return nullptr;
+  }
+
+private:
+  void SetRegion(std::size_t region)
+  {
+    region_ = region;
+    pos_ = 0;
+    buffer_.clear();
+    if (region_ < source_->regions.size())
+    {
+      buffer_addr_ = read_ = source_->regions[region_].beg;
+    }
+  }
+
+  std::shared_ptr<PatternMatchSource const> source_;
+  PatternSearcher searcher_;
+  std::size_t region_{};
+  // Offset (into the local region data or the buffer) to resume searching at.
+  std::size_t pos_{};
+  std::vector<std::uint8_t> buffer_;
+  // Target address of the first byte in the buffer.
+  std::uint8_t* buffer_addr_{};
+  // Target address of the next byte to be read.
+  std::uint8_t* read_{};
+};
+
+inline void* GetPatternMatchResult(PatternMatchSource const& source,
+                                   std::uint8_t* match) noexcept
+{
+  HADESMEM_DETAIL_ASSERT(match);
+
+  return !!(source.flags & PatternFlags::kRelativeAddress)
+           ? reinterpret_cast<void*>(match - source.base)
+           : match;
+}
+}
+
+// PatternMatchIterator satisfies the requirements of an input iterator
+// (C++ Standard, 24.2.1, Input Iterators [input.iterators]).
+class PatternMatchIterator
+  : public std::iterator<std::input_iterator_tag, void*>
+{
+public:
+  using BaseIteratorT = std::iterator<std::input_iterator_tag, void*>;
+  using value_type = BaseIteratorT::value_type;
+  using difference_type = BaseIteratorT::difference_type;
+  using pointer = BaseIteratorT::pointer;
+  using reference = BaseIteratorT::reference;
+  using iterator_category = BaseIteratorT::iterator_category;
+
+  constexpr PatternMatchIterator() noexcept
+  {
+  }
+
+  explicit PatternMatchIterator(
+    std::shared_ptr<detail::PatternMatchSource const> const& source)
+    : impl_{std::make_shared<Impl>(source)}
+  {
+    Advance();
+  }
+
+  reference operator*() const noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(impl_.get());
+    return impl_->match_;
+  }
+
+  pointer operator->() const noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(impl_.get());
+    return &impl_->match_;
+  }
+
+  PatternMatchIterator& operator++()
+  {
+    HADESMEM_DETAIL_ASSERT(impl_.get());
+
+    Advance();
+
+    return *this;
+  }
+
+  PatternMatchIterator operator++(int)
+  {
+    PatternMatchIterator const iter{*this};
+    ++*this;
+    return iter;
+  }
+
+  bool operator==(PatternMatchIterator const& other) const noexcept
+  {
+    return impl_ == other.impl_;
+  }
+
+  bool operator!=(PatternMatchIterator const& other) const noexcept
+  {
+    return !(*this == other);
+  }
+
+private:
+  void Advance()
+  {
+    auto const match = impl_->stream_.Next();
+    if (!match)
+    {
+      impl_.reset();
+      return;
+    }
+
+    impl_->match_ = detail::GetPatternMatchResult(*impl_->source_, match);
+  }
+
+  struct Impl
+  {
+    explicit Impl(
+      std::shared_ptr<detail::PatternMatchSource const> const& source)
+      : source_{source}, stream_{source}
+    {
+    }
+
+    std::shared_ptr<detail::PatternMatchSource const> source_;
+    detail::PatternMatchStream stream_;
+    void* match_{};
+  };
+
+  // Shallow copy semantics, as required by InputIterator.
+  std::shared_ptr<Impl> impl_;
+};
+
+// Lazy range of every match of a pattern. Nothing is read until iteration
+// starts, and each call to begin restarts the search (and so reflects the
+// current contents of the target).
+class PatternMatchList
+{
+public:
+  using value_type = void*;
+  using iterator = PatternMatchIterator;
+  using const_iterator = PatternMatchIterator;
+
+  explicit PatternMatchList(
+    std::shared_ptr<detail::PatternMatchSource const> const& source)
+    : source_{source}
+  {
+  }
+
+  iterator begin() const
+  {
+    return iterator{source_};
+  }
+
+  const_iterator cbegin() const
+  {
+    return const_iterator{source_};
+  }
+
+  iterator end() const noexcept
+  {
+    return iterator{};
+  }
+
+  const_iterator cend() const noexcept
+  {
+    return const_iterator{};
+  }
+
+  // Counts matches without materializing iterators, stopping early once
+  // max_count is reached.
+  std::size_t
+    Count(std::size_t max_count = (std::numeric_limits<std::size_t>::max)())
+      const
+  {
+    detail::PatternMatchStream stream{source_};
+    std::size_t count = 0;
+    while (count < max_count && stream.Next())
+    {
+      ++count;
+    }
+
+    return count;
+  }
+
+private:
+  std::shared_ptr<detail::PatternMatchSource const> source_;
+};
+
+namespace detail
+{
+inline std::shared_ptr<PatternMatchSource>
+  MakePatternMatchSource(Process const* process,
+                         CompiledPattern const& data,
+                         std::uint32_t flags)
+{
+  HADESMEM_DETAIL_ASSERT(
+    !(flags & ~(PatternFlags::kInvalidFlagMaxValue - 1UL)));
+
+  if (data.IsEmpty())
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"Empty pattern."});
+  }
+
+  // The list can outlive the caller's pattern, so always take a copy of the
+  // data even if the pattern is a view.
+  auto source = std::make_shared<PatternMatchSource>();
+  source->process = process;
+  auto const values = data.GetValues();
+  auto const masks = data.GetMasks();
+  source->pattern = CompiledPattern{
+    std::vector<std::uint8_t>(values, values + data.GetSize()),
+    std::vector<std::uint8_t>(masks, masks + data.GetSize())};
+  source->flags = flags;
+  return source;
+}
+}
+
+inline PatternMatchList FindAll(Process const& process,
+                                std::wstring const& module,
+                                CompiledPattern const& data,
+                                std::uint32_t flags)
+{
+  auto const source = detail::MakePatternMatchSource(&process, data, flags);
+  auto const mod_info = detail::GetModuleInfo(process, module);
+  auto const& scan_regions = !!(flags & PatternFlags::kScanData)
+                               ? mod_info.data_regions
+                               : mod_info.code_regions;
+  for (auto const& region : scan_regions)
+  {
+    source->regions.emplace_back(
+      detail::PatternMatchRegion{region.first, region.second, nullptr});
+  }
+  source->base = static_cast<std::uint8_t*>(mod_info.module->GetHandle());
+  return PatternMatchList{source};
+}
+
+inline PatternMatchList FindAll(Process const& process,
+                                std::wstring const& module,
+                                std::wstring const& data,
+                                std::uint32_t flags)
+{
+  return FindAll(process, module, CompiledPattern{data}, flags);
+}
+
+// Searches the section data cached by the context, so the target is only read
+// if the context doesn't have the data yet. The list shares ownership of that
+// data, so it stays valid (but is no longer updated) if the context is
+// refreshed or invalidated while the list is in use.
+inline PatternMatchList FindAll(ModuleScanContext& context,
+                                CompiledPattern const& data,
+                                std::uint32_t flags)
+{
+  auto const source =
+    detail::MakePatternMatchSource(&context.GetProcess(), data, flags);
+  context.Refresh();
+  auto const& mod_info = context.GetRegionInfo();
+  auto const& scan_regions = !!(flags & PatternFlags::kScanData)
+                               ? mod_info.data_regions
+                               : mod_info.code_regions;
+  source->buffers = context.GetSharedSectionBuffers(flags);
+  auto const& buffers = *source->buffers;
+  HADESMEM_DETAIL_ASSERT(scan_regions.size() == buffers.size());
+  for (std::size_t i = 0; i < scan_regions.size(); ++i)
+  {
+    source->regions.emplace_back(detail::PatternMatchRegion{
+      scan_regions[i].first, scan_regions[i].second, buffers[i].data()});
+  }
+  source->base = static_cast<std::uint8_t*>(context.GetBase());
+  return PatternMatchList{source};
+}
+
+inline PatternMatchList FindAll(ModuleScanContext& context,
+                                std::wstring const& data,
+                                std::uint32_t flags)
+{
+  return FindAll(context, CompiledPattern{data}, flags);
+}
+
+inline PatternMatchList FindAll(Process const& process,
+                                void* base,
+                                std::size_t size,
+                                CompiledPattern const& data,
+                                std::uint32_t flags)
+{
+  auto const source = detail::MakePatternMatchSource(&process, data, flags);
+  auto const beg = static_cast<std::uint8_t*>(base);
+  source->regions.emplace_back(
+    detail::PatternMatchRegion{beg, beg + size, nullptr});
+  source->base = beg;
+  return PatternMatchList{source};
+}
+
+inline PatternMatchList FindAll(Process const& process,
+                                void* base,
+                                std::size_t size,
+                                std::wstring const& data,
+                                std::uint32_t flags)
+{
+  return FindAll(process, base, size, CompiledPattern{data}, flags);
+}
+
+// The file is mapped into our own process and searched in place. Matches are
+// addresses in the mapping (which stays valid for as long as the list or any
+// of its iterators exist), or file offsets if PatternFlags::kRelativeAddress
+// is specified.
+inline PatternMatchList FindAllInFile(std::wstring const& path,
+                                      CompiledPattern const& data,
+                                      std::uint32_t flags)
+{
+  auto const source = detail::MakePatternMatchSource(nullptr, data, flags);
+
+  source->file = detail::SmartFileHandle{::CreateFileW(path.c_str(),
+                                                       GENERIC_READ,
+                                                       FILE_SHARE_READ,
+                                                       nullptr,
+                                                       OPEN_EXISTING,
+                                                       0,
+                                                       nullptr)};
+  if (!source->file.IsValid())
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"CreateFileW failed."}
+                                    << ErrorCodeWinLast{last_error});
+  }
+
+  LARGE_INTEGER file_size{};
+  if (!::GetFileSizeEx(source->file.GetHandle(), &file_size))
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"GetFileSizeEx failed."}
+                                    << ErrorCodeWinLast{last_error});
+  }
+
+  // Empty files can't be mapped, but they can't contain any matches either.
+  if (!file_size.QuadPart)
+  {
+    return PatternMatchList{source};
+  }
+
+  if (static_cast<ULONGLONG>(file_size.QuadPart) >
+      (std::numeric_limits<std::size_t>::max)())
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"File is too large."});
+  }
+
+  source->mapping = detail::SmartHandle{::CreateFileMappingW(
+    source->file.GetHandle(), nullptr, PAGE_READONLY, 0, 0, nullptr)};
+  if (!source->mapping.IsValid())
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"CreateFileMappingW failed."}
+                                    << ErrorCodeWinLast{last_error});
+  }
+
+  source->view = detail::SmartMappedFileHandle{
+    ::MapViewOfFile(source->mapping.GetHandle(), FILE_MAP_READ, 0, 0, 0)};
+  if (!source->view.IsValid())
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"MapViewOfFile failed."}
+                                    << ErrorCodeWinLast{last_error});
+  }
+
+  auto const beg = static_cast<std::uint8_t*>(source->view.GetHandle());
+  auto const size = static_cast<std::size_t>(file_size.QuadPart);
+  source->regions.emplace_back(
+    detail::PatternMatchRegion{beg, beg + size, beg});
+  source->base = beg;
+  return PatternMatchList{source};
+}
+
+inline PatternMatchList FindAllInFile(std::wstring const& path,
+                                      std::wstring const& data,
+                                      std::uint32_t flags)
+{
+  return FindAllInFile(path, CompiledPattern{data}, flags);
+}
+}
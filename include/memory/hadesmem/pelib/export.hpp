@@ -27,8 +27,7 @@
 
 // TODO: Ensure we properly support data exports. http://bit.ly/1Lu548u
 
-// TODO: Add constructor to look up Export by name, optimized by using binary
-// search.
+// TODO: Add constructor to look up Export by name, using ExportIndex.
 
 // TODO: Is our naming of ordinal number vs procedure number correct/orthodox?
 // Look into what other people/tools/documents call things.
@@ -0,0 +1,449 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+#include <winnt.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/pelib/pe_view.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+
+// ExportIndex looks up exports by name or procedure number without walking
+// ExportList, which constructs an Export (and so does several reads) for
+// every entry. The export directory normally contains the function, name and
+// ordinal tables as well as the name and forwarder strings, so it is read in
+// one go where possible. Anything outside it is read from the process.
+
+// TODO: Share the lookup logic with PeView.
+
+namespace hadesmem
+{
+namespace detail
+{
+// Attached to errors due to a malformed export directory, which callers treat
+// as empty (as ExportList does), as opposed to e.g. a failed read.
+using ErrorInvalidExportDir =
+  boost::error_info<struct TagErrorInvalidExportDir, bool>;
+
+inline bool IsInvalidExportDirError(Error const& e)
+{
+  auto const invalid = boost::get_error_info<ErrorInvalidExportDir>(e);
+  return invalid && *invalid;
+}
+}
+
+struct ExportTarget
+{
+  WORD procedure_number;
+  // Only set if the export isn't forwarded.
+  DWORD rva;
+  PVOID va;
+  bool virtual_va;
+  bool forwarded;
+  std::string forwarder_module;
+  std::string forwarder_function;
+};
+
+// Everything is read up front, so lookups don't modify the index and may be
+// done from multiple threads at once.
+class ExportIndex
+{
+public:
+  explicit ExportIndex(Process const& process, PeFile const& pe_file)
+    : process_{&process}, pe_file_{pe_file}
+  {
+    pe_file.CheckHeaders();
+
+    detail::PeHeaders const& headers = pe_file.GetHeaders();
+    auto const export_dir_index = static_cast<DWORD>(PeDataDir::Export);
+    if (export_dir_index >= headers.num_data_dirs)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Export directory is invalid."}
+                << detail::ErrorInvalidExportDir{true});
+    }
+
+    // Windows will load images which don't specify a size for the export
+    // directory.
+    dir_rva_ = headers.data_dirs[export_dir_index].VirtualAddress;
+    dir_size_ = headers.data_dirs[export_dir_index].Size;
+    auto const dir_ptr =
+      static_cast<std::uint8_t*>(RvaToVa(process, pe_file, dir_rva_));
+    if (!dir_ptr)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Export directory is invalid."}
+                << detail::ErrorInvalidExportDir{true});
+    }
+
+    ReadDirectory(dir_ptr);
+
+    IMAGE_EXPORT_DIRECTORY export_dir;
+    ReadRva(dir_rva_, &export_dir, sizeof(export_dir));
+    ordinal_base_ = export_dir.Base;
+
+    functions_ = ReadTable<DWORD>(export_dir.AddressOfFunctions,
+                                  export_dir.NumberOfFunctions);
+
+    // A bad name table only affects lookup by name, so it isn't an error. The
+    // same goes for ExportList.
+    try
+    {
+      names_ =
+        ReadTable<DWORD>(export_dir.AddressOfNames, export_dir.NumberOfNames);
+      name_ordinals_ = ReadTable<WORD>(export_dir.AddressOfNameOrdinals,
+                                       export_dir.NumberOfNames);
+      IndexNames();
+    }
+    catch (Error const& e)
+    {
+      if (!detail::IsInvalidExportDirError(e))
+      {
+        throw;
+      }
+
+      names_.clear();
+      name_ordinals_.clear();
+      name_map_.clear();
+      names_hashed_ = false;
+    }
+  }
+
+  explicit ExportIndex(Process const&& process, PeFile const& pe_file) = delete;
+
+  DWORD GetOrdinalBase() const noexcept
+  {
+    return ordinal_base_;
+  }
+
+  DWORD GetNumberOfFunctions() const noexcept
+  {
+    return static_cast<DWORD>(functions_.size());
+  }
+
+  DWORD GetNumberOfNames() const noexcept
+  {
+    return static_cast<DWORD>(names_.size());
+  }
+
+  // Random access views of the tables read by the constructor, valid for the
+  // lifetime of the index.
+  PeExportFunctionTable GetFunctions() const noexcept
+  {
+    return PeExportFunctionTable{
+      detail::PeExportFunctionDecoder{
+        reinterpret_cast<std::uint8_t const*>(functions_.data()),
+        ordinal_base_},
+      functions_.size()};
+  }
+
+  PeExportNameTable GetNames() const noexcept
+  {
+    return PeExportNameTable{
+      detail::PeExportNameDecoder{
+        reinterpret_cast<std::uint8_t const*>(names_.data()),
+        reinterpret_cast<std::uint8_t const*>(name_ordinals_.data())},
+      names_.size()};
+  }
+
+  bool FindByName(std::string const& name, ExportTarget& target) const
+  {
+    std::size_t index = 0;
+    if (!FindName(name, index))
+    {
+      return false;
+    }
+
+    DWORD const procedure_number = ordinal_base_ + name_ordinals_[index];
+    if (procedure_number > (std::numeric_limits<WORD>::max)())
+    {
+      return false;
+    }
+
+    return FindByProcedureNumber(static_cast<WORD>(procedure_number), target);
+  }
+
+  // Unused entries (i.e. a zero RVA) are not found, as ExportList skips them.
+  bool FindByProcedureNumber(WORD procedure_number, ExportTarget& target) const
+  {
+    if (procedure_number < ordinal_base_ ||
+        procedure_number - ordinal_base_ >= functions_.size())
+    {
+      return false;
+    }
+
+    DWORD const func_rva = functions_[procedure_number - ordinal_base_];
+    if (!func_rva)
+    {
+      return false;
+    }
+
+    target = ExportTarget{};
+    target.procedure_number = procedure_number;
+
+    // Check function RVA. If it lies inside the export dir region then it's a
+    // forwarded export. Otherwise it's a regular RVA.
+    if (func_rva > dir_rva_ && func_rva < dir_rva_ + dir_size_)
+    {
+      target.forwarded = true;
+      std::string const forwarder = ReadStringRva(func_rva);
+      std::string::size_type const split_pos = forwarder.rfind('.');
+      if (split_pos == std::string::npos)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Invalid forwarder string format."});
+      }
+
+      target.forwarder_module = forwarder.substr(0, split_pos);
+      target.forwarder_function = forwarder.substr(split_pos + 1);
+    }
+    else
+    {
+      target.rva = func_rva;
+      target.va = RvaToVa(*process_, pe_file_, func_rva, &target.virtual_va);
+    }
+
+    return true;
+  }
+
+private:
+  using StringRef = std::pair<char const*, std::size_t>;
+
+  void ReadDirectory(std::uint8_t* dir_ptr)
+  {
+    std::size_t const size =
+      (std::max)(std::size_t{dir_size_}, sizeof(IMAGE_EXPORT_DIRECTORY));
+    if (std::uint64_t{dir_rva_} + size > pe_file_.GetSize())
+    {
+      return;
+    }
+
+    // In a data file the directory may be split across sections.
+    if (pe_file_.GetType() == PeFileType::Data &&
+        RvaToVa(*process_,
+                pe_file_,
+                static_cast<DWORD>(dir_rva_ + size - 1)) !=
+          dir_ptr + size - 1)
+    {
+      return;
+    }
+
+    try
+    {
+      dir_data_ = ReadVector<std::uint8_t>(*process_, dir_ptr, size);
+    }
+    catch (std::exception const& /*e*/)
+    {
+      dir_data_.clear();
+    }
+  }
+
+  bool InDirectory(DWORD rva, std::size_t len) const noexcept
+  {
+    return rva >= dir_rva_ &&
+           std::uint64_t{rva} - dir_rva_ + len <= dir_data_.size();
+  }
+
+  void ReadRva(DWORD rva, void* data, std::size_t len) const
+  {
+    if (InDirectory(rva, len))
+    {
+      std::memcpy(data, &dir_data_[rva - dir_rva_], len);
+      return;
+    }
+
+    void* const va = RvaToVa(*process_, pe_file_, rva);
+    if (!va)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Export directory is invalid."}
+                << detail::ErrorInvalidExportDir{true});
+    }
+
+    detail::ReadImpl(*process_, va, data, len);
+  }
+
+  template <typename T>
+  std::vector<T> ReadTable(DWORD rva, DWORD count) const
+  {
+    std::vector<T> table;
+    if (!rva || !count)
+    {
+      return table;
+    }
+
+    // Guard against allocating a huge table for a malformed count.
+    if (std::uint64_t{count} * sizeof(T) > pe_file_.GetSize())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Export directory is invalid."}
+                << detail::ErrorInvalidExportDir{true});
+    }
+
+    table.resize(count);
+    ReadRva(rva, table.data(), table.size() * sizeof(T));
+    return table;
+  }
+
+  // Returns the name without copying it if it is inside the directory.
+  StringRef GetStringRva(DWORD rva, std::string& buf) const
+  {
+    if (InDirectory(rva, 1))
+    {
+      auto const beg =
+        reinterpret_cast<char const*>(&dir_data_[rva - dir_rva_]);
+      auto const len = dir_data_.size() - (rva - dir_rva_);
+      if (auto const end = static_cast<char const*>(std::memchr(beg, 0, len)))
+      {
+        return {beg, static_cast<std::size_t>(end - beg)};
+      }
+    }
+
+    void* const va = RvaToVa(*process_, pe_file_, rva);
+    if (!va)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid export name."}
+                << detail::ErrorInvalidExportDir{true});
+    }
+
+    buf = detail::CheckedReadString<char>(*process_, pe_file_, va);
+    return {buf.data(), buf.size()};
+  }
+
+  std::string ReadStringRva(DWORD rva) const
+  {
+    std::string buf;
+    auto const str = GetStringRva(rva, buf);
+    return std::string(str.first, str.second);
+  }
+
+  // Same order as std::string::compare.
+  static int CompareStrings(StringRef lhs, StringRef rhs) noexcept
+  {
+    int const cmp = std::char_traits<char>::compare(
+      lhs.first, rhs.first, (std::min)(lhs.second, rhs.second));
+    if (cmp)
+    {
+      return cmp;
+    }
+
+    return lhs.second < rhs.second ? -1 : (lhs.second > rhs.second ? 1 : 0);
+  }
+
+  // AddressOfNames is sorted (the loader relies on it to binary search), but
+  // malformed files may not follow that, in which case every name is hashed
+  // instead.
+  void IndexNames()
+  {
+    if (names_.empty())
+    {
+      return;
+    }
+
+    std::string prev_buf;
+    std::string cur_buf;
+    StringRef prev = GetStringRva(names_[0], prev_buf);
+    for (std::size_t i = 1; i < names_.size(); ++i)
+    {
+      StringRef const cur = GetStringRva(names_[i], cur_buf);
+      if (CompareStrings(prev, cur) > 0)
+      {
+        HashNames();
+        return;
+      }
+
+      if (cur.first == cur_buf.data())
+      {
+        prev_buf = cur_buf;
+        prev = StringRef{prev_buf.data(), prev_buf.size()};
+      }
+      else
+      {
+        prev = cur;
+      }
+    }
+  }
+
+  void HashNames()
+  {
+    // Where a name appears more than once the first one wins.
+    name_map_.reserve(names_.size());
+    for (std::size_t i = 0; i < names_.size(); ++i)
+    {
+      name_map_.emplace(ReadStringRva(names_[i]), i);
+    }
+    names_hashed_ = true;
+  }
+
+  bool FindName(std::string const& name, std::size_t& index) const
+  {
+    if (names_hashed_)
+    {
+      auto const iter = name_map_.find(name);
+      if (iter == std::end(name_map_))
+      {
+        return false;
+      }
+
+      index = iter->second;
+      return true;
+    }
+
+    // Finds the first of any duplicates, as the hash map does.
+    StringRef const key{name.data(), name.size()};
+    std::string buf;
+    std::size_t lo = 0;
+    std::size_t hi = names_.size();
+    while (lo < hi)
+    {
+      std::size_t const mid = lo + (hi - lo) / 2;
+      if (CompareStrings(GetStringRva(names_[mid], buf), key) < 0)
+      {
+        lo = mid + 1;
+      }
+      else
+      {
+        hi = mid;
+      }
+    }
+
+    if (lo == names_.size() ||
+        CompareStrings(GetStringRva(names_[lo], buf), key))
+    {
+      return false;
+    }
+
+    index = lo;
+    return true;
+  }
+
+  Process const* process_;
+  PeFile pe_file_;
+  DWORD dir_rva_{};
+  DWORD dir_size_{};
+  DWORD ordinal_base_{};
+  std::vector<std::uint8_t> dir_data_;
+  std::vector<DWORD> functions_;
+  std::vector<DWORD> names_;
+  std::vector<WORD> name_ordinals_;
+  bool names_hashed_{};
+  std::unordered_map<std::string, std::size_t> name_map_;
+};
+}
@@ -19,7 +19,8 @@
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
 
-// TODO: Support using forward iterators via binary search.
+// ExportList constructs an Export (doing several reads) for every entry. For
+// random access to the raw tables see ExportIndex::GetFunctions and GetNames.
 
 namespace hadesmem
 {
@@ -3,9 +3,13 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iterator>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include <windows.h>
 
@@ -15,6 +19,7 @@
 #include <hadesmem/error.hpp>
 #include <hadesmem/pelib/import_thunk.hpp>
 #include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/pelib/pe_view.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
 
@@ -217,4 +222,156 @@ private:
   PeFile const* pe_file_;
   DWORD first_thunk_;
 };
+
+// Reads a whole thunk array up front (a page at a time), so that it can be
+// iterated with random access and without constructing an ImportThunk for
+// every entry. Thunks are read from the lookup table, or from the IAT if there
+// isn't one. Like ImportThunkList, the table ends at the first null thunk or
+// the first one which can't be read.
+class ImportThunkTable
+{
+public:
+  using value_type = PeImportThunkEntry;
+  using iterator = PeImportThunkTable::iterator;
+  using const_iterator = PeImportThunkTable::const_iterator;
+
+  explicit ImportThunkTable(Process const& process,
+                            PeFile const& pe_file,
+                            DWORD original_first_thunk,
+                            DWORD first_thunk)
+  {
+    std::size_t const thunk_size = pe_file.Is64()
+                                     ? sizeof(IMAGE_THUNK_DATA64)
+                                     : sizeof(IMAGE_THUNK_DATA32);
+    DWORD const lookup_rva =
+      original_first_thunk ? original_first_thunk : first_thunk;
+    auto cur =
+      static_cast<std::uint8_t*>(RvaToVa(process, pe_file, lookup_rva));
+
+    // A missing terminator can't make the table larger than the file.
+    std::size_t const max_thunks = pe_file.GetSize() / thunk_size;
+    std::size_t num_thunks = 0;
+    std::size_t scanned = 0;
+    bool terminated = false;
+    while (cur && !terminated)
+    {
+      std::size_t const page_size = 0x1000;
+      std::size_t const len =
+        page_size - reinterpret_cast<std::uintptr_t>(cur) % page_size;
+      std::size_t const offset = data_.size();
+      data_.resize(offset + len);
+      if (!ReadChunk(process, cur, &data_[offset], len))
+      {
+        break;
+      }
+      cur += len;
+
+      for (; scanned + thunk_size <= data_.size(); scanned += thunk_size)
+      {
+        std::uint64_t value = 0;
+        std::memcpy(&value, &data_[scanned], thunk_size);
+        if (!value || num_thunks == max_thunks)
+        {
+          terminated = true;
+          break;
+        }
+
+        ++num_thunks;
+      }
+    }
+
+    data_.resize(num_thunks * thunk_size);
+    table_ = PeImportThunkTable{
+      detail::PeImportThunkDecoder{data_.data(),
+                                   first_thunk,
+                                   static_cast<std::uint32_t>(thunk_size)},
+      num_thunks};
+  }
+
+  explicit ImportThunkTable(Process const&& process,
+                            PeFile const& pe_file,
+                            DWORD original_first_thunk,
+                            DWORD first_thunk) = delete;
+
+  explicit ImportThunkTable(Process const& process,
+                            PeFile&& pe_file,
+                            DWORD original_first_thunk,
+                            DWORD first_thunk) = delete;
+
+  explicit ImportThunkTable(Process const&& process,
+                            PeFile&& pe_file,
+                            DWORD original_first_thunk,
+                            DWORD first_thunk) = delete;
+
+  // The table refers to data_, so copying would leave it pointing at the
+  // original. Moving keeps the buffer.
+  ImportThunkTable(ImportThunkTable const& other) = delete;
+
+  ImportThunkTable& operator=(ImportThunkTable const& other) = delete;
+
+  ImportThunkTable(ImportThunkTable&& other) = default;
+
+  ImportThunkTable& operator=(ImportThunkTable&& other) = default;
+
+  const_iterator begin() const noexcept
+  {
+    return table_.begin();
+  }
+
+  const_iterator cbegin() const noexcept
+  {
+    return table_.cbegin();
+  }
+
+  const_iterator end() const noexcept
+  {
+    return table_.end();
+  }
+
+  const_iterator cend() const noexcept
+  {
+    return table_.cend();
+  }
+
+  std::size_t size() const noexcept
+  {
+    return table_.size();
+  }
+
+  bool empty() const noexcept
+  {
+    return table_.empty();
+  }
+
+  value_type operator[](std::size_t index) const noexcept
+  {
+    return table_[index];
+  }
+
+private:
+  static bool ReadChunk(Process const& process,
+                        void* address,
+                        void* data,
+                        std::size_t len)
+  {
+    if (detail::TryReadUnchecked(process, address, data, len))
+    {
+      return true;
+    }
+
+    // ReadImpl also handles guard pages etc.
+    try
+    {
+      detail::ReadImpl(process, address, data, len);
+      return true;
+    }
+    catch (std::exception const& /*e*/)
+    {
+      return false;
+    }
+  }
+
+  std::vector<std::uint8_t> data_;
+  PeImportThunkTable table_;
+};
 }
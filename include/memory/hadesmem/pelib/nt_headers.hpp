@@ -20,32 +20,13 @@
 #include <hadesmem/error.hpp>
 #include <hadesmem/pelib/dos_header.hpp>
 #include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/pelib/pe_view.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
 #include <hadesmem/write.hpp>
 
 namespace hadesmem
 {
-enum class PeDataDir : std::uint32_t
-{
-  Export,
-  Import,
-  Resource,
-  Exception,
-  Security,
-  BaseReloc,
-  Debug,
-  Architecture,
-  GlobalPTR,
-  TLS,
-  LoadConfig,
-  BoundImport,
-  IAT,
-  DelayImport,
-  COMDescriptor,
-  Reserved
-};
-
 class NtHeaders
 {
 public:
@@ -3,8 +3,11 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <exception>
 #include <iosfwd>
 #include <memory>
 #include <ostream>
@@ -15,9 +18,11 @@
 
 #include <hadesmem/config.hpp>
 #include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/pe_format.hpp>
 #include <hadesmem/detail/region_alloc_size.hpp>
 #include <hadesmem/error.hpp>
 #include <hadesmem/module.hpp>
+#include <hadesmem/pelib/pe_view.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/region.hpp>
 #include <hadesmem/region_list.hpp>
@@ -45,6 +50,10 @@
 // accompanying calls to Read/Write/etc.). Dependency on hadesmem APIs in
 // general should be removed, as ideally we could make the PeFile code
 // OS-independent as all we're doing is parsing files.
+// PeView (pe_view.hpp) is a separate Process-independent parser covering only
+// headers, sections, exports and imports. The only code shared with the types
+// here is the header parsing and RVA/file offset translation used by RvaToVa
+// and FileOffsetToRva.
 
 // TODO: Move to an attribute based system for warning on malformed or
 // suspicious files. Also important for testing, so we can ensure certain
@@ -101,14 +110,47 @@
 
 namespace hadesmem
 {
-// TODO: 'k' prefix.
-// TODO: Investigate if there is a better way to implement PeLib rather than
-// branching on PeFileType everywhere.
-enum class PeFileType
+namespace detail
 {
-  Image,
-  Data
-};
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeDosHeader) == sizeof(IMAGE_DOS_HEADER));
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeFileHeader) ==
+                              sizeof(IMAGE_FILE_HEADER));
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeOptionalHeader32) ==
+                              sizeof(IMAGE_OPTIONAL_HEADER32));
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeOptionalHeader64) ==
+                              sizeof(IMAGE_OPTIONAL_HEADER64));
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeSectionHeader) ==
+                              sizeof(IMAGE_SECTION_HEADER));
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeExportDirectory) ==
+                              sizeof(IMAGE_EXPORT_DIRECTORY));
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PeImportDescriptor) ==
+                              sizeof(IMAGE_IMPORT_DESCRIPTOR));
+HADESMEM_DETAIL_STATIC_ASSERT(kPeOptionalHeaderOffset ==
+                              offsetof(IMAGE_NT_HEADERS, OptionalHeader));
+
+// The headers almost always fit in the first page, so it is read up front and
+// the process is only read again for anything past it.
+inline PeHeaders
+  ReadPeHeaders(Process const& process, std::uint8_t* base, DWORD size)
+{
+  std::uint8_t page[0x1000];
+  std::size_t const page_len = (std::min)(sizeof(page), std::size_t{size});
+  bool const have_page = TryReadUnchecked(process, base, page, page_len);
+  return ParsePeHeaders(
+    [&](std::uint64_t offset, void* data, std::size_t len)
+    {
+      if (have_page && offset + len <= page_len)
+      {
+        std::memcpy(data, page + offset, len);
+      }
+      else
+      {
+        ReadImpl(process, base + offset, data, len);
+      }
+    },
+    size);
+}
+}
 
 class PeFile
 {
@@ -169,6 +211,20 @@ public:
     catch (...)
     {
     }
+
+    // Invalid headers just mean RvaToVa etc. fail to resolve anything, but a
+    // failure to read them is kept for CheckHeaders, so that it isn't
+    // mistaken for invalid headers.
+    auto headers = std::make_shared<detail::PeHeaders>();
+    try
+    {
+      *headers = detail::ReadPeHeaders(process, base_, size_);
+    }
+    catch (...)
+    {
+      headers_error_ = std::current_exception();
+    }
+    headers_ = std::move(headers);
   }
 
   explicit PeFile(Process const&& process,
@@ -196,12 +252,33 @@ public:
     return is_64_;
   }
 
+  // Parsed once at construction, so changes to the headers after that are not
+  // seen by RvaToVa and FileOffsetToRva. Empty if they couldn't be read (see
+  // CheckHeaders).
+  detail::PeHeaders const& GetHeaders() const noexcept
+  {
+    return *headers_;
+  }
+
+  // Rethrows the error (e.g. a failed read) which stopped the headers from
+  // being parsed, if any. Invalid headers are not an error.
+  void CheckHeaders() const
+  {
+    if (headers_error_)
+    {
+      std::rethrow_exception(headers_error_);
+    }
+  }
+
 private:
   Process const* process_;
   PBYTE base_;
   PeFileType type_;
   DWORD size_;
   bool is_64_{false};
+  // Shared so that copies (which are common) don't copy the section table.
+  std::shared_ptr<detail::PeHeaders const> headers_;
+  std::exception_ptr headers_error_;
 };
 
 inline bool operator==(PeFile const& lhs, PeFile const& rhs) noexcept
@@ -250,312 +327,49 @@ inline std::wostream& operator<<(std::wostream& lhs, PeFile const& rhs)
   return lhs;
 }
 
-// TODO: Add sample files for all the corner cases we're handling, and ensure it
-// is correct, so we can add regression tests.
 // TODO: Find a better name for this functions? It's slightly confusing...
-// TODO: Measure code coverage of this and other critical functions when writing
-// tests to ensure full coverage. Then add attributes and regression tests.
-// TODO: Consider if there is a better way to handle virtual VAs other than an
-// out param. Attributes?
+// Only the headers cached by PeFile are used, so this never reads from the
+// process.
 inline PVOID RvaToVa(Process const& process,
                      PeFile const& pe_file,
                      DWORD rva,
-                     bool* virtual_va = nullptr)
+                     bool* virtual_va = nullptr) noexcept
 {
+  (void)process;
+
   if (virtual_va)
   {
     *virtual_va = false;
   }
 
-  PeFileType const type = pe_file.GetType();
   PBYTE base = static_cast<PBYTE>(pe_file.GetBase());
 
-  if (type == PeFileType::Data)
-  {
-    if (!rva)
-    {
-      return nullptr;
-    }
-
-    IMAGE_DOS_HEADER dos_header = Read<IMAGE_DOS_HEADER>(process, base);
-    if (dos_header.e_magic != IMAGE_DOS_SIGNATURE)
-    {
-      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                      << ErrorString{"Invalid DOS header."});
-    }
-
-    BYTE* ptr_nt_headers = base + dos_header.e_lfanew;
-    if (Read<DWORD>(process, ptr_nt_headers) != IMAGE_NT_SIGNATURE)
-    {
-      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                      << ErrorString{"Invalid NT headers."});
-    }
-
-    auto const file_header =
-      Read<IMAGE_FILE_HEADER>(process, ptr_nt_headers + sizeof(DWORD));
-
-    auto const optional_header_32 =
-      pe_file.Is64()
-        ? IMAGE_OPTIONAL_HEADER32{}
-        : Read<IMAGE_OPTIONAL_HEADER32>(process,
-                                        ptr_nt_headers + sizeof(DWORD) +
-                                          sizeof(IMAGE_FILE_HEADER));
-    auto const optional_header_64 =
-      pe_file.Is64()
-        ? Read<IMAGE_OPTIONAL_HEADER64>(
-            process, ptr_nt_headers + sizeof(DWORD) + sizeof(IMAGE_FILE_HEADER))
-        : IMAGE_OPTIONAL_HEADER64{};
-
-    DWORD const size_of_headers = pe_file.Is64()
-                                    ? optional_header_64.SizeOfHeaders
-                                    : optional_header_32.SizeOfHeaders;
-    DWORD const file_alignment = pe_file.Is64()
-                                   ? optional_header_64.FileAlignment
-                                   : optional_header_32.FileAlignment;
-    DWORD const size_of_image = pe_file.Is64() ? optional_header_64.SizeOfImage
-                                               : optional_header_32.SizeOfImage;
-
-    // A PE file can legally have zero sections, in which case the entire file
-    // is executable as though it were a single section whose size is equal to
-    // the SizeOfHeaders value rounded up to the nearest page.
-    // TODO: Confirm that the comment on rounding is correct, then implement it.
-    WORD num_sections = file_header.NumberOfSections;
-    if (!num_sections)
-    {
-      // In cases where the PE file has no sections it can apparently also have
-      // all sorts of messed up RVAs for data dirs etc... Make sure that none of
-      // them lie outside the file, because otherwise simply returning a direct
-      // offset from the base wouldn't work anyway...
-      if (rva > pe_file.GetSize())
-      {
-        return nullptr;
-      }
-      else
-      {
-        return base + rva;
-      }
-    }
-
-    // SizeOfHeaders can be arbitrarily large, including the size of the entire.
-    // RVAs inside the headers are treated as an offset from zero, rather than
-    // finding the 'true' location in a section.
-    if (rva < size_of_headers)
-    {
-      // TODO: This probably needs some extra checks as some cases are probably
-      // invalid, but I don't know what the checks should be. Need to
-      // investigate to see what is allowed and what is not.
-      if (rva > pe_file.GetSize() || rva > size_of_image)
-      {
-        return nullptr;
-      }
-      else
-      {
-        return base + rva;
-      }
-    }
-
-    if (rva > size_of_image)
-    {
-      return nullptr;
-    }
-
-    auto ptr_section_header = reinterpret_cast<PIMAGE_SECTION_HEADER>(
-      ptr_nt_headers + offsetof(IMAGE_NT_HEADERS, OptionalHeader) +
-      file_header.SizeOfOptionalHeader);
-    void const* const file_end =
-      static_cast<std::uint8_t*>(pe_file.GetBase()) + pe_file.GetSize();
-    // Virtual section table.
-    if (ptr_section_header >= file_end)
-    {
-      if (rva > pe_file.GetSize())
-      {
-        return nullptr;
-      }
-      else
-      {
-        return base + rva;
-      }
-    }
-
-    bool in_header = true;
-    for (WORD i = 0; i < num_sections; ++i)
-    {
-      // For a virtual section header, simply return nullptr. (Similar to above,
-      // except this time only the Nth entry onwards is virtual, rather than all
-      // the headers.)
-      if (ptr_section_header + 1 > file_end)
-      {
-        return nullptr;
-      }
-
-      auto const section_header =
-        Read<IMAGE_SECTION_HEADER>(process, ptr_section_header);
-
-      DWORD const virtual_beg = section_header.VirtualAddress;
-      DWORD const virtual_size = section_header.Misc.VirtualSize;
-      DWORD const raw_size = section_header.SizeOfRawData;
-      // If VirtualSize is zero then SizeOfRawData is used.
-      DWORD const virtual_end =
-        virtual_beg + (virtual_size ? virtual_size : raw_size);
-      if (virtual_beg <= rva && rva < virtual_end)
-      {
-        rva -= virtual_beg;
-
-        // If the RVA is outside the raw data (which would put it in the
-        // zero-fill of the virtual data) just return nullptr because it's
-        // invalid. Technically files like this will work when loaded by the
-        // PE loader due to the sections being mapped differention in memory
-        // to on disk, but if you want to inspect the file in that manner you
-        // should just use LoadLibrary with the appropriate flags for your
-        // scenario and then use PeFileType::Image.
-        if (rva > raw_size)
-        {
-          // It's useful to be able to detect this case as a user for things
-          // like exports, where typically a failure to resolve an RVA would be
-          // an error/suspicious, but not in the case of a data export where it
-          // is normal for the RVA to be in the zero fill of a data segment.
-          // TODO: Find other places in this function where we need to set this
-          // flag.
-          // TODO: Also check section characteristics?
-          if (rva < virtual_size && virtual_va)
-          {
-            *virtual_va = true;
-          }
-
-          return nullptr;
-        }
-
-        // If PointerToRawData is less than 0x200 it is rounded
-        // down to 0.
-        if (section_header.PointerToRawData >= 0x200)
-        {
-          // TODO: Check whether we actually need/want to force alignment here.
-          rva += section_header.PointerToRawData & ~(file_alignment - 1);
-        }
-
-        // If the RVA now lies outside the actual file just return nullptr
-        // because it's invalid.
-        if (rva >= pe_file.GetSize())
-        {
-          return nullptr;
-        }
-
-        return base + rva;
-      }
-
-      // This should be the 'normal' case. However sometimes the RVA is at a
-      // lower address than any of the sections, so we want to detect this so we
-      // can just treat the RVA as an offset from the module base (similar to
-      // when the image is loaded).
-      if (virtual_beg <= rva)
-      {
-        in_header = false;
-      }
-
-      ++ptr_section_header;
-    }
-
-    // Doing the same thing as in the SizeOfHeaders check above because we're
-    // not sure of better criteria to base it off. Perhaps it's correct now?
-    if (in_header && rva < pe_file.GetSize())
-    {
-      // Only applies in low alignment, otherwise it's invalid?
-      if (file_alignment < 200)
-      {
-        return base + rva;
-      }
-      // Also only applies if the RVA is smaller than file alignment?
-      else if (rva < file_alignment)
-      {
-        return base + rva;
-      }
-      else
-      {
-        return nullptr;
-      }
-    }
-
-    // Sample: nullSOH-XP (Corkami PE Corpus)
-    if (rva < size_of_image && rva < pe_file.GetSize())
-    {
-      return base + rva;
-    }
-
-    return nullptr;
-  }
-  else if (type == PeFileType::Image)
+  if (pe_file.GetType() == PeFileType::Image)
   {
     return rva ? (base + rva) : nullptr;
   }
-  else
-  {
-    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                    << ErrorString{"Unhandled file type."});
-  }
+
+  HADESMEM_DETAIL_ASSERT(pe_file.GetType() == PeFileType::Data);
+  std::uint32_t offset = 0;
+  return detail::RvaToFileOffset(
+           pe_file.GetHeaders(), pe_file.GetSize(), rva, offset, virtual_va)
+           ? base + offset
+           : nullptr;
 }
 
-// TODO: 'Harden' this function against malicious/malformed PE files like is
-// done for RvaToVa.
 inline DWORD FileOffsetToRva(Process const& process,
                              PeFile const& pe_file,
-                             DWORD file_offset)
+                             DWORD file_offset) noexcept
 {
-  PeFileType const type = pe_file.GetType();
-  PBYTE base = static_cast<PBYTE>(pe_file.GetBase());
-
-  if (type == PeFileType::Data)
-  {
-    IMAGE_DOS_HEADER dos_header = Read<IMAGE_DOS_HEADER>(process, base);
-    if (dos_header.e_magic != IMAGE_DOS_SIGNATURE)
-    {
-      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                      << ErrorString{"Invalid DOS header."});
-    }
-
-    BYTE* ptr_nt_headers = base + dos_header.e_lfanew;
-    if (Read<DWORD>(process, ptr_nt_headers) != IMAGE_NT_SIGNATURE)
-    {
-      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                      << ErrorString{"Invalid NT headers."});
-    }
-
-    auto const file_header =
-      Read<IMAGE_FILE_HEADER>(process, ptr_nt_headers + sizeof(DWORD));
-
-    auto ptr_section_header = reinterpret_cast<PIMAGE_SECTION_HEADER>(
-      ptr_nt_headers + offsetof(IMAGE_NT_HEADERS, OptionalHeader) +
-      file_header.SizeOfOptionalHeader);
-
-    WORD num_sections = file_header.NumberOfSections;
-    for (WORD i = 0; i < num_sections; ++i)
-    {
-      auto const section_header =
-        Read<IMAGE_SECTION_HEADER>(process, ptr_section_header);
+  (void)process;
 
-      DWORD const raw_beg = section_header.PointerToRawData;
-      DWORD const raw_size = section_header.SizeOfRawData;
-      DWORD const raw_end = raw_beg + raw_size;
-      if (raw_beg <= file_offset && file_offset < raw_end)
-      {
-        file_offset -= raw_beg;
-        file_offset += section_header.VirtualAddress;
-        return file_offset;
-      }
-
-      ++ptr_section_header;
-    }
-
-    return 0;
-  }
-  else if (type == PeFileType::Image)
+  if (pe_file.GetType() == PeFileType::Image)
   {
     return file_offset;
   }
-  else
-  {
-    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                    << ErrorString{"Unhandled file type."});
-  }
+
+  HADESMEM_DETAIL_ASSERT(pe_file.GetType() == PeFileType::Data);
+  return detail::FileOffsetToRva(pe_file.GetHeaders(), file_offset);
 }
 
 namespace detail
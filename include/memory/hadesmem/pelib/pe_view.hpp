@@ -0,0 +1,1224 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/pe_format.hpp>
+#include <hadesmem/error.hpp>
+
+// PeView parses a PE file directly from a bounds-checked span of bytes (e.g. a
+// file read or mapped into memory with detail::MappedFile), with no dependency
+// on Process or windows.h. Every access is checked against the span, so
+// malformed files can never cause a read outside of it.
+//
+// PeView is a standalone parser for the headers, sections, exports and imports
+// only. Other directories (TLS, relocations, bound imports, resources, etc.)
+// are only available through the Process-backed types.
+//
+// The only code shared with the Process-backed types is the header parsing
+// and RVA/file offset translation below (ParsePeHeaders, RvaToFileOffset and
+// FileOffsetToRva), which PeFile uses to implement RvaToVa and
+// FileOffsetToRva. The Process-backed DosHeader, ExportList, ImportDirList,
+// etc. are separate implementations and still read through Process.
+
+namespace hadesmem
+{
+// TODO: 'k' prefix.
+// TODO: Investigate if there is a better way to implement PeLib rather than
+// branching on PeFileType everywhere.
+enum class PeFileType
+{
+  Image,
+  Data
+};
+
+enum class PeDataDir : std::uint32_t
+{
+  Export,
+  Import,
+  Resource,
+  Exception,
+  Security,
+  BaseReloc,
+  Debug,
+  Architecture,
+  GlobalPTR,
+  TLS,
+  LoadConfig,
+  BoundImport,
+  IAT,
+  DelayImport,
+  COMDescriptor,
+  Reserved
+};
+
+namespace detail
+{
+// Non-empty section in PeHeaders::section_index.
+struct PeSectionRange
+{
+  std::uint32_t virtual_beg;
+  std::uint32_t virtual_end;
+  // Index into PeHeaders::sections.
+  std::uint32_t index;
+};
+
+// The parts of the headers needed to translate addresses. Only the section
+// headers which lie entirely inside the file are stored.
+struct PeHeaders
+{
+  bool dos_valid{};
+  bool nt_valid{};
+  bool is_64{};
+  std::uint32_t nt_headers_offset{};
+  PeFileHeader file_header{};
+  std::uint64_t image_base{};
+  std::uint32_t entry_point{};
+  std::uint32_t section_alignment{};
+  std::uint32_t file_alignment{};
+  std::uint32_t size_of_image{};
+  std::uint32_t size_of_headers{};
+  // NumberOfRvaAndSizes, clamped to the size of the array.
+  std::uint32_t num_data_dirs{};
+  PeDataDirectory data_dirs[kPeNumDataDirs]{};
+  std::uint64_t section_table_offset{};
+  std::vector<PeSectionHeader> sections;
+  // Sections sorted by RVA, so RvaToFileOffset can binary search them. Only
+  // valid if no two sections overlap, otherwise the order of the section
+  // table matters and it has to be searched linearly.
+  std::vector<PeSectionRange> section_index;
+  bool section_index_valid{};
+  std::uint32_t min_section_rva{};
+};
+
+// If VirtualSize is zero then SizeOfRawData is used.
+inline std::uint32_t GetPeSectionVirtualEnd(PeSectionHeader const& section)
+  noexcept
+{
+  return section.VirtualAddress +
+         (section.VirtualSize ? section.VirtualSize : section.SizeOfRawData);
+}
+
+inline void BuildPeSectionIndex(PeHeaders& headers)
+{
+  headers.section_index.clear();
+  headers.section_index.reserve(headers.sections.size());
+  headers.min_section_rva = (std::numeric_limits<std::uint32_t>::max)();
+  for (std::size_t i = 0; i < headers.sections.size(); ++i)
+  {
+    PeSectionHeader const& section = headers.sections[i];
+    headers.min_section_rva =
+      (std::min)(headers.min_section_rva, section.VirtualAddress);
+    // Sections which are empty (or wrap) never contain an RVA.
+    std::uint32_t const virtual_end = GetPeSectionVirtualEnd(section);
+    if (virtual_end > section.VirtualAddress)
+    {
+      headers.section_index.push_back(PeSectionRange{
+        section.VirtualAddress, virtual_end, static_cast<std::uint32_t>(i)});
+    }
+  }
+
+  std::sort(std::begin(headers.section_index),
+            std::end(headers.section_index),
+            [](PeSectionRange const& lhs, PeSectionRange const& rhs)
+            {
+              return lhs.virtual_beg < rhs.virtual_beg;
+            });
+  auto const overlap =
+    std::adjacent_find(std::begin(headers.section_index),
+                       std::end(headers.section_index),
+                       [](PeSectionRange const& lhs, PeSectionRange const& rhs)
+                       {
+                         return rhs.virtual_beg < lhs.virtual_end;
+                       });
+  headers.section_index_valid = overlap == std::end(headers.section_index);
+}
+
+template <typename OptionalHeaderT>
+void CopyPeOptionalHeader(OptionalHeaderT const& optional_header,
+                          PeHeaders& headers)
+{
+  headers.image_base = optional_header.ImageBase;
+  headers.entry_point = optional_header.AddressOfEntryPoint;
+  headers.section_alignment = optional_header.SectionAlignment;
+  headers.file_alignment = optional_header.FileAlignment;
+  headers.size_of_image = optional_header.SizeOfImage;
+  headers.size_of_headers = optional_header.SizeOfHeaders;
+  headers.num_data_dirs = (std::min)(optional_header.NumberOfRvaAndSizes,
+                                     std::uint32_t{kPeNumDataDirs});
+  std::copy(std::begin(optional_header.DataDirectory),
+            std::end(optional_header.DataDirectory),
+            std::begin(headers.data_dirs));
+}
+
+// 'read(offset, data, len)' must copy 'len' bytes from the given file offset.
+// It is only ever called for ranges inside the file. Anything past the end of
+// the file reads as zero.
+template <typename ReadFn>
+PeHeaders ParsePeHeaders(ReadFn read, std::uint64_t size)
+{
+  auto const read_clamped =
+    [&](std::uint64_t offset, void* data, std::size_t len)
+  {
+    std::memset(data, 0, len);
+    if (offset < size)
+    {
+      read(offset,
+           data,
+           static_cast<std::size_t>(
+             (std::min)(std::uint64_t{len}, size - offset)));
+    }
+  };
+
+  PeHeaders headers;
+
+  PeDosHeader dos_header;
+  read_clamped(0, &dos_header, sizeof(dos_header));
+  headers.dos_valid = dos_header.e_magic == kPeDosSignature;
+  if (!headers.dos_valid)
+  {
+    return headers;
+  }
+
+  headers.nt_headers_offset = static_cast<std::uint32_t>(dos_header.e_lfanew);
+  std::uint64_t const nt_headers_offset = headers.nt_headers_offset;
+  std::uint32_t signature = 0;
+  read_clamped(nt_headers_offset, &signature, sizeof(signature));
+  headers.nt_valid = signature == kPeNtSignature;
+  if (!headers.nt_valid)
+  {
+    return headers;
+  }
+
+  read_clamped(nt_headers_offset + sizeof(signature),
+               &headers.file_header,
+               sizeof(headers.file_header));
+  headers.is_64 = headers.file_header.Machine == kPeMachineAmd64;
+
+  if (headers.is_64)
+  {
+    PeOptionalHeader64 optional_header;
+    read_clamped(nt_headers_offset + kPeOptionalHeaderOffset,
+                 &optional_header,
+                 sizeof(optional_header));
+    CopyPeOptionalHeader(optional_header, headers);
+  }
+  else
+  {
+    PeOptionalHeader32 optional_header;
+    read_clamped(nt_headers_offset + kPeOptionalHeaderOffset,
+                 &optional_header,
+                 sizeof(optional_header));
+    CopyPeOptionalHeader(optional_header, headers);
+  }
+
+  headers.section_table_offset = nt_headers_offset + kPeOptionalHeaderOffset +
+                                 headers.file_header.SizeOfOptionalHeader;
+  if (headers.section_table_offset < size)
+  {
+    std::uint64_t const num_in_file =
+      (std::min)(std::uint64_t{headers.file_header.NumberOfSections},
+                 (size - headers.section_table_offset) /
+                   sizeof(PeSectionHeader));
+    headers.sections.resize(static_cast<std::size_t>(num_in_file));
+    if (!headers.sections.empty())
+    {
+      read(headers.section_table_offset,
+           headers.sections.data(),
+           headers.sections.size() * sizeof(PeSectionHeader));
+    }
+  }
+
+  BuildPeSectionIndex(headers);
+
+  return headers;
+}
+
+inline void CheckPeHeaders(PeHeaders const& headers)
+{
+  if (!headers.dos_valid)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"Invalid DOS header."});
+  }
+
+  if (!headers.nt_valid)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"Invalid NT headers."});
+  }
+}
+
+// Maps an RVA inside the given section. See RvaToFileOffset.
+inline bool SectionRvaToFileOffset(PeHeaders const& headers,
+                                   PeSectionHeader const& section,
+                                   std::uint32_t size,
+                                   std::uint32_t rva,
+                                   std::uint32_t& offset,
+                                   bool* virtual_va) noexcept
+{
+  std::uint32_t section_offset = rva - section.VirtualAddress;
+
+  // If the RVA is outside the raw data (which would put it in the zero-fill
+  // of the virtual data) it's invalid. Technically files like this will work
+  // when loaded by the PE loader due to the sections being mapped differently
+  // in memory to on disk, but if you want to inspect the file in that manner
+  // you should just use LoadLibrary with the appropriate flags for your
+  // scenario and then use PeFileType::Image.
+  if (section_offset > section.SizeOfRawData)
+  {
+    // It's useful to be able to detect this case as a user for things like
+    // exports, where typically a failure to resolve an RVA would be an
+    // error/suspicious, but not in the case of a data export where it is
+    // normal for the RVA to be in the zero fill of a data segment.
+    // TODO: Find other places in this function where we need to set this
+    // flag.
+    // TODO: Also check section characteristics?
+    if (section_offset < section.VirtualSize && virtual_va)
+    {
+      *virtual_va = true;
+    }
+
+    return false;
+  }
+
+  // If PointerToRawData is less than 0x200 it is rounded down to 0.
+  if (section.PointerToRawData >= 0x200)
+  {
+    // TODO: Check whether we actually need/want to force alignment here.
+    section_offset += section.PointerToRawData & ~(headers.file_alignment - 1);
+  }
+
+  // If the RVA now lies outside the actual file it's invalid.
+  if (section_offset >= size)
+  {
+    return false;
+  }
+
+  offset = section_offset;
+  return true;
+}
+
+// Translates an RVA to a file offset for PeFileType::Data. Returns false if
+// the RVA doesn't map to anything in the file (or the headers are invalid),
+// and sets 'virtual_va' if that is because it is in the zero-fill of a
+// section.
+// TODO: Add sample files for all the corner cases we're handling, and ensure it
+// is correct, so we can add regression tests.
+// TODO: Measure code coverage of this and other critical functions when writing
+// tests to ensure full coverage. Then add attributes and regression tests.
+// TODO: Consider if there is a better way to handle virtual VAs other than an
+// out param. Attributes?
+inline bool RvaToFileOffset(PeHeaders const& headers,
+                            std::uint32_t size,
+                            std::uint32_t rva,
+                            std::uint32_t& offset,
+                            bool* virtual_va = nullptr) noexcept
+{
+  if (virtual_va)
+  {
+    *virtual_va = false;
+  }
+
+  if (!rva || !headers.nt_valid)
+  {
+    return false;
+  }
+
+  // A PE file can legally have zero sections, in which case the entire file
+  // is executable as though it were a single section whose size is equal to
+  // the SizeOfHeaders value rounded up to the nearest page.
+  // TODO: Confirm that the comment on rounding is correct, then implement it.
+  if (!headers.file_header.NumberOfSections)
+  {
+    // In cases where the PE file has no sections it can apparently also have
+    // all sorts of messed up RVAs for data dirs etc... Make sure that none of
+    // them lie outside the file, because otherwise simply returning a direct
+    // offset from the base wouldn't work anyway...
+    if (rva > size)
+    {
+      return false;
+    }
+
+    offset = rva;
+    return true;
+  }
+
+  // SizeOfHeaders can be arbitrarily large, including the size of the entire.
+  // RVAs inside the headers are treated as an offset from zero, rather than
+  // finding the 'true' location in a section.
+  if (rva < headers.size_of_headers)
+  {
+    // TODO: This probably needs some extra checks as some cases are probably
+    // invalid, but I don't know what the checks should be. Need to
+    // investigate to see what is allowed and what is not.
+    if (rva > size || rva > headers.size_of_image)
+    {
+      return false;
+    }
+
+    offset = rva;
+    return true;
+  }
+
+  if (rva > headers.size_of_image)
+  {
+    return false;
+  }
+
+  // Virtual section table.
+  if (headers.section_table_offset >= size)
+  {
+    if (rva > size)
+    {
+      return false;
+    }
+
+    offset = rva;
+    return true;
+  }
+
+  bool in_header = true;
+  if (headers.section_index_valid)
+  {
+    // At most one section can contain the RVA, so this finds the same section
+    // as searching the table in order.
+    auto const iter =
+      std::upper_bound(std::begin(headers.section_index),
+                       std::end(headers.section_index),
+                       rva,
+                       [](std::uint32_t lhs, PeSectionRange const& rhs)
+                       {
+                         return lhs < rhs.virtual_beg;
+                       });
+    if (iter != std::begin(headers.section_index) &&
+        rva < std::prev(iter)->virtual_end)
+    {
+      return SectionRvaToFileOffset(headers,
+                                    headers.sections[std::prev(iter)->index],
+                                    size,
+                                    rva,
+                                    offset,
+                                    virtual_va);
+    }
+
+    // For a virtual section header, simply return nullptr. (Similar to above,
+    // except this time only the Nth entry onwards is virtual, rather than all
+    // the headers.)
+    if (headers.sections.size() < headers.file_header.NumberOfSections)
+    {
+      return false;
+    }
+
+    in_header = rva < headers.min_section_rva;
+  }
+  else
+  {
+    for (std::size_t i = 0; i < headers.file_header.NumberOfSections; ++i)
+    {
+      // Virtual section header, as above.
+      if (i >= headers.sections.size())
+      {
+        return false;
+      }
+
+      PeSectionHeader const& section = headers.sections[i];
+      std::uint32_t const virtual_beg = section.VirtualAddress;
+      if (virtual_beg <= rva && rva < GetPeSectionVirtualEnd(section))
+      {
+        return SectionRvaToFileOffset(
+          headers, section, size, rva, offset, virtual_va);
+      }
+
+      // This should be the 'normal' case. However sometimes the RVA is at a
+      // lower address than any of the sections, so we want to detect this so
+      // we can just treat the RVA as an offset from the module base (similar
+      // to when the image is loaded).
+      if (virtual_beg <= rva)
+      {
+        in_header = false;
+      }
+    }
+  }
+
+  // Doing the same thing as in the SizeOfHeaders check above because we're
+  // not sure of better criteria to base it off. Perhaps it's correct now?
+  if (in_header && rva < size)
+  {
+    // Only applies in low alignment, otherwise it's invalid?
+    // Also only applies if the RVA is smaller than file alignment?
+    if (headers.file_alignment < 200 || rva < headers.file_alignment)
+    {
+      offset = rva;
+      return true;
+    }
+
+    return false;
+  }
+
+  // Sample: nullSOH-XP (Corkami PE Corpus)
+  if (rva < headers.size_of_image && rva < size)
+  {
+    offset = rva;
+    return true;
+  }
+
+  return false;
+}
+
+// Returns zero if the offset is not inside any section's raw data (or the
+// headers are invalid).
+// TODO: 'Harden' this function against malicious/malformed PE files like is
+// done for RvaToFileOffset.
+inline std::uint32_t FileOffsetToRva(PeHeaders const& headers,
+                                     std::uint32_t file_offset) noexcept
+{
+  for (auto const& section : headers.sections)
+  {
+    std::uint32_t const raw_beg = section.PointerToRawData;
+    std::uint32_t const raw_end = raw_beg + section.SizeOfRawData;
+    if (raw_beg <= file_offset && file_offset < raw_end)
+    {
+      return file_offset - raw_beg + section.VirtualAddress;
+    }
+  }
+
+  return 0;
+}
+}
+
+struct PeViewExport
+{
+  std::uint32_t rva;
+  std::uint16_t procedure_number;
+  bool by_name;
+  bool forwarded;
+  // Set if the RVA is in the zero-fill of a section (e.g. a data export).
+  bool virtual_va;
+  std::string name;
+  std::string forwarder;
+  std::string forwarder_module;
+  std::string forwarder_function;
+};
+
+struct PeViewImportThunk
+{
+  // RVA of the IAT entry.
+  std::uint32_t iat_rva;
+  bool by_ordinal;
+  std::uint16_t ordinal;
+  std::uint16_t hint;
+  std::string name;
+};
+
+struct PeViewImportDir
+{
+  std::uint32_t original_first_thunk;
+  std::uint32_t time_date_stamp;
+  std::uint32_t forwarder_chain;
+  std::uint32_t first_thunk;
+  std::string name;
+  std::vector<PeViewImportThunk> thunks;
+};
+
+struct PeExportFunction
+{
+  // May be out of range for a WORD in malformed files.
+  std::uint64_t procedure_number;
+  // Zero for an unused entry.
+  std::uint32_t rva;
+};
+
+struct PeExportName
+{
+  std::uint32_t name_rva;
+  // Index into AddressOfFunctions (i.e. unbiased by the ordinal base).
+  std::uint16_t ordinal;
+};
+
+struct PeImportThunkEntry
+{
+  // RVA of the IAT entry.
+  std::uint32_t iat_rva;
+  // Raw lookup table (or IAT) entry.
+  std::uint64_t value;
+  bool by_ordinal;
+  std::uint16_t ordinal;
+  // RVA of the hint/name entry, if not by ordinal.
+  std::uint32_t name_rva;
+};
+
+namespace detail
+{
+// Decoders turn an index into an entry of a table which has already been
+// located and bounds checked as a whole.
+
+struct PeExportFunctionDecoder
+{
+  using value_type = PeExportFunction;
+
+  value_type operator()(std::size_t index) const noexcept
+  {
+    value_type func{std::uint64_t{ordinal_base} + index, 0};
+    std::memcpy(&func.rva,
+                functions + index * sizeof(std::uint32_t),
+                sizeof(std::uint32_t));
+    return func;
+  }
+
+  std::uint8_t const* functions;
+  std::uint32_t ordinal_base;
+};
+
+struct PeExportNameDecoder
+{
+  using value_type = PeExportName;
+
+  value_type operator()(std::size_t index) const noexcept
+  {
+    value_type name{};
+    std::memcpy(&name.name_rva,
+                names + index * sizeof(std::uint32_t),
+                sizeof(std::uint32_t));
+    std::memcpy(&name.ordinal,
+                ordinals + index * sizeof(std::uint16_t),
+                sizeof(std::uint16_t));
+    return name;
+  }
+
+  std::uint8_t const* names;
+  std::uint8_t const* ordinals;
+};
+
+struct PeImportThunkDecoder
+{
+  using value_type = PeImportThunkEntry;
+
+  value_type operator()(std::size_t index) const noexcept
+  {
+    value_type thunk{};
+    thunk.iat_rva =
+      static_cast<std::uint32_t>(first_thunk + index * thunk_size);
+    std::memcpy(&thunk.value, thunks + index * thunk_size, thunk_size);
+    thunk.by_ordinal = !!(thunk.value >> (thunk_size * 8 - 1));
+    if (thunk.by_ordinal)
+    {
+      thunk.ordinal = static_cast<std::uint16_t>(thunk.value);
+    }
+    else
+    {
+      thunk.name_rva = static_cast<std::uint32_t>(thunk.value);
+    }
+    return thunk;
+  }
+
+  std::uint8_t const* thunks;
+  std::uint32_t first_thunk;
+  std::uint32_t thunk_size;
+};
+}
+
+// PeTableIterator satisfies the requirements of a random access iterator
+// (C++ Standard, 24.2.7, Random Access Iterators [random.access.iterators]),
+// except that entries are decoded on access and returned by value (so there
+// is no operator->). Stepping is just index arithmetic, with no reads, checks
+// or allocation.
+template <typename DecoderT>
+class PeTableIterator
+  : public std::iterator<std::random_access_iterator_tag,
+                         typename DecoderT::value_type,
+                         std::ptrdiff_t,
+                         void,
+                         typename DecoderT::value_type>
+{
+public:
+  using BaseIteratorT = std::iterator<std::random_access_iterator_tag,
+                                      typename DecoderT::value_type,
+                                      std::ptrdiff_t,
+                                      void,
+                                      typename DecoderT::value_type>;
+  using value_type = typename BaseIteratorT::value_type;
+  using difference_type = typename BaseIteratorT::difference_type;
+  using pointer = typename BaseIteratorT::pointer;
+  using reference = typename BaseIteratorT::reference;
+  using iterator_category = typename BaseIteratorT::iterator_category;
+
+  constexpr PeTableIterator() noexcept : decoder_{}, index_{}
+  {
+  }
+
+  explicit PeTableIterator(DecoderT const& decoder, std::size_t index) noexcept
+    : decoder_(decoder), index_{index}
+  {
+  }
+
+  reference operator*() const noexcept
+  {
+    return decoder_(index_);
+  }
+
+  reference operator[](difference_type n) const noexcept
+  {
+    return decoder_(index_ + n);
+  }
+
+  PeTableIterator& operator++() noexcept
+  {
+    ++index_;
+    return *this;
+  }
+
+  PeTableIterator operator++(int) noexcept
+  {
+    PeTableIterator const iter{*this};
+    ++*this;
+    return iter;
+  }
+
+  PeTableIterator& operator--() noexcept
+  {
+    --index_;
+    return *this;
+  }
+
+  PeTableIterator operator--(int) noexcept
+  {
+    PeTableIterator const iter{*this};
+    --*this;
+    return iter;
+  }
+
+  PeTableIterator& operator+=(difference_type n) noexcept
+  {
+    index_ += n;
+    return *this;
+  }
+
+  PeTableIterator& operator-=(difference_type n) noexcept
+  {
+    index_ -= n;
+    return *this;
+  }
+
+  friend PeTableIterator operator+(PeTableIterator iter,
+                                   difference_type n) noexcept
+  {
+    return iter += n;
+  }
+
+  friend PeTableIterator operator+(difference_type n,
+                                   PeTableIterator iter) noexcept
+  {
+    return iter += n;
+  }
+
+  friend PeTableIterator operator-(PeTableIterator iter,
+                                   difference_type n) noexcept
+  {
+    return iter -= n;
+  }
+
+  friend difference_type operator-(PeTableIterator const& lhs,
+                                   PeTableIterator const& rhs) noexcept
+  {
+    return static_cast<difference_type>(lhs.index_ - rhs.index_);
+  }
+
+  // Iterators are only comparable if they come from the same table.
+  bool operator==(PeTableIterator const& other) const noexcept
+  {
+    return index_ == other.index_;
+  }
+
+  bool operator!=(PeTableIterator const& other) const noexcept
+  {
+    return !(*this == other);
+  }
+
+  bool operator<(PeTableIterator const& other) const noexcept
+  {
+    return index_ < other.index_;
+  }
+
+  bool operator>(PeTableIterator const& other) const noexcept
+  {
+    return other < *this;
+  }
+
+  bool operator<=(PeTableIterator const& other) const noexcept
+  {
+    return !(other < *this);
+  }
+
+  bool operator>=(PeTableIterator const& other) const noexcept
+  {
+    return !(*this < other);
+  }
+
+private:
+  DecoderT decoder_;
+  std::size_t index_;
+};
+
+// A table of fixed size entries (e.g. AddressOfFunctions or an import lookup
+// table) which has already been located and bounds checked. It doesn't own
+// the underlying data. Iterators hold a copy of the decoder rather than a
+// pointer to the table, so they remain valid after the table is destroyed.
+template <typename DecoderT> class PeTable
+{
+public:
+  using value_type = typename DecoderT::value_type;
+  using size_type = std::size_t;
+  using iterator = PeTableIterator<DecoderT>;
+  using const_iterator = PeTableIterator<DecoderT>;
+
+  constexpr PeTable() noexcept : decoder_{}, size_{}
+  {
+  }
+
+  explicit PeTable(DecoderT const& decoder, std::size_t size) noexcept
+    : decoder_(decoder), size_{size}
+  {
+  }
+
+  const_iterator begin() const noexcept
+  {
+    return const_iterator{decoder_, 0};
+  }
+
+  const_iterator cbegin() const noexcept
+  {
+    return begin();
+  }
+
+  const_iterator end() const noexcept
+  {
+    return const_iterator{decoder_, size_};
+  }
+
+  const_iterator cend() const noexcept
+  {
+    return end();
+  }
+
+  size_type size() const noexcept
+  {
+    return size_;
+  }
+
+  bool empty() const noexcept
+  {
+    return !size_;
+  }
+
+  value_type operator[](size_type index) const noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(index < size_);
+    return decoder_(index);
+  }
+
+private:
+  DecoderT decoder_;
+  std::size_t size_;
+};
+
+using PeExportFunctionTable = PeTable<detail::PeExportFunctionDecoder>;
+
+using PeExportNameTable = PeTable<detail::PeExportNameDecoder>;
+
+using PeImportThunkTable = PeTable<detail::PeImportThunkDecoder>;
+
+class PeView
+{
+public:
+  // For PeFileType::Image the span is a mapped (or dumped) image, so RVAs are
+  // simply offsets into it.
+  explicit PeView(void const* data,
+                  std::size_t size,
+                  PeFileType type = PeFileType::Data)
+    : base_{static_cast<std::uint8_t const*>(data)},
+      size_{static_cast<std::uint32_t>(size)},
+      type_{type}
+  {
+    HADESMEM_DETAIL_ASSERT(base_ != nullptr);
+    if (!size || size > (std::numeric_limits<std::uint32_t>::max)())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Invalid file size."});
+    }
+
+    headers_ = detail::ParsePeHeaders(
+      [this](std::uint64_t offset, void* out, std::size_t len)
+      {
+        std::memcpy(out, base_ + offset, len);
+      },
+      size_);
+    detail::CheckPeHeaders(headers_);
+  }
+
+  void const* GetBase() const noexcept
+  {
+    return base_;
+  }
+
+  std::uint32_t GetSize() const noexcept
+  {
+    return size_;
+  }
+
+  PeFileType GetType() const noexcept
+  {
+    return type_;
+  }
+
+  bool Is64() const noexcept
+  {
+    return headers_.is_64;
+  }
+
+  detail::PeFileHeader const& GetFileHeader() const noexcept
+  {
+    return headers_.file_header;
+  }
+
+  std::uint64_t GetImageBase() const noexcept
+  {
+    return headers_.image_base;
+  }
+
+  std::uint32_t GetAddressOfEntryPoint() const noexcept
+  {
+    return headers_.entry_point;
+  }
+
+  std::uint32_t GetSectionAlignment() const noexcept
+  {
+    return headers_.section_alignment;
+  }
+
+  std::uint32_t GetFileAlignment() const noexcept
+  {
+    return headers_.file_alignment;
+  }
+
+  std::uint32_t GetSizeOfImage() const noexcept
+  {
+    return headers_.size_of_image;
+  }
+
+  std::uint32_t GetSizeOfHeaders() const noexcept
+  {
+    return headers_.size_of_headers;
+  }
+
+  // Zero if the directory is past NumberOfRvaAndSizes.
+  detail::PeDataDirectory GetDataDirectory(PeDataDir data_dir) const noexcept
+  {
+    auto const index = static_cast<std::uint32_t>(data_dir);
+    return index < headers_.num_data_dirs ? headers_.data_dirs[index]
+                                          : detail::PeDataDirectory{};
+  }
+
+  // Only the section headers which lie inside the file.
+  std::vector<detail::PeSectionHeader> const& GetSections() const noexcept
+  {
+    return headers_.sections;
+  }
+
+  // Returns nullptr if the RVA doesn't map to anything inside the span.
+  void const* RvaToPtr(std::uint32_t rva,
+                       bool* virtual_va = nullptr) const noexcept
+  {
+    if (type_ == PeFileType::Image)
+    {
+      if (virtual_va)
+      {
+        *virtual_va = false;
+      }
+
+      return rva && rva < size_ ? base_ + rva : nullptr;
+    }
+
+    std::uint32_t offset = 0;
+    return detail::RvaToFileOffset(headers_, size_, rva, offset, virtual_va)
+             ? base_ + offset
+             : nullptr;
+  }
+
+  std::uint32_t FileOffsetToRva(std::uint32_t file_offset) const noexcept
+  {
+    return type_ == PeFileType::Image
+             ? file_offset
+             : detail::FileOffsetToRva(headers_, file_offset);
+  }
+
+  bool Contains(void const* ptr, std::size_t len) const noexcept
+  {
+    auto const p = static_cast<std::uint8_t const*>(ptr);
+    return p >= base_ && p <= base_ + size_ &&
+           len <= static_cast<std::size_t>(base_ + size_ - p);
+  }
+
+  template <typename T> bool TryRead(void const* ptr, T& out) const noexcept
+  {
+    if (!ptr || !Contains(ptr, sizeof(T)))
+    {
+      return false;
+    }
+
+    std::memcpy(&out, ptr, sizeof(T));
+    return true;
+  }
+
+  // Strings which run into the end of the file are terminated by it.
+  // Sample: maxsecXP.exe (Corkami PE Corpus)
+  std::string ReadString(void const* ptr) const
+  {
+    if (!ptr || !Contains(ptr, 1))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{} << ErrorString{"Invalid VA."});
+    }
+
+    auto const beg = static_cast<char const*>(ptr);
+    auto const end = reinterpret_cast<char const*>(base_ + size_);
+    return std::string(beg, std::find(beg, end, '\0'));
+  }
+
+  // Every entry in AddressOfFunctions, including unused (zero) ones. Empty if
+  // the table isn't entirely inside the span.
+  PeExportFunctionTable GetExportFunctions() const noexcept
+  {
+    detail::PeExportDirectory export_dir;
+    if (!GetExportDirectory(export_dir))
+    {
+      return PeExportFunctionTable{};
+    }
+
+    auto const functions = static_cast<std::uint8_t const*>(
+      RvaToPtr(export_dir.AddressOfFunctions));
+    std::size_t const num_functions = export_dir.NumberOfFunctions;
+    if (!functions || num_functions > size_ / sizeof(std::uint32_t) ||
+        !Contains(functions, num_functions * sizeof(std::uint32_t)))
+    {
+      return PeExportFunctionTable{};
+    }
+
+    return PeExportFunctionTable{
+      detail::PeExportFunctionDecoder{functions, export_dir.Base},
+      num_functions};
+  }
+
+  // AddressOfNames and AddressOfNameOrdinals. Empty if either isn't entirely
+  // inside the span.
+  PeExportNameTable GetExportNames() const noexcept
+  {
+    detail::PeExportDirectory export_dir;
+    if (!GetExportDirectory(export_dir))
+    {
+      return PeExportNameTable{};
+    }
+
+    auto const names =
+      static_cast<std::uint8_t const*>(RvaToPtr(export_dir.AddressOfNames));
+    auto const ordinals = static_cast<std::uint8_t const*>(
+      RvaToPtr(export_dir.AddressOfNameOrdinals));
+    std::size_t const num_names = export_dir.NumberOfNames;
+    if (!num_names || !names || !ordinals ||
+        num_names > size_ / sizeof(std::uint32_t) ||
+        !Contains(names, num_names * sizeof(std::uint32_t)) ||
+        !Contains(ordinals, num_names * sizeof(std::uint16_t)))
+    {
+      return PeExportNameTable{};
+    }
+
+    return PeExportNameTable{detail::PeExportNameDecoder{names, ordinals},
+                             num_names};
+  }
+
+  // The thunks of one import descriptor, up to the terminator (or the end of
+  // the span). Thunks are read from the lookup table, or from the IAT if there
+  // isn't one.
+  PeImportThunkTable GetImportThunks(std::uint32_t original_first_thunk,
+                                     std::uint32_t first_thunk) const noexcept
+  {
+    std::uint32_t const thunk_size = Is64() ? 8 : 4;
+    std::uint32_t const lookup_rva =
+      original_first_thunk ? original_first_thunk : first_thunk;
+    auto const thunks = static_cast<std::uint8_t const*>(RvaToPtr(lookup_rva));
+    std::size_t num_thunks = 0;
+    for (auto thunk = thunks; thunk && Contains(thunk, thunk_size);
+         thunk += thunk_size, ++num_thunks)
+    {
+      std::uint64_t value = 0;
+      std::memcpy(&value, thunk, thunk_size);
+      if (!value)
+      {
+        break;
+      }
+    }
+
+    return PeImportThunkTable{
+      detail::PeImportThunkDecoder{thunks, first_thunk, thunk_size},
+      num_thunks};
+  }
+
+  // Unused (zero) entries in AddressOfFunctions are skipped, as they are by
+  // ExportList.
+  std::vector<PeViewExport> GetExports() const
+  {
+    std::vector<PeViewExport> exports;
+
+    PeExportFunctionTable const functions = GetExportFunctions();
+    if (functions.empty())
+    {
+      return exports;
+    }
+
+    // Name index for each ordinal. Where an ordinal has more than one name,
+    // the first one wins.
+    std::vector<std::uint32_t> name_rvas(functions.size());
+    std::vector<bool> has_name(functions.size());
+    for (PeExportName const name : GetExportNames())
+    {
+      if (name.ordinal < functions.size() && !has_name[name.ordinal])
+      {
+        has_name[name.ordinal] = true;
+        name_rvas[name.ordinal] = name.name_rva;
+      }
+    }
+
+    detail::PeDataDirectory const export_data_dir =
+      GetDataDirectory(PeDataDir::Export);
+    std::uint32_t const export_dir_beg = export_data_dir.VirtualAddress;
+    std::uint32_t const export_dir_end = export_dir_beg + export_data_dir.Size;
+    for (std::size_t i = 0; i < functions.size(); ++i)
+    {
+      PeExportFunction const func = functions[i];
+      if (!func.rva)
+      {
+        continue;
+      }
+
+      if (func.procedure_number > (std::numeric_limits<std::uint16_t>::max)())
+      {
+        break;
+      }
+
+      PeViewExport exp{};
+      exp.procedure_number = static_cast<std::uint16_t>(func.procedure_number);
+      if (has_name[i])
+      {
+        exp.by_name = true;
+        exp.name = ReadString(RvaToPtr(name_rvas[i]));
+      }
+
+      // Check function RVA. If it lies inside the export dir region then it's
+      // a forwarded export. Otherwise it's a regular RVA.
+      if (func.rva > export_dir_beg && func.rva < export_dir_end)
+      {
+        exp.forwarded = true;
+        exp.forwarder = ReadString(RvaToPtr(func.rva));
+        std::string::size_type const split_pos = exp.forwarder.rfind('.');
+        if (split_pos == std::string::npos)
+        {
+          HADESMEM_DETAIL_THROW_EXCEPTION(
+            Error{} << ErrorString{"Invalid forwarder string format."});
+        }
+
+        exp.forwarder_module = exp.forwarder.substr(0, split_pos);
+        exp.forwarder_function = exp.forwarder.substr(split_pos + 1);
+      }
+      else
+      {
+        exp.rva = func.rva;
+        RvaToPtr(func.rva, &exp.virtual_va);
+      }
+
+      exports.emplace_back(std::move(exp));
+    }
+
+    return exports;
+  }
+
+  // Descriptors are read until the first one without a name or IAT, in the
+  // same way as the loader (and ImportDirList).
+  // TODO: Support partially virtual descriptors (see ImportDir).
+  std::vector<PeViewImportDir> GetImports() const
+  {
+    std::vector<PeViewImportDir> import_dirs;
+
+    auto desc = static_cast<std::uint8_t const*>(
+      RvaToPtr(GetDataDirectory(PeDataDir::Import).VirtualAddress));
+    for (detail::PeImportDescriptor data; TryRead(desc, data);
+         desc += sizeof(data))
+    {
+      if (!data.Name || !data.FirstThunk)
+      {
+        break;
+      }
+
+      PeViewImportDir import_dir{data.OriginalFirstThunk,
+                                 data.TimeDateStamp,
+                                 data.ForwarderChain,
+                                 data.FirstThunk,
+                                 ReadString(RvaToPtr(data.Name)),
+                                 {}};
+
+      PeImportThunkTable const thunks =
+        GetImportThunks(data.OriginalFirstThunk, data.FirstThunk);
+      import_dir.thunks.reserve(thunks.size());
+      for (PeImportThunkEntry const thunk : thunks)
+      {
+        PeViewImportThunk import_thunk{};
+        import_thunk.iat_rva = thunk.iat_rva;
+        import_thunk.by_ordinal = thunk.by_ordinal;
+        if (thunk.by_ordinal)
+        {
+          import_thunk.ordinal = thunk.ordinal;
+        }
+        else
+        {
+          auto const by_name =
+            static_cast<std::uint8_t const*>(RvaToPtr(thunk.name_rva));
+          if (!TryRead(by_name, import_thunk.hint))
+          {
+            HADESMEM_DETAIL_THROW_EXCEPTION(
+              Error{} << ErrorString{"Invalid import by name."});
+          }
+          import_thunk.name = ReadString(by_name + sizeof(import_thunk.hint));
+        }
+
+        import_dir.thunks.emplace_back(std::move(import_thunk));
+      }
+
+      import_dirs.emplace_back(std::move(import_dir));
+    }
+
+    return import_dirs;
+  }
+
+private:
+  bool GetExportDirectory(detail::PeExportDirectory& export_dir) const noexcept
+  {
+    std::uint32_t const rva =
+      GetDataDirectory(PeDataDir::Export).VirtualAddress;
+    return rva && TryRead(RvaToPtr(rva), export_dir);
+  }
+
+  std::uint8_t const* base_;
+  std::uint32_t size_;
+  PeFileType type_;
+  detail::PeHeaders headers_;
+};
+}
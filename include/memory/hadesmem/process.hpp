@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -13,7 +14,10 @@
 
 #include <hadesmem/config.hpp>
 #include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/region_cache.hpp>
 #include <hadesmem/detail/smart_handle.hpp>
+#include <hadesmem/detail/snapshot_view.hpp>
+#include <hadesmem/detail/symbol_cache.hpp>
 #include <hadesmem/detail/trace.hpp>
 #include <hadesmem/detail/winapi.hpp>
 #include <hadesmem/error.hpp>
@@ -41,9 +45,29 @@ public:
     CheckWoW64();
   }
 
+  // A process snapshot (see process_snapshot.hpp) rather than a live process.
+  // Reads, region queries and module enumeration are all answered from the
+  // snapshot, so anything built on them (e.g. Find, PeLib, ReadString) works
+  // unchanged. The snapshot is read-only, and anything which needs a live
+  // process (e.g. writing memory, allocating memory, threads) fails.
+  explicit Process(std::shared_ptr<detail::SnapshotView const> snapshot)
+    : id_{snapshot->GetProcessId()}, snapshot_{std::move(snapshot)}
+  {
+  }
+
+  // The region and symbol caches (if enabled) start out empty in the copy.
   Process(Process const& other)
-    : handle_{DuplicateHandle(other.id_, other.handle_.GetHandle())},
-      id_{other.id_}
+    : handle_{other.snapshot_
+                ? nullptr
+                : DuplicateHandle(other.id_, other.handle_.GetHandle())},
+      id_{other.id_},
+      region_cache_{other.region_cache_
+                      ? std::make_unique<detail::RegionCache>()
+                      : nullptr},
+      symbol_cache_{other.symbol_cache_ ? CreateSymbolCache(other.IsSelf())
+                                        : nullptr},
+      trusted_buffers_{other.trusted_buffers_},
+      snapshot_{other.snapshot_}
   {
   }
 
@@ -56,9 +80,16 @@ public:
   }
 
   Process(Process&& other) noexcept : handle_{std::move(other.handle_)},
-                                      id_{other.id_}
+                                      id_{other.id_},
+                                      region_cache_{
+                                        std::move(other.region_cache_)},
+                                      symbol_cache_{
+                                        std::move(other.symbol_cache_)},
+                                      trusted_buffers_{other.trusted_buffers_},
+                                      snapshot_{std::move(other.snapshot_)}
   {
     other.id_ = 0;
+    ClearMovedSymbolCache();
   }
 
   Process& operator=(Process&& other) noexcept
@@ -67,8 +98,13 @@ public:
 
     handle_ = std::move(other.handle_);
     id_ = other.id_;
+    region_cache_ = std::move(other.region_cache_);
+    symbol_cache_ = std::move(other.symbol_cache_);
+    trusted_buffers_ = other.trusted_buffers_;
+    snapshot_ = std::move(other.snapshot_);
 
     other.id_ = 0;
+    ClearMovedSymbolCache();
 
     return *this;
   }
@@ -88,6 +124,123 @@ public:
     return handle_.GetHandle();
   }
 
+  // Reads and writes of the current process are done with a direct (guarded)
+  // memory copy, rather than a call to ReadProcessMemory or
+  // WriteProcessMemory.
+  bool IsSelf() const noexcept
+  {
+    return !snapshot_ && id_ == ::GetCurrentProcessId();
+  }
+
+  // Opt-in mode for the current process only, for when all memory accessed
+  // through this object is known to be valid and accessible (e.g. PeLib
+  // parsing a buffer we allocated ourselves). Region queries and protection
+  // changes are skipped entirely, and reads and writes become a single
+  // guarded memory copy. Accessing inaccessible memory still throws (rather
+  // than crashing), but memory which would otherwise have been temporarily
+  // reprotected (e.g. PAGE_NOACCESS or guard pages) can not be accessed.
+  void SetTrustedBufferMode(bool enabled)
+  {
+    if (enabled && !IsSelf())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Trusted buffer mode is only supported for "
+                               "the current process."});
+    }
+
+    trusted_buffers_ = enabled;
+  }
+
+  bool IsTrustedBufferMode() const noexcept
+  {
+    return trusted_buffers_;
+  }
+
+  // Opt-in cache of the regions in the target which are directly readable.
+  // Reads which land entirely inside a cached region need only a single
+  // ReadProcessMemory call, rather than querying the region and checking its
+  // protection first. Regions are cached as they are queried, and the cache is
+  // discarded if a cached read fails, or if the region map is changed through
+  // this object (e.g. Protect or Free). Call InvalidateRegionCache if it may
+  // have been changed in any other way (e.g. by the target itself) and a stale
+  // region could still be readable.
+  void SetRegionCacheEnabled(bool enabled)
+  {
+    if (!enabled)
+    {
+      region_cache_.reset();
+    }
+    else if (!region_cache_)
+    {
+      region_cache_ = std::make_unique<detail::RegionCache>();
+    }
+  }
+
+  bool IsRegionCacheEnabled() const noexcept
+  {
+    return !!region_cache_;
+  }
+
+  void InvalidateRegionCache() const noexcept
+  {
+    if (region_cache_)
+    {
+      region_cache_->Invalidate();
+    }
+  }
+
+  // Null unless the region cache is enabled.
+  detail::RegionCache* GetRegionCache() const noexcept
+  {
+    return region_cache_.get();
+  }
+
+  // Opt-in cache of the procedure addresses found by FindProcedure (and the
+  // forwarder modules it looks up along the way), keyed by module handle and
+  // name or ordinal. For the current process it is invalidated automatically
+  // whenever a module is loaded or unloaded, and InjectDll and FreeDll
+  // invalidate it for any process. For other processes each hit is checked
+  // against the module still being mapped (see detail::CheckCachedImage), but
+  // that can't catch a different module loaded at the same base, so call
+  // InvalidateSymbolCache if modules may have been loaded or unloaded in the
+  // target in any other way. Moving the Process empties the cache.
+  void SetSymbolCacheEnabled(bool enabled)
+  {
+    if (!enabled)
+    {
+      symbol_cache_.reset();
+    }
+    else if (!symbol_cache_)
+    {
+      symbol_cache_ = CreateSymbolCache(IsSelf());
+    }
+  }
+
+  bool IsSymbolCacheEnabled() const noexcept
+  {
+    return !!symbol_cache_;
+  }
+
+  void InvalidateSymbolCache() const noexcept
+  {
+    if (symbol_cache_)
+    {
+      symbol_cache_->Invalidate();
+    }
+  }
+
+  // Null unless the symbol cache is enabled.
+  detail::SymbolCache* GetSymbolCache() const noexcept
+  {
+    return symbol_cache_.get();
+  }
+
+  // Null unless this is a process snapshot.
+  detail::SnapshotView const* GetSnapshot() const noexcept
+  {
+    return snapshot_.get();
+  }
+
   void Cleanup()
   {
     if (id_ != ::GetCurrentProcessId())
@@ -100,6 +253,8 @@ public:
     }
 
     id_ = 0;
+    trusted_buffers_ = false;
+    snapshot_.reset();
   }
 
 private:
@@ -151,13 +306,39 @@ private:
              : detail::DuplicateHandle(handle).Detach();
   }
 
+  // Cached export indexes refer to the Process they were built through, which
+  // is the one the cache was just moved from.
+  void ClearMovedSymbolCache() noexcept
+  {
+    if (symbol_cache_)
+    {
+      symbol_cache_->Clear();
+    }
+  }
+
+  static std::unique_ptr<detail::SymbolCache> CreateSymbolCache(bool is_self)
+  {
+    auto symbol_cache = std::make_unique<detail::SymbolCache>();
+    if (is_self)
+    {
+      symbol_cache->RegisterDllNotification();
+    }
+    return symbol_cache;
+  }
+
   detail::SmartHandle handle_;
   DWORD id_;
+  std::unique_ptr<detail::RegionCache> region_cache_;
+  std::unique_ptr<detail::SymbolCache> symbol_cache_;
+  bool trusted_buffers_{};
+  std::shared_ptr<detail::SnapshotView const> snapshot_;
 };
 
+// A snapshot is a different process to the live process it was taken from (and
+// to other snapshots of it), so snapshot identity is part of the comparison.
 inline bool operator==(Process const& lhs, Process const& rhs) noexcept
 {
-  return lhs.GetId() == rhs.GetId();
+  return lhs.GetId() == rhs.GetId() && lhs.GetSnapshot() == rhs.GetSnapshot();
 }
 
 inline bool operator!=(Process const& lhs, Process const& rhs) noexcept
@@ -167,22 +348,28 @@ inline bool operator!=(Process const& lhs, Process const& rhs) noexcept
 
 inline bool operator<(Process const& lhs, Process const& rhs) noexcept
 {
-  return lhs.GetId() < rhs.GetId();
+  if (lhs.GetId() != rhs.GetId())
+  {
+    return lhs.GetId() < rhs.GetId();
+  }
+
+  return std::less<detail::SnapshotView const*>{}(lhs.GetSnapshot(),
+                                                  rhs.GetSnapshot());
 }
 
 inline bool operator<=(Process const& lhs, Process const& rhs) noexcept
 {
-  return lhs.GetId() <= rhs.GetId();
+  return !(rhs < lhs);
 }
 
 inline bool operator>(Process const& lhs, Process const& rhs) noexcept
 {
-  return lhs.GetId() > rhs.GetId();
+  return rhs < lhs;
 }
 
 inline bool operator>=(Process const& lhs, Process const& rhs) noexcept
 {
-  return lhs.GetId() >= rhs.GetId();
+  return !(lhs < rhs);
 }
 
 inline std::ostream& operator<<(std::ostream& lhs, Process const& rhs)
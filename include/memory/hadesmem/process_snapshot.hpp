@@ -0,0 +1,339 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+#include <winioctl.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/query_region.hpp>
+#include <hadesmem/detail/read_impl.hpp>
+#include <hadesmem/detail/smart_handle.hpp>
+#include <hadesmem/detail/snapshot_view.hpp>
+#include <hadesmem/detail/trace.hpp>
+#include <hadesmem/detail/winapi.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/module_list.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/region.hpp>
+#include <hadesmem/region_list.hpp>
+#include <hadesmem/thread_helpers.hpp>
+
+// Process snapshots. CreateProcessSnapshot copies the region map, module list
+// and every readable region of a process to a file, and OpenProcessSnapshot
+// returns a Process which reads from that file instead of a live process. All
+// the usual APIs (Read, Region, Module, Find, FindInRegions, PeLib, etc.) can
+// then be used on a consistent copy of the target, without any further cross
+// process reads, and on a different machine to the one it was taken on (as
+// long as the architecture is the same).
+
+namespace hadesmem
+{
+struct ProcessSnapshotFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    // Suspend the process while it is being captured, so that the snapshot is
+    // consistent.
+    kSuspend = 1 << 0,
+    kInvalidFlagMaxValue = 1 << 1
+  };
+};
+
+namespace detail
+{
+// Regions are captured in pieces of this size, so memory usage is bounded
+// regardless of the size of the largest region.
+enum : std::size_t
+{
+  kSnapshotChunkSize = 0x100000
+};
+
+inline void WriteSnapshotFile(HANDLE file,
+                              std::uint64_t offset,
+                              void const* data,
+                              std::size_t len)
+{
+  OVERLAPPED overlapped{};
+  overlapped.Offset = static_cast<DWORD>(offset);
+  overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+  DWORD bytes_written = 0;
+  if (!::WriteFile(file,
+                   data,
+                   static_cast<DWORD>(len),
+                   &bytes_written,
+                   &overlapped) ||
+      bytes_written != len)
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{} << ErrorString{"WriteFile failed."}
+                                            << ErrorCodeWinLast{last_error});
+  }
+}
+
+// Writes each run of pages which are not entirely zero. Zero pages are skipped
+// and left as holes in the (sparse) file.
+inline void WriteSnapshotPages(HANDLE file,
+                               std::uint64_t offset,
+                               std::uint8_t const* data,
+                               std::size_t len)
+{
+  HADESMEM_DETAIL_ASSERT(len % kSnapshotDataAlignment == 0);
+
+  std::size_t run_beg = 0;
+  for (std::size_t i = 0; i <= len; i += kSnapshotDataAlignment)
+  {
+    bool const is_zero =
+      i == len ||
+      std::find_if(data + i,
+                   data + i + kSnapshotDataAlignment,
+                   [](std::uint8_t b)
+                   {
+                     return b != 0;
+                   }) == data + i + kSnapshotDataAlignment;
+    if (is_zero)
+    {
+      if (run_beg != i)
+      {
+        WriteSnapshotFile(file, offset + run_beg, data + run_beg, i - run_beg);
+      }
+
+      run_beg = i + kSnapshotDataAlignment;
+    }
+  }
+}
+
+inline void
+  ZeroSnapshotFile(HANDLE file, std::uint64_t offset, std::uint64_t len)
+{
+  FILE_ZERO_DATA_INFORMATION zero_data{};
+  zero_data.FileOffset.QuadPart = static_cast<LONGLONG>(offset);
+  zero_data.BeyondFinalZero.QuadPart = static_cast<LONGLONG>(offset + len);
+  DWORD bytes_returned = 0;
+  if (!::DeviceIoControl(file,
+                         FSCTL_SET_ZERO_DATA,
+                         &zero_data,
+                         sizeof(zero_data),
+                         nullptr,
+                         0,
+                         &bytes_returned,
+                         nullptr))
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"DeviceIoControl failed."}
+                                    << ErrorCodeWinLast{last_error});
+  }
+}
+
+// Returns false if the region could not be read. The target may still be
+// running, so regions can be freed or reprotected after they have been
+// enumerated, which is not an error.
+inline bool WriteSnapshotRegion(Process const& process,
+                                HANDLE file,
+                                std::uint64_t offset,
+                                SnapshotRegion const& region,
+                                std::vector<std::uint8_t>& buffer)
+{
+  auto const base = static_cast<std::uintptr_t>(region.base);
+  for (std::uint64_t done = 0; done < region.size;)
+  {
+    std::size_t const len = static_cast<std::size_t>(
+      (std::min)(region.size - done, std::uint64_t{buffer.size()}));
+    if (!TryReadUnchecked(process,
+                          reinterpret_cast<void*>(base + done),
+                          buffer.data(),
+                          len))
+    {
+      // The space for this region will be reused, and the holes left for
+      // zero pages must not expose the data we have already written.
+      if (done)
+      {
+        ZeroSnapshotFile(file, offset, done);
+      }
+
+      return false;
+    }
+
+    WriteSnapshotPages(file, offset + done, buffer.data(), len);
+    done += len;
+  }
+
+  return true;
+}
+
+template <std::size_t N>
+inline void CopySnapshotString(std::wstring const& src,
+                               std::uint16_t (&dst)[N])
+{
+  std::size_t const len = (std::min)(src.size(), N - 1);
+  std::copy(std::begin(src), std::begin(src) + len, dst);
+  dst[len] = 0;
+}
+}
+
+// Only the contents of readable committed regions are captured (guard pages
+// and PAGE_NOCACHE/PAGE_WRITECOMBINE memory are skipped rather than
+// reprotected), but the metadata of every non-free region is recorded.
+// Thread state and handles are not captured.
+inline void CreateProcessSnapshot(Process const& process,
+                                  std::wstring const& path,
+                                  std::uint32_t flags =
+                                    ProcessSnapshotFlags::kNone)
+{
+  HADESMEM_DETAIL_ASSERT(flags < ProcessSnapshotFlags::kInvalidFlagMaxValue);
+
+  std::unique_ptr<SuspendedProcess> suspended_process;
+  if (!!(flags & ProcessSnapshotFlags::kSuspend))
+  {
+    suspended_process.reset(new SuspendedProcess{process.GetId()});
+  }
+
+  std::vector<detail::SnapshotRegion> regions;
+  for (auto const& region : RegionList{process})
+  {
+    if (region.GetState() == MEM_FREE)
+    {
+      continue;
+    }
+
+    regions.emplace_back(detail::SnapshotRegion{
+      reinterpret_cast<std::uintptr_t>(region.GetBase()),
+      reinterpret_cast<std::uintptr_t>(region.GetAllocBase()),
+      region.GetSize(),
+      0,
+      region.GetAllocProtect(),
+      region.GetState(),
+      region.GetProtect(),
+      region.GetType()});
+  }
+
+  std::vector<detail::SnapshotModule> modules;
+  for (auto const& module : ModuleList{process})
+  {
+    detail::SnapshotModule snapshot_module{};
+    snapshot_module.base =
+      reinterpret_cast<std::uintptr_t>(module.GetHandle());
+    snapshot_module.size = module.GetSize();
+    detail::CopySnapshotString(module.GetName(), snapshot_module.name);
+    detail::CopySnapshotString(module.GetPath(), snapshot_module.path);
+    modules.emplace_back(snapshot_module);
+  }
+
+  detail::SmartFileHandle const file{::CreateFileW(path.c_str(),
+                                                   GENERIC_READ | GENERIC_WRITE,
+                                                   0,
+                                                   nullptr,
+                                                   CREATE_ALWAYS,
+                                                   FILE_ATTRIBUTE_NORMAL,
+                                                   nullptr)};
+  if (!file.IsValid())
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"CreateFileW failed."}
+                                    << ErrorCodeWinLast{last_error});
+  }
+
+  // Not all file systems support sparse files (e.g. FAT), in which case the
+  // zero pages simply take up space.
+  DWORD bytes_returned = 0;
+  if (!::DeviceIoControl(file.GetHandle(),
+                         FSCTL_SET_SPARSE,
+                         nullptr,
+                         0,
+                         nullptr,
+                         0,
+                         &bytes_returned,
+                         nullptr))
+  {
+    HADESMEM_DETAIL_TRACE_FORMAT_A("Failed to make snapshot file sparse. "
+                                   "LastError: [%lu].",
+                                   ::GetLastError());
+  }
+
+  std::uint64_t const tables_size =
+    sizeof(detail::SnapshotHeader) +
+    regions.size() * sizeof(detail::SnapshotRegion) +
+    modules.size() * sizeof(detail::SnapshotModule);
+  std::uint64_t offset = (tables_size + detail::kSnapshotDataAlignment - 1) &
+                         ~std::uint64_t{detail::kSnapshotDataAlignment - 1};
+  std::vector<std::uint8_t> buffer(detail::kSnapshotChunkSize);
+  for (auto& region : regions)
+  {
+    MEMORY_BASIC_INFORMATION mbi{};
+    mbi.State = region.state;
+    mbi.Protect = region.protect;
+    if (!detail::CanRead(mbi) || detail::IsBadProtect(mbi))
+    {
+      continue;
+    }
+
+    if (detail::WriteSnapshotRegion(
+          process, file.GetHandle(), offset, region, buffer))
+    {
+      region.data_offset = offset;
+      offset += region.size;
+    }
+  }
+
+  detail::SnapshotHeader const header{
+    detail::kSnapshotMagic,
+    detail::kSnapshotVersion,
+    static_cast<std::uint32_t>(sizeof(void*)),
+    process.GetId(),
+    static_cast<std::uint32_t>(regions.size()),
+    static_cast<std::uint32_t>(modules.size()),
+    reinterpret_cast<std::uintptr_t>(
+      detail::GetSystemInfo().lpMaximumApplicationAddress),
+    offset};
+  std::vector<std::uint8_t> tables(static_cast<std::size_t>(tables_size));
+  auto cur = tables.data();
+  std::memcpy(cur, &header, sizeof(header));
+  cur += sizeof(header);
+  if (!regions.empty())
+  {
+    std::memcpy(
+      cur, regions.data(), regions.size() * sizeof(detail::SnapshotRegion));
+    cur += regions.size() * sizeof(detail::SnapshotRegion);
+  }
+  if (!modules.empty())
+  {
+    std::memcpy(
+      cur, modules.data(), modules.size() * sizeof(detail::SnapshotModule));
+  }
+  detail::WriteSnapshotFile(file.GetHandle(), 0, tables.data(), tables.size());
+
+  // Trailing zero pages were never written, so the file may be too short.
+  LARGE_INTEGER end{};
+  end.QuadPart = static_cast<LONGLONG>(offset);
+  if (!::SetFilePointerEx(file.GetHandle(), end, nullptr, FILE_BEGIN) ||
+      !::SetEndOfFile(file.GetHandle()))
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"SetEndOfFile failed."}
+                                    << ErrorCodeWinLast{last_error});
+  }
+}
+
+// The file is mapped rather than read, so opening even a very large snapshot
+// is cheap, and only the pages which are actually accessed are loaded.
+inline Process OpenProcessSnapshot(std::wstring const& path)
+{
+  return Process{std::make_shared<detail::SnapshotView const>(path)};
+}
+}
@@ -3,8 +3,11 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <exception>
 #include <iterator>
 #include <memory>
@@ -15,9 +18,11 @@
 #include <windows.h>
 
 #include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/find_terminator.hpp>
 #include <hadesmem/detail/protect_guard.hpp>
 #include <hadesmem/detail/query_region.hpp>
 #include <hadesmem/detail/read_impl.hpp>
+#include <hadesmem/detail/scratch_buffer.hpp>
 #include <hadesmem/detail/static_assert.hpp>
 #include <hadesmem/detail/type_traits.hpp>
 #include <hadesmem/error.hpp>
@@ -31,6 +36,9 @@ template <typename T> struct ReadStringTraits
 {
   // 4KB default chunk size
   static std::size_t const kChunkLen = 0x1000;
+  // Size of the first chunk read, which is then doubled for each subsequent
+  // chunk until it reaches the chunk size.
+  static std::size_t const kInitialChunkLen = 0x40;
 };
 }
 
@@ -83,6 +91,54 @@ inline void
   std::copy(std::begin(data), std::end(data), out);
 }
 
+namespace detail
+{
+// Per-thread scratch buffer for reads whose size isn't known up front (e.g.
+// strings), so that reading lots of short strings doesn't allocate.
+inline ScratchBuffer& GetReadStringScratch()
+{
+  thread_local ScratchBuffer scratch;
+  return scratch;
+}
+
+// Reads characters in chunks (growing exponentially from 'chunk_len' up to
+// 'max_chunk_len') from 'cur' until a terminator is found or 'end' is
+// reached. Returns true if a terminator was found. The caller is responsible
+// for ensuring all the memory in [cur, end) is readable.
+template <typename T, typename OutputIterator>
+bool ReadStringChunks(Process const& process,
+                      T*& cur,
+                      std::uintptr_t end,
+                      OutputIterator& data,
+                      std::size_t& chunk_len,
+                      std::size_t max_chunk_len)
+{
+  ScopedScratch scratch{GetReadStringScratch()};
+  while (reinterpret_cast<std::uintptr_t>(cur) + sizeof(T) <= end)
+  {
+    std::size_t const len = (std::min)(
+      chunk_len,
+      static_cast<std::size_t>((end - reinterpret_cast<std::uintptr_t>(cur)) /
+                               sizeof(T)));
+    chunk_len = (std::min)(chunk_len * 2, max_chunk_len);
+
+    auto const buf = reinterpret_cast<T*>(scratch.Get(len * sizeof(T)));
+    ReadUnchecked(process, cur, buf, len * sizeof(T));
+
+    T const* const terminator = FindTerminator<T>(buf, buf + len);
+    data = std::copy<T const*>(buf, terminator, data);
+    cur += len;
+
+    if (terminator != buf + len)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+}
+
 template <typename T, typename OutputIterator>
 void ReadStringEx(Process const& process,
                   PVOID address,
@@ -97,6 +153,41 @@ void ReadStringEx(Process const& process,
 
   HADESMEM_DETAIL_ASSERT(chunk_len != 0);
 
+  // Most strings are short (e.g. import and export names), so start with a
+  // small read and only grow it if the string turns out to be longer.
+  std::size_t cur_chunk_len = (std::min)(
+    chunk_len, std::size_t{detail::ReadStringTraits<T>::kInitialChunkLen});
+  auto const bound = upper_bound
+                       ? reinterpret_cast<std::uintptr_t>(upper_bound)
+                       : ~static_cast<std::uintptr_t>(0);
+
+  if (process.IsTrustedBufferMode())
+  {
+    // There are no regions to bound each read by, so never read past the end
+    // of the current page (the granularity of page protection) in one go, in
+    // case the string is terminated right before an inaccessible page.
+    std::uintptr_t const kPageSize = 0x1000;
+    auto cur = static_cast<T*>(address);
+    for (;;)
+    {
+      auto const cur_raw = reinterpret_cast<std::uintptr_t>(cur);
+      if (cur_raw + sizeof(T) > bound)
+      {
+        return;
+      }
+
+      // A misaligned character may straddle two pages.
+      std::uintptr_t const page_end = (cur_raw | (kPageSize - 1)) + 1;
+      std::uintptr_t const end = (std::min)(
+        (std::max)(page_end, cur_raw + sizeof(T)), bound);
+      if (detail::ReadStringChunks(
+            process, cur, end, data, cur_chunk_len, chunk_len))
+      {
+        return;
+      }
+    }
+  }
+
   for (;;)
   {
     detail::ProtectGuard protect_guard{
@@ -110,27 +201,16 @@ void ReadStringEx(Process const& process,
                                 : region_next_real;
 
     T* cur = static_cast<T*>(address);
-    while (cur + 1 <= region_next)
+    if (detail::ReadStringChunks(process,
+                                 cur,
+                                 reinterpret_cast<std::uintptr_t>(region_next),
+                                 data,
+                                 cur_chunk_len,
+                                 chunk_len) ||
+        region_next == upper_bound)
     {
-      std::size_t const len_to_end = reinterpret_cast<DWORD_PTR>(region_next) -
-                                     reinterpret_cast<DWORD_PTR>(cur);
-      std::size_t const buf_len_bytes =
-        (std::min)(chunk_len * sizeof(T), len_to_end);
-      std::size_t const buf_len = buf_len_bytes / sizeof(T);
-
-      std::vector<T> buf(buf_len);
-      detail::ReadUnchecked(process, cur, buf.data(), buf.size() * sizeof(T));
-
-      auto const iter = std::find(std::begin(buf), std::end(buf), T());
-      std::copy(std::begin(buf), iter, data);
-
-      if (iter != std::end(buf) || region_next == upper_bound)
-      {
-        protect_guard.Restore();
-        return;
-      }
-
-      cur += buf_len;
+      protect_guard.Restore();
+      return;
     }
 
     address = region_next;
@@ -197,6 +277,28 @@ std::basic_string<T, Traits, Alloc> ReadString(Process const& process,
     process, address, detail::ReadStringTraits<T>::kChunkLen);
 }
 
+// Reads into a caller-supplied buffer, e.g. one which is reused across calls
+// to avoid allocating (and zeroing) a new vector every time.
+template <typename T>
+inline void ReadSpan(Process const& process,
+                     PVOID address,
+                     T* data,
+                     std::size_t count,
+                     std::uint32_t flags = ReadFlags::kNone)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(detail::IsTriviallyCopyable<T>::value);
+
+  HADESMEM_DETAIL_ASSERT(count ? address != nullptr : true);
+  HADESMEM_DETAIL_ASSERT(count ? data != nullptr : true);
+
+  if (!count)
+  {
+    return;
+  }
+
+  detail::ReadImpl(process, address, data, sizeof(T) * count, flags);
+}
+
 template <typename T, typename Alloc = std::allocator<T>>
 inline std::vector<T, Alloc> ReadVectorEx(Process const& process,
                                           PVOID address,
@@ -265,4 +367,155 @@ inline void ReadVector(Process const& process,
 
   return ReadVectorEx<T>(process, address, count, out, ReadFlags::kNone);
 }
+
+// Single read in a batch. 'error' is set by ReadBatch (null on success).
+struct ReadRequest
+{
+  PVOID address;
+  std::size_t size;
+  void* data;
+  std::exception_ptr error;
+};
+
+namespace detail
+{
+// Requests are only merged into a single read if the result would be no
+// larger than this, so a few far apart requests can't turn into one huge read.
+enum : std::size_t
+{
+  kReadBatchMaxSpan = 0x10000
+};
+
+inline void ReadRequestsIndividually(Process const& process,
+                                     ReadRequest* const* beg,
+                                     ReadRequest* const* end,
+                                     std::uint32_t flags)
+{
+  for (auto cur = beg; cur != end; ++cur)
+  {
+    ReadRequest& request = **cur;
+    try
+    {
+      ReadImpl(process, request.address, request.data, request.size, flags);
+      request.error = nullptr;
+    }
+    catch (...)
+    {
+      request.error = std::current_exception();
+    }
+  }
+}
+}
+
+// Reads many (typically small and scattered) ranges with as few underlying
+// reads as possible. Requests are sorted by address, and requests which
+// overlap or are separated by no more than 'max_gap' bytes are serviced by a
+// single read (the bytes in the gaps are read and discarded). If a merged read
+// fails (e.g. because a gap contains an inaccessible page), its requests are
+// retried individually. Failures are reported per request rather than thrown,
+// and the return value is the number of requests which failed.
+inline std::size_t ReadBatch(Process const& process,
+                             ReadRequest* requests,
+                             std::size_t count,
+                             std::size_t max_gap = 0x100,
+                             std::uint32_t flags = ReadFlags::kNone)
+{
+  HADESMEM_DETAIL_ASSERT(count ? requests != nullptr : true);
+
+  std::vector<ReadRequest*> sorted;
+  sorted.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    HADESMEM_DETAIL_ASSERT(requests[i].size ? requests[i].data != nullptr
+                                            : true);
+
+    requests[i].error = nullptr;
+    if (requests[i].size)
+    {
+      sorted.emplace_back(&requests[i]);
+    }
+  }
+
+  std::sort(std::begin(sorted),
+            std::end(sorted),
+            [](ReadRequest const* lhs, ReadRequest const* rhs)
+            {
+              return lhs->address < rhs->address;
+            });
+
+  auto const get_beg = [](ReadRequest const* request)
+  {
+    return reinterpret_cast<std::uintptr_t>(request->address);
+  };
+  auto const get_end = [](ReadRequest const* request)
+  {
+    return reinterpret_cast<std::uintptr_t>(request->address) + request->size;
+  };
+
+  std::vector<std::uint8_t> buffer;
+  for (auto group_beg = sorted.data(), sorted_end = group_beg + sorted.size();
+       group_beg != sorted_end;)
+  {
+    std::uintptr_t const span_beg = get_beg(*group_beg);
+    std::uintptr_t span_end = get_end(*group_beg);
+    auto group_end = group_beg + 1;
+    for (; group_end != sorted_end; ++group_end)
+    {
+      std::uintptr_t const beg = get_beg(*group_end);
+      std::uintptr_t const end = (std::max)(span_end, get_end(*group_end));
+      if ((beg > span_end && beg - span_end > max_gap) ||
+          end - span_beg > detail::kReadBatchMaxSpan)
+      {
+        break;
+      }
+
+      span_end = end;
+    }
+
+    if (group_end - group_beg == 1)
+    {
+      detail::ReadRequestsIndividually(process, group_beg, group_end, flags);
+      group_beg = group_end;
+      continue;
+    }
+
+    buffer.resize(static_cast<std::size_t>(span_end - span_beg));
+    try
+    {
+      detail::ReadImpl(process,
+                       reinterpret_cast<void*>(span_beg),
+                       buffer.data(),
+                       buffer.size(),
+                       flags);
+      for (auto cur = group_beg; cur != group_end; ++cur)
+      {
+        auto const offset = static_cast<std::size_t>(get_beg(*cur) - span_beg);
+        std::memcpy((*cur)->data, buffer.data() + offset, (*cur)->size);
+      }
+    }
+    catch (...)
+    {
+      detail::ReadRequestsIndividually(process, group_beg, group_end, flags);
+    }
+
+    group_beg = group_end;
+  }
+
+  return static_cast<std::size_t>(
+    std::count_if(requests,
+                  requests + count,
+                  [](ReadRequest const& request)
+                  {
+                    return !!request.error;
+                  }));
+}
+
+inline std::size_t ReadBatch(Process const& process,
+                             std::vector<ReadRequest>& requests,
+                             std::size_t max_gap = 0x100,
+                             std::uint32_t flags = ReadFlags::kNone)
+{
+  return ReadBatch(
+    process, requests.data(), requests.size(), max_gap, flags);
+}
 }
@@ -0,0 +1,385 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/read_impl.hpp>
+#include <hadesmem/detail/trace.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+
+namespace hadesmem
+{
+class ReadPipelineIterator;
+
+struct ReadPipelineRange
+{
+  void* base;
+  std::size_t size;
+};
+
+struct ReadPipelineChunk
+{
+  // Address in the target of the first byte of the chunk.
+  std::uint8_t* beg;
+  // End of the part of the range which belongs to this chunk. The data is
+  // extended past it (up to 'read_end') by the overlap given to the pipeline,
+  // so that e.g. matches which cross the chunk boundary can still be found.
+  std::uint8_t* end;
+  std::uint8_t* read_end;
+  // Local copy of [beg, read_end), or nullptr if the chunk could not be read.
+  // The target is still running, so memory can be freed or reprotected after
+  // the ranges were built, which is not an error.
+  std::uint8_t const* data;
+  // Index of the range the chunk belongs to.
+  std::size_t range;
+};
+
+namespace detail
+{
+enum : std::size_t
+{
+  kReadPipelineDefaultChunkSize = 1024 * 1024,
+  kReadPipelineDefaultNumBuffers = 3,
+  kReadPipelineDefaultNumThreads = 2
+};
+}
+
+// Reads a list of (potentially huge) ranges in fixed size chunks on a small
+// pool of worker threads, so that reading the next chunks overlaps with the
+// caller processing the current one. Chunks are returned in order. Only
+// 'num_buffers' chunks are ever in memory at once (the one being processed
+// and those being read ahead), so memory usage is bounded regardless of the
+// size of the ranges.
+// Memory is read as-is, without querying or changing its protection (doing so
+// from multiple threads at once would race), so the ranges should only cover
+// memory which is readable (e.g. regions filtered with CanRead).
+// Chunks are consumed through Next, ForEach or an input iterator, all of which
+// must only be used from a single thread. The data for a chunk is only valid
+// until the next chunk is requested.
+class ReadPipeline
+{
+public:
+  explicit ReadPipeline(
+    Process const& process,
+    std::vector<ReadPipelineRange> const& ranges,
+    std::size_t chunk_size = detail::kReadPipelineDefaultChunkSize,
+    std::size_t overlap = 0,
+    std::size_t num_buffers = detail::kReadPipelineDefaultNumBuffers,
+    std::size_t num_threads = detail::kReadPipelineDefaultNumThreads)
+    : process_{&process}, buffer_size_{chunk_size + overlap}
+  {
+    HADESMEM_DETAIL_ASSERT(chunk_size != 0);
+    HADESMEM_DETAIL_ASSERT(num_buffers != 0);
+    HADESMEM_DETAIL_ASSERT(num_threads != 0);
+
+    for (std::size_t i = 0; i < ranges.size(); ++i)
+    {
+      auto const beg = static_cast<std::uint8_t*>(ranges[i].base);
+      auto const end = beg + ranges[i].size;
+      for (auto cur = beg; cur < end;)
+      {
+        auto const chunk_end =
+          cur + (std::min)(static_cast<std::size_t>(end - cur), chunk_size);
+        auto const read_end =
+          chunk_end +
+          (std::min)(static_cast<std::size_t>(end - chunk_end), overlap);
+        chunks_.emplace_back(ChunkInfo{cur, chunk_end, read_end, i});
+        cur = chunk_end;
+      }
+    }
+
+    // Buffers are only allocated (and threads only started) if there's
+    // actually something to read.
+    num_buffers = (std::min)(num_buffers, chunks_.size());
+    slots_.resize(num_buffers);
+    for (auto& slot : slots_)
+    {
+      slot.buffer.reset(new std::uint8_t[buffer_size_]);
+    }
+
+    num_threads = (std::min)(num_threads, num_buffers);
+    try
+    {
+      for (std::size_t i = 0; i < num_threads; ++i)
+      {
+        threads_.emplace_back(&ReadPipeline::ReadMain, this);
+      }
+    }
+    catch (...)
+    {
+      Stop();
+      throw;
+    }
+  }
+
+  explicit ReadPipeline(Process const&& process,
+                        std::vector<ReadPipelineRange> const& ranges,
+                        std::size_t chunk_size,
+                        std::size_t overlap,
+                        std::size_t num_buffers,
+                        std::size_t num_threads) = delete;
+
+  ReadPipeline(ReadPipeline const& other) = delete;
+
+  ReadPipeline& operator=(ReadPipeline const& other) = delete;
+
+  ~ReadPipeline()
+  {
+    Stop();
+  }
+
+  std::size_t GetNumChunks() const noexcept
+  {
+    return chunks_.size();
+  }
+
+  // Blocks until the next chunk has been read. Returns false once every chunk
+  // has been returned.
+  bool Next(ReadPipelineChunk& chunk)
+  {
+    std::unique_lock<std::mutex> lock{mutex_};
+
+    // The previous chunk is no longer in use, so its buffer can be reused.
+    if (released_ != next_consume_)
+    {
+      released_ = next_consume_;
+      read_condition_.notify_all();
+    }
+
+    if (next_consume_ == chunks_.size())
+    {
+      return false;
+    }
+
+    Slot& slot = slots_[next_consume_ % slots_.size()];
+    while (slot.chunk != next_consume_)
+    {
+      ready_condition_.wait(lock);
+    }
+
+    ChunkInfo const& info = chunks_[next_consume_];
+    chunk.beg = info.beg;
+    chunk.end = info.end;
+    chunk.read_end = info.read_end;
+    chunk.data = slot.valid ? slot.buffer.get() : nullptr;
+    chunk.range = info.range;
+    ++next_consume_;
+
+    return true;
+  }
+
+  // Single pass only, as chunks are discarded once they have been consumed.
+  ReadPipelineIterator begin();
+
+  ReadPipelineIterator end() noexcept;
+
+  // Stops early (without reading any more chunks) if the callback returns
+  // false.
+  template <typename Func> void ForEach(Func func)
+  {
+    ReadPipelineChunk chunk;
+    while (Next(chunk))
+    {
+      if (!func(chunk))
+      {
+        break;
+      }
+    }
+  }
+
+private:
+  struct ChunkInfo
+  {
+    std::uint8_t* beg;
+    std::uint8_t* end;
+    std::uint8_t* read_end;
+    std::size_t range;
+  };
+
+  struct Slot
+  {
+    std::unique_ptr<std::uint8_t[]> buffer;
+    // Index of the chunk which has been read into the buffer.
+    std::size_t chunk{(std::numeric_limits<std::size_t>::max)()};
+    bool valid{};
+  };
+
+  void ReadMain()
+  {
+    for (;;)
+    {
+      std::size_t i = 0;
+      {
+        // A chunk can only be read once the chunk which previously used the
+        // same buffer has been released by the consumer.
+        std::unique_lock<std::mutex> lock{mutex_};
+        while (!stop_ && next_read_ < chunks_.size() &&
+               next_read_ >= released_ + slots_.size())
+        {
+          read_condition_.wait(lock);
+        }
+
+        if (stop_ || next_read_ == chunks_.size())
+        {
+          return;
+        }
+
+        i = next_read_++;
+      }
+
+      ChunkInfo const& info = chunks_[i];
+      Slot& slot = slots_[i % slots_.size()];
+      bool valid = true;
+      try
+      {
+        detail::ReadUnchecked(
+          *process_,
+          info.beg,
+          slot.buffer.get(),
+          static_cast<std::size_t>(info.read_end - info.beg));
+      }
+      catch (...)
+      {
+        HADESMEM_DETAIL_TRACE_A(
+          boost::current_exception_diagnostic_information().c_str());
+        valid = false;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        slot.chunk = i;
+        slot.valid = valid;
+      }
+      ready_condition_.notify_one();
+    }
+  }
+
+  void Stop() noexcept
+  {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      stop_ = true;
+    }
+    read_condition_.notify_all();
+
+    for (auto& thread : threads_)
+    {
+      thread.join();
+    }
+    threads_.clear();
+  }
+
+  Process const* process_;
+  std::size_t buffer_size_;
+  std::vector<ChunkInfo> chunks_;
+  std::vector<Slot> slots_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable read_condition_;
+  std::condition_variable ready_condition_;
+  bool stop_{};
+  std::size_t next_read_{};
+  std::size_t next_consume_{};
+  // Every chunk before this one has been released by the consumer.
+  std::size_t released_{};
+};
+
+class ReadPipelineIterator
+  : public std::iterator<std::input_iterator_tag, ReadPipelineChunk>
+{
+public:
+  using BaseIteratorT =
+    std::iterator<std::input_iterator_tag, ReadPipelineChunk>;
+  using value_type = BaseIteratorT::value_type;
+  using difference_type = BaseIteratorT::difference_type;
+  using pointer = BaseIteratorT::pointer;
+  using reference = BaseIteratorT::reference;
+  using iterator_category = BaseIteratorT::iterator_category;
+
+  constexpr ReadPipelineIterator() noexcept
+  {
+  }
+
+  explicit ReadPipelineIterator(ReadPipeline& pipeline) : pipeline_{&pipeline}
+  {
+    Advance();
+  }
+
+  reference operator*() const noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(pipeline_);
+    return chunk_;
+  }
+
+  pointer operator->() const noexcept
+  {
+    HADESMEM_DETAIL_ASSERT(pipeline_);
+    return &chunk_;
+  }
+
+  ReadPipelineIterator& operator++()
+  {
+    HADESMEM_DETAIL_ASSERT(pipeline_);
+
+    Advance();
+
+    return *this;
+  }
+
+  ReadPipelineIterator operator++(int)
+  {
+    ReadPipelineIterator const iter{*this};
+    ++*this;
+    return iter;
+  }
+
+  bool operator==(ReadPipelineIterator const& other) const noexcept
+  {
+    return pipeline_ == other.pipeline_;
+  }
+
+  bool operator!=(ReadPipelineIterator const& other) const noexcept
+  {
+    return !(*this == other);
+  }
+
+private:
+  void Advance()
+  {
+    if (!pipeline_->Next(chunk_))
+    {
+      pipeline_ = nullptr;
+    }
+  }
+
+  ReadPipeline* pipeline_{};
+  mutable ReadPipelineChunk chunk_{};
+};
+
+inline ReadPipelineIterator ReadPipeline::begin()
+{
+  return ReadPipelineIterator{*this};
+}
+
+inline ReadPipelineIterator ReadPipeline::end() noexcept
+{
+  return ReadPipelineIterator{};
+}
+}
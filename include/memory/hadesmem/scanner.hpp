@@ -3,17 +3,39 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/compiled_pattern.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/parallel_for.hpp>
+#include <hadesmem/detail/pattern_search.hpp>
+#include <hadesmem/detail/query_region.hpp>
+#include <hadesmem/detail/read_impl.hpp>
+#include <hadesmem/detail/scratch_buffer.hpp>
+#include <hadesmem/detail/trace.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read_pipeline.hpp>
+#include <hadesmem/region.hpp>
+#include <hadesmem/region_list.hpp>
+
 // TODO: Implement this.
 // TODO: Use process reflection on Windows 7 + for scanning while process is suspended. (RtlCreateProcessReflection)
 //  Requires extra privileges though Make it optional?
 //  There's newer and better APIs available on W8+. PSS? ProcDump supports them all I think...
 //  PSS doesn't support large pages, so can't be used against e.g.SQL.
-// TODO: Use a file view with a small memory cache rather than consuming large amounts of RAM.
 // TODO: Multi-threaded scanning options.
 // TODO: Wildcard support for vector/string scanning.
 // TODO: Regex support for string scanning.
-// TODO: Memory protection filters(read, write, exec).
-// TODO: Memory type filters(private, mapped, image).
 // TODO: Support pausing target while scanning.
 // TODO: Support injected scanning.
 // TODO: Configurable scan buffer size.
@@ -26,3 +48,470 @@
 // TODO: Custom scanning via user supplied predicate.
 // TODO: Improved floating point support (configurable or 'smart' epsilon).
 // TODO: Group search support.
+
+namespace hadesmem
+{
+struct RegionProtectFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    kRead = 1 << 0,
+    kWrite = 1 << 1,
+    kExecute = 1 << 2,
+    kInvalidFlagMaxValue = 1 << 3
+  };
+};
+
+struct RegionTypeFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    kPrivate = 1 << 0,
+    kMapped = 1 << 1,
+    kImage = 1 << 2,
+    kAll = kPrivate | kMapped | kImage,
+    kInvalidFlagMaxValue = 1 << 3
+  };
+};
+
+struct RegionStateFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    kCommit = 1 << 0,
+    kReserve = 1 << 1,
+    kAll = kCommit | kReserve,
+    kInvalidFlagMaxValue = 1 << 2
+  };
+};
+
+// Selects regions by protection, type (MEM_PRIVATE etc.) and state (MEM_COMMIT
+// etc.). A region matches if it has every protection in 'protect', none of the
+// protections in 'protect_excluded', and one of the given types and states.
+// Free regions never match.
+class RegionFilter
+{
+public:
+  explicit RegionFilter(
+    std::uint32_t protect = RegionProtectFlags::kRead,
+    std::uint32_t protect_excluded = RegionProtectFlags::kNone,
+    std::uint32_t types = RegionTypeFlags::kAll,
+    std::uint32_t states = RegionStateFlags::kCommit) noexcept
+    : protect_{protect},
+      protect_excluded_{protect_excluded},
+      types_{types},
+      states_{states}
+  {
+    HADESMEM_DETAIL_ASSERT(
+      !(protect & ~(RegionProtectFlags::kInvalidFlagMaxValue - 1UL)));
+    HADESMEM_DETAIL_ASSERT(
+      !(protect_excluded & ~(RegionProtectFlags::kInvalidFlagMaxValue - 1UL)));
+    HADESMEM_DETAIL_ASSERT(
+      !(types & ~(RegionTypeFlags::kInvalidFlagMaxValue - 1UL)));
+    HADESMEM_DETAIL_ASSERT(
+      !(states & ~(RegionStateFlags::kInvalidFlagMaxValue - 1UL)));
+  }
+
+  std::uint32_t GetProtect() const noexcept
+  {
+    return protect_;
+  }
+
+  std::uint32_t GetProtectExcluded() const noexcept
+  {
+    return protect_excluded_;
+  }
+
+  std::uint32_t GetTypes() const noexcept
+  {
+    return types_;
+  }
+
+  std::uint32_t GetStates() const noexcept
+  {
+    return states_;
+  }
+
+  bool Matches(MEMORY_BASIC_INFORMATION const& mbi) const noexcept
+  {
+    std::uint32_t const protect =
+      (detail::CanRead(mbi) ? RegionProtectFlags::kRead : 0U) |
+      (detail::CanWrite(mbi) ? RegionProtectFlags::kWrite : 0U) |
+      (detail::CanExecute(mbi) ? RegionProtectFlags::kExecute : 0U);
+
+    std::uint32_t type = RegionTypeFlags::kNone;
+    switch (mbi.Type)
+    {
+    case MEM_PRIVATE:
+      type = RegionTypeFlags::kPrivate;
+      break;
+    case MEM_MAPPED:
+      type = RegionTypeFlags::kMapped;
+      break;
+    case MEM_IMAGE:
+      type = RegionTypeFlags::kImage;
+      break;
+    }
+
+    std::uint32_t state = RegionStateFlags::kNone;
+    switch (mbi.State)
+    {
+    case MEM_COMMIT:
+      state = RegionStateFlags::kCommit;
+      break;
+    case MEM_RESERVE:
+      state = RegionStateFlags::kReserve;
+      break;
+    }
+
+    return (protect & protect_) == protect_ &&
+           !(protect & protect_excluded_) && !!(type & types_) &&
+           !!(state & states_);
+  }
+
+  bool Matches(Region const& region) const noexcept
+  {
+    MEMORY_BASIC_INFORMATION mbi{};
+    mbi.Protect = region.GetProtect();
+    mbi.Type = region.GetType();
+    mbi.State = region.GetState();
+    return Matches(mbi);
+  }
+
+private:
+  std::uint32_t protect_;
+  std::uint32_t protect_excluded_;
+  std::uint32_t types_;
+  std::uint32_t states_;
+};
+
+namespace detail
+{
+// Regions are scanned in pieces of this size, so memory usage is bounded by
+// the number of threads rather than the size of the largest region.
+enum : std::size_t
+{
+  kRegionScanChunkSize = 1024 * 1024
+};
+
+struct RegionScanChunk
+{
+  std::uint8_t* beg;
+  // Matches must start before this address to belong to the chunk.
+  std::uint8_t* end;
+  // Extended into the next chunk of the same region by the pattern length minus
+  // one, so matches which cross the chunk boundary are still found.
+  std::uint8_t* read_end;
+};
+
+inline std::vector<ReadPipelineRange>
+  GetRegionScanRanges(Process const& process, RegionFilter const& filter)
+{
+  std::vector<ReadPipelineRange> ranges;
+  RegionList const regions{process};
+  for (auto const& region : regions)
+  {
+    // Guard pages can't be read without side effects, so they're skipped even
+    // if the filter allows them.
+    MEMORY_BASIC_INFORMATION mbi{};
+    mbi.Protect = region.GetProtect();
+    mbi.Type = region.GetType();
+    mbi.State = region.GetState();
+    if (!filter.Matches(mbi) || !CanRead(mbi) || IsGuard(mbi))
+    {
+      continue;
+    }
+
+    ranges.emplace_back(ReadPipelineRange{region.GetBase(), region.GetSize()});
+  }
+
+  return ranges;
+}
+
+inline std::vector<RegionScanChunk>
+  GetRegionScanChunks(Process const& process,
+                      RegionFilter const& filter,
+                      std::size_t overlap)
+{
+  std::vector<RegionScanChunk> chunks;
+  for (auto const& range : GetRegionScanRanges(process, filter))
+  {
+    auto const beg = static_cast<std::uint8_t*>(range.base);
+    auto const end = beg + range.size;
+    for (auto cur = beg; cur < end;)
+    {
+      auto const chunk_end =
+        cur + (std::min)(static_cast<std::size_t>(end - cur),
+                         static_cast<std::size_t>(kRegionScanChunkSize));
+      auto const read_end =
+        chunk_end +
+        (std::min)(static_cast<std::size_t>(end - chunk_end), overlap);
+      chunks.emplace_back(RegionScanChunk{cur, chunk_end, read_end});
+      cur = chunk_end;
+    }
+  }
+
+  return chunks;
+}
+
+// Reads the chunk into the calling thread's scan scratch buffer, so each
+// worker thread reuses the same memory for every chunk it scans. The data is
+// only valid for the lifetime of 'scratch'.
+// Returns nullptr if the chunk could not be read. The target is still running,
+// so regions can be freed or reprotected after they have been enumerated,
+// which is not an error.
+inline std::uint8_t const* ReadRegionScanChunk(Process const& process,
+                                               RegionScanChunk const& chunk,
+                                               ScopedScratch& scratch)
+{
+  auto const size = static_cast<std::size_t>(chunk.read_end - chunk.beg);
+  auto const buffer = scratch.Get(size);
+  try
+  {
+    ReadUnchecked(process, chunk.beg, buffer, size);
+  }
+  catch (Error const& /*e*/)
+  {
+    HADESMEM_DETAIL_TRACE_A(
+      boost::current_exception_diagnostic_information().c_str());
+    return nullptr;
+  }
+
+  return buffer;
+}
+
+// Chunks are scanned in order on the calling thread, while the following
+// chunks are read in the background. Stops early if the callback returns
+// false.
+template <typename Func>
+void ScanRegionsPipelined(Process const& process,
+                          RegionFilter const& filter,
+                          std::size_t overlap,
+                          Func func)
+{
+  ReadPipeline pipeline{process,
+                        GetRegionScanRanges(process, filter),
+                        kRegionScanChunkSize,
+                        overlap};
+  pipeline.ForEach([&](ReadPipelineChunk const& chunk)
+                   {
+                     return !chunk.data || func(chunk);
+                   });
+}
+}
+
+// Searches every region of the target which matches the filter (rather than
+// just the sections of a single module), e.g. to find JIT compiled code or
+// shellcode on the heap. Regions are read in bounded chunks, and if
+// PatternFlags::kParallel is specified the chunks are scanned on multiple
+// threads (otherwise they're scanned in order on the calling thread, with the
+// next chunks being read in the background). Matches which span two regions
+// are not found.
+
+// Of the PatternFlags, only kThrowOnUnmatch and kParallel have any effect.
+
+// Returns the match with the lowest address.
+inline void* FindInRegions(Process const& process,
+                           CompiledPattern const& data,
+                           RegionFilter const& filter,
+                           std::uint32_t flags)
+{
+  HADESMEM_DETAIL_ASSERT(
+    !(flags & ~(PatternFlags::kInvalidFlagMaxValue - 1UL)));
+
+  if (data.IsEmpty())
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"Empty pattern."});
+  }
+
+  detail::PatternSearcher const searcher{data};
+  if (!(flags & PatternFlags::kParallel))
+  {
+    void* address = nullptr;
+    detail::ScanRegionsPipelined(
+      process,
+      filter,
+      data.GetSize() - 1,
+      [&](ReadPipelineChunk const& chunk)
+      {
+        auto const h_beg = chunk.data;
+        auto const h_end = h_beg + (chunk.read_end - chunk.beg);
+        auto const match = searcher.Search(h_beg, h_end);
+        if (!match || match >= h_beg + (chunk.end - chunk.beg))
+        {
+          return true;
+        }
+
+        address = chunk.beg + (match - h_beg);
+        return false;
+      });
+
+    if (!address && !!(flags & PatternFlags::kThrowOnUnmatch))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Could not match pattern."});
+    }
+
+    return address;
+  }
+
+  auto const chunks =
+    detail::GetRegionScanChunks(process, filter, data.GetSize() - 1);
+  std::vector<std::uint8_t*> results(chunks.size());
+  // Chunks after the lowest one known to contain a match can't change the
+  // result, so they're skipped.
+  std::atomic<std::size_t> first_match{chunks.size()};
+  detail::ParallelFor(
+    chunks.size(),
+    [&](std::size_t i)
+    {
+      if (i > first_match)
+      {
+        return;
+      }
+
+      auto const& chunk = chunks[i];
+      detail::ScopedScratch scratch{detail::GetScanScratch()};
+      auto const h_beg = detail::ReadRegionScanChunk(process, chunk, scratch);
+      if (!h_beg)
+      {
+        return;
+      }
+
+      auto const h_end = h_beg + (chunk.read_end - chunk.beg);
+      auto const match = searcher.Search(h_beg, h_end);
+      if (!match || match >= h_beg + (chunk.end - chunk.beg))
+      {
+        return;
+      }
+
+      results[i] = chunk.beg + (match - h_beg);
+      std::size_t cur = first_match;
+      while (i < cur && !first_match.compare_exchange_weak(cur, i))
+      {
+      }
+    },
+    detail::GetDefaultParallelism(),
+    detail::kParallelScanMinChunksPerThread);
+
+  std::size_t const i = first_match;
+  if (i == chunks.size())
+  {
+    if (!!(flags & PatternFlags::kThrowOnUnmatch))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Could not match pattern."});
+    }
+
+    return nullptr;
+  }
+
+  return results[i];
+}
+
+inline void* FindInRegions(Process const& process,
+                           std::wstring const& data,
+                           RegionFilter const& filter,
+                           std::uint32_t flags)
+{
+  return FindInRegions(process, CompiledPattern{data}, filter, flags);
+}
+
+// Returns every match (including overlapping ones), in address order.
+inline std::vector<void*> FindAllInRegions(Process const& process,
+                                           CompiledPattern const& data,
+                                           RegionFilter const& filter,
+                                           std::uint32_t flags)
+{
+  HADESMEM_DETAIL_ASSERT(
+    !(flags & ~(PatternFlags::kInvalidFlagMaxValue - 1UL)));
+
+  if (data.IsEmpty())
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"Empty pattern."});
+  }
+
+  detail::PatternSearcher const searcher{data};
+  std::vector<void*> matches;
+  if (!(flags & PatternFlags::kParallel))
+  {
+    detail::ScanRegionsPipelined(
+      process,
+      filter,
+      data.GetSize() - 1,
+      [&](ReadPipelineChunk const& chunk)
+      {
+        // Matches which start in the overlap belong to the next chunk.
+        auto const h_beg = chunk.data;
+        auto const h_end = h_beg + (chunk.read_end - chunk.beg);
+        auto const h_limit = h_beg + (chunk.end - chunk.beg);
+        for (auto match = searcher.Search(h_beg, h_end);
+             match && match < h_limit;
+             match = searcher.Search(match + 1, h_end))
+        {
+          matches.emplace_back(chunk.beg + (match - h_beg));
+        }
+
+        return true;
+      });
+  }
+  else
+  {
+    auto const chunks =
+      detail::GetRegionScanChunks(process, filter, data.GetSize() - 1);
+    std::vector<std::vector<void*>> results(chunks.size());
+    detail::ParallelFor(
+      chunks.size(),
+      [&](std::size_t i)
+      {
+        auto const& chunk = chunks[i];
+        detail::ScopedScratch scratch{detail::GetScanScratch()};
+        auto const h_beg =
+          detail::ReadRegionScanChunk(process, chunk, scratch);
+        if (!h_beg)
+        {
+          return;
+        }
+
+        // Matches which start in the overlap belong to the next chunk.
+        auto const h_end = h_beg + (chunk.read_end - chunk.beg);
+        auto const h_limit = h_beg + (chunk.end - chunk.beg);
+        for (auto match = searcher.Search(h_beg, h_end);
+             match && match < h_limit;
+             match = searcher.Search(match + 1, h_end))
+        {
+          results[i].emplace_back(chunk.beg + (match - h_beg));
+        }
+      },
+      detail::GetDefaultParallelism(),
+      detail::kParallelScanMinChunksPerThread);
+
+    for (auto const& chunk_results : results)
+    {
+      matches.insert(
+        std::end(matches), std::begin(chunk_results), std::end(chunk_results));
+    }
+  }
+
+  if (matches.empty() && !!(flags & PatternFlags::kThrowOnUnmatch))
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Could not match pattern."});
+  }
+
+  return matches;
+}
+
+inline std::vector<void*> FindAllInRegions(Process const& process,
+                                           std::wstring const& data,
+                                           RegionFilter const& filter,
+                                           std::uint32_t flags)
+{
+  return FindAllInRegions(process, CompiledPattern{data}, filter, flags);
+}
+}
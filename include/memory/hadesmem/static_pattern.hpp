@@ -0,0 +1,184 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/compiled_pattern.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+
+// Compile-time pattern literals. The pattern is validated and converted to
+// value/mask arrays by the compiler, so there is no parsing at runtime and a
+// malformed pattern is a compile error rather than an exception.
+//
+// Only the canonical format is supported: whitespace separated tokens of
+// exactly two characters, each of which is either a hex digit or a '?'
+// wildcard. e.g. HADESMEM_PATTERN(L"48 8B 05 ?? ?? ?? ?? FF D?").
+//
+// The result converts implicitly to CompiledPattern, so it can be passed
+// directly to any of the Find overloads.
+#define HADESMEM_PATTERN(str)                                                  \
+  ([]()                                                                        \
+   {                                                                           \
+     constexpr auto hadesmem_static_pattern =                                  \
+       ::hadesmem::detail::MakeStaticPattern<                                  \
+         ::hadesmem::detail::GetStaticPatternSize(str)>(str);                  \
+     return hadesmem_static_pattern;                                           \
+   }())
+
+namespace hadesmem
+{
+namespace detail
+{
+// Deliberately not constexpr. Reaching a call to this while evaluating a
+// pattern literal makes the expression non-constant, which is what turns an
+// invalid pattern into a compile error.
+inline std::size_t InvalidStaticPattern()
+{
+  HADESMEM_DETAIL_THROW_EXCEPTION(Error{} << ErrorString{"Invalid pattern."});
+}
+
+template <typename CharT> constexpr bool IsStaticPatternSpace(CharT c) noexcept
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+template <typename CharT> constexpr bool IsStaticPatternNibble(CharT c) noexcept
+{
+  return c == '?' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+         (c >= 'A' && c <= 'F');
+}
+
+template <typename CharT>
+constexpr std::uint8_t GetStaticPatternNibbleValue(CharT c) noexcept
+{
+  return static_cast<std::uint8_t>(
+    (c >= '0' && c <= '9')
+      ? c - '0'
+      : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                               : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : 0);
+}
+
+template <typename CharT, std::size_t Len>
+constexpr std::size_t SkipStaticPatternSpace(CharT const (&str)[Len],
+                                             std::size_t i) noexcept
+{
+  return (i + 1 < Len && IsStaticPatternSpace(str[i]))
+           ? SkipStaticPatternSpace(str, i + 1)
+           : i;
+}
+
+template <typename CharT, std::size_t Len>
+constexpr bool IsValidStaticPatternToken(CharT const (&str)[Len],
+                                         std::size_t i) noexcept
+{
+  return i + 2 < Len && IsStaticPatternNibble(str[i]) &&
+         IsStaticPatternNibble(str[i + 1]) &&
+         (i + 3 == Len || IsStaticPatternSpace(str[i + 2]));
+}
+
+template <typename CharT, std::size_t Len>
+constexpr std::size_t GetStaticPatternSizeImpl(CharT const (&str)[Len],
+                                               std::size_t i,
+                                               std::size_t count)
+{
+  return i + 1 >= Len
+           ? (count ? count : InvalidStaticPattern())
+           : IsValidStaticPatternToken(str, i)
+               ? GetStaticPatternSizeImpl(
+                   str, SkipStaticPatternSpace(str, i + 2), count + 1)
+               : InvalidStaticPattern();
+}
+
+// Number of bytes in the pattern. Not usable in a constant expression if the
+// pattern is malformed.
+template <typename CharT, std::size_t Len>
+constexpr std::size_t GetStaticPatternSize(CharT const (&str)[Len])
+{
+  return GetStaticPatternSizeImpl(str, SkipStaticPatternSpace(str, 0), 0);
+}
+
+// Offset of the token for the given byte index. The pattern must have already
+// been validated.
+template <typename CharT, std::size_t Len>
+constexpr std::size_t GetStaticPatternTokenOffset(CharT const (&str)[Len],
+                                                  std::size_t index,
+                                                  std::size_t i = 0) noexcept
+{
+  return index ? GetStaticPatternTokenOffset(
+                   str, index - 1, SkipStaticPatternSpace(str, i) + 2)
+               : SkipStaticPatternSpace(str, i);
+}
+
+template <typename CharT>
+constexpr std::uint8_t GetStaticPatternValue(CharT hi, CharT lo) noexcept
+{
+  return static_cast<std::uint8_t>((GetStaticPatternNibbleValue(hi) << 4) |
+                                   GetStaticPatternNibbleValue(lo));
+}
+
+template <typename CharT>
+constexpr std::uint8_t GetStaticPatternMask(CharT hi, CharT lo) noexcept
+{
+  return static_cast<std::uint8_t>((hi == '?' ? 0x00 : 0xF0) |
+                                   (lo == '?' ? 0x00 : 0x0F));
+}
+}
+
+template <std::size_t N> class StaticPattern
+{
+public:
+  HADESMEM_DETAIL_STATIC_ASSERT(N > 0);
+
+  template <typename CharT, std::size_t Len, std::size_t... I>
+  constexpr StaticPattern(CharT const (&str)[Len],
+                          std::index_sequence<I...>) noexcept
+    : values_{detail::GetStaticPatternValue(
+        str[detail::GetStaticPatternTokenOffset(str, I)],
+        str[detail::GetStaticPatternTokenOffset(str, I) + 1])...},
+      masks_{detail::GetStaticPatternMask(
+        str[detail::GetStaticPatternTokenOffset(str, I)],
+        str[detail::GetStaticPatternTokenOffset(str, I) + 1])...}
+  {
+  }
+
+  static constexpr std::size_t GetSize() noexcept
+  {
+    return N;
+  }
+
+  constexpr std::uint8_t GetValue(std::size_t i) const noexcept
+  {
+    return values_[i];
+  }
+
+  constexpr std::uint8_t GetMask(std::size_t i) const noexcept
+  {
+    return masks_[i];
+  }
+
+  operator CompiledPattern() const
+  {
+    return CompiledPattern{std::vector<std::uint8_t>(values_, values_ + N),
+                           std::vector<std::uint8_t>(masks_, masks_ + N)};
+  }
+
+private:
+  std::uint8_t values_[N];
+  std::uint8_t masks_[N];
+};
+
+namespace detail
+{
+template <std::size_t N, typename CharT, std::size_t Len>
+constexpr StaticPattern<N> MakeStaticPattern(CharT const (&str)[Len]) noexcept
+{
+  return StaticPattern<N>{str, std::make_index_sequence<N>{}};
+}
+}
+}
@@ -0,0 +1,436 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/protect_guard.hpp>
+#include <hadesmem/detail/query_region.hpp>
+#include <hadesmem/detail/read_impl.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/detail/thread_aux.hpp>
+#include <hadesmem/detail/trace.hpp>
+#include <hadesmem/detail/type_traits.hpp>
+#include <hadesmem/detail/winapi.hpp>
+#include <hadesmem/detail/write_impl.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/flush.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/thread.hpp>
+#include <hadesmem/thread_helpers.hpp>
+#include <hadesmem/thread_list.hpp>
+
+namespace hadesmem
+{
+struct WriteTransactionFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    // Save the original bytes so that a failed commit can be undone, and so
+    // that a successful one can later be undone with Rollback.
+    kRollback = 1 << 0,
+    // Suspend the process while writing, and fail if any thread is currently
+    // executing one of the ranges being written (like PatchRaw).
+    kSuspend = 1 << 1,
+    kNoFlushInstructionCache = 1 << 2,
+    kInvalidFlagMaxValue = 1 << 3
+  };
+};
+
+// Batches writes so that applying many small patches (e.g. hundreds of byte
+// patches to .text) costs one suspension, one protection change per run of
+// contiguous pages, and one instruction cache flush, rather than a full
+// suspend/protect/write/restore/flush cycle per patch.
+// Writes are applied in the order they were added, so where writes overlap
+// the last one wins. Adjacent and overlapping writes are merged and written
+// with a single call.
+class WriteTransaction
+{
+public:
+  explicit WriteTransaction(Process const& process,
+                            std::uint32_t flags = WriteTransactionFlags::kNone)
+    : process_{&process}, flags_{flags}
+  {
+    HADESMEM_DETAIL_ASSERT(flags < WriteTransactionFlags::kInvalidFlagMaxValue);
+  }
+
+  explicit WriteTransaction(
+    Process const&& process,
+    std::uint32_t flags = WriteTransactionFlags::kNone) = delete;
+
+  WriteTransaction(WriteTransaction const& other) = delete;
+
+  WriteTransaction& operator=(WriteTransaction const& other) = delete;
+
+  WriteTransaction(WriteTransaction&& other) = default;
+
+  WriteTransaction& operator=(WriteTransaction&& other) = default;
+
+  // The data is copied, so it doesn't need to outlive the transaction.
+  void Add(PVOID address, void const* data, std::size_t len)
+  {
+    HADESMEM_DETAIL_ASSERT(address != nullptr);
+    HADESMEM_DETAIL_ASSERT(len ? data != nullptr : true);
+    HADESMEM_DETAIL_ASSERT(!committed_);
+
+    if (!len)
+    {
+      return;
+    }
+
+    auto const src = static_cast<std::uint8_t const*>(data);
+    writes_.emplace_back(PendingWrite{
+      reinterpret_cast<std::uintptr_t>(address), data_.size(), len});
+    data_.insert(std::end(data_), src, src + len);
+  }
+
+  template <typename T> void Add(PVOID address, T const& data)
+  {
+    HADESMEM_DETAIL_STATIC_ASSERT(detail::IsTriviallyCopyable<T>::value);
+
+    Add(address, std::addressof(data), sizeof(data));
+  }
+
+  template <typename T>
+  void Add(PVOID address, T const* ptr, std::size_t count)
+  {
+    HADESMEM_DETAIL_STATIC_ASSERT(detail::IsTriviallyCopyable<T>::value);
+
+    Add(address, static_cast<void const*>(ptr), sizeof(T) * count);
+  }
+
+  template <typename T, typename Alloc>
+  void AddVector(PVOID address, std::vector<T, Alloc> const& data)
+  {
+    Add(address, data.data(), data.size());
+  }
+
+  std::size_t GetNumWrites() const noexcept
+  {
+    return writes_.size();
+  }
+
+  bool IsCommitted() const noexcept
+  {
+    return committed_;
+  }
+
+  // If the transaction was created with kRollback then either every write is
+  // applied or (on failure) none are. Otherwise a failure may leave some of
+  // the writes applied. Page protections are restored either way.
+  void Commit()
+  {
+    HADESMEM_DETAIL_ASSERT(!committed_);
+
+    if (committed_)
+    {
+      return;
+    }
+
+    BuildSpans();
+
+    if (!spans_.empty())
+    {
+      Apply(span_data_.data(), !!(flags_ & WriteTransactionFlags::kRollback));
+    }
+
+    committed_ = true;
+  }
+
+  // Writes back the original bytes of a committed transaction. Requires
+  // kRollback.
+  void Rollback()
+  {
+    HADESMEM_DETAIL_ASSERT(committed_);
+
+    if (!(flags_ & WriteTransactionFlags::kRollback))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Transaction does not support rollback."});
+    }
+
+    if (!committed_)
+    {
+      return;
+    }
+
+    if (!spans_.empty())
+    {
+      Apply(orig_data_.data(), false);
+    }
+
+    committed_ = false;
+  }
+
+  // Discards all writes (without undoing them) so the transaction can be
+  // reused.
+  void Clear() noexcept
+  {
+    writes_.clear();
+    data_.clear();
+    spans_.clear();
+    runs_.clear();
+    span_data_.clear();
+    orig_data_.clear();
+    committed_ = false;
+  }
+
+private:
+  struct PendingWrite
+  {
+    std::uintptr_t address;
+    std::size_t offset;
+    std::size_t len;
+  };
+
+  struct Span
+  {
+    std::uintptr_t beg;
+    std::uintptr_t end;
+    std::size_t offset;
+  };
+
+  struct PageRun
+  {
+    std::uintptr_t beg;
+    std::uintptr_t end;
+  };
+
+  void BuildSpans()
+  {
+    spans_.clear();
+    runs_.clear();
+
+    std::vector<std::size_t> order(writes_.size());
+    std::iota(std::begin(order), std::end(order), std::size_t{});
+    std::sort(std::begin(order),
+              std::end(order),
+              [&](std::size_t lhs, std::size_t rhs)
+              {
+                return writes_[lhs].address < writes_[rhs].address;
+              });
+
+    std::size_t span_data_size = 0;
+    for (auto const i : order)
+    {
+      PendingWrite const& write = writes_[i];
+      std::uintptr_t const write_end = write.address + write.len;
+      if (!spans_.empty() && write.address <= spans_.back().end)
+      {
+        Span& span = spans_.back();
+        if (write_end > span.end)
+        {
+          span_data_size += static_cast<std::size_t>(write_end - span.end);
+          span.end = write_end;
+        }
+      }
+      else
+      {
+        spans_.emplace_back(Span{write.address, write_end, span_data_size});
+        span_data_size += write.len;
+      }
+    }
+
+    // Spans are entirely covered by writes, so they can be built without
+    // reading anything from the target.
+    span_data_.resize(span_data_size);
+    for (auto const& write : writes_)
+    {
+      auto const iter = std::prev(std::upper_bound(
+        std::begin(spans_),
+        std::end(spans_),
+        write.address,
+        [](std::uintptr_t address, Span const& span)
+        {
+          return address < span.beg;
+        }));
+      std::memcpy(&span_data_[iter->offset + (write.address - iter->beg)],
+                  &data_[write.offset],
+                  write.len);
+    }
+
+    std::uintptr_t const page_size = detail::GetSystemInfo().dwPageSize;
+    for (auto const& span : spans_)
+    {
+      std::uintptr_t const beg = span.beg & ~(page_size - 1);
+      std::uintptr_t const end = (span.end + page_size - 1) & ~(page_size - 1);
+      if (!runs_.empty() && beg <= runs_.back().end)
+      {
+        runs_.back().end = (std::max)(runs_.back().end, end);
+      }
+      else
+      {
+        runs_.emplace_back(PageRun{beg, end});
+      }
+    }
+  }
+
+  void VerifyThreads() const
+  {
+    ThreadList const threads{process_->GetId()};
+    for (auto const& thread_entry : threads)
+    {
+      if (thread_entry.GetId() == ::GetCurrentThreadId())
+      {
+        continue;
+      }
+
+      Thread const thread{thread_entry.GetId()};
+      auto const context = GetThreadContext(thread, CONTEXT_CONTROL);
+      std::uintptr_t const ip = detail::GetThreadContextIp(context);
+      for (auto const& span : spans_)
+      {
+        if (ip >= span.beg && ip < span.end)
+        {
+          HADESMEM_DETAIL_THROW_EXCEPTION(
+            Error{} << ErrorString{
+              "Thread is currently executing patch target."});
+        }
+      }
+    }
+  }
+
+  void MakeWritable(std::vector<detail::ProtectGuard>& guards) const
+  {
+    // One protection change per run, or per region where a run crosses
+    // regions with different protections.
+    for (auto const& run : runs_)
+    {
+      for (std::uintptr_t cur = run.beg; cur < run.end;)
+      {
+        MEMORY_BASIC_INFORMATION mbi =
+          detail::Query(*process_, reinterpret_cast<void const*>(cur));
+        std::uintptr_t const region_end =
+          reinterpret_cast<std::uintptr_t>(mbi.BaseAddress) + mbi.RegionSize;
+        std::uintptr_t const end = (std::min)(run.end, region_end);
+        mbi.BaseAddress = reinterpret_cast<void*>(cur);
+        mbi.RegionSize = static_cast<SIZE_T>(end - cur);
+        guards.emplace_back(*process_, mbi, detail::ProtectGuardType::kWrite);
+        cur = end;
+      }
+    }
+  }
+
+  void WriteSpan(std::uint8_t const* span_data, Span const& span) const
+  {
+    detail::WriteUnchecked(*process_,
+                           reinterpret_cast<void*>(span.beg),
+                           span_data + span.offset,
+                           static_cast<std::size_t>(span.end - span.beg));
+  }
+
+  void Apply(std::uint8_t const* span_data, bool backup)
+  {
+    std::unique_ptr<SuspendedProcess> suspended_process;
+    if (flags_ & WriteTransactionFlags::kSuspend)
+    {
+      suspended_process.reset(new SuspendedProcess{process_->GetId()});
+      VerifyThreads();
+    }
+
+    std::vector<detail::ProtectGuard> guards;
+    MakeWritable(guards);
+
+    if (backup)
+    {
+      orig_data_.resize(span_data_.size());
+      for (auto const& span : spans_)
+      {
+        detail::ReadUnchecked(*process_,
+                              reinterpret_cast<void*>(span.beg),
+                              &orig_data_[span.offset],
+                              static_cast<std::size_t>(span.end - span.beg));
+      }
+    }
+
+    std::size_t written = 0;
+    try
+    {
+      for (; written < spans_.size(); ++written)
+      {
+        WriteSpan(span_data, spans_[written]);
+      }
+    }
+    catch (...)
+    {
+      if (backup)
+      {
+        RestoreSpansUnchecked(written);
+        // The span which failed may have been partially written, so try to
+        // restore it as well. Whatever made the write fail will usually make
+        // this fail too, so that's not treated as an error.
+        TryRestoreSpan(spans_[written]);
+      }
+
+      throw;
+    }
+
+    for (auto iter = guards.rbegin(); iter != guards.rend(); ++iter)
+    {
+      iter->Restore();
+    }
+
+    if (!(flags_ & WriteTransactionFlags::kNoFlushInstructionCache))
+    {
+      std::uintptr_t const beg = spans_.front().beg;
+      std::uintptr_t const end = spans_.back().end;
+      FlushInstructionCache(*process_,
+                            reinterpret_cast<void const*>(beg),
+                            static_cast<SIZE_T>(end - beg));
+    }
+  }
+
+  bool TryRestoreSpan(Span const& span) noexcept
+  {
+    try
+    {
+      WriteSpan(orig_data_.data(), span);
+    }
+    catch (...)
+    {
+      HADESMEM_DETAIL_TRACE_A(
+        boost::current_exception_diagnostic_information().c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+  void RestoreSpansUnchecked(std::size_t count) noexcept
+  {
+    for (std::size_t i = 0; i < count && i < spans_.size(); ++i)
+    {
+      if (!TryRestoreSpan(spans_[i]))
+      {
+        // WARNING: Memory is left partially written if this fails.
+        HADESMEM_DETAIL_ASSERT(false);
+      }
+    }
+  }
+
+  Process const* process_;
+  std::uint32_t flags_;
+  bool committed_{};
+  std::vector<PendingWrite> writes_;
+  std::vector<std::uint8_t> data_;
+  // Writes merged into non-overlapping ranges, sorted by address.
+  std::vector<Span> spans_;
+  // Spans expanded to page boundaries and merged.
+  std::vector<PageRun> runs_;
+  std::vector<std::uint8_t> span_data_;
+  std::vector<std::uint8_t> orig_data_;
+};
+}
@@ -0,0 +1,108 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/cached_process_reader.hpp>
+#include <hadesmem/cached_process_reader.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/alloc.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+
+void TestCachedProcessReader()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+  hadesmem::CachedProcessReader reader(process);
+  BOOST_TEST_EQ(&reader.GetProcess(), &process);
+  BOOST_TEST_EQ(reader.GetBudget(),
+                static_cast<std::size_t>(
+                  hadesmem::CachedProcessReader::kDefaultBudget));
+
+  std::size_t const page_size = hadesmem::CachedProcessReader::kPageSize;
+  auto const buffer = static_cast<std::uint8_t*>(
+    hadesmem::Alloc(process, page_size * 4));
+  for (std::size_t i = 0; i < page_size * 4; ++i)
+  {
+    buffer[i] = static_cast<std::uint8_t>(i % 0xFF + 1);
+  }
+
+  // A read which straddles two pages caches both of them.
+  auto const straddle = buffer + page_size - 2;
+  BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(reader, straddle),
+                *reinterpret_cast<std::uint32_t*>(straddle));
+  BOOST_TEST_EQ(reader.GetNumHits(), 0UL);
+  BOOST_TEST_EQ(reader.GetNumMisses(), 2UL);
+  BOOST_TEST_EQ(reader.GetNumPages(), 2UL);
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(reader, buffer + 1), buffer[1]);
+  BOOST_TEST_EQ(reader.GetNumHits(), 1UL);
+
+  auto const vec = hadesmem::ReadVector<std::uint8_t>(
+    reader, buffer, page_size * 2);
+  BOOST_TEST(vec == std::vector<std::uint8_t>(buffer, buffer + page_size * 2));
+  BOOST_TEST_EQ(reader.GetNumHits(), 3UL);
+  BOOST_TEST_EQ(reader.GetNumMisses(), 2UL);
+
+  // Writes are not seen until the cache is invalidated.
+  buffer[0] = 0;
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(reader, buffer), 1);
+  std::uint64_t const epoch = reader.GetEpoch();
+  reader.Invalidate();
+  BOOST_TEST_EQ(reader.GetEpoch(), epoch + 1);
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(reader, buffer), 0);
+  buffer[0] = 1;
+  reader.Invalidate(buffer, 1);
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(reader, buffer), 1);
+
+  // Strings which cross a page boundary and strings which run up to the upper
+  // bound without a terminator.
+  buffer[page_size * 3 - 1] = 0;
+  auto const str = hadesmem::ReadString<char>(reader, buffer + page_size);
+  BOOST_TEST_EQ(str.size(), page_size * 2 - 1);
+  BOOST_TEST(str == std::string(reinterpret_cast<char*>(buffer) + page_size));
+  auto const bounded =
+    hadesmem::ReadStringBounded<char>(reader, buffer + 1, buffer + 5);
+  BOOST_TEST(bounded == "\x02\x03\x04\x05");
+
+  // Eviction.
+  reader.SetBudget(page_size);
+  BOOST_TEST_EQ(reader.GetNumPages(), 1UL);
+  reader.ResetCounters();
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(reader, buffer + page_size * 3),
+                buffer[page_size * 3]);
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(reader, buffer), 1);
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(reader, buffer + page_size * 3),
+                buffer[page_size * 3]);
+  BOOST_TEST_EQ(reader.GetNumPages(), 1UL);
+  BOOST_TEST_EQ(reader.GetNumHits(), 0UL);
+  BOOST_TEST_EQ(reader.GetNumMisses(), 3UL);
+
+  // Unreadable memory throws, isn't cached, and doesn't evict the pages which
+  // are.
+  std::uint8_t const last = buffer[page_size * 3];
+  hadesmem::Free(process, buffer);
+  BOOST_TEST_THROWS(hadesmem::Read<std::uint8_t>(reader, buffer),
+                    hadesmem::Error);
+  BOOST_TEST_EQ(reader.GetNumPages(), 1UL);
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(reader, buffer + page_size * 3),
+                last);
+  BOOST_TEST_EQ(reader.GetNumHits(), 1UL);
+  reader.Invalidate();
+  BOOST_TEST_THROWS(
+    hadesmem::Read<std::uint8_t>(reader, buffer + page_size * 3),
+    hadesmem::Error);
+  BOOST_TEST_EQ(reader.GetNumPages(), 1UL);
+}
+
+int main()
+{
+  TestCachedProcessReader();
+  return boost::report_errors();
+}
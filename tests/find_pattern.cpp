@@ -4,14 +4,27 @@
 #include <hadesmem/find_pattern.hpp>
 #include <hadesmem/find_pattern.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
 #include <hadesmem/detail/warning_disable_prefix.hpp>
 #include <boost/detail/lightweight_test.hpp>
 #include <hadesmem/detail/warning_disable_suffix.hpp>
 
+#include <hadesmem/compiled_pattern.hpp>
 #include <hadesmem/config.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/multi_pattern_matcher.hpp>
 #include <hadesmem/detail/self_path.hpp>
 #include <hadesmem/error.hpp>
+#include <hadesmem/pattern_cache.hpp>
+#include <hadesmem/pattern_db.hpp>
+#include <hadesmem/pattern_match_list.hpp>
 #include <hadesmem/process.hpp>
+#include <hadesmem/static_pattern.hpp>
 
 // TODO: Clean up, expand, fix, etc these tests.
 
@@ -26,6 +39,92 @@
 
 // TODO: LoadFile test.
 
+void TestCompiledPattern()
+{
+  hadesmem::CompiledPattern const pattern{L" FF D? ?B ?? 0x90 5\r\n"};
+  BOOST_TEST_EQ(pattern.GetSize(), 6UL);
+  std::uint8_t const values[] = {0xFF, 0xD0, 0x0B, 0x00, 0x90, 0x05};
+  std::uint8_t const masks[] = {0xFF, 0xF0, 0x0F, 0x00, 0xFF, 0xFF};
+  BOOST_TEST(
+    std::equal(std::begin(values), std::end(values), pattern.GetValues()));
+  BOOST_TEST(
+    std::equal(std::begin(masks), std::end(masks), pattern.GetMasks()));
+  BOOST_TEST(pattern ==
+             hadesmem::CompiledPattern{std::string{"ff d? ?b ?? 90 05"}});
+
+  std::uint8_t const match[] = {0xFF, 0xD7, 0x3B, 0x12, 0x90, 0x05};
+  BOOST_TEST(pattern.Matches(match));
+  std::uint8_t const mismatch[] = {0xFF, 0xC7, 0x3B, 0x12, 0x90, 0x05};
+  BOOST_TEST(!pattern.Matches(mismatch));
+
+  BOOST_TEST_THROWS(hadesmem::CompiledPattern{L""}, hadesmem::Error);
+  BOOST_TEST_THROWS(hadesmem::CompiledPattern{L" \t "}, hadesmem::Error);
+  BOOST_TEST_THROWS(hadesmem::CompiledPattern{L"90 GG"}, hadesmem::Error);
+  BOOST_TEST_THROWS(hadesmem::CompiledPattern{L"90 100"}, hadesmem::Error);
+  BOOST_TEST_THROWS(hadesmem::CompiledPattern{L"90 ?G"}, hadesmem::Error);
+  BOOST_TEST_THROWS(hadesmem::CompiledPattern{L"90 ???"}, hadesmem::Error);
+
+  auto const static_pattern = HADESMEM_PATTERN(L" FF D? ?B ?? 90 05\r\n");
+  BOOST_TEST_EQ(static_pattern.GetSize(), 6UL);
+  BOOST_TEST_EQ(static_pattern.GetValue(1), 0xD0);
+  BOOST_TEST_EQ(static_pattern.GetMask(2), 0x0F);
+  BOOST_TEST(hadesmem::CompiledPattern{static_pattern} == pattern);
+}
+
+void TestMultiPatternMatcher()
+{
+  std::vector<std::uint8_t> const haystack = {
+    0x90, 0x48, 0x8B, 0x05, 0x11, 0x22, 0x33, 0x44, 0xE8, 0x01, 0x02, 0x03,
+    0x04, 0x90, 0x48, 0x8B, 0x05, 0x55, 0x66, 0x77, 0x88, 0xC3};
+
+  auto const make_needle = [](std::wstring const& data)
+  {
+    return hadesmem::CompiledPattern{data};
+  };
+
+  hadesmem::detail::MultiPatternMatcher matcher;
+  auto const mov_id = matcher.Add(make_needle(L"48 8B 05 ?? ?? ?? ??"));
+  auto const call_id = matcher.Add(make_needle(L"E8 ?? ?? ?? ?? 90"));
+  auto const ret_id = matcher.Add(make_needle(L"?? 88 C3"));
+  auto const wildcard_id = matcher.Add(make_needle(L"?? ??"));
+  auto const missing_id = matcher.Add(make_needle(L"CC CC"));
+  auto const nibble_id = matcher.Add(make_needle(L"?5 6?"));
+  matcher.Compile();
+  BOOST_TEST_EQ(matcher.GetNumPatterns(), 6UL);
+  BOOST_TEST_EQ(matcher.GetMaxPatternLength(), 7UL);
+
+  std::vector<bool> matched(matcher.GetNumPatterns());
+  std::vector<std::ptrdiff_t> offsets(matcher.GetNumPatterns(), -1);
+  auto const h_beg = haystack.data();
+  auto const remaining = matcher.FindFirst(
+    h_beg,
+    h_beg + haystack.size(),
+    matched,
+    [&](std::size_t id, std::uint8_t const* match)
+    {
+      offsets[id] = match - h_beg;
+    });
+  BOOST_TEST_EQ(remaining, 1UL);
+  BOOST_TEST_EQ(offsets[mov_id], 1);
+  BOOST_TEST_EQ(offsets[call_id], 8);
+  BOOST_TEST_EQ(offsets[ret_id], 19);
+  BOOST_TEST_EQ(offsets[wildcard_id], 0);
+  BOOST_TEST_EQ(offsets[missing_id], -1);
+  BOOST_TEST_EQ(offsets[nibble_id], 17);
+  BOOST_TEST(!matched[missing_id]);
+
+  // Patterns which were already matched are skipped on subsequent calls.
+  std::size_t num_callbacks = 0;
+  matcher.FindFirst(h_beg + 14,
+                    h_beg + haystack.size(),
+                    matched,
+                    [&](std::size_t /*id*/, std::uint8_t const* /*match*/)
+                    {
+                      ++num_callbacks;
+                    });
+  BOOST_TEST_EQ(num_callbacks, 0UL);
+}
+
 void TestFindPattern()
 {
   hadesmem::Process const process{::GetCurrentProcessId()};
@@ -81,6 +180,131 @@ void TestFindPattern()
                    0U),
     hadesmem::Error);
 
+  BOOST_TEST_EQ(
+    hadesmem::Find(process, L"", L"90", hadesmem::PatternFlags::kParallel, 0U),
+    nop);
+  BOOST_TEST_EQ(
+    hadesmem::Find(process,
+                   L"",
+                   L"90",
+                   hadesmem::PatternFlags::kParallel,
+                   reinterpret_cast<std::uintptr_t>(nop) - process_base),
+    nop_second);
+  BOOST_TEST_EQ(hadesmem::Find(process,
+                               L"",
+                               L"46 ?? 6E 64 50 61 74 74 65 72 6E",
+                               hadesmem::PatternFlags::kScanData |
+                                 hadesmem::PatternFlags::kParallel,
+                               0U),
+                find_pattern_string);
+  BOOST_TEST_EQ(hadesmem::Find(process,
+                               L"",
+                               L"11 22 33 44 55 66 77 88 99 AA BB CC DD EE FF",
+                               hadesmem::PatternFlags::kParallel,
+                               0U),
+                static_cast<void*>(nullptr));
+
+  hadesmem::ModuleScanContext scan_context{process, L""};
+  BOOST_TEST_EQ(scan_context.GetBase(), reinterpret_cast<void*>(process_base));
+  BOOST_TEST(!scan_context.Refresh());
+  BOOST_TEST_EQ(
+    hadesmem::Find(scan_context, L"90", hadesmem::PatternFlags::kNone, 0U),
+    nop);
+  BOOST_TEST_EQ(hadesmem::Find(scan_context,
+                               HADESMEM_PATTERN("90"),
+                               hadesmem::PatternFlags::kNone,
+                               0U),
+                nop);
+  BOOST_TEST_EQ(
+    hadesmem::Find(scan_context,
+                   L"90",
+                   hadesmem::PatternFlags::kNone,
+                   reinterpret_cast<std::uintptr_t>(nop) - process_base),
+    nop_second);
+  BOOST_TEST_EQ(hadesmem::Find(scan_context,
+                               L"46 ?? 6E 64 50 61 74 74 65 72 6E",
+                               hadesmem::PatternFlags::kScanData,
+                               0U),
+                find_pattern_string);
+  BOOST_TEST_THROWS(
+    hadesmem::Find(scan_context,
+                   L"11 22 33 44 55 66 77 88 99 AA BB CC DD EE FF",
+                   hadesmem::PatternFlags::kThrowOnUnmatch,
+                   0U),
+    hadesmem::Error);
+
+  auto const nops =
+    hadesmem::FindAll(process, L"", L"90", hadesmem::PatternFlags::kNone);
+  auto nop_iter = std::begin(nops);
+  BOOST_TEST(nop_iter != std::end(nops));
+  BOOST_TEST_EQ(*nop_iter, nop);
+  BOOST_TEST(++nop_iter != std::end(nops));
+  BOOST_TEST_EQ(*nop_iter, nop_second);
+  std::size_t const num_nops = nops.Count();
+  BOOST_TEST(num_nops >= 2);
+  BOOST_TEST_EQ(
+    static_cast<std::size_t>(std::distance(std::begin(nops), std::end(nops))),
+    num_nops);
+  BOOST_TEST_EQ(nops.Count(1), 1UL);
+  {
+    // The list keeps the context's section data alive after invalidation.
+    auto const context_nops =
+      hadesmem::FindAll(scan_context, L"90", hadesmem::PatternFlags::kNone);
+    scan_context.Invalidate();
+    BOOST_TEST_EQ(context_nops.Count(), num_nops);
+  }
+  BOOST_TEST_EQ(*std::begin(hadesmem::FindAll(
+                  process,
+                  L"",
+                  L"46 ?? 6E 64 50 61 74 74 65 72 6E",
+                  hadesmem::PatternFlags::kScanData)),
+                find_pattern_string);
+  BOOST_TEST_EQ(
+    hadesmem::FindAll(process,
+                      L"",
+                      L"11 22 33 44 55 66 77 88 99 AA BB CC DD EE FF",
+                      hadesmem::PatternFlags::kNone)
+      .Count(),
+    0UL);
+
+  // Matches which cross the boundaries of the chunks the target is read in.
+  std::size_t const chunk_size = hadesmem::detail::kFindAllChunkSize;
+  std::vector<std::uint8_t> haystack(chunk_size * 2 + 16);
+  std::vector<void*> expected_matches;
+  std::size_t const offsets[] = {
+    0, chunk_size - 2, chunk_size * 2 - 1, haystack.size() - 4};
+  for (auto const offset : offsets)
+  {
+    haystack[offset] = 0xDE;
+    haystack[offset + 1] = 0xAD;
+    haystack[offset + 2] = 0xBE;
+    haystack[offset + 3] = 0xEF;
+    expected_matches.emplace_back(reinterpret_cast<void*>(offset));
+  }
+  auto const haystack_matches =
+    hadesmem::FindAll(process,
+                      haystack.data(),
+                      haystack.size(),
+                      L"DE AD BE EF",
+                      hadesmem::PatternFlags::kRelativeAddress);
+  BOOST_TEST(std::vector<void*>(std::begin(haystack_matches),
+                                std::end(haystack_matches)) ==
+             expected_matches);
+  std::wstring const haystack_path =
+    hadesmem::detail::GetSelfPath() + L".find_all.bin";
+  hadesmem::detail::BufferToFile(haystack_path,
+                                 haystack.data(),
+                                 static_cast<std::streamsize>(haystack.size()));
+  {
+    auto const file_matches =
+      hadesmem::FindAllInFile(haystack_path,
+                              L"DE AD BE EF",
+                              hadesmem::PatternFlags::kRelativeAddress);
+    BOOST_TEST(std::vector<void*>(std::begin(file_matches),
+                                  std::end(file_matches)) == expected_matches);
+  }
+  BOOST_TEST(::DeleteFileW(haystack_path.c_str()) != FALSE);
+
   HMODULE const ntdll_mod = ::GetModuleHandleW(L"ntdll");
   BOOST_TEST_NE(ntdll_mod, static_cast<HMODULE>(nullptr));
   std::uintptr_t const ntdll_base = reinterpret_cast<std::uintptr_t>(ntdll_mod);
@@ -138,6 +362,101 @@ void TestFindPattern()
 )";
   hadesmem::FindPattern find_pattern{process, pattern_file_data, true};
   find_pattern = hadesmem::FindPattern{process, pattern_file_data, true};
+  hadesmem::FindPattern const find_pattern_context{
+    process, pattern_file_data, true, {&scan_context}};
+  BOOST_TEST(find_pattern_context == find_pattern);
+
+  // Parallel resolution must give exactly the same results as serial.
+  std::wstring pattern_file_data_parallel = pattern_file_data;
+  std::wstring const throw_flag = L"<Flag Name=\"ThrowOnUnmatch\"/>";
+  std::wstring const parallel_flag = L"<Flag Name=\"Parallel\"/>";
+  for (auto pos = pattern_file_data_parallel.find(throw_flag);
+       pos != std::wstring::npos;
+       pos = pattern_file_data_parallel.find(throw_flag, pos + 1))
+  {
+    pattern_file_data_parallel.insert(pos, parallel_flag);
+    pos += parallel_flag.size();
+  }
+  hadesmem::FindPattern const find_pattern_parallel{
+    process, pattern_file_data_parallel, true};
+  BOOST_TEST_EQ(find_pattern_parallel.GetModuleMap().size(), 2UL);
+  for (auto const& module : find_pattern.GetModuleMap())
+  {
+    for (auto const& pattern : module.second)
+    {
+      BOOST_TEST_EQ(find_pattern_parallel.Lookup(module.first, pattern.first),
+                    pattern.second.GetAddress());
+    }
+  }
+
+  std::wstring const cache_path =
+    hadesmem::detail::GetSelfPath() + L".pattern_cache.xml";
+  ::DeleteFileW(cache_path.c_str());
+  {
+    hadesmem::PatternCache cache{cache_path};
+    hadesmem::FindPattern const find_pattern_uncached{
+      process, pattern_file_data, true, {}, &cache};
+    BOOST_TEST(find_pattern_uncached == find_pattern);
+    BOOST_TEST_EQ(cache.GetNumHits(), 0UL);
+    BOOST_TEST_EQ(cache.GetNumMisses(), 2UL);
+    BOOST_TEST(!cache.IsDirty());
+  }
+  {
+    hadesmem::PatternCache cache{cache_path,
+                                 hadesmem::PatternCacheFlags::kVerify};
+    hadesmem::FindPattern const find_pattern_cached{
+      process, pattern_file_data, true, {}, &cache};
+    BOOST_TEST(find_pattern_cached == find_pattern);
+    BOOST_TEST_EQ(cache.GetNumHits(), 2UL);
+    BOOST_TEST_EQ(cache.GetNumMisses(), 0UL);
+  }
+  {
+    // Module identity changes when the hash is added, so this is a miss.
+    hadesmem::PatternCache cache{cache_path,
+                                 hadesmem::PatternCacheFlags::kHashModule};
+    hadesmem::FindPattern const find_pattern_hashed{
+      process, pattern_file_data, true, {}, &cache};
+    BOOST_TEST(find_pattern_hashed == find_pattern);
+    BOOST_TEST_EQ(cache.GetNumHits(), 0UL);
+    BOOST_TEST_EQ(cache.GetNumMisses(), 2UL);
+  }
+  BOOST_TEST(::DeleteFileW(cache_path.c_str()) != FALSE);
+
+  std::vector<std::uint8_t> const pattern_db_data =
+    hadesmem::CompilePatternDb(pattern_file_data, true);
+  {
+    hadesmem::PatternDb const pattern_db{pattern_db_data.data(),
+                                         pattern_db_data.size()};
+    BOOST_TEST_EQ(pattern_db.GetNumModules(), 2UL);
+    hadesmem::FindPattern const find_pattern_db{process, pattern_db};
+    BOOST_TEST(find_pattern_db == find_pattern);
+  }
+  std::wstring const pattern_db_path =
+    hadesmem::detail::GetSelfPath() + L".pattern_db.bin";
+  hadesmem::detail::BufferToFile(
+    pattern_db_path,
+    pattern_db_data.data(),
+    static_cast<std::streamsize>(pattern_db_data.size()));
+  {
+    hadesmem::PatternDb const pattern_db{pattern_db_path};
+    hadesmem::FindPattern const find_pattern_db{process, pattern_db};
+    BOOST_TEST(find_pattern_db == find_pattern);
+  }
+  BOOST_TEST(::DeleteFileW(pattern_db_path.c_str()) != FALSE);
+  BOOST_TEST_THROWS((hadesmem::PatternDb{pattern_db_data.data(),
+                                         pattern_db_data.size() - 1}),
+                    hadesmem::Error);
+  {
+    // Unknown flag bits are rejected when the database is opened.
+    std::vector<std::uint8_t> bad_db_data = pattern_db_data;
+    auto const bad_module =
+      reinterpret_cast<hadesmem::detail::PatternDbModule*>(
+        bad_db_data.data() + sizeof(hadesmem::detail::PatternDbHeader));
+    bad_module->flags |= hadesmem::PatternFlags::kInvalidFlagMaxValue;
+    BOOST_TEST_THROWS(
+      (hadesmem::PatternDb{bad_db_data.data(), bad_db_data.size()}),
+      hadesmem::Error);
+  }
   BOOST_TEST_EQ(find_pattern.GetModuleMap().size(), 2UL);
   BOOST_TEST_EQ(find_pattern.GetPatternMap(L"").size(), 5UL);
 
@@ -274,6 +593,8 @@ void TestFindPattern()
 
 int main()
 {
+  TestCompiledPattern();
+  TestMultiPatternMatcher();
   TestFindPattern();
   return boost::report_errors();
 }
@@ -0,0 +1,227 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/find_procedure.hpp>
+#include <hadesmem/find_procedure.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/alloc.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/scope_warden.hpp>
+#include <hadesmem/detail/self_path.hpp>
+#include <hadesmem/detail/smart_handle.hpp>
+#include <hadesmem/detail/symbol_cache.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/pelib/export_index.hpp>
+#include <hadesmem/process.hpp>
+
+void TestSymbolCache()
+{
+  hadesmem::Process process{::GetCurrentProcessId()};
+  BOOST_TEST(!process.IsSymbolCacheEnabled());
+  BOOST_TEST(process.GetSymbolCache() == nullptr);
+
+  hadesmem::Module const kernel32{process, L"kernel32.dll"};
+  FARPROC const heap_alloc =
+    hadesmem::FindProcedure(process, kernel32, "HeapAlloc");
+  FARPROC const close_handle =
+    hadesmem::FindProcedure(process, kernel32, "CloseHandle");
+
+  process.SetSymbolCacheEnabled(true);
+  BOOST_TEST(process.IsSymbolCacheEnabled());
+  hadesmem::detail::SymbolCache const* const symbol_cache =
+    process.GetSymbolCache();
+  BOOST_TEST(symbol_cache != nullptr);
+  // The loader notification must have been registered, otherwise nothing is
+  // cached.
+  BOOST_TEST(!symbol_cache->IsDisabled());
+
+  // HeapAlloc is forwarded to ntdll, so the first lookup also caches the
+  // forwarder module and RtlAllocateHeap.
+  BOOST_TEST(hadesmem::FindProcedure(process, kernel32, "HeapAlloc") ==
+             heap_alloc);
+  std::size_t const num_hits = symbol_cache->GetNumHits();
+  BOOST_TEST(hadesmem::FindProcedure(process, kernel32, "HeapAlloc") ==
+             heap_alloc);
+  BOOST_TEST_EQ(symbol_cache->GetNumHits(), num_hits + 1);
+  hadesmem::Module const ntdll{process, L"ntdll.dll"};
+  BOOST_TEST(hadesmem::FindProcedure(process, ntdll, "RtlAllocateHeap") ==
+             heap_alloc);
+  BOOST_TEST_EQ(symbol_cache->GetNumHits(), num_hits + 2);
+
+  // The export index is built once per module and reused for later misses.
+  std::shared_ptr<hadesmem::ExportIndex const> exports;
+  BOOST_TEST(process.GetSymbolCache()->FindExportIndex(kernel32.GetHandle(),
+                                                       exports));
+  BOOST_TEST(exports != nullptr);
+  BOOST_TEST(hadesmem::FindProcedure(process, kernel32, "CloseHandle") ==
+             close_handle);
+  std::shared_ptr<hadesmem::ExportIndex const> exports_again;
+  BOOST_TEST(process.GetSymbolCache()->FindExportIndex(kernel32.GetHandle(),
+                                                       exports_again));
+  BOOST_TEST(exports_again == exports);
+
+  BOOST_TEST_THROWS(
+    hadesmem::FindProcedure(process, kernel32, "non_existant_export"),
+    hadesmem::Error);
+
+  // Copies start out with a new cache. Moves keep the cache, but empty it, as
+  // the export indexes in it refer to the old Process.
+  hadesmem::Process const process_copy{process};
+  BOOST_TEST(process_copy.IsSymbolCacheEnabled());
+  BOOST_TEST(process_copy.GetSymbolCache() != symbol_cache);
+  BOOST_TEST_EQ(process_copy.GetSymbolCache()->GetNumHits(), 0UL);
+  hadesmem::Process process_moved{std::move(process)};
+  BOOST_TEST(process_moved.GetSymbolCache() == symbol_cache);
+  BOOST_TEST(!process_moved.GetSymbolCache()->FindExportIndex(
+    kernel32.GetHandle(), exports));
+
+  std::uint32_t const generation = symbol_cache->GetGeneration();
+  process_moved.InvalidateSymbolCache();
+  BOOST_TEST(symbol_cache->GetGeneration() != generation);
+  std::size_t const num_misses = symbol_cache->GetNumMisses();
+  BOOST_TEST(hadesmem::FindProcedure(process_moved, kernel32, "CloseHandle") ==
+             close_handle);
+  BOOST_TEST(symbol_cache->GetNumMisses() > num_misses);
+
+  // Loading or unloading a module in the current process invalidates the
+  // cache automatically (where the loader supports notifications).
+  if (!::GetModuleHandleW(L"msimg32.dll"))
+  {
+    std::uint32_t const generation_load = symbol_cache->GetGeneration();
+    HMODULE const msimg32 = ::LoadLibraryW(L"msimg32.dll");
+    BOOST_TEST(msimg32 != nullptr);
+    std::uint32_t const generation_free = symbol_cache->GetGeneration();
+    BOOST_TEST(generation_free != generation_load);
+    BOOST_TEST(::FreeLibrary(msimg32) != FALSE);
+    BOOST_TEST(symbol_cache->GetGeneration() != generation_free);
+  }
+
+  process_moved.SetSymbolCacheEnabled(false);
+  BOOST_TEST(!process_moved.IsSymbolCacheEnabled());
+  BOOST_TEST(hadesmem::FindProcedure(process_moved, kernel32, "HeapAlloc") ==
+             heap_alloc);
+}
+
+// Nothing tells the cache when a remote process unloads a module, so each hit
+// is checked against the module still being mapped.
+void TestSymbolCacheRemote()
+{
+  auto const command_line = L"\"" + hadesmem::detail::GetSelfPath() + L"\"";
+  std::vector<wchar_t> command_line_buf(std::begin(command_line),
+                                        std::end(command_line));
+  command_line_buf.push_back(L'\0');
+
+  STARTUPINFO start_info{};
+  PROCESS_INFORMATION proc_info{};
+  BOOST_TEST(::CreateProcessW(nullptr,
+                              command_line_buf.data(),
+                              nullptr,
+                              nullptr,
+                              FALSE,
+                              CREATE_SUSPENDED | CREATE_NO_WINDOW,
+                              nullptr,
+                              nullptr,
+                              &start_info,
+                              &proc_info) != FALSE);
+  hadesmem::detail::SmartHandle const child_process{proc_info.hProcess};
+  hadesmem::detail::SmartHandle const child_thread{proc_info.hThread};
+  auto terminate_child = [&]()
+  {
+    ::TerminateProcess(child_process.GetHandle(), 0);
+  };
+  auto ensure_terminate_child =
+    hadesmem::detail::MakeScopeWarden(terminate_child);
+
+  hadesmem::Process child{proc_info.dwProcessId};
+  child.SetSymbolCacheEnabled(true);
+  hadesmem::detail::SymbolCache* const symbol_cache = child.GetSymbolCache();
+
+  // Nothing is mapped as an image here, as if the module had been unloaded
+  // since the address was cached.
+  hadesmem::Allocator const unloaded{child, 0x1000};
+  HMODULE const unloaded_module = static_cast<HMODULE>(unloaded.GetBase());
+  symbol_cache->InsertProcedure(symbol_cache->GetGeneration(),
+                                unloaded_module,
+                                std::string{"Unloaded"},
+                                reinterpret_cast<FARPROC>(unloaded.GetBase()));
+  std::uint32_t const generation = symbol_cache->GetGeneration();
+  BOOST_TEST_THROWS(hadesmem::detail::GetProcAddressInternal(
+                      child, unloaded_module, "Unloaded"),
+                    hadesmem::Error);
+  BOOST_TEST(symbol_cache->GetGeneration() != generation);
+
+  // ntdll is at the same base in every process, and still mapped, so the
+  // cached address is used.
+  HMODULE const ntdll = ::GetModuleHandleW(L"ntdll.dll");
+  FARPROC const nt_close = ::GetProcAddress(ntdll, "NtClose");
+  BOOST_TEST(hadesmem::detail::GetProcAddressInternal(
+               child, ntdll, "NtClose") == nt_close);
+  std::uint32_t const generation_ntdll = symbol_cache->GetGeneration();
+  std::size_t const num_hits = symbol_cache->GetNumHits();
+  BOOST_TEST(hadesmem::detail::GetProcAddressInternal(
+               child, ntdll, "NtClose") == nt_close);
+  BOOST_TEST_EQ(symbol_cache->GetNumHits(), num_hits + 1);
+  BOOST_TEST_EQ(symbol_cache->GetGeneration(), generation_ntdll);
+}
+
+void TestResolveMany()
+{
+  hadesmem::Process process{::GetCurrentProcessId()};
+  hadesmem::Module const kernel32{process, L"kernel32.dll"};
+  hadesmem::Module const ntdll{process, L"ntdll.dll"};
+
+  std::vector<hadesmem::ResolveRequest> requests(3);
+  requests[0].name = "CloseHandle";
+  requests[1].name = "HeapAlloc";
+  requests[2].name = "non_existant_export";
+  std::vector<hadesmem::ResolveRequest> ntdll_requests(2);
+  ntdll_requests[0].name = "NtClose";
+  ntdll_requests[1].ordinal = 1;
+
+  // The first pass is uncached, the second fills the cache and the third is
+  // answered from it.
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    BOOST_TEST_EQ(hadesmem::ResolveMany(process, kernel32, requests), 1UL);
+    BOOST_TEST(requests[0].address ==
+               ::GetProcAddress(kernel32.GetHandle(), "CloseHandle"));
+    BOOST_TEST(!requests[0].error);
+    BOOST_TEST(requests[1].address ==
+               ::GetProcAddress(kernel32.GetHandle(), "HeapAlloc"));
+    BOOST_TEST(!requests[1].error);
+    BOOST_TEST(requests[2].address == nullptr);
+    BOOST_TEST(!!requests[2].error);
+
+    BOOST_TEST_EQ(hadesmem::ResolveMany(process, ntdll, ntdll_requests), 0UL);
+    BOOST_TEST(ntdll_requests[0].address ==
+               ::GetProcAddress(ntdll.GetHandle(), "NtClose"));
+    BOOST_TEST(ntdll_requests[1].address ==
+               ::GetProcAddress(ntdll.GetHandle(), MAKEINTRESOURCEA(1)));
+
+    process.SetSymbolCacheEnabled(true);
+  }
+
+  BOOST_TEST(process.GetSymbolCache()->GetNumHits() >= 4);
+  BOOST_TEST_EQ(hadesmem::ResolveMany(process, kernel32, nullptr, 0), 0UL);
+}
+
+int main()
+{
+  TestSymbolCache();
+  TestSymbolCacheRemote();
+  TestResolveMany();
+  return boost::report_errors();
+}
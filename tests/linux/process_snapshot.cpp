@@ -0,0 +1,159 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/linux/process_snapshot.hpp>
+#include <hadesmem/linux/process_snapshot.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/detail/snapshot_format.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/linux/process.hpp>
+#include <hadesmem/linux/write.hpp>
+
+void TestProcessSnapshot()
+{
+  // A page of data, a page of zeros and a page which can't be read, in a child
+  // process (so that it can be stopped while it is captured).
+  long const page_size = ::sysconf(_SC_PAGESIZE);
+  auto const base = static_cast<std::uint8_t*>(
+    ::mmap(nullptr,
+           page_size * 3,
+           PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS,
+           -1,
+           0));
+  BOOST_TEST(base != MAP_FAILED);
+  std::vector<std::uint8_t> const marker = {0x5E, 0x19, 0xB2, 0x47, 0xE3, 0x0A,
+                                            0x9C, 0x61, 0xD8, 0x2F, 0x74, 0xC5};
+  std::copy(std::begin(marker), std::end(marker), base + 0x100);
+  BOOST_TEST_EQ(::mprotect(base + page_size * 2, page_size, PROT_NONE), 0);
+
+  pid_t const child = ::fork();
+  if (!child)
+  {
+    for (;;)
+    {
+      ::pause();
+    }
+  }
+  BOOST_TEST(child > 0);
+
+  std::string const snapshot_path =
+    "/tmp/hadesmem_snapshot_" + std::to_string(::getpid()) + ".bin";
+  {
+    hadesmem::Process const process{child};
+    hadesmem::CreateProcessSnapshot(
+      process, snapshot_path, hadesmem::ProcessSnapshotFlags::kSuspend);
+  }
+  ::kill(child, SIGKILL);
+  ::waitpid(child, nullptr, 0);
+
+  std::ifstream file{snapshot_path, std::ios::binary};
+  std::vector<std::uint8_t> const data{std::istreambuf_iterator<char>{file},
+                                       std::istreambuf_iterator<char>{}};
+  BOOST_TEST(data.size() >= sizeof(hadesmem::detail::SnapshotHeader));
+
+  hadesmem::detail::SnapshotHeader header{};
+  std::memcpy(&header, data.data(), sizeof(header));
+  BOOST_TEST_EQ(header.magic, hadesmem::detail::kSnapshotMagic);
+  BOOST_TEST_EQ(header.version, hadesmem::detail::kSnapshotVersion);
+  BOOST_TEST_EQ(header.pointer_size, sizeof(void*));
+  BOOST_TEST_EQ(header.process_id, static_cast<std::uint32_t>(child));
+  BOOST_TEST_EQ(header.size, data.size());
+
+  std::vector<hadesmem::detail::SnapshotRegion> regions(header.num_regions);
+  std::memcpy(regions.data(),
+              data.data() + sizeof(header),
+              regions.size() * sizeof(hadesmem::detail::SnapshotRegion));
+  auto const region =
+    std::find_if(std::begin(regions),
+                 std::end(regions),
+                 [&](hadesmem::detail::SnapshotRegion const& r)
+                 {
+                   return r.base == reinterpret_cast<std::uintptr_t>(base);
+                 });
+  BOOST_TEST(region != std::end(regions));
+  BOOST_TEST_EQ(region->size, static_cast<std::uint64_t>(page_size * 2));
+  BOOST_TEST_EQ(region->protect, hadesmem::detail::kSnapshotPageReadWrite);
+  BOOST_TEST(region->data_offset != 0);
+  BOOST_TEST(region->data_offset % hadesmem::detail::kSnapshotDataAlignment ==
+             0);
+  BOOST_TEST(std::equal(std::begin(marker),
+                        std::end(marker),
+                        data.begin() + region->data_offset + 0x100));
+  BOOST_TEST(std::all_of(data.begin() + region->data_offset + page_size,
+                         data.begin() + region->data_offset + page_size * 2,
+                         [](std::uint8_t b)
+                         {
+                           return b == 0;
+                         }));
+
+  auto const noaccess = region + 1;
+  BOOST_TEST(noaccess != std::end(regions));
+  BOOST_TEST_EQ(noaccess->state, hadesmem::detail::kSnapshotMemReserve);
+  BOOST_TEST_EQ(noaccess->data_offset, 0UL);
+
+  // The test executable itself is a module.
+  std::vector<hadesmem::detail::SnapshotModule> modules(header.num_modules);
+  std::memcpy(modules.data(),
+              data.data() + sizeof(header) +
+                regions.size() * sizeof(hadesmem::detail::SnapshotRegion),
+              modules.size() * sizeof(hadesmem::detail::SnapshotModule));
+  char exe_path[0x1000] = {};
+  BOOST_TEST(::readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1) > 0);
+  std::string const exe_name = std::strrchr(exe_path, '/') + 1;
+  BOOST_TEST(std::any_of(std::begin(modules),
+                         std::end(modules),
+                         [&](hadesmem::detail::SnapshotModule const& module)
+                         {
+                           return std::equal(std::begin(exe_name),
+                                             std::end(exe_name),
+                                             module.name) &&
+                                  module.name[exe_name.size()] == 0;
+                         }));
+
+  BOOST_TEST_EQ(std::remove(snapshot_path.c_str()), 0);
+  BOOST_TEST_EQ(::munmap(base, page_size * 3), 0);
+}
+
+void TestCopySnapshotString()
+{
+  std::uint16_t name[8];
+  hadesmem::detail::CopySnapshotString("a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80",
+                                       name);
+  std::uint16_t const expected[] = {'a', 0xE9, 0x20AC, 0xD83D, 0xDE00, 0};
+  BOOST_TEST(std::equal(std::begin(expected), std::end(expected), name));
+
+  hadesmem::detail::CopySnapshotString("\xFFz\xC3", name);
+  std::uint16_t const expected_invalid[] = {0xFFFD, 'z', 0xFFFD, 0};
+  BOOST_TEST(std::equal(
+    std::begin(expected_invalid), std::end(expected_invalid), name));
+
+  hadesmem::detail::CopySnapshotString("0123456789", name);
+  BOOST_TEST_EQ(name[7], 0);
+  BOOST_TEST_EQ(name[6], '6');
+}
+
+int main()
+{
+  TestProcessSnapshot();
+  TestCopySnapshotString();
+  return boost::report_errors();
+}
@@ -0,0 +1,248 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/linux/read.hpp>
+#include <hadesmem/linux/read.hpp>
+#include <hadesmem/linux/write.hpp>
+#include <hadesmem/linux/write.hpp>
+#include <hadesmem/linux/region_list.hpp>
+#include <hadesmem/linux/region_list.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/detail/snapshot_format.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/linux/process.hpp>
+
+// TODO: Test against a Wine process, once the tests can depend on one.
+
+void TestProcess()
+{
+  hadesmem::Process const process{::getpid()};
+  BOOST_TEST(process.IsSelf());
+  BOOST_TEST_EQ(process.GetId(), ::getpid());
+  BOOST_TEST(process == hadesmem::Process{::getpid()});
+
+  BOOST_TEST_THROWS(hadesmem::Process{0}, hadesmem::Error);
+}
+
+void TestReadWrite()
+{
+  hadesmem::Process const process{::getpid()};
+
+  std::uint32_t value = 0x12345678;
+  BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(process, &value), value);
+  hadesmem::Write(process, &value, std::uint32_t{0x87654321});
+  BOOST_TEST_EQ(value, 0x87654321UL);
+
+  std::array<int, 4> arr = {{1, 2, 3, 4}};
+  BOOST_TEST((hadesmem::Read<int, 4>(process, &arr) == arr));
+  std::vector<int> const vec = {5, 6, 7, 8};
+  hadesmem::WriteVector(process, arr.data(), vec);
+  BOOST_TEST(hadesmem::ReadVector<int>(process, arr.data(), 4) == vec);
+
+  char str[0x10] = {};
+  hadesmem::WriteString(process, str, std::string{"hadesmem"});
+  BOOST_TEST_EQ(hadesmem::ReadString<char>(process, str), "hadesmem");
+
+  // A page of data followed by a page which can't be read. A string which
+  // ends right before the inaccessible page must still be readable.
+  long const page_size = ::sysconf(_SC_PAGESIZE);
+  auto const base = static_cast<char*>(::mmap(nullptr,
+                                              page_size * 2,
+                                              PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS,
+                                              -1,
+                                              0));
+  BOOST_TEST(base != MAP_FAILED);
+  BOOST_TEST_EQ(::mprotect(base + page_size, page_size, PROT_NONE), 0);
+  std::memset(base, 'a', page_size - 1);
+  BOOST_TEST_EQ(hadesmem::ReadString<char>(process, base).size(),
+                static_cast<std::size_t>(page_size - 1));
+  base[page_size - 1] = 'a';
+  BOOST_TEST_THROWS(hadesmem::ReadString<char>(process, base),
+                    hadesmem::Error);
+  BOOST_TEST_THROWS(
+    hadesmem::Read<std::uint32_t>(process, base + page_size - 2),
+    hadesmem::Error);
+
+  // Writes ignore page protections, like they do on Windows.
+  BOOST_TEST_EQ(::mprotect(base, page_size, PROT_READ), 0);
+  hadesmem::Write(process, base, std::uint32_t{0xDEADBEEF});
+  BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(process, base), 0xDEADBEEFUL);
+  hadesmem::Write(process, base + page_size, std::uint32_t{0xDEADBEEF});
+  BOOST_TEST_EQ(::mprotect(base + page_size, page_size, PROT_READ), 0);
+  BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(process, base + page_size),
+                0xDEADBEEFUL);
+
+  BOOST_TEST_EQ(::munmap(base, page_size * 2), 0);
+  BOOST_TEST_THROWS(hadesmem::Write(process, base, std::uint32_t{0}),
+                    hadesmem::Error);
+}
+
+void TestReadWriteBatch()
+{
+  hadesmem::Process const process{::getpid()};
+
+  long const page_size = ::sysconf(_SC_PAGESIZE);
+  auto const inaccessible =
+    ::mmap(nullptr, page_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  BOOST_TEST(inaccessible != MAP_FAILED);
+
+  // Enough requests to need more than one system call.
+  std::vector<std::uint32_t> values(0x1800);
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    values[i] = static_cast<std::uint32_t>(i * 0x01010101UL);
+  }
+
+  std::vector<std::uint32_t> out(values.size());
+  std::uint32_t out_inaccessible = 0;
+  std::vector<hadesmem::ReadRequest> requests;
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    requests.push_back({&values[i], sizeof(values[i]), &out[i], nullptr});
+    if (i == 10 || i == 0x1200)
+    {
+      requests.push_back({inaccessible,
+                          sizeof(out_inaccessible),
+                          &out_inaccessible,
+                          nullptr});
+    }
+  }
+  requests.push_back({nullptr, 0, nullptr, nullptr});
+
+  BOOST_TEST_EQ(hadesmem::ReadBatch(process, requests), 2UL);
+  BOOST_TEST(out == values);
+  for (auto const& request : requests)
+  {
+    BOOST_TEST_EQ(!!request.error, request.address == inaccessible);
+  }
+  BOOST_TEST_THROWS(std::rethrow_exception(requests[11].error),
+                    hadesmem::Error);
+
+  std::vector<std::uint32_t> in(values.size(), 0xCCCCCCCC);
+  std::vector<hadesmem::WriteRequest> write_requests;
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    write_requests.push_back({&out[i], sizeof(in[i]), &in[i], nullptr});
+  }
+  BOOST_TEST_EQ(::munmap(inaccessible, page_size), 0);
+  write_requests.insert(write_requests.begin() + 10,
+                        {inaccessible, sizeof(in[0]), in.data(), nullptr});
+  BOOST_TEST_EQ(hadesmem::WriteBatch(process, write_requests), 1UL);
+  BOOST_TEST(out == in);
+  BOOST_TEST(!!write_requests[10].error);
+
+  BOOST_TEST_EQ(hadesmem::ReadBatch(process, nullptr, 0), 0UL);
+}
+
+void TestRegionList()
+{
+  hadesmem::Process const process{::getpid()};
+
+  long const page_size = ::sysconf(_SC_PAGESIZE);
+  auto const base = static_cast<char*>(::mmap(nullptr,
+                                              page_size * 2,
+                                              PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS,
+                                              -1,
+                                              0));
+  BOOST_TEST(base != MAP_FAILED);
+  BOOST_TEST_EQ(::mprotect(base + page_size, page_size, PROT_NONE), 0);
+
+  hadesmem::RegionList const regions{process};
+  BOOST_TEST(std::is_sorted(std::begin(regions), std::end(regions)));
+
+  auto const find = [&](void* address)
+  {
+    return std::find_if(std::begin(regions),
+                        std::end(regions),
+                        [&](hadesmem::Region const& region)
+                        {
+                          return region.GetBase() == address;
+                        });
+  };
+
+  auto const rw = find(base);
+  BOOST_TEST(rw != std::end(regions));
+  BOOST_TEST_EQ(rw->GetSize(), static_cast<std::size_t>(page_size));
+  BOOST_TEST_EQ(rw->GetState(), hadesmem::detail::kSnapshotMemCommit);
+  BOOST_TEST_EQ(rw->GetProtect(), hadesmem::detail::kSnapshotPageReadWrite);
+  BOOST_TEST_EQ(rw->GetType(), hadesmem::detail::kSnapshotMemPrivate);
+  BOOST_TEST(!rw->IsFile());
+
+  auto const reserved = find(base + page_size);
+  BOOST_TEST(reserved != std::end(regions));
+  BOOST_TEST_EQ(reserved->GetState(), hadesmem::detail::kSnapshotMemReserve);
+  BOOST_TEST_EQ(reserved->GetProtect(), 0UL);
+
+  // Every mapping of the executable is part of the same group.
+  auto const exe = std::find_if(std::begin(regions),
+                                std::end(regions),
+                                [](hadesmem::Region const& region)
+                                {
+                                  return region.GetProtect() ==
+                                           hadesmem::detail::
+                                             kSnapshotPageExecuteRead &&
+                                         region.IsFile();
+                                });
+  BOOST_TEST(exe != std::end(regions));
+  BOOST_TEST_EQ(exe->GetType(), hadesmem::detail::kSnapshotMemMapped);
+  BOOST_TEST(exe->GetAllocBase() <= exe->GetBase());
+
+  BOOST_TEST_EQ(::munmap(base, page_size * 2), 0);
+}
+
+void TestOtherProcess()
+{
+  static std::uint32_t value = 0x1337;
+
+  pid_t const child = ::fork();
+  if (!child)
+  {
+    for (;;)
+    {
+      ::pause();
+    }
+  }
+  BOOST_TEST(child > 0);
+
+  {
+    hadesmem::Process const process{child};
+    BOOST_TEST(!process.IsSelf());
+
+    hadesmem::Write(process, &value, std::uint32_t{0x7331});
+    BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(process, &value), 0x7331UL);
+    BOOST_TEST_EQ(value, 0x1337UL);
+  }
+
+  ::kill(child, SIGKILL);
+  ::waitpid(child, nullptr, 0);
+}
+
+int main()
+{
+  TestProcess();
+  TestReadWrite();
+  TestReadWriteBatch();
+  TestRegionList();
+  TestOtherProcess();
+  return boost::report_errors();
+}
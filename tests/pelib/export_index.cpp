@@ -0,0 +1,245 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/pelib/export_index.hpp>
+#include <hadesmem/pelib/export_index.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_procedure.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/module_list.hpp>
+#include <hadesmem/pelib/export.hpp>
+#include <hadesmem/pelib/export_list.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+
+// Export something to ensure tests pass...
+extern "C" __declspec(dllexport) void Dummy();
+extern "C" __declspec(dllexport) void Dummy()
+{
+}
+
+void TestExportIndex()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  bool processed_one_export_index = false;
+
+  hadesmem::ModuleList modules(process);
+  for (auto const& mod : modules)
+  {
+    hadesmem::PeFile const cur_pe_file(
+      process, mod.GetHandle(), hadesmem::PeFileType::Image, 0);
+
+    hadesmem::ExportList cur_export_list(process, cur_pe_file);
+    if (std::begin(cur_export_list) == std::end(cur_export_list))
+    {
+      continue;
+    }
+
+    hadesmem::ExportIndex const cur_export_index(process, cur_pe_file);
+
+    processed_one_export_index = true;
+
+    // The index must agree with ExportList on every export.
+    for (auto const& e : cur_export_list)
+    {
+      hadesmem::ExportTarget target;
+      BOOST_TEST(cur_export_index.FindByProcedureNumber(
+        e.GetProcedureNumber(), target));
+      BOOST_TEST_EQ(target.procedure_number, e.GetProcedureNumber());
+      BOOST_TEST_EQ(target.forwarded, e.IsForwarded());
+      if (e.IsForwarded())
+      {
+        BOOST_TEST_EQ(target.forwarder_module, e.GetForwarderModule());
+        BOOST_TEST_EQ(target.forwarder_function, e.GetForwarderFunction());
+      }
+      else
+      {
+        BOOST_TEST_EQ(target.rva, e.GetRva());
+        BOOST_TEST_EQ(target.va, e.GetVa());
+        BOOST_TEST_EQ(target.virtual_va, e.IsVirtualVa());
+      }
+
+      if (e.ByName())
+      {
+        hadesmem::ExportTarget target_by_name;
+        BOOST_TEST(cur_export_index.FindByName(e.GetName(), target_by_name));
+        BOOST_TEST_EQ(target_by_name.procedure_number, e.GetProcedureNumber());
+      }
+
+      if (e.ByName() && !e.IsForwarded())
+      {
+        BOOST_TEST(hadesmem::FindProcedure(process, mod, e.GetName()) ==
+                   reinterpret_cast<FARPROC>(e.GetVa()));
+      }
+    }
+
+    // The random access tables must cover the same exports.
+    hadesmem::PeExportFunctionTable const functions =
+      cur_export_index.GetFunctions();
+    BOOST_TEST_EQ(functions.size(), cur_export_index.GetNumberOfFunctions());
+    BOOST_TEST_EQ(std::distance(std::begin(functions), std::end(functions)),
+                  static_cast<std::ptrdiff_t>(functions.size()));
+    BOOST_TEST_EQ(
+      std::count_if(std::begin(functions),
+                    std::end(functions),
+                    [](hadesmem::PeExportFunction const& f)
+                    {
+                      return f.rva != 0;
+                    }),
+      std::distance(std::begin(cur_export_list), std::end(cur_export_list)));
+    for (auto const& e : cur_export_list)
+    {
+      hadesmem::PeExportFunction const f = functions[e.GetOrdinalNumber()];
+      BOOST_TEST_EQ(f.procedure_number, e.GetProcedureNumber());
+      BOOST_TEST_EQ(f.rva, hadesmem::Read<DWORD>(process, e.GetRvaPtr()));
+    }
+    BOOST_TEST_EQ(cur_export_index.GetNames().size(),
+                  cur_export_index.GetNumberOfNames());
+
+    hadesmem::ExportTarget target;
+    BOOST_TEST(
+      !cur_export_index.FindByName("hadesmem_not_an_export", target));
+    BOOST_TEST(!cur_export_index.FindByName("", target));
+    BOOST_TEST(!cur_export_index.FindByProcedureNumber(
+      static_cast<WORD>(cur_export_index.GetOrdinalBase() +
+                        cur_export_index.GetNumberOfFunctions()),
+      target));
+  }
+
+  BOOST_TEST(processed_one_export_index);
+
+  // Only a malformed export directory is treated as empty by FindProcedure.
+  BOOST_TEST(hadesmem::detail::IsInvalidExportDirError(
+    hadesmem::Error{} << hadesmem::detail::ErrorInvalidExportDir{true}));
+  // Only the tag matters, not the message.
+  BOOST_TEST(!hadesmem::detail::IsInvalidExportDirError(
+    hadesmem::Error{}
+    << hadesmem::ErrorString{"Export directory is invalid."}));
+  BOOST_TEST(!hadesmem::detail::IsInvalidExportDirError(hadesmem::Error{}));
+
+  hadesmem::Module const self(process, nullptr);
+  BOOST_TEST(hadesmem::FindProcedure(process, self, "Dummy") ==
+             ::GetProcAddress(::GetModuleHandleW(nullptr), "Dummy"));
+
+  // Forwarded exports are resolved through the forwarder module.
+  // kernel32!HeapAlloc is forwarded to ntdll!RtlAllocateHeap.
+  hadesmem::Module const kernel32(process, L"kernel32.dll");
+  BOOST_TEST(hadesmem::FindProcedure(process, kernel32, "HeapAlloc") ==
+             ::GetProcAddress(::GetModuleHandleW(L"ntdll.dll"),
+                              "RtlAllocateHeap"));
+}
+
+void TestExportIndexDuplicateNames()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  // A minimal image with an export directory at 0x1000.
+  auto const base = static_cast<std::uint8_t*>(::VirtualAlloc(
+    nullptr, 0x2000, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+  BOOST_TEST(base != nullptr);
+  auto const dos_header = reinterpret_cast<IMAGE_DOS_HEADER*>(base);
+  dos_header->e_magic = IMAGE_DOS_SIGNATURE;
+  dos_header->e_lfanew = 0x40;
+  auto const nt_headers =
+    reinterpret_cast<IMAGE_NT_HEADERS32*>(base + dos_header->e_lfanew);
+  nt_headers->Signature = IMAGE_NT_SIGNATURE;
+  nt_headers->FileHeader.Machine = IMAGE_FILE_MACHINE_I386;
+  nt_headers->FileHeader.SizeOfOptionalHeader =
+    sizeof(IMAGE_OPTIONAL_HEADER32);
+  nt_headers->OptionalHeader.Magic = IMAGE_NT_OPTIONAL_HDR32_MAGIC;
+  nt_headers->OptionalHeader.SizeOfImage = 0x2000;
+  nt_headers->OptionalHeader.SizeOfHeaders = 0x1000;
+  nt_headers->OptionalHeader.NumberOfRvaAndSizes =
+    IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+  nt_headers->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT] = {
+    0x1000, 0x100};
+
+  auto const export_dir =
+    reinterpret_cast<IMAGE_EXPORT_DIRECTORY*>(base + 0x1000);
+  export_dir->Base = 1;
+  export_dir->NumberOfFunctions = 5;
+  export_dir->NumberOfNames = 5;
+  export_dir->AddressOfFunctions = 0x1040;
+  export_dir->AddressOfNames = 0x1060;
+  export_dir->AddressOfNameOrdinals = 0x1080;
+  auto const functions = reinterpret_cast<DWORD*>(base + 0x1040);
+  auto const names = reinterpret_cast<DWORD*>(base + 0x1060);
+  auto const name_ordinals = reinterpret_cast<WORD*>(base + 0x1080);
+  for (WORD i = 0; i < 5; ++i)
+  {
+    functions[i] = 0x1800 + i * 0x10;
+    name_ordinals[i] = i;
+  }
+  std::memcpy(base + 0x10A0, "a\0b\0c", 6);
+  DWORD const name_a = 0x10A0;
+  DWORD const name_b = 0x10A2;
+  DWORD const name_c = 0x10A4;
+
+  hadesmem::PeFile const pe_file(
+    process, base, hadesmem::PeFileType::Image, 0x2000);
+
+  // Sorted, so binary searched. Whichever duplicate the search lands on, the
+  // first one is found.
+  DWORD const sorted[] = {name_a, name_b, name_b, name_b, name_c};
+  std::memcpy(names, sorted, sizeof(sorted));
+  {
+    hadesmem::ExportIndex const exports(process, pe_file);
+    hadesmem::ExportTarget target;
+    BOOST_TEST(exports.FindByName("b", target));
+    BOOST_TEST_EQ(target.procedure_number, 2);
+    BOOST_TEST(exports.FindByName("c", target));
+    BOOST_TEST_EQ(target.procedure_number, 5);
+    BOOST_TEST(!exports.FindByName("d", target));
+  }
+
+  // Not sorted, so hashed. The first duplicate must still win.
+  DWORD const unsorted[] = {name_c, name_b, name_b, name_b, name_a};
+  std::memcpy(names, unsorted, sizeof(unsorted));
+  {
+    hadesmem::ExportIndex const exports(process, pe_file);
+    hadesmem::ExportTarget target;
+    BOOST_TEST(exports.FindByName("b", target));
+    BOOST_TEST_EQ(target.procedure_number, 2);
+    BOOST_TEST(exports.FindByName("a", target));
+    BOOST_TEST_EQ(target.procedure_number, 5);
+  }
+
+  // No export directory at all is tagged as malformed, so it is treated as
+  // empty.
+  nt_headers->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT] = {
+    0, 0};
+  hadesmem::PeFile const pe_file_no_exports(
+    process, base, hadesmem::PeFileType::Image, 0x2000);
+  try
+  {
+    hadesmem::ExportIndex const exports(process, pe_file_no_exports);
+    BOOST_TEST(false);
+  }
+  catch (hadesmem::Error const& e)
+  {
+    BOOST_TEST(hadesmem::detail::IsInvalidExportDirError(e));
+  }
+
+  BOOST_TEST(::VirtualFree(base, 0, MEM_RELEASE) != FALSE);
+}
+
+int main()
+{
+  TestExportIndex();
+  TestExportIndexDuplicateNames();
+  return boost::report_errors();
+}
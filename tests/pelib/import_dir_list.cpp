@@ -4,6 +4,8 @@
 #include <hadesmem/pelib/import_dir_list.hpp>
 #include <hadesmem/pelib/import_dir_list.hpp>
 
+#include <cstddef>
+#include <iterator>
 #include <sstream>
 #include <utility>
 
@@ -109,6 +111,34 @@ void TestImportDirList()
       hadesmem::ImportThunkList import_thunks(
         process, cur_pe_file, d.GetOriginalFirstThunk());
       BOOST_TEST(std::begin(import_thunks) != std::end(import_thunks));
+
+      // The table must agree with ImportThunkList on every thunk.
+      hadesmem::ImportThunkTable const thunk_table(
+        process, cur_pe_file, d.GetOriginalFirstThunk(), d.GetFirstThunk());
+      BOOST_TEST_EQ(
+        std::distance(std::begin(thunk_table), std::end(thunk_table)),
+        std::distance(std::begin(import_thunks), std::end(import_thunks)));
+      std::size_t thunk_index = 0;
+      for (auto const& t : import_thunks)
+      {
+        BOOST_TEST(thunk_index < thunk_table.size());
+        if (thunk_index >= thunk_table.size())
+        {
+          break;
+        }
+
+        hadesmem::PeImportThunkEntry const entry = thunk_table[thunk_index];
+        BOOST_TEST_EQ(entry.value, t.GetAddressOfData());
+        BOOST_TEST_EQ(entry.by_ordinal, t.ByOrdinal());
+        BOOST_TEST_EQ(entry.iat_rva,
+                      d.GetFirstThunk() +
+                        thunk_index * (cur_pe_file.Is64() ? 8U : 4U));
+        if (entry.by_ordinal)
+        {
+          BOOST_TEST_EQ(entry.ordinal, t.GetOrdinal());
+        }
+        ++thunk_index;
+      }
       for (auto const& t : import_thunks)
       {
         hadesmem::ImportThunk test_thunk(
@@ -4,6 +4,7 @@
 #include <hadesmem/pelib/pe_file.hpp>
 #include <hadesmem/pelib/pe_file.hpp>
 
+#include <cstdint>
 #include <sstream>
 #include <utility>
 
@@ -14,6 +15,7 @@
 #include <hadesmem/config.hpp>
 #include <hadesmem/error.hpp>
 #include <hadesmem/module.hpp>
+#include <hadesmem/pelib/export_index.hpp>
 #include <hadesmem/process.hpp>
 
 // TODO: More comprehensive PE file testing.
@@ -84,8 +86,56 @@ void TestPeFile()
   BOOST_TEST_NE(test_str_1.str(), test_str_3.str());
 }
 
+void TestPeFileUnreadableHeaders()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  // 64-bit headers which end exactly at the end of the first page, so the
+  // section table is in the second page, which can't be read.
+  auto const base = static_cast<std::uint8_t*>(::VirtualAlloc(
+    nullptr, 0x2000, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+  BOOST_TEST(base != nullptr);
+  auto const dos_header = reinterpret_cast<IMAGE_DOS_HEADER*>(base);
+  dos_header->e_magic = IMAGE_DOS_SIGNATURE;
+  dos_header->e_lfanew = 0x1000 - sizeof(IMAGE_NT_HEADERS64);
+  auto const nt_headers =
+    reinterpret_cast<IMAGE_NT_HEADERS64*>(base + dos_header->e_lfanew);
+  nt_headers->Signature = IMAGE_NT_SIGNATURE;
+  nt_headers->FileHeader.Machine = IMAGE_FILE_MACHINE_AMD64;
+  nt_headers->FileHeader.NumberOfSections = 1;
+  nt_headers->FileHeader.SizeOfOptionalHeader =
+    sizeof(IMAGE_OPTIONAL_HEADER64);
+  nt_headers->OptionalHeader.Magic = IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+  nt_headers->OptionalHeader.NumberOfRvaAndSizes =
+    IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+  DWORD old_protect = 0;
+  BOOST_TEST(
+    ::VirtualProtect(base + 0x1000, 0x1000, PAGE_NOACCESS, &old_protect));
+
+  hadesmem::PeFile const pe_file(
+    process, base, hadesmem::PeFileType::Data, 0x2000);
+  // Only needs the NT headers, which could be read.
+  BOOST_TEST(pe_file.Is64());
+  BOOST_TEST_THROWS(pe_file.CheckHeaders(), hadesmem::Error);
+
+  // The read failure is reported, rather than the export directory being
+  // treated as invalid (and so empty).
+  try
+  {
+    hadesmem::ExportIndex const exports(process, pe_file);
+    BOOST_TEST(false);
+  }
+  catch (hadesmem::Error const& e)
+  {
+    BOOST_TEST(!hadesmem::detail::IsInvalidExportDirError(e));
+  }
+
+  BOOST_TEST(::VirtualFree(base, 0, MEM_RELEASE) != FALSE);
+}
+
 int main()
 {
   TestPeFile();
+  TestPeFileUnreadableHeaders();
   return boost::report_errors();
 }
@@ -0,0 +1,460 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/pelib/pe_view.hpp>
+#include <hadesmem/pelib/pe_view.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/detail/mapped_file.hpp>
+#include <hadesmem/detail/pe_format.hpp>
+#include <hadesmem/error.hpp>
+
+namespace
+{
+// Small PE32 file with two sections:
+//   .rdata: RVA 0x1000 (VirtualSize 0x400), raw data 0x200-0x400.
+//   .data: RVA 0x2000 (VirtualSize 0x1000), raw data 0x400-0x600.
+// The export dir (three exports, one forwarded, one in the zero-fill of .data
+// and one without a name) and the import dir (one by name, one by ordinal) are
+// in .rdata, and the IAT is at the start of .data.
+class TestFile
+{
+public:
+  TestFile() : data_(0x600)
+  {
+    hadesmem::detail::PeDosHeader dos_header{};
+    dos_header.e_magic = hadesmem::detail::kPeDosSignature;
+    dos_header.e_lfanew = 0x40;
+    Put(0, dos_header);
+
+    Put(0x40, std::uint32_t{hadesmem::detail::kPeNtSignature});
+
+    hadesmem::detail::PeFileHeader file_header{};
+    file_header.Machine = 0x14C;
+    file_header.NumberOfSections = 2;
+    file_header.SizeOfOptionalHeader =
+      sizeof(hadesmem::detail::PeOptionalHeader32);
+    Put(0x44, file_header);
+
+    hadesmem::detail::PeOptionalHeader32 optional_header{};
+    optional_header.Magic = 0x10B;
+    optional_header.AddressOfEntryPoint = 0x2100;
+    optional_header.ImageBase = 0x10000000;
+    optional_header.SectionAlignment = 0x1000;
+    optional_header.FileAlignment = 0x200;
+    optional_header.SizeOfImage = 0x3000;
+    optional_header.SizeOfHeaders = 0x200;
+    optional_header.NumberOfRvaAndSizes = hadesmem::detail::kPeNumDataDirs;
+    optional_header.DataDirectory[0] = {0x1000, 0x100};
+    optional_header.DataDirectory[1] = {0x1100, 0x28};
+    Put(0x58, optional_header);
+
+    hadesmem::detail::PeSectionHeader rdata{};
+    std::memcpy(rdata.Name, ".rdata", 6);
+    rdata.VirtualSize = 0x400;
+    rdata.VirtualAddress = 0x1000;
+    rdata.SizeOfRawData = 0x200;
+    rdata.PointerToRawData = 0x200;
+    Put(0x138, rdata);
+
+    hadesmem::detail::PeSectionHeader data{};
+    std::memcpy(data.Name, ".data", 5);
+    data.VirtualSize = 0x1000;
+    data.VirtualAddress = 0x2000;
+    data.SizeOfRawData = 0x200;
+    data.PointerToRawData = 0x400;
+    Put(0x160, data);
+
+    hadesmem::detail::PeExportDirectory export_dir{};
+    export_dir.Name = 0x1080;
+    export_dir.Base = 1;
+    export_dir.NumberOfFunctions = 3;
+    export_dir.NumberOfNames = 2;
+    export_dir.AddressOfFunctions = 0x1028;
+    export_dir.AddressOfNames = 0x1034;
+    export_dir.AddressOfNameOrdinals = 0x103C;
+    PutRva(0x1000, export_dir);
+    PutRva(0x1028, std::uint32_t{0x2010});
+    PutRva(0x102C, std::uint32_t{0x1090});
+    PutRva(0x1030, std::uint32_t{0x2800});
+    PutRva(0x1034, std::uint32_t{0x10A0});
+    PutRva(0x1038, std::uint32_t{0x10A8});
+    PutRva(0x103C, std::uint16_t{0});
+    PutRva(0x103E, std::uint16_t{1});
+    PutStringRva(0x1080, "test.dll");
+    PutStringRva(0x1090, "other.Func");
+    PutStringRva(0x10A0, "Alpha");
+    PutStringRva(0x10A8, "Beta");
+
+    hadesmem::detail::PeImportDescriptor import_desc{};
+    import_desc.OriginalFirstThunk = 0x1140;
+    import_desc.Name = 0x1180;
+    import_desc.FirstThunk = 0x2000;
+    PutRva(0x1100, import_desc);
+    PutRva(0x1140, std::uint32_t{0x1160});
+    PutRva(0x1144, std::uint32_t{0x80000010});
+    PutRva(0x1160, std::uint16_t{7});
+    PutStringRva(0x1162, "Sleep");
+    PutStringRva(0x1180, "kernel32.dll");
+    PutRva(0x2000, std::uint32_t{0x1160});
+    PutRva(0x2004, std::uint32_t{0x80000010});
+  }
+
+  std::vector<std::uint8_t>& GetData()
+  {
+    return data_;
+  }
+
+private:
+  template <typename T> void Put(std::size_t offset, T const& value)
+  {
+    std::memcpy(&data_[offset], &value, sizeof(value));
+  }
+
+  // Only valid for the raw data of the two sections.
+  template <typename T> void PutRva(std::uint32_t rva, T const& value)
+  {
+    Put(RvaToOffset(rva), value);
+  }
+
+  void PutStringRva(std::uint32_t rva, char const* str)
+  {
+    std::memcpy(&data_[RvaToOffset(rva)], str, std::strlen(str) + 1);
+  }
+
+  static std::size_t RvaToOffset(std::uint32_t rva)
+  {
+    return rva < 0x2000 ? rva - 0x1000 + 0x200 : rva - 0x2000 + 0x400;
+  }
+
+  std::vector<std::uint8_t> data_;
+};
+}
+
+void TestPeViewHeaders()
+{
+  TestFile file;
+  auto const base = file.GetData().data();
+  hadesmem::PeView const pe_view(base, file.GetData().size());
+
+  BOOST_TEST(pe_view.GetBase() == base);
+  BOOST_TEST_EQ(pe_view.GetSize(), 0x600U);
+  BOOST_TEST(pe_view.GetType() == hadesmem::PeFileType::Data);
+  BOOST_TEST(!pe_view.Is64());
+  BOOST_TEST_EQ(pe_view.GetFileHeader().NumberOfSections, 2);
+  BOOST_TEST_EQ(pe_view.GetImageBase(), 0x10000000U);
+  BOOST_TEST_EQ(pe_view.GetAddressOfEntryPoint(), 0x2100U);
+  BOOST_TEST_EQ(pe_view.GetSectionAlignment(), 0x1000U);
+  BOOST_TEST_EQ(pe_view.GetFileAlignment(), 0x200U);
+  BOOST_TEST_EQ(pe_view.GetSizeOfImage(), 0x3000U);
+  BOOST_TEST_EQ(pe_view.GetSizeOfHeaders(), 0x200U);
+  BOOST_TEST_EQ(
+    pe_view.GetDataDirectory(hadesmem::PeDataDir::Export).VirtualAddress,
+    0x1000U);
+  BOOST_TEST_EQ(pe_view.GetDataDirectory(hadesmem::PeDataDir::Import).Size,
+                0x28U);
+  BOOST_TEST_EQ(
+    pe_view.GetDataDirectory(hadesmem::PeDataDir::TLS).VirtualAddress, 0U);
+
+  auto const& sections = pe_view.GetSections();
+  BOOST_TEST_EQ(sections.size(), 2UL);
+  BOOST_TEST_EQ(std::string(reinterpret_cast<char const*>(sections[0].Name)),
+                ".rdata");
+  BOOST_TEST_EQ(sections[1].VirtualAddress, 0x2000U);
+
+  // Sections.
+  BOOST_TEST(pe_view.RvaToPtr(0x1000) == base + 0x200);
+  BOOST_TEST(pe_view.RvaToPtr(0x2010) == base + 0x410);
+  BOOST_TEST_EQ(pe_view.FileOffsetToRva(0x410), 0x2010U);
+  BOOST_TEST_EQ(pe_view.FileOffsetToRva(0x200), 0x1000U);
+
+  // Headers.
+  BOOST_TEST(pe_view.RvaToPtr(0x40) == base + 0x40);
+  BOOST_TEST_EQ(pe_view.FileOffsetToRva(0x40), 0U);
+
+  // Zero-fill, past SizeOfImage and null.
+  bool virtual_va = false;
+  BOOST_TEST(pe_view.RvaToPtr(0x2800, &virtual_va) == nullptr);
+  BOOST_TEST(virtual_va);
+  BOOST_TEST(pe_view.RvaToPtr(0x1000, &virtual_va) != nullptr);
+  BOOST_TEST(!virtual_va);
+  BOOST_TEST(pe_view.RvaToPtr(0x5000) == nullptr);
+  BOOST_TEST(pe_view.RvaToPtr(0) == nullptr);
+
+  hadesmem::PeView const pe_view_image(
+    base, file.GetData().size(), hadesmem::PeFileType::Image);
+  BOOST_TEST(pe_view_image.RvaToPtr(0x410) == base + 0x410);
+  BOOST_TEST(pe_view_image.RvaToPtr(0x600) == nullptr);
+  BOOST_TEST_EQ(pe_view_image.FileOffsetToRva(0x410), 0x410U);
+}
+
+void TestPeViewExports()
+{
+  TestFile file;
+  hadesmem::PeView const pe_view(file.GetData().data(),
+                                 file.GetData().size());
+
+  auto const exports = pe_view.GetExports();
+  BOOST_TEST_EQ(exports.size(), 3UL);
+
+  BOOST_TEST(exports[0].by_name);
+  BOOST_TEST_EQ(exports[0].name, "Alpha");
+  BOOST_TEST_EQ(exports[0].procedure_number, 1);
+  BOOST_TEST_EQ(exports[0].rva, 0x2010U);
+  BOOST_TEST(!exports[0].forwarded);
+  BOOST_TEST(!exports[0].virtual_va);
+
+  BOOST_TEST_EQ(exports[1].name, "Beta");
+  BOOST_TEST_EQ(exports[1].procedure_number, 2);
+  BOOST_TEST(exports[1].forwarded);
+  BOOST_TEST_EQ(exports[1].forwarder, "other.Func");
+  BOOST_TEST_EQ(exports[1].forwarder_module, "other");
+  BOOST_TEST_EQ(exports[1].forwarder_function, "Func");
+
+  BOOST_TEST(!exports[2].by_name);
+  BOOST_TEST_EQ(exports[2].procedure_number, 3);
+  BOOST_TEST_EQ(exports[2].rva, 0x2800U);
+  BOOST_TEST(exports[2].virtual_va);
+}
+
+void TestPeViewImports()
+{
+  TestFile file;
+  hadesmem::PeView const pe_view(file.GetData().data(),
+                                 file.GetData().size());
+
+  auto const imports = pe_view.GetImports();
+  BOOST_TEST_EQ(imports.size(), 1UL);
+  BOOST_TEST_EQ(imports[0].name, "kernel32.dll");
+  BOOST_TEST_EQ(imports[0].first_thunk, 0x2000U);
+  BOOST_TEST_EQ(imports[0].thunks.size(), 2UL);
+
+  auto const& by_name = imports[0].thunks[0];
+  BOOST_TEST(!by_name.by_ordinal);
+  BOOST_TEST_EQ(by_name.name, "Sleep");
+  BOOST_TEST_EQ(by_name.hint, 7);
+  BOOST_TEST_EQ(by_name.iat_rva, 0x2000U);
+
+  auto const& by_ordinal = imports[0].thunks[1];
+  BOOST_TEST(by_ordinal.by_ordinal);
+  BOOST_TEST_EQ(by_ordinal.ordinal, 0x10);
+  BOOST_TEST_EQ(by_ordinal.iat_rva, 0x2004U);
+}
+
+void TestPeViewTables()
+{
+  TestFile file;
+  hadesmem::PeView const pe_view(file.GetData().data(),
+                                 file.GetData().size());
+
+  hadesmem::PeExportFunctionTable const functions =
+    pe_view.GetExportFunctions();
+  BOOST_TEST_EQ(functions.size(), 3UL);
+  BOOST_TEST_EQ(std::distance(functions.begin(), functions.end()), 3L);
+  BOOST_TEST_EQ(functions[0].procedure_number, 1UL);
+  BOOST_TEST_EQ(functions[0].rva, 0x2010U);
+  BOOST_TEST_EQ(functions[2].procedure_number, 3UL);
+  BOOST_TEST_EQ(functions[2].rva, 0x2800U);
+
+  auto iter = functions.end();
+  BOOST_TEST_EQ((*--iter).rva, 0x2800U);
+  BOOST_TEST_EQ((*(iter - 1)).rva, 0x1090U);
+  BOOST_TEST_EQ(iter[-2].rva, 0x2010U);
+  BOOST_TEST(functions.begin() + 2 == iter);
+  BOOST_TEST(2 + functions.begin() == iter);
+  BOOST_TEST(functions.begin() < iter);
+  BOOST_TEST(iter >= functions.begin());
+  BOOST_TEST_EQ(iter - functions.begin(), 2L);
+  BOOST_TEST(std::find_if(functions.begin(),
+                          functions.end(),
+                          [](hadesmem::PeExportFunction const& func)
+                          {
+                            return func.rva == 0x2800U;
+                          }) == iter);
+
+  // Iterators don't depend on the table object.
+  auto const names_beg = pe_view.GetExportNames().begin();
+  auto const names_end = pe_view.GetExportNames().end();
+  BOOST_TEST_EQ(names_end - names_beg, 2L);
+  auto const beta = std::lower_bound(
+    names_beg,
+    names_end,
+    std::string{"Beta"},
+    [&](hadesmem::PeExportName const& name, std::string const& value)
+    {
+      return pe_view.ReadString(pe_view.RvaToPtr(name.name_rva)) < value;
+    });
+  BOOST_TEST(beta != names_end);
+  BOOST_TEST_EQ((*beta).ordinal, 1);
+  BOOST_TEST_EQ(functions[(*beta).ordinal].rva, 0x1090U);
+
+  hadesmem::PeImportThunkTable const thunks =
+    pe_view.GetImportThunks(0x1140, 0x2000);
+  BOOST_TEST_EQ(thunks.size(), 2UL);
+  BOOST_TEST(!thunks[0].by_ordinal);
+  BOOST_TEST_EQ(thunks[0].name_rva, 0x1160U);
+  BOOST_TEST_EQ(thunks[0].iat_rva, 0x2000U);
+  BOOST_TEST(thunks[1].by_ordinal);
+  BOOST_TEST_EQ(thunks[1].ordinal, 0x10);
+  BOOST_TEST_EQ(thunks[1].iat_rva, 0x2004U);
+
+  // The IAT is used if there is no lookup table.
+  hadesmem::PeImportThunkTable const iat = pe_view.GetImportThunks(0, 0x2000);
+  BOOST_TEST_EQ(iat.size(), 2UL);
+  BOOST_TEST_EQ(iat[1].value, 0x80000010UL);
+
+  BOOST_TEST(pe_view.GetImportThunks(0, 0).empty());
+}
+
+// The section index must give the same results as searching the section
+// table in order.
+void CheckPeSectionIndex(std::vector<std::uint8_t> const& data)
+{
+  auto const headers = hadesmem::detail::ParsePeHeaders(
+    [&](std::uint64_t offset, void* out, std::size_t len)
+    {
+      std::memcpy(out, &data[static_cast<std::size_t>(offset)], len);
+    },
+    data.size());
+  BOOST_TEST(headers.section_index_valid);
+  auto linear_headers = headers;
+  linear_headers.section_index_valid = false;
+
+  auto const size = static_cast<std::uint32_t>(data.size());
+  for (std::uint32_t rva = 0; rva < 0x3100; rva += 4)
+  {
+    std::uint32_t offset = 0;
+    bool virtual_va = false;
+    bool const found = hadesmem::detail::RvaToFileOffset(
+      headers, size, rva, offset, &virtual_va);
+    std::uint32_t linear_offset = 0;
+    bool linear_virtual_va = false;
+    bool const linear_found = hadesmem::detail::RvaToFileOffset(
+      linear_headers, size, rva, linear_offset, &linear_virtual_va);
+    BOOST_TEST_EQ(found, linear_found);
+    BOOST_TEST_EQ(offset, linear_offset);
+    BOOST_TEST_EQ(virtual_va, linear_virtual_va);
+  }
+}
+
+void TestPeViewSectionIndex()
+{
+  TestFile file;
+  auto& data = file.GetData();
+  CheckPeSectionIndex(data);
+
+  // Section table out of order.
+  std::uint8_t section[sizeof(hadesmem::detail::PeSectionHeader)];
+  std::memcpy(section, &data[0x138], sizeof(section));
+  std::memmove(&data[0x138], &data[0x160], sizeof(section));
+  std::memcpy(&data[0x160], section, sizeof(section));
+  CheckPeSectionIndex(data);
+
+  // Overlapping sections are searched in table order. Now .data (which is
+  // first) covers 0x1000-0x2000.
+  hadesmem::detail::PeSectionHeader data_section;
+  std::memcpy(&data_section, &data[0x138], sizeof(data_section));
+  data_section.VirtualAddress = 0x1000;
+  std::memcpy(&data[0x138], &data_section, sizeof(data_section));
+  hadesmem::PeView const pe_view(data.data(), data.size());
+  BOOST_TEST(!pe_view.GetSections().empty());
+  BOOST_TEST(pe_view.RvaToPtr(0x1010) == data.data() + 0x410);
+  bool virtual_va = false;
+  BOOST_TEST(pe_view.RvaToPtr(0x1300, &virtual_va) == nullptr);
+  BOOST_TEST(virtual_va);
+}
+
+void TestPeViewMalformed()
+{
+  TestFile file;
+  auto& data = file.GetData();
+
+  // Section data past the end of the file.
+  hadesmem::PeView const pe_view_truncated(data.data(), 0x300);
+  BOOST_TEST_EQ(pe_view_truncated.GetSections().size(), 2UL);
+  BOOST_TEST(pe_view_truncated.RvaToPtr(0x1000) == data.data() + 0x200);
+  BOOST_TEST(pe_view_truncated.RvaToPtr(0x2010) == nullptr);
+  BOOST_TEST(pe_view_truncated.GetImports().empty());
+
+  // Section table past the end of the file.
+  hadesmem::PeView const pe_view_headers(data.data(), 0x150);
+  BOOST_TEST_EQ(pe_view_headers.GetSections().size(), 0UL);
+  BOOST_TEST(pe_view_headers.GetExports().empty());
+
+  bool thrown = false;
+  try
+  {
+    hadesmem::PeView const pe_view_nt(data.data(), 0x40);
+  }
+  catch (hadesmem::Error const&)
+  {
+    thrown = true;
+  }
+  BOOST_TEST(thrown);
+
+  data[0] = 0;
+  thrown = false;
+  try
+  {
+    hadesmem::PeView const pe_view_dos(data.data(), data.size());
+  }
+  catch (hadesmem::Error const&)
+  {
+    thrown = true;
+  }
+  BOOST_TEST(thrown);
+}
+
+void TestMappedFile()
+{
+#if defined(_WIN32)
+  std::wstring const path = L"hadesmem_pe_view_test.bin";
+#else // #if defined(_WIN32)
+  std::string const path = "hadesmem_pe_view_test.bin";
+#endif // #if defined(_WIN32)
+
+  TestFile file;
+  {
+    std::ofstream out{path, std::ios::binary};
+    out.write(reinterpret_cast<char const*>(file.GetData().data()),
+              static_cast<std::streamsize>(file.GetData().size()));
+  }
+
+  {
+    hadesmem::detail::MappedFile const mapped_file{path};
+    BOOST_TEST_EQ(mapped_file.GetSize(), file.GetData().size());
+    hadesmem::PeView const pe_view(mapped_file.GetData(),
+                                   mapped_file.GetSize());
+    BOOST_TEST_EQ(pe_view.GetExports().size(), 3UL);
+  }
+
+#if defined(_WIN32)
+  BOOST_TEST(::DeleteFileW(path.c_str()) != 0);
+#else // #if defined(_WIN32)
+  BOOST_TEST_EQ(std::remove(path.c_str()), 0);
+#endif // #if defined(_WIN32)
+}
+
+int main()
+{
+  TestPeViewHeaders();
+  TestPeViewExports();
+  TestPeViewImports();
+  TestPeViewTables();
+  TestPeViewSectionIndex();
+  TestPeViewMalformed();
+  TestMappedFile();
+  return boost::report_errors();
+}
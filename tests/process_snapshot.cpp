@@ -0,0 +1,126 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/process_snapshot.hpp>
+#include <hadesmem/process_snapshot.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/alloc.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/self_path.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/module_list.hpp>
+#include <hadesmem/pelib/nt_headers.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/protect.hpp>
+#include <hadesmem/read.hpp>
+#include <hadesmem/region.hpp>
+#include <hadesmem/region_list.hpp>
+#include <hadesmem/scanner.hpp>
+#include <hadesmem/write.hpp>
+
+void TestProcessSnapshot()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  // A page of data, a page of zeros (which is left as a hole in the file) and
+  // a page which can't be read.
+  hadesmem::Allocator const allocator{process, 0x3000};
+  auto const base = static_cast<std::uint8_t*>(allocator.GetBase());
+  std::vector<std::uint8_t> const marker = {0x5E, 0x19, 0xB2, 0x47, 0xE3, 0x0A,
+                                            0x9C, 0x61, 0xD8, 0x2F, 0x74, 0xC5};
+  hadesmem::WriteVector(process, base + 0x100, marker);
+  hadesmem::WriteString(process, base + 0x200, std::string{"snapshot"});
+  hadesmem::Protect(process, base + 0x2000, PAGE_NOACCESS);
+  hadesmem::Region const region{process, base};
+
+  std::wstring const snapshot_path =
+    hadesmem::detail::GetSelfPath() + L".snapshot.bin";
+  hadesmem::CreateProcessSnapshot(process, snapshot_path);
+
+  // The snapshot must not see later changes to the live process.
+  hadesmem::Write(process, base + 0x100, std::uint8_t{0});
+
+  {
+    hadesmem::Process const snapshot =
+      hadesmem::OpenProcessSnapshot(snapshot_path);
+    BOOST_TEST(snapshot.GetSnapshot() != nullptr);
+    BOOST_TEST(!snapshot.IsSelf());
+    BOOST_TEST_EQ(snapshot.GetId(), process.GetId());
+    // Same ID, but not the same process.
+    BOOST_TEST(snapshot != process);
+    BOOST_TEST((snapshot < process) != (process < snapshot));
+    hadesmem::Process const snapshot_copy{snapshot};
+    BOOST_TEST(snapshot_copy == snapshot);
+    BOOST_TEST(!(snapshot_copy < snapshot) && !(snapshot < snapshot_copy));
+
+    BOOST_TEST(hadesmem::ReadVector<std::uint8_t>(
+                 snapshot, base + 0x100, marker.size()) == marker);
+    BOOST_TEST_EQ(hadesmem::ReadString<char>(snapshot, base + 0x200),
+                  "snapshot");
+    BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(snapshot, base + 0x1000), 0UL);
+    BOOST_TEST_THROWS(hadesmem::Read<std::uint8_t>(snapshot, base + 0x2000),
+                      hadesmem::Error);
+    BOOST_TEST_THROWS(
+      hadesmem::Write(snapshot, base + 0x100, std::uint8_t{0}),
+      hadesmem::Error);
+
+    hadesmem::Region const snapshot_region{snapshot, base + 0x10};
+    BOOST_TEST_EQ(snapshot_region.GetBase(), region.GetBase());
+    BOOST_TEST_EQ(snapshot_region.GetAllocBase(), region.GetAllocBase());
+    BOOST_TEST_EQ(snapshot_region.GetSize(), region.GetSize());
+    BOOST_TEST_EQ(snapshot_region.GetProtect(), region.GetProtect());
+    BOOST_TEST_EQ(snapshot_region.GetType(), region.GetType());
+    hadesmem::RegionList const regions{snapshot};
+    BOOST_TEST(std::begin(regions) != std::end(regions));
+
+    // The marker was overwritten in the live process after the snapshot was
+    // taken, but is still there in the snapshot.
+    std::wstring const pattern = L"5E 19 B2 47 E3 ?? 9C 61 D8 2F 74 C5";
+    auto const matches =
+      hadesmem::FindAllInRegions(snapshot,
+                                 pattern,
+                                 hadesmem::RegionFilter{},
+                                 hadesmem::PatternFlags::kNone);
+    BOOST_TEST(std::find(std::begin(matches),
+                         std::end(matches),
+                         static_cast<void*>(base + 0x100)) !=
+               std::end(matches));
+
+    hadesmem::Module const ntdll{process, L"ntdll.dll"};
+    hadesmem::Module const snapshot_ntdll{snapshot, L"ntdll.dll"};
+    BOOST_TEST_EQ(snapshot_ntdll.GetHandle(), ntdll.GetHandle());
+    BOOST_TEST_EQ(snapshot_ntdll.GetSize(), ntdll.GetSize());
+    BOOST_TEST(snapshot_ntdll.GetPath() == ntdll.GetPath());
+    hadesmem::ModuleList const modules{snapshot};
+    BOOST_TEST(std::find(std::begin(modules), std::end(modules), ntdll) !=
+               std::end(modules));
+
+    hadesmem::PeFile const pe_file{snapshot,
+                                   snapshot_ntdll.GetHandle(),
+                                   hadesmem::PeFileType::Image,
+                                   0};
+    hadesmem::NtHeaders const nt_headers{snapshot, pe_file};
+    BOOST_TEST(nt_headers.IsValid());
+  }
+
+  BOOST_TEST(::DeleteFileW(snapshot_path.c_str()) != FALSE);
+}
+
+int main()
+{
+  TestProcessSnapshot();
+  return boost::report_errors();
+}
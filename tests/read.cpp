@@ -4,8 +4,11 @@
 #include <hadesmem/read.hpp>
 #include <hadesmem/read.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <cstring>
+#include <exception>
 #include <string>
 #include <vector>
 
@@ -15,9 +18,11 @@
 
 #include <hadesmem/alloc.hpp>
 #include <hadesmem/config.hpp>
+#include <hadesmem/detail/scratch_buffer.hpp>
 #include <hadesmem/detail/winapi.hpp>
 #include <hadesmem/error.hpp>
 #include <hadesmem/process.hpp>
+#include <hadesmem/protect.hpp>
 
 // TODO: Run tests against known data (e.g. Read tests should be done against
 // a memory mapped file with known values).
@@ -118,6 +123,48 @@ void TestReadString()
   BOOST_TEST(wide_new_test_string_2 == wide_test_string_2);
 }
 
+void TestReadStringLong()
+{
+  SYSTEM_INFO const sys_info = hadesmem::detail::GetSystemInfo();
+  DWORD const page_size = sys_info.dwPageSize;
+
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  // Long enough to need several (growing) chunks, and terminated right
+  // before an inaccessible page.
+  hadesmem::Allocator const str_alloc(process, page_size * 4);
+  auto const base = static_cast<std::uint8_t*>(str_alloc.GetBase());
+  hadesmem::Protect(process, base + page_size * 3, PAGE_NOACCESS);
+
+  std::size_t const len = (page_size * 3) / sizeof(wchar_t) - 1;
+  std::wstring const wide_test_string(len, L'\x4100');
+  auto const str_mem_wide = reinterpret_cast<wchar_t*>(base);
+  std::copy(
+    std::begin(wide_test_string), std::end(wide_test_string), str_mem_wide);
+  str_mem_wide[len] = L'\0';
+  BOOST_TEST(hadesmem::ReadString<wchar_t>(process, str_mem_wide) ==
+             wide_test_string);
+  BOOST_TEST(hadesmem::ReadStringBounded<wchar_t>(
+               process, str_mem_wide, str_mem_wide + 100) ==
+             wide_test_string.substr(0, 100));
+
+  std::string const test_string(page_size * 3 - 1, 'a');
+  auto const str_mem = reinterpret_cast<char*>(base);
+  std::copy(std::begin(test_string), std::end(test_string), str_mem);
+  str_mem[test_string.size()] = '\0';
+  BOOST_TEST_EQ(hadesmem::ReadString<char>(process, str_mem), test_string);
+  BOOST_TEST_EQ(hadesmem::ReadString<char>(process, str_mem + 5),
+                test_string.substr(5));
+
+  // Unterminated, so the read continues into the inaccessible page (which is
+  // temporarily reprotected).
+  str_mem[test_string.size()] = 'a';
+  BOOST_TEST_EQ(hadesmem::ReadString<char>(process, str_mem),
+                test_string + 'a');
+
+  hadesmem::Protect(process, base + page_size * 3, PAGE_READWRITE);
+}
+
 void TestReadVector()
 {
   hadesmem::Process const process(::GetCurrentProcessId());
@@ -134,6 +181,14 @@ void TestReadVector()
 
   auto const empty_list =
     hadesmem::ReadVector<unsigned char>(process, &int_list[0], 0);
+
+  std::array<int, 10> int_list_read_3 = {};
+  hadesmem::ReadSpan(
+    process, &int_list[0], int_list_read_3.data(), int_list_read_3.size());
+  BOOST_TEST(std::equal(std::begin(int_list_read_3),
+                        std::end(int_list_read_3),
+                        std::begin(int_list)));
+  hadesmem::ReadSpan<int>(process, &int_list[0], nullptr, 0);
 }
 
 void TestReadCrossRegion()
@@ -152,11 +207,195 @@ void TestReadCrossRegion()
   BOOST_TEST(buf == zero_buf);
 }
 
+void TestReadRegionCache()
+{
+  SYSTEM_INFO const sys_info = hadesmem::detail::GetSystemInfo();
+  DWORD const page_size = sys_info.dwPageSize;
+
+  hadesmem::Process process(::GetCurrentProcessId());
+  BOOST_TEST(!process.IsRegionCacheEnabled());
+  BOOST_TEST(process.GetRegionCache() == nullptr);
+  process.SetRegionCacheEnabled(true);
+  BOOST_TEST(process.IsRegionCacheEnabled());
+  auto const region_cache = process.GetRegionCache();
+  BOOST_TEST(region_cache != nullptr);
+
+  int value = 0x12345678;
+  BOOST_TEST_EQ(hadesmem::Read<int>(process, &value), value);
+  BOOST_TEST_EQ(region_cache->GetNumHits(), 0UL);
+  BOOST_TEST_EQ(region_cache->GetNumMisses(), 1UL);
+  BOOST_TEST_EQ(hadesmem::Read<int>(process, &value), value);
+  BOOST_TEST_EQ(region_cache->GetNumHits(), 1UL);
+  BOOST_TEST(region_cache->GetNumRegions() != 0);
+
+  // Regions which need their protection changed to be read are never cached.
+  LPVOID const no_access = VirtualAlloc(
+    nullptr, page_size, MEM_RESERVE | MEM_COMMIT, PAGE_NOACCESS);
+  BOOST_TEST(no_access != 0);
+  BOOST_TEST_EQ(hadesmem::Read<int>(process, no_access), 0);
+  BOOST_TEST_EQ(hadesmem::Read<int>(process, no_access), 0);
+  BOOST_TEST_EQ(region_cache->GetNumHits(), 1UL);
+  BOOST_TEST(VirtualFree(no_access, 0, MEM_RELEASE) != FALSE);
+
+  // Protect (and Free) through the same Process invalidate the cache.
+  void* const address = hadesmem::Alloc(process, page_size);
+  *static_cast<int*>(address) = value;
+  BOOST_TEST_EQ(hadesmem::Read<int>(process, address), value);
+  BOOST_TEST_EQ(hadesmem::Read<int>(process, address), value);
+  BOOST_TEST_EQ(region_cache->GetNumHits(), 2UL);
+  hadesmem::Protect(process, address, PAGE_NOACCESS);
+  BOOST_TEST_EQ(hadesmem::Read<int>(process, address), value);
+  BOOST_TEST_EQ(region_cache->GetNumHits(), 2UL);
+  hadesmem::Free(process, address);
+  BOOST_TEST_EQ(region_cache->GetNumRegions(), 0UL);
+
+  // Memory freed behind our back is detected when the cached read fails.
+  LPVOID const stale = VirtualAlloc(
+    nullptr, page_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  BOOST_TEST(stale != 0);
+  BOOST_TEST_EQ(hadesmem::Read<int>(process, stale), 0);
+  BOOST_TEST(VirtualFree(stale, 0, MEM_RELEASE) != FALSE);
+  BOOST_TEST_THROWS(hadesmem::Read<int>(process, stale), hadesmem::Error);
+
+  process.InvalidateRegionCache();
+  BOOST_TEST_EQ(region_cache->GetNumRegions(), 0UL);
+  process.SetRegionCacheEnabled(false);
+  BOOST_TEST(process.GetRegionCache() == nullptr);
+  BOOST_TEST_EQ(hadesmem::Read<int>(process, &value), value);
+}
+
+void TestReadBatch()
+{
+  SYSTEM_INFO const sys_info = hadesmem::detail::GetSystemInfo();
+  DWORD const page_size = sys_info.dwPageSize;
+
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  std::vector<std::uint32_t> values(0x1000);
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    values[i] = static_cast<std::uint32_t>(i * 0x01010101UL);
+  }
+  int const local = 0x12345678;
+
+  // Reserved (but uncommitted) memory can never be read.
+  LPVOID const reserved =
+    VirtualAlloc(nullptr, page_size, MEM_RESERVE, PAGE_NOACCESS);
+  BOOST_TEST(reserved != 0);
+
+  for (std::size_t max_gap : {0UL, 0x100UL, 0x10000UL})
+  {
+    std::uint32_t out[5] = {};
+    int out_local = 0;
+    std::uint32_t out_overlap[2] = {};
+    int out_reserved = 0;
+    std::vector<hadesmem::ReadRequest> requests = {
+      {&values[100], sizeof(out[0]), &out[0]},
+      {&values[3], sizeof(out[1]), &out[1]},
+      {&values[4], sizeof(out[2]), &out[2]},
+      {&values[0xFFF], sizeof(out[3]), &out[3]},
+      {reserved, sizeof(out_reserved), &out_reserved},
+      {const_cast<int*>(&local), sizeof(out_local), &out_local},
+      {&values[3], sizeof(out_overlap), &out_overlap[0]},
+      {&values[50], 0, nullptr},
+      {&values[101], sizeof(out[4]), &out[4]},
+    };
+    BOOST_TEST_EQ(hadesmem::ReadBatch(process, requests, max_gap), 1UL);
+    BOOST_TEST_EQ(out[0], values[100]);
+    BOOST_TEST_EQ(out[1], values[3]);
+    BOOST_TEST_EQ(out[2], values[4]);
+    BOOST_TEST_EQ(out[3], values[0xFFF]);
+    BOOST_TEST_EQ(out[4], values[101]);
+    BOOST_TEST_EQ(out_local, local);
+    BOOST_TEST_EQ(out_overlap[0], values[3]);
+    BOOST_TEST_EQ(out_overlap[1], values[4]);
+    for (auto const& request : requests)
+    {
+      BOOST_TEST_EQ(!!request.error, request.address == reserved);
+    }
+    BOOST_TEST_THROWS(std::rethrow_exception(requests[4].error),
+                      hadesmem::Error);
+  }
+
+  BOOST_TEST(VirtualFree(reserved, 0, MEM_RELEASE) != FALSE);
+
+  BOOST_TEST_EQ(hadesmem::ReadBatch(process, nullptr, 0), 0UL);
+}
+
+void TestReadTrustedBuffer()
+{
+  SYSTEM_INFO const sys_info = hadesmem::detail::GetSystemInfo();
+  DWORD const page_size = sys_info.dwPageSize;
+
+  hadesmem::Process process(::GetCurrentProcessId());
+  BOOST_TEST(process.IsSelf());
+  BOOST_TEST(!process.IsTrustedBufferMode());
+  process.SetTrustedBufferMode(true);
+  BOOST_TEST(process.IsTrustedBufferMode());
+  hadesmem::Process const process_copy(process);
+  BOOST_TEST(process_copy.IsTrustedBufferMode());
+
+  int const value = 0x12345678;
+  BOOST_TEST_EQ(hadesmem::Read<int>(process, const_cast<int*>(&value)),
+                value);
+
+  // A string terminated right before an inaccessible page must not cause a
+  // read of that page.
+  auto const buffer = static_cast<char*>(VirtualAlloc(
+    nullptr, page_size * 2, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+  BOOST_TEST(buffer != 0);
+  DWORD old_protect = 0;
+  BOOST_TEST(VirtualProtect(
+               buffer + page_size, page_size, PAGE_NOACCESS, &old_protect) !=
+             FALSE);
+  char* const str = buffer + page_size - 4;
+  std::memcpy(str, "abc", 4);
+  BOOST_TEST_EQ(hadesmem::ReadString<char>(process, str), "abc");
+  BOOST_TEST_EQ(
+    hadesmem::ReadStringBounded<char>(process, str, str + 2), "ab");
+
+  // Inaccessible memory throws rather than crashing, and isn't reprotected.
+  BOOST_TEST_THROWS(hadesmem::Read<int>(process, buffer + page_size),
+                    hadesmem::Error);
+  BOOST_TEST_THROWS(hadesmem::Read<int>(process, str + 2), hadesmem::Error);
+  str[3] = 'd';
+  BOOST_TEST_THROWS(hadesmem::ReadString<char>(process, str),
+                    hadesmem::Error);
+  BOOST_TEST(VirtualFree(buffer, 0, MEM_RELEASE) != FALSE);
+
+  process.SetTrustedBufferMode(false);
+  BOOST_TEST(!process.IsTrustedBufferMode());
+}
+
+void TestScratchBufferTrim()
+{
+  hadesmem::detail::ScratchBuffer scratch;
+  {
+    hadesmem::detail::ScopedScratch scoped{scratch};
+    BOOST_TEST(scoped.Get(16) != nullptr);
+  }
+  // Small buffers are kept for reuse.
+  BOOST_TEST_EQ(scratch.GetSize(), 16UL);
+  {
+    hadesmem::detail::ScopedScratch scoped{scratch};
+    BOOST_TEST(
+      scoped.Get(hadesmem::detail::kScratchBufferMaxRetainedSize + 1) !=
+      nullptr);
+  }
+  // Large ones are freed once they're no longer in use.
+  BOOST_TEST_EQ(scratch.GetSize(), 0UL);
+}
+
 int main()
 {
   TestReadPod();
   TestReadString();
+  TestReadStringLong();
   TestReadVector();
   TestReadCrossRegion();
+  TestReadRegionCache();
+  TestReadBatch();
+  TestReadTrustedBuffer();
+  TestScratchBufferTrim();
   return boost::report_errors();
 }
@@ -0,0 +1,110 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/read_pipeline.hpp>
+#include <hadesmem/read_pipeline.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/winapi.hpp>
+#include <hadesmem/process.hpp>
+
+void TestReadPipeline()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  std::vector<std::uint8_t> first(0x10000);
+  std::vector<std::uint8_t> second(0x1234);
+  for (std::size_t i = 0; i < first.size(); ++i)
+  {
+    first[i] = static_cast<std::uint8_t>(i * 7);
+  }
+  for (std::size_t i = 0; i < second.size(); ++i)
+  {
+    second[i] = static_cast<std::uint8_t>(i * 13);
+  }
+
+  std::vector<hadesmem::ReadPipelineRange> const ranges = {
+    {first.data(), first.size()}, {second.data(), second.size()}};
+  std::size_t const chunk_size = 0x1000;
+  std::size_t const overlap = 0x10;
+
+  for (std::size_t num_buffers = 1; num_buffers <= 4; ++num_buffers)
+  {
+    hadesmem::ReadPipeline pipeline{
+      process, ranges, chunk_size, overlap, num_buffers, 2};
+    BOOST_TEST_EQ(pipeline.GetNumChunks(), 0x10UL + 2UL);
+
+    std::size_t num_chunks = 0;
+    std::uint8_t* expected = first.data();
+    for (auto const& chunk : pipeline)
+    {
+      if (num_chunks == 0x10)
+      {
+        expected = second.data();
+      }
+
+      auto const range_end = static_cast<std::uint8_t*>(
+                               ranges[chunk.range].base) +
+                             ranges[chunk.range].size;
+      BOOST_TEST_EQ(chunk.range, num_chunks < 0x10 ? 0UL : 1UL);
+      BOOST_TEST(chunk.beg == expected);
+      BOOST_TEST(chunk.end == (std::min)(chunk.beg + chunk_size, range_end));
+      BOOST_TEST(chunk.read_end == (std::min)(chunk.end + overlap, range_end));
+      BOOST_TEST(chunk.data != nullptr);
+      BOOST_TEST(std::memcmp(chunk.data,
+                             chunk.beg,
+                             static_cast<std::size_t>(chunk.read_end -
+                                                      chunk.beg)) == 0);
+      expected = chunk.end;
+      ++num_chunks;
+    }
+    BOOST_TEST_EQ(num_chunks, 0x10UL + 2UL);
+  }
+
+  // Stopping early must not wait for (or leak) the chunks being read ahead.
+  {
+    hadesmem::ReadPipeline pipeline{process, ranges, chunk_size};
+    std::size_t num_chunks = 0;
+    pipeline.ForEach([&](hadesmem::ReadPipelineChunk const& /*chunk*/)
+                     {
+                       return ++num_chunks < 3;
+                     });
+    BOOST_TEST_EQ(num_chunks, 3UL);
+  }
+
+  // Unreadable chunks are reported rather than thrown.
+  {
+    LPVOID const reserved =
+      VirtualAlloc(nullptr, chunk_size, MEM_RESERVE, PAGE_NOACCESS);
+    BOOST_TEST(reserved != 0);
+    std::vector<hadesmem::ReadPipelineRange> const bad_ranges = {
+      {reserved, chunk_size}, {second.data(), second.size()}};
+    hadesmem::ReadPipeline pipeline{process, bad_ranges, chunk_size};
+    hadesmem::ReadPipelineChunk chunk{};
+    BOOST_TEST(pipeline.Next(chunk));
+    BOOST_TEST(chunk.data == nullptr);
+    BOOST_TEST(pipeline.Next(chunk));
+    BOOST_TEST(chunk.data != nullptr);
+    BOOST_TEST(!pipeline.Next(chunk));
+    BOOST_TEST(VirtualFree(reserved, 0, MEM_RELEASE) != FALSE);
+  }
+
+  hadesmem::ReadPipeline empty{process, {}};
+  BOOST_TEST_EQ(empty.GetNumChunks(), 0UL);
+  BOOST_TEST(empty.begin() == empty.end());
+}
+
+int main()
+{
+  TestReadPipeline();
+  return boost::report_errors();
+}
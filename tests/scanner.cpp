@@ -0,0 +1,141 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/scanner.hpp>
+#include <hadesmem/scanner.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/alloc.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/region.hpp>
+#include <hadesmem/write.hpp>
+
+void TestRegionFilter()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  hadesmem::Allocator const allocator{process, 0x1000};
+  hadesmem::Region const region{process, allocator.GetBase()};
+
+  BOOST_TEST(hadesmem::RegionFilter{}.Matches(region));
+  BOOST_TEST(
+    hadesmem::RegionFilter{hadesmem::RegionProtectFlags::kRead |
+                             hadesmem::RegionProtectFlags::kWrite |
+                             hadesmem::RegionProtectFlags::kExecute,
+                           hadesmem::RegionProtectFlags::kNone,
+                           hadesmem::RegionTypeFlags::kPrivate}
+      .Matches(region));
+  BOOST_TEST(!hadesmem::RegionFilter{hadesmem::RegionProtectFlags::kRead,
+                                     hadesmem::RegionProtectFlags::kExecute}
+                .Matches(region));
+  BOOST_TEST(!hadesmem::RegionFilter{hadesmem::RegionProtectFlags::kRead,
+                                     hadesmem::RegionProtectFlags::kNone,
+                                     hadesmem::RegionTypeFlags::kImage}
+                .Matches(region));
+  BOOST_TEST(!hadesmem::RegionFilter{hadesmem::RegionProtectFlags::kNone,
+                                     hadesmem::RegionProtectFlags::kNone,
+                                     hadesmem::RegionTypeFlags::kAll,
+                                     hadesmem::RegionStateFlags::kReserve}
+                .Matches(region));
+}
+
+void TestFindInRegions()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  // Put the marker across the boundary between two scan chunks, in memory
+  // which is executable (like JIT code or injected shellcode would be). The
+  // copies of the pattern made while scanning are never executable, so they
+  // can't produce false positives.
+  std::size_t const chunk_size = hadesmem::detail::kRegionScanChunkSize;
+  hadesmem::Allocator const allocator{process, chunk_size * 2};
+  std::vector<std::uint8_t> const marker = {0x3C, 0x71, 0xA9, 0x0E, 0xD2, 0x5B,
+                                            0x84, 0xF7, 0x16, 0x6D, 0xC3, 0x28};
+  auto const marker_address =
+    static_cast<std::uint8_t*>(allocator.GetBase()) + chunk_size - 5;
+  hadesmem::WriteVector(process, marker_address, marker);
+
+  hadesmem::RegionFilter const exec_filter{
+    hadesmem::RegionProtectFlags::kRead | hadesmem::RegionProtectFlags::kWrite |
+      hadesmem::RegionProtectFlags::kExecute,
+    hadesmem::RegionProtectFlags::kNone,
+    hadesmem::RegionTypeFlags::kPrivate};
+  std::wstring const pattern = L"3C 71 A9 0E D2 ?? 84 F7 16 6D C3 28";
+
+  BOOST_TEST_EQ(hadesmem::FindInRegions(
+                  process, pattern, exec_filter, hadesmem::PatternFlags::kNone),
+                static_cast<void*>(marker_address));
+  BOOST_TEST_EQ(hadesmem::FindInRegions(process,
+                                        pattern,
+                                        exec_filter,
+                                        hadesmem::PatternFlags::kParallel),
+                static_cast<void*>(marker_address));
+
+  auto const matches = hadesmem::FindAllInRegions(
+    process, pattern, exec_filter, hadesmem::PatternFlags::kNone);
+  BOOST_TEST_EQ(matches.size(), 1UL);
+  BOOST_TEST(std::find(std::begin(matches),
+                       std::end(matches),
+                       static_cast<void*>(marker_address)) !=
+             std::end(matches));
+  BOOST_TEST(hadesmem::FindAllInRegions(process,
+                                        pattern,
+                                        exec_filter,
+                                        hadesmem::PatternFlags::kParallel) ==
+             matches);
+
+  // Every other copy of the marker is in non-executable memory.
+  auto const all_matches = hadesmem::FindAllInRegions(
+    process, pattern, hadesmem::RegionFilter{}, hadesmem::PatternFlags::kNone);
+  BOOST_TEST(all_matches.size() >= 1);
+  BOOST_TEST(std::is_sorted(std::begin(all_matches), std::end(all_matches)));
+  auto const no_exec_matches = hadesmem::FindAllInRegions(
+    process,
+    pattern,
+    hadesmem::RegionFilter{hadesmem::RegionProtectFlags::kRead,
+                           hadesmem::RegionProtectFlags::kExecute},
+    hadesmem::PatternFlags::kNone);
+  BOOST_TEST(std::find(std::begin(no_exec_matches),
+                       std::end(no_exec_matches),
+                       static_cast<void*>(marker_address)) ==
+             std::end(no_exec_matches));
+
+  // A filter which can't match anything.
+  hadesmem::RegionFilter const empty_filter{
+    hadesmem::RegionProtectFlags::kWrite, hadesmem::RegionProtectFlags::kWrite};
+  BOOST_TEST_EQ(
+    hadesmem::FindInRegions(
+      process, pattern, empty_filter, hadesmem::PatternFlags::kNone),
+    static_cast<void*>(nullptr));
+  BOOST_TEST(hadesmem::FindAllInRegions(process,
+                                        pattern,
+                                        empty_filter,
+                                        hadesmem::PatternFlags::kNone)
+               .empty());
+  BOOST_TEST_THROWS(
+    hadesmem::FindInRegions(
+      process, pattern, empty_filter, hadesmem::PatternFlags::kThrowOnUnmatch),
+    hadesmem::Error);
+  BOOST_TEST_THROWS(
+    hadesmem::FindAllInRegions(
+      process, pattern, empty_filter, hadesmem::PatternFlags::kThrowOnUnmatch),
+    hadesmem::Error);
+}
+
+int main()
+{
+  TestRegionFilter();
+  TestFindInRegions();
+  return boost::report_errors();
+}
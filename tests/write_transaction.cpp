@@ -0,0 +1,215 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/write_transaction.hpp>
+#include <hadesmem/write_transaction.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/winapi.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/thread.hpp>
+#include <hadesmem/thread_helpers.hpp>
+
+namespace
+{
+DWORD GetProtect(void const* address)
+{
+  MEMORY_BASIC_INFORMATION mbi{};
+  BOOST_TEST(::VirtualQuery(address, &mbi, sizeof(mbi)) != 0);
+  return mbi.Protect;
+}
+
+// Page made read-only by LockPageOnWrite the first time the address in DR0 is
+// written to.
+void* g_page_to_lock = nullptr;
+
+LONG CALLBACK LockPageOnWrite(EXCEPTION_POINTERS* exception_pointers)
+{
+  auto const context = exception_pointers->ContextRecord;
+  if (exception_pointers->ExceptionRecord->ExceptionCode !=
+        EXCEPTION_SINGLE_STEP ||
+      !(context->Dr6 & 1))
+  {
+    return EXCEPTION_CONTINUE_SEARCH;
+  }
+
+  DWORD old_protect = 0;
+  BOOST_TEST(
+    ::VirtualProtect(g_page_to_lock, 0x1000, PAGE_READONLY, &old_protect));
+
+  // Clear DR0 so the breakpoint doesn't fire again when rolling back.
+  context->Dr0 = 0;
+  context->Dr6 = 0;
+  context->Dr7 &= ~static_cast<decltype(context->Dr7)>(1);
+
+  return EXCEPTION_CONTINUE_EXECUTION;
+}
+
+void SetWriteBreakpoint(void* address)
+{
+  hadesmem::Thread const thread(::GetCurrentThreadId());
+  auto context = hadesmem::GetThreadContext(thread, CONTEXT_DEBUG_REGISTERS);
+  context.Dr0 = reinterpret_cast<std::uintptr_t>(address);
+  context.Dr6 = 0;
+  // L0, with RW0 set to break on writes and LEN0 set to 4 bytes.
+  context.Dr7 = 1 | (1 << 16) | (3 << 18);
+  hadesmem::SetThreadContext(thread, context);
+}
+
+void ClearWriteBreakpoint()
+{
+  hadesmem::Thread const thread(::GetCurrentThreadId());
+  auto context = hadesmem::GetThreadContext(thread, CONTEXT_DEBUG_REGISTERS);
+  context.Dr0 = 0;
+  context.Dr6 = 0;
+  context.Dr7 = 0;
+  hadesmem::SetThreadContext(thread, context);
+}
+}
+
+void TestWriteTransaction()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  // Three committed pages with differing protections, followed by a page which
+  // is only reserved.
+  auto const base = static_cast<std::uint8_t*>(
+    VirtualAlloc(nullptr, 0x4000, MEM_RESERVE, PAGE_NOACCESS));
+  BOOST_TEST(base != nullptr);
+  BOOST_TEST(VirtualAlloc(base, 0x3000, MEM_COMMIT, PAGE_READWRITE) != 0);
+  for (std::size_t i = 0; i < 0x3000; ++i)
+  {
+    base[i] = static_cast<std::uint8_t>(i);
+  }
+  std::vector<std::uint8_t> const orig(base, base + 0x3000);
+  DWORD old_protect = 0;
+  BOOST_TEST(VirtualProtect(base, 0x2000, PAGE_READONLY, &old_protect));
+  BOOST_TEST(
+    VirtualProtect(base + 0x2000, 0x1000, PAGE_EXECUTE_READ, &old_protect));
+
+  {
+    hadesmem::WriteTransaction transaction{
+      process,
+      hadesmem::WriteTransactionFlags::kRollback |
+        hadesmem::WriteTransactionFlags::kSuspend};
+    std::uint32_t const value = 0xDEADBEEF;
+    transaction.Add(base + 0x10, value);
+    // Crosses the first page boundary.
+    std::vector<std::uint8_t> const bytes(0x20, 0xCC);
+    transaction.AddVector(base + 0xFF0, bytes);
+    // Overlaps the previous write, and so should replace part of it.
+    std::uint8_t const nop = 0x90;
+    transaction.Add(base + 0x1000, nop);
+    transaction.Add(base + 0x2800, value);
+    BOOST_TEST_EQ(transaction.GetNumWrites(), 4UL);
+
+    transaction.Commit();
+    BOOST_TEST(transaction.IsCommitted());
+
+    std::vector<std::uint8_t> expected(orig);
+    std::memcpy(&expected[0x10], &value, sizeof(value));
+    std::memcpy(&expected[0xFF0], bytes.data(), bytes.size());
+    expected[0x1000] = nop;
+    std::memcpy(&expected[0x2800], &value, sizeof(value));
+    BOOST_TEST(std::memcmp(base, expected.data(), expected.size()) == 0);
+    BOOST_TEST_EQ(GetProtect(base), static_cast<DWORD>(PAGE_READONLY));
+    BOOST_TEST_EQ(GetProtect(base + 0x1000), static_cast<DWORD>(PAGE_READONLY));
+    BOOST_TEST_EQ(GetProtect(base + 0x2000),
+                  static_cast<DWORD>(PAGE_EXECUTE_READ));
+
+    transaction.Rollback();
+    BOOST_TEST(!transaction.IsCommitted());
+    BOOST_TEST(std::memcmp(base, orig.data(), orig.size()) == 0);
+    BOOST_TEST_EQ(GetProtect(base), static_cast<DWORD>(PAGE_READONLY));
+  }
+
+  // A failure part way through leaves everything as it was.
+  {
+    hadesmem::WriteTransaction transaction{
+      process, hadesmem::WriteTransactionFlags::kRollback};
+    std::uint32_t const value = 0x12345678;
+    transaction.Add(base + 0x100, value);
+    transaction.Add(base + 0x3100, value);
+    BOOST_TEST_THROWS(transaction.Commit(), hadesmem::Error);
+    BOOST_TEST(!transaction.IsCommitted());
+    BOOST_TEST(std::memcmp(base, orig.data(), orig.size()) == 0);
+    BOOST_TEST_EQ(GetProtect(base), static_cast<DWORD>(PAGE_READONLY));
+  }
+
+  {
+    hadesmem::WriteTransaction transaction{process};
+    std::uint8_t const value = 0x42;
+    transaction.Add(base + 0x2000, value);
+    transaction.Commit();
+    BOOST_TEST_EQ(base[0x2000], value);
+    BOOST_TEST_THROWS(transaction.Rollback(), hadesmem::Error);
+
+    transaction.Clear();
+    BOOST_TEST_EQ(transaction.GetNumWrites(), 0UL);
+    transaction.Commit();
+  }
+
+  BOOST_TEST(VirtualFree(base, 0, MEM_RELEASE) != FALSE);
+}
+
+void TestWriteTransactionPartialFailure()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  // Two writable pages. The second is made read-only by a data breakpoint
+  // when the first is written, so that the failure happens after MakeWritable
+  // has succeeded and the first span has already been written.
+  auto const base = static_cast<std::uint8_t*>(
+    VirtualAlloc(nullptr, 0x2000, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+  BOOST_TEST(base != nullptr);
+  for (std::size_t i = 0; i < 0x2000; ++i)
+  {
+    base[i] = static_cast<std::uint8_t>(i);
+  }
+  std::vector<std::uint8_t> const orig(base, base + 0x2000);
+
+  g_page_to_lock = base + 0x1000;
+  auto const veh = ::AddVectoredExceptionHandler(1, &LockPageOnWrite);
+  BOOST_TEST(veh != nullptr);
+  SetWriteBreakpoint(base + 0x100);
+
+  {
+    hadesmem::WriteTransaction transaction{
+      process, hadesmem::WriteTransactionFlags::kRollback};
+    std::uint32_t const value = 0x12345678;
+    transaction.Add(base + 0x100, value);
+    std::vector<std::uint8_t> const bytes(0x10, 0xCC);
+    transaction.AddVector(base + 0x200, bytes);
+    transaction.Add(base + 0x1100, value);
+    BOOST_TEST_THROWS(transaction.Commit(), hadesmem::Error);
+    BOOST_TEST(!transaction.IsCommitted());
+  }
+
+  ClearWriteBreakpoint();
+  BOOST_TEST(::RemoveVectoredExceptionHandler(veh) != 0);
+
+  // The breakpoint must have fired, otherwise nothing was rolled back.
+  BOOST_TEST_EQ(GetProtect(base + 0x1000), static_cast<DWORD>(PAGE_READONLY));
+  // Both spans on the first page were written then restored, and the span on
+  // the second page was never written.
+  BOOST_TEST(std::memcmp(base, orig.data(), orig.size()) == 0);
+  BOOST_TEST_EQ(GetProtect(base), static_cast<DWORD>(PAGE_READWRITE));
+
+  BOOST_TEST(VirtualFree(base, 0, MEM_RELEASE) != FALSE);
+}
+
+int main()
+{
+  TestWriteTransaction();
+  TestWriteTransactionPartialFailure();
+  return boost::report_errors();
+}